@@ -61,6 +61,7 @@ int    cfs_curproc_is_in_groups(gid_t group);
 void   cfs_curproc_groups_dump(gid_t *array, int size);
 mode_t cfs_curproc_umask(void);
 char  *cfs_curproc_comm(void);
+int    cfs_curproc_getenv(const char *key, char *value, int size);
 
 
 /*
@@ -55,6 +55,11 @@ extern cfs_duration_t libcfs_console_max_delay;
 extern cfs_duration_t libcfs_console_min_delay;
 extern unsigned int libcfs_console_backoff;
 extern unsigned int libcfs_debug_binary;
+extern unsigned int libcfs_debug_deferred;
+extern unsigned int libcfs_debug_sample;
+extern unsigned int libcfs_debug_sample_mask;
+extern __u64 libcfs_debug_filter_nid;
+extern int libcfs_debug_filter_opc;
 extern char libcfs_debug_file_path_arr[PATH_MAX];
 
 int libcfs_debug_mask2str(char *str, int size, int mask, int is_subsys);
@@ -84,6 +89,7 @@ struct ptldebug_header {
 
 
 #define PH_FLAG_FIRST_RECORD 1
+#define PH_FLAG_DEFERRED     2 /* format ids and raw arguments, not text */
 
 /* Debugging subsystems (32 bits, non-overlapping) */
 /* keep these in sync with lnet/utils/debug.c and lnet/libcfs/debug.c */
@@ -183,11 +189,44 @@ static inline int cfs_cdebug_show(unsigned int mask, unsigned int subsystem)
                 ((libcfs_debug & mask) && (libcfs_subsystem_debug & subsystem));
 }
 
+#ifdef __KERNEL__
+/* must be a power of two */
+#define LIBCFS_DEBUG_SAMPLE_SLOTS       64
+extern unsigned int libcfs_debug_sample_cnt[LIBCFS_DEBUG_SAMPLE_SLOTS];
+
+/**
+ * Tells whether libcfs_debug_sample drops a message that passed the debug
+ * mask, before its arguments are evaluated.  Messages about an RPC or a
+ * lock pass its xid or cookie as \a id, so that all of them are kept or
+ * dropped together.  Others pass 0 and are counted per source \a line; the
+ * counters are not atomic, as sampling need not be exact.
+ */
+static inline int cfs_cdebug_sampled_out(unsigned int mask, int line, __u64 id)
+{
+        unsigned int n = libcfs_debug_sample;
+
+        if (likely(n <= 1) || (mask & libcfs_debug_sample_mask) == 0 ||
+            (mask & (D_CANTMASK | libcfs_printk)) != 0)
+                return 0;
+        if (id != 0)
+                return do_div(id, n) != 0;
+        return libcfs_debug_sample_cnt[line &
+                                       (LIBCFS_DEBUG_SAMPLE_SLOTS - 1)]++ %
+               n != 0;
+}
+#else
+static inline int cfs_cdebug_sampled_out(unsigned int mask, int line, __u64 id)
+{
+        return 0;
+}
+#endif
+
 #define __CDEBUG(cdls, mask, format, ...)                               \
 do {                                                                    \
         CFS_CHECK_STACK();                                              \
                                                                         \
-        if (cfs_cdebug_show(mask, DEBUG_SUBSYSTEM))                     \
+        if (cfs_cdebug_show(mask, DEBUG_SUBSYSTEM) &&                   \
+            !cfs_cdebug_sampled_out(mask, __LINE__, 0))                 \
                 libcfs_debug_msg(cdls, DEBUG_SUBSYSTEM, mask,           \
                                  __FILE__, __FUNCTION__, __LINE__,      \
                                  format, ## __VA_ARGS__);               \
@@ -207,6 +246,10 @@ static inline int cfs_cdebug_show(unsigned int mask, unsigned int subsystem)
 {
         return 0;
 }
+static inline int cfs_cdebug_sampled_out(unsigned int mask, int line, __u64 id)
+{
+        return 0;
+}
 #define CDEBUG(mask, format, ...) (void)(0)
 #define CDEBUG_LIMIT(mask, format, ...) (void)(0)
 #warning "CDEBUG IS DISABLED. THIS SHOULD NEVER BE DONE FOR PRODUCTION!"
@@ -329,6 +372,31 @@ extern int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls,
                               const char *format2, ...)
         __attribute__ ((format (printf, 9, 10)));
 
+/**
+ * Identifies the RPC or lock a message is about, for the nid/opcode trace
+ * filters.  Unknown fields match any filter.
+ */
+struct libcfs_debug_key {
+        __u64   dk_id;          /* xid or lock cookie */
+        __u64   dk_nid;         /* peer nid, LNET_NID_ANY if unknown */
+        int     dk_opc;         /* RPC opcode, -1 if unknown */
+};
+
+extern int libcfs_debug_msg_key(const struct libcfs_debug_key *key,
+                                cfs_debug_limit_state_t *cdls,
+                                int subsys, int mask, const char *file,
+                                const char *fn, const int line,
+                                const char *format, ...)
+        __attribute__ ((format (printf, 8, 9)));
+
+extern int libcfs_debug_vmsg2_key(const struct libcfs_debug_key *key,
+                                  cfs_debug_limit_state_t *cdls,
+                                  int subsys, int mask, const char *file,
+                                  const char *fn, const int line,
+                                  const char *format1, va_list args,
+                                  const char *format2, ...)
+        __attribute__ ((format (printf, 10, 11)));
+
 #define libcfs_debug_vmsg(cdls, subsys, mask, file, fn, line, format, args)   \
     libcfs_debug_vmsg2(cdls, subsys, mask, file, fn,line,format,args,NULL,NULL)
 
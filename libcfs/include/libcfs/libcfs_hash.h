@@ -214,6 +214,13 @@ enum cfs_hash_tag {
          * change on hash table is non-blocking
          */
         CFS_HASH_NBLK_CHANGE    = 1 << 13,
+        /**
+         * cfs_hash_lookup() doesn't take any lock, only changes and rehash
+         * do. Items must not be freed until an RCU grace period after they
+         * are removed, ops::hs_get_rcu is required and keys can't be
+         * changed by cfs_hash_rehash_key(). Kernel only.
+         */
+        CFS_HASH_RCU_LOOKUP     = 1 << 14,
         /** NB, we typed hs_flags as  __u16, please change it
          * if you need to extend >=16 flags */
 };
@@ -232,6 +239,8 @@ enum cfs_hash_tag {
  *      lookup, add(add_tail or add_head), delete
  *    . rehash
  *      grows or shrink
+ *    . lockless lookup
+ *      RCU protected buckets for read-mostly hash-tables
  *    . iteration
  *      locked iteration and unlocked iteration
  *    . bigname
@@ -243,8 +252,15 @@ enum cfs_hash_tag {
  * When the htable grows or shrinks, a separate task (cfs_hash_rehash_worker)
  * is spawned to handle the rehash in the background, it's possible that other
  * processes can concurrently perform additions, deletions, and lookups
- * without being blocked on rehash completion, because rehash will release
- * the global wrlock for each bucket.
+ * without being blocked on rehash completion.
+ *
+ * Rehash is incremental: the old and new bucket-tables stay readable side
+ * by side, and buckets are migrated in steps of about CFS_HASH_RH_STEP
+ * items, each step holding the global wrlock. The worker releases the lock
+ * between steps, and every addition or deletion also migrates a step
+ * (unless CFS_HASH_NBLK_CHANGE is set), so rehash progresses even while
+ * the worker is not scheduled. The longest step is reported as "maxpause"
+ * (microseconds) by cfs_hash_debug_str().
  *
  * rehash and iteration can't run at the same time because it's too tricky
  * to keep both of them safe and correct.
@@ -252,13 +268,21 @@ enum cfs_hash_tag {
  *   . if iteration is in progress while we try to launch rehash, then
  *     it just giveup, iterator will launch rehash at the end.
  *   . if rehash is in progress while we try to iterate the hash table,
- *     then we just wait (shouldn't be very long time), anyway, nobody
- *     should expect iteration of whole hash-table to be non-blocking.
+ *     migration is paused until the last iterator leaves. Iteration walks
+ *     the larger bucket-table, which contains all buckets of both tables.
  *
  * During rehashing, a (key,object) pair may be in one of two buckets,
- * depending on whether the worker task has yet to transfer the object
- * to its new location in the table. Lookups and deletions need to search both
+ * depending on whether the rehash has yet to transfer the object to its
+ * new location in the table. Lookups and deletions need to search both
  * locations; additions must take care to only insert into the new bucket.
+ *
+ * Lockless lookup:
+ * With CFS_HASH_RCU_LOOKUP, cfs_hash_lookup() walks the hlist under
+ * rcu_read_lock() only. Items can move to another hlist (rehash) or be
+ * removed while they are being walked, so a lockless miss is not trusted
+ * and the lookup is retried with locks; a hit is always right because the
+ * key is compared and the refcount is taken by ops::hs_get_rcu. The old
+ * bucket-table is freed only after a grace period once rehash is done.
  */
 
 typedef struct cfs_hash {
@@ -301,12 +325,18 @@ typedef struct cfs_hash {
         __u32                       hs_rehash_count;
         /** # of iterators (caller of cfs_hash_for_each_*) */
         __u32                       hs_iterators;
+        /** next bucket of hs_buckets to migrate while rehashing */
+        __u32                       hs_rehash_next;
+        /** longest step of rehash holding hs_lock, in microseconds */
+        __u32                       hs_rehash_max_pause;
         /** rehash workitem */
         cfs_workitem_t              hs_rehash_wi;
         /** refcount on this hash table */
         cfs_atomic_t                hs_refcount;
         /** rehash buckets-table */
         cfs_hash_bucket_t         **hs_rehash_buckets;
+        /** odd while hs_buckets and hs_cur_bits are being changed */
+        unsigned int                hs_buckets_seq;
 #if CFS_HASH_DEBUG_LEVEL >= CFS_HASH_DEBUG_1
         /** serialize debug members */
         cfs_spinlock_t              hs_dep_lock;
@@ -362,6 +392,9 @@ typedef struct cfs_hash_ops {
         void *   (*hs_object)(cfs_hlist_node_t *hnode);
         /** get refcount of item, always called with holding bucket-lock */
         void     (*hs_get)(cfs_hash_t *hs, cfs_hlist_node_t *hnode);
+        /** get refcount of item found by lockless lookup, return 0 if the
+         * item is being destroyed, only for CFS_HASH_RCU_LOOKUP */
+        int      (*hs_get_rcu)(cfs_hash_t *hs, cfs_hlist_node_t *hnode);
         /** release refcount of item */
         void     (*hs_put)(cfs_hash_t *hs, cfs_hlist_node_t *hnode);
         /** release refcount of item, always called with holding bucket-lock */
@@ -478,6 +511,12 @@ cfs_hash_with_nblk_change(cfs_hash_t *hs)
         return (hs->hs_flags & CFS_HASH_NBLK_CHANGE) != 0;
 }
 
+static inline int
+cfs_hash_with_rcu_lookup(cfs_hash_t *hs)
+{
+        return (hs->hs_flags & CFS_HASH_RCU_LOOKUP) != 0;
+}
+
 static inline int
 cfs_hash_is_exiting(cfs_hash_t *hs)
 {       /* cfs_hash_destroy is called */
@@ -744,6 +783,8 @@ void *cfs_hash_del_key(cfs_hash_t *hs, const void *key);
 
 /* Hash lookup/for_each functions */
 #define CFS_HASH_LOOP_HOG       1024
+/** # of items migrated by each step of rehash */
+#define CFS_HASH_RH_STEP        64
 
 typedef int (*cfs_hash_for_each_cb_t)(cfs_hash_t *hs, cfs_hash_bd_t *bd,
                                       cfs_hlist_node_t *node, void *data);
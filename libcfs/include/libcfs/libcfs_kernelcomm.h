@@ -91,6 +91,7 @@ typedef int (*libcfs_kkuc_cb_t)(__u32 data, void *cb_arg);
 
 /* Kernel methods */
 extern int libcfs_kkuc_msg_put(cfs_file_t *fp, void *payload);
+extern int libcfs_kkuc_msgs_put(cfs_file_t *fp, void *payload, int len);
 extern int libcfs_kkuc_group_put(int group, void *payload);
 extern int libcfs_kkuc_group_add(cfs_file_t *fp, int uid, int group,
                                  __u32 data);
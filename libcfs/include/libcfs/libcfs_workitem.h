@@ -42,8 +42,10 @@
  * - a workitem always runs in thread context.
  * - a workitem can be concurrent with other workitems but is strictly
  *   serialized with respect to itself.
- * - no CPU affinity, a workitem does not necessarily run on the same CPU
- *   that schedules it. However, this might change in the future.
+ * - a workitem runs on the CPUs of one CPU partition: the one given as
+ *   scheduler id (e.g. cfs_cpt_current() to stay close to the caller), or
+ *   a partition picked by address of the workitem for CFS_WI_SCHED_ANY.
+ *   It does not necessarily run on the same CPU that schedules it.
  * - if a workitem is scheduled again before it has a chance to run, it
  *   runs only once.
  * - if a workitem is scheduled while it runs, it runs again after it
@@ -83,8 +85,8 @@ typedef struct cfs_workitem {
 } cfs_workitem_t;
 
 /**
- * positive values are reserved as CPU id of future implementation of
- * per-cpu scheduler, so user can "bind" workitem on specific CPU.
+ * non-negative values are CPU partition id, so user can "bind" workitem
+ * on CPUs of a partition, see cfs_cpt_number() and cfs_cpt_current().
  */
 #define CFS_WI_SCHED_ANY        (-1)
 #define CFS_WI_SCHED_SERIAL     (-2)
@@ -107,6 +109,14 @@ int  cfs_wi_cancel(cfs_workitem_t *wi);
 void cfs_wi_schedule(cfs_workitem_t *wi);
 int  cfs_wi_startup(void);
 void cfs_wi_shutdown(void);
+int  cfs_wi_stats_print(char *buf, int size);
+
+/** # of CPU partitions, each of them has its own workitem scheduler */
+int  cfs_cpt_number(void);
+/** CPU partition of @cpu */
+int  cfs_cpt_of_cpu(int cpu);
+/** CPU partition of the current CPU */
+int  cfs_cpt_current(void);
 
 #ifdef __KERNEL__
 /** # workitem scheduler loops before reschedule */
@@ -61,6 +61,7 @@
 #include <linux/timer.h>
 #include <linux/signal.h>
 #include <linux/sched.h>
+#include <linux/nodemask.h>
 #include <linux/kthread.h>
 #ifdef HAVE_LINUX_RANDOM_H
 #include <linux/random.h>
@@ -97,6 +98,13 @@
 #endif
 
 #define cfs_set_cpus_allowed(t, mask)  set_cpus_allowed(t, mask)
+
+/*
+ * NUMA
+ */
+#define cfs_num_online_nodes()          num_online_nodes()
+#define cfs_for_each_online_node(node)  for_each_online_node(node)
+#define cfs_cpu_to_node(cpu)            cpu_to_node(cpu)
 /*
  * cache
  */
@@ -62,6 +62,8 @@ typedef struct hlist_node cfs_hlist_node_t;
 #define cfs_hlist_add_head(n, next)        hlist_add_head(n, next)
 #define cfs_hlist_add_before(n, next)      hlist_add_before(n, next)
 #define cfs_hlist_add_after(n, next)       hlist_add_after(n, next)
+#define cfs_hlist_add_head_rcu(n, h)       hlist_add_head_rcu(n, h)
+#define cfs_hlist_add_after_rcu(n, next)   hlist_add_after_rcu(n, next)
 
 #define cfs_hlist_entry(ptr, type, member) hlist_entry(ptr, type, member)
 #define cfs_hlist_for_each(pos, head)      hlist_for_each(pos, head)
@@ -434,6 +436,10 @@ static inline void cfs_hlist_add_after(cfs_hlist_node_t *n,
 		next->next->pprev  = &next->next;
 }
 
+/* no lockless readers in userspace */
+#define cfs_hlist_add_head_rcu(n, h)       cfs_hlist_add_head(n, h)
+#define cfs_hlist_add_after_rcu(n, next)   cfs_hlist_add_after(n, next)
+
 #define cfs_hlist_entry(ptr, type, member) container_of(ptr,type,member)
 
 #define cfs_hlist_for_each(pos, head) \
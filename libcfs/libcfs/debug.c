@@ -93,6 +93,35 @@ EXPORT_SYMBOL(libcfs_console_backoff);
 unsigned int libcfs_debug_binary = 1;
 EXPORT_SYMBOL(libcfs_debug_binary);
 
+unsigned int libcfs_debug_deferred;
+CFS_MODULE_PARM(libcfs_debug_deferred, "i", uint, 0644,
+                "Format debug messages when dumped rather than when logged");
+EXPORT_SYMBOL(libcfs_debug_deferred);
+
+unsigned int libcfs_debug_sample;
+CFS_MODULE_PARM(libcfs_debug_sample, "i", uint, 0644,
+                "Only trace one in this many messages of libcfs_debug_sample_mask");
+EXPORT_SYMBOL(libcfs_debug_sample);
+
+unsigned int libcfs_debug_sample_mask = D_RPCTRACE | D_DLMTRACE | D_TRACE |
+                                        D_INFO;
+CFS_MODULE_PARM(libcfs_debug_sample_mask, "i", uint, 0644,
+                "Debug message types subject to libcfs_debug_sample");
+EXPORT_SYMBOL(libcfs_debug_sample_mask);
+
+/* per source line counters for libcfs_debug_sample */
+unsigned int libcfs_debug_sample_cnt[LIBCFS_DEBUG_SAMPLE_SLOTS];
+EXPORT_SYMBOL(libcfs_debug_sample_cnt);
+
+/* only trace RPCs and locks of this peer/opcode, set via sysctl */
+__u64 libcfs_debug_filter_nid = LNET_NID_ANY;
+EXPORT_SYMBOL(libcfs_debug_filter_nid);
+
+int libcfs_debug_filter_opc = -1;
+CFS_MODULE_PARM(libcfs_debug_filter_opc, "i", int, 0644,
+                "Only trace RPCs and locks with this opcode (-1 for all)");
+EXPORT_SYMBOL(libcfs_debug_filter_opc);
+
 unsigned int libcfs_stack;
 EXPORT_SYMBOL(libcfs_stack);
 
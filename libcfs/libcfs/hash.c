@@ -115,6 +115,12 @@ CFS_MODULE_PARM(warn_on_depth, "i", uint, 0644,
                 "warning when hash depth is high.");
 #endif
 
+#ifdef __KERNEL__
+# define cfs_hash_wmb()         smp_wmb()
+#else /* liblustre is single-threaded */
+# define cfs_hash_wmb()         do {} while (0)
+#endif
+
 static inline void
 cfs_hash_nl_lock(cfs_hash_lock_t *lock, int exclusive) {}
 
@@ -234,6 +240,11 @@ cfs_hash_lock_setup(cfs_hash_t *hs)
         }
 }
 
+/*
+ * All hash heads link new items by cfs_hlist_add_*_rcu(), so lockless
+ * readers (CFS_HASH_RCU_LOOKUP) never see a half-linked node.
+ */
+
 /**
  * Simple hash head without depth tracking
  * new element is always added to head of hlist
@@ -260,7 +271,7 @@ static int
 cfs_hash_hh_hnode_add(cfs_hash_t *hs, cfs_hash_bd_t *bd,
                       cfs_hlist_node_t *hnode)
 {
-        cfs_hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
+        cfs_hlist_add_head_rcu(hnode, cfs_hash_hh_hhead(hs, bd));
         return -1; /* unknown depth */
 }
 
@@ -302,7 +313,7 @@ cfs_hash_hd_hnode_add(cfs_hash_t *hs, cfs_hash_bd_t *bd,
 {
         cfs_hash_head_dep_t *hh = container_of(cfs_hash_hd_hhead(hs, bd),
                                                cfs_hash_head_dep_t, hd_head);
-        cfs_hlist_add_head(hnode, &hh->hd_head);
+        cfs_hlist_add_head_rcu(hnode, &hh->hd_head);
         return ++hh->hd_depth;
 }
 
@@ -348,9 +359,9 @@ cfs_hash_dh_hnode_add(cfs_hash_t *hs, cfs_hash_bd_t *bd,
                                             cfs_hash_dhead_t, dh_head);
 
         if (dh->dh_tail != NULL) /* not empty */
-                cfs_hlist_add_after(dh->dh_tail, hnode);
+                cfs_hlist_add_after_rcu(dh->dh_tail, hnode);
         else /* empty list */
-                cfs_hlist_add_head(hnode, &dh->dh_head);
+                cfs_hlist_add_head_rcu(hnode, &dh->dh_head);
         dh->dh_tail = hnode;
         return -1; /* unknown depth */
 }
@@ -403,9 +414,9 @@ cfs_hash_dd_hnode_add(cfs_hash_t *hs, cfs_hash_bd_t *bd,
                                                 cfs_hash_dhead_dep_t, dd_head);
 
         if (dh->dd_tail != NULL) /* not empty */
-                cfs_hlist_add_after(dh->dd_tail, hnode);
+                cfs_hlist_add_after_rcu(dh->dd_tail, hnode);
         else /* empty list */
-                cfs_hlist_add_head(hnode, &dh->dd_head);
+                cfs_hlist_add_head_rcu(hnode, &dh->dd_head);
         dh->dd_tail = hnode;
         return ++dh->dd_depth;
 }
@@ -872,6 +883,34 @@ cfs_hash_dual_bd_finddel_locked(cfs_hash_t *hs, cfs_hash_bd_t *bds,
 }
 CFS_EXPORT_SYMBOL(cfs_hash_dual_bd_finddel_locked);
 
+/*
+ * The larger bucket-table contains all buckets of the smaller one while
+ * rehashing, so it covers every item in either table.
+ */
+static cfs_hash_bucket_t **
+cfs_hash_full_bkts(cfs_hash_t *hs)
+{
+        /* NB: caller should hold hs->hs_rwlock if REHASH is set */
+        if (hs->hs_rehash_buckets == NULL)
+                return hs->hs_buckets;
+
+        LASSERT(hs->hs_rehash_bits != 0);
+        return hs->hs_rehash_bits > hs->hs_cur_bits ?
+               hs->hs_rehash_buckets : hs->hs_buckets;
+}
+
+static unsigned int
+cfs_hash_full_nbkt(cfs_hash_t *hs)
+{
+        /* NB: caller should hold hs->hs_rwlock if REHASH is set */
+        if (hs->hs_rehash_buckets == NULL)
+                return CFS_HASH_NBKT(hs);
+
+        LASSERT(hs->hs_rehash_bits != 0);
+        return hs->hs_rehash_bits > hs->hs_cur_bits ?
+               CFS_HASH_RH_NBKT(hs) : CFS_HASH_NBKT(hs);
+}
+
 static void
 cfs_hash_buckets_free(cfs_hash_bucket_t **buckets,
                       int bkt_size, int prev_size, int size)
@@ -954,6 +993,7 @@ cfs_hash_buckets_realloc(cfs_hash_t *hs, cfs_hash_bucket_t **old_bkts,
  *           - CFS_HASH_SORT enable chained hash sort
  */
 static int cfs_hash_rehash_worker(cfs_workitem_t *wi);
+static void cfs_hash_rehash_help(cfs_hash_t *hs);
 
 #if CFS_HASH_DEBUG_LEVEL >= CFS_HASH_DEBUG_1
 static int cfs_hash_dep_print(cfs_workitem_t *wi)
@@ -1040,6 +1080,12 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
                      (flags & CFS_HASH_NO_LOCK) == 0));
         LASSERT(ergo((flags & CFS_HASH_REHASH_KEY) != 0,
                       ops->hs_keycpy != NULL));
+        LASSERT(ergo((flags & CFS_HASH_RCU_LOOKUP) != 0,
+                     ops->hs_get_rcu != NULL &&
+                     (flags & (CFS_HASH_NO_LOCK | CFS_HASH_REHASH_KEY)) == 0));
+#ifndef __KERNEL__
+        flags &= ~CFS_HASH_RCU_LOOKUP;
+#endif
 
         len = (flags & CFS_HASH_BIGNAME) == 0 ?
               CFS_HASH_NAME_LEN : CFS_HASH_BIGNAME_LEN;
@@ -1230,6 +1276,8 @@ cfs_hash_add(cfs_hash_t *hs, const void *key, cfs_hlist_node_t *hnode)
         cfs_hash_unlock(hs, 0);
         if (bits > 0)
                 cfs_hash_rehash(hs, cfs_hash_rehash_inline(hs));
+        else if (bits == -EALREADY)
+                cfs_hash_rehash_help(hs);
 }
 CFS_EXPORT_SYMBOL(cfs_hash_add);
 
@@ -1256,6 +1304,8 @@ cfs_hash_find_or_add(cfs_hash_t *hs, const void *key,
         cfs_hash_unlock(hs, 0);
         if (bits > 0)
                 cfs_hash_rehash(hs, cfs_hash_rehash_inline(hs));
+        else if (bits == -EALREADY)
+                cfs_hash_rehash_help(hs);
 
         return ehnode;
 }
@@ -1320,6 +1370,8 @@ cfs_hash_del(cfs_hash_t *hs, const void *key, cfs_hlist_node_t *hnode)
         cfs_hash_unlock(hs, 0);
         if (bits > 0)
                 cfs_hash_rehash(hs, cfs_hash_rehash_inline(hs));
+        else if (bits == -EALREADY)
+                cfs_hash_rehash_help(hs);
 
         return obj;
 }
@@ -1338,6 +1390,59 @@ cfs_hash_del_key(cfs_hash_t *hs, const void *key)
 }
 CFS_EXPORT_SYMBOL(cfs_hash_del_key);
 
+/**
+ * Find @key in @hs without taking the hash or bucket locks, and get a
+ * refcount on the item found by ops->hs_get_rcu().  NULL is returned if
+ * the item is not found, is being destroyed, or if the bucket-table is
+ * changing, in which case the caller retries with locks.
+ */
+static cfs_hlist_node_t *
+cfs_hash_lookup_rcu(cfs_hash_t *hs, const void *key)
+{
+#ifdef __KERNEL__
+        cfs_hash_bucket_t **bkts;
+        cfs_hlist_head_t   *hhead;
+        cfs_hlist_node_t   *hnode = NULL;
+        cfs_hash_bd_t       bd;
+        unsigned int        seq;
+        unsigned int        bits;
+        unsigned int        index;
+
+        rcu_read_lock();
+
+        seq = hs->hs_buckets_seq;
+        smp_rmb();
+        bkts = rcu_dereference(hs->hs_buckets);
+        bits = hs->hs_cur_bits;
+        /* items can be in either bucket-table while rehashing */
+        if (hs->hs_rehash_buckets != NULL)
+                goto out;
+        smp_rmb();
+        if ((seq & 1) != 0 || seq != hs->hs_buckets_seq)
+                goto out;
+
+        index = cfs_hash_id(hs, key, (1U << bits) - 1);
+        bd.bd_bucket = bkts[index & ((1U << (bits - hs->hs_bkt_bits)) - 1)];
+        bd.bd_offset = index >> (bits - hs->hs_bkt_bits);
+        hhead = cfs_hash_bd_hhead(hs, &bd);
+
+        for (hnode = rcu_dereference(hhead->first); hnode != NULL;
+             hnode = rcu_dereference(hnode->next)) {
+                if (!cfs_hash_keycmp(hs, key, hnode))
+                        continue;
+
+                if (!CFS_HOP(hs, get_rcu)(hs, hnode))
+                        hnode = NULL; /* dying, let the locked lookup decide */
+                break;
+        }
+ out:
+        rcu_read_unlock();
+        return hnode;
+#else
+        return NULL;
+#endif
+}
+
 /**
  * Lookup an item using @key in the libcfs hash @hs and return it.
  * If the @key is found in the hash hs->hs_get() is called and the
@@ -1353,6 +1458,13 @@ cfs_hash_lookup(cfs_hash_t *hs, const void *key)
         cfs_hlist_node_t     *hnode;
         cfs_hash_bd_t         bds[2];
 
+        if (cfs_hash_with_rcu_lookup(hs)) {
+                hnode = cfs_hash_lookup_rcu(hs, key);
+                if (hnode != NULL)
+                        return cfs_hash_object(hs, hnode);
+                /* not found, or moved under us: retry with locks */
+        }
+
         cfs_hash_lock(hs, 0);
         cfs_hash_dual_bd_get_and_lock(hs, key, bds, 0);
 
@@ -1381,15 +1493,11 @@ cfs_hash_for_each_enter(cfs_hash_t *hs)
          */
         hs->hs_iterating = 1;
 
+        /* NB: iteration is mostly called by service thread, so we
+         * don't wait for rehash in progress, migration of buckets is
+         * paused by hs_iterators and resumed after iteration */
         cfs_hash_lock(hs, 1);
         hs->hs_iterators++;
-
-        /* NB: iteration is mostly called by service thread,
-         * we tend to cancel pending rehash-requst, instead of
-         * blocking service thread, we will relaunch rehash request
-         * after iteration */
-        if (cfs_hash_is_rehashing(hs))
-                cfs_hash_rehash_cancel_locked(hs);
         cfs_hash_unlock(hs, 1);
 }
 
@@ -1404,6 +1512,9 @@ cfs_hash_for_each_exit(cfs_hash_t *hs)
         cfs_hash_lock(hs, 1);
         remained = --hs->hs_iterators;
         bits = cfs_hash_rehash_bits(hs);
+        /* resume migration paused by iteration */
+        if (remained == 0 && hs->hs_rehash_buckets != NULL)
+                cfs_wi_schedule(&hs->hs_rehash_wi);
         cfs_hash_unlock(hs, 1);
         /* NB: it's race on cfs_has_t::hs_iterating, see above */
         if (remained == 0)
@@ -1440,11 +1551,10 @@ cfs_hash_for_each_tight(cfs_hash_t *hs, cfs_hash_for_each_cb_t func,
         cfs_hash_for_each_enter(hs);
 
         cfs_hash_lock(hs, 0);
-        LASSERT(!cfs_hash_is_rehashing(hs));
-
-        cfs_hash_for_each_bucket(hs, &bd, i) {
+        for (i = 0; i < cfs_hash_full_nbkt(hs); i++) {
                 cfs_hlist_head_t *hhead;
 
+                bd.bd_bucket = cfs_hash_full_bkts(hs)[i];
                 cfs_hash_bd_lock(hs, &bd, excl);
                 if (func == NULL) { /* only glimpse size */
                         count += bd.bd_bucket->hsb_count;
@@ -1586,11 +1696,10 @@ cfs_hash_for_each_relax(cfs_hash_t *hs, cfs_hash_for_each_cb_t func, void *data)
                          !cfs_hash_with_no_itemref(hs) ||
                          CFS_HOP(hs, put_locked) == NULL;
         cfs_hash_lock(hs, 0);
-        LASSERT(!cfs_hash_is_rehashing(hs));
-
-        cfs_hash_for_each_bucket(hs, &bd, i) {
+        for (i = 0; i < cfs_hash_full_nbkt(hs); i++) {
                 cfs_hlist_head_t *hhead;
 
+                bd.bd_bucket = cfs_hash_full_bkts(hs)[i];
                 cfs_hash_bd_lock(hs, &bd, 0);
                 version = cfs_hash_bd_version_get(&bd);
 
@@ -1756,6 +1865,142 @@ cfs_hash_for_each_key(cfs_hash_t *hs, const void *key,
 }
 CFS_EXPORT_SYMBOL(cfs_hash_for_each_key);
 
+static int
+cfs_hash_rehash_bd(cfs_hash_t *hs, cfs_hash_bd_t *old)
+{
+        cfs_hash_bd_t      new;
+        cfs_hlist_head_t  *hhead;
+        cfs_hlist_node_t  *hnode;
+        cfs_hlist_node_t  *pos;
+        void              *key;
+        int                c = 0;
+
+        /* hold cfs_hash_lock(hs, 1), so don't need any bucket lock */
+        cfs_hash_bd_for_each_hlist(hs, old, hhead) {
+                cfs_hlist_for_each_safe(hnode, pos, hhead) {
+                        key = cfs_hash_key(hs, hnode);
+                        LASSERT(key != NULL);
+                        /* Validate hnode is in the correct bucket. */
+                        cfs_hash_bucket_validate(hs, old, hnode);
+                        /*
+                         * Delete from old hash bucket; move to new bucket.
+                         * ops->hs_key must be defined.
+                         */
+                        cfs_hash_bd_from_key(hs, hs->hs_rehash_buckets,
+                                             hs->hs_rehash_bits, key, &new);
+                        cfs_hash_bd_move_locked(hs, old, &new, hnode);
+                        c++;
+                }
+        }
+
+        return c;
+}
+
+/*
+ * Migrate buckets of hs_buckets to hs_rehash_buckets until about @nitems
+ * items are moved, hold cfs_hash_lock(hs, 1).
+ *
+ * \retval 1 if all buckets are migrated
+ */
+static int
+cfs_hash_rehash_step(cfs_hash_t *hs, int nitems)
+{
+        struct timeval  start;
+        struct timeval  end;
+        cfs_hash_bd_t   bd;
+        long            pause;
+        int             count = 0;
+
+        LASSERT(hs->hs_rehash_buckets != NULL);
+
+        cfs_gettimeofday(&start);
+        while (count < nitems && hs->hs_rehash_next < CFS_HASH_NBKT(hs)) {
+                bd.bd_bucket = hs->hs_buckets[hs->hs_rehash_next++];
+                count += cfs_hash_rehash_bd(hs, &bd);
+        }
+        cfs_gettimeofday(&end);
+
+        pause = cfs_timeval_sub(&end, &start, NULL);
+        if (pause > (long)hs->hs_rehash_max_pause)
+                hs->hs_rehash_max_pause = pause;
+
+        return hs->hs_rehash_next == CFS_HASH_NBKT(hs);
+}
+
+/*
+ * Switch to hs_rehash_buckets, hold cfs_hash_lock(hs, 1).  The old
+ * bucket-table is returned, it has @nbkt buckets and the first @keep
+ * of them are shared with the new bucket-table.
+ */
+static cfs_hash_bucket_t **
+cfs_hash_rehash_switch(cfs_hash_t *hs, unsigned int *keep, unsigned int *nbkt)
+{
+        cfs_hash_bucket_t **bkts = hs->hs_buckets;
+
+        *nbkt = CFS_HASH_NBKT(hs);
+        *keep = min(CFS_HASH_NBKT(hs), CFS_HASH_RH_NBKT(hs));
+
+        /* lockless readers must see hs_buckets and hs_cur_bits together */
+        hs->hs_buckets_seq++;
+        cfs_hash_wmb();
+        hs->hs_buckets = hs->hs_rehash_buckets;
+        hs->hs_rehash_buckets = NULL;
+
+        hs->hs_cur_bits = hs->hs_rehash_bits;
+        cfs_hash_wmb();
+        hs->hs_buckets_seq++;
+
+        hs->hs_rehash_bits = 0;
+        return bkts;
+}
+
+/*
+ * Abort migration because @hs is dying.  Keep the bucket-table which
+ * contains all buckets, cfs_hash_destroy() removes items wherever they
+ * are.  The dropped bucket-table is returned like cfs_hash_rehash_switch().
+ */
+static cfs_hash_bucket_t **
+cfs_hash_rehash_abort(cfs_hash_t *hs, unsigned int *keep, unsigned int *nbkt)
+{
+        cfs_hash_bucket_t **bkts = hs->hs_rehash_buckets;
+
+        LASSERT(cfs_hash_is_exiting(hs));
+
+        if (hs->hs_rehash_bits > hs->hs_cur_bits) /* growing */
+                return cfs_hash_rehash_switch(hs, keep, nbkt);
+
+        *nbkt = CFS_HASH_RH_NBKT(hs);
+        *keep = *nbkt;
+        hs->hs_rehash_buckets = NULL;
+        hs->hs_rehash_bits = 0;
+        return bkts;
+}
+
+/*
+ * Release cfs_hash_lock(hs, 1) and free bucket-table @bkts dropped by
+ * rehash, except its first @keep buckets which are still in use.
+ */
+static void
+cfs_hash_rehash_unlock_free(cfs_hash_t *hs, cfs_hash_bucket_t **bkts,
+                            unsigned int keep, unsigned int nbkt)
+{
+        int     bsize = cfs_hash_bkt_size(hs);
+#ifdef __KERNEL__
+        int     rcu   = cfs_hash_with_rcu_lookup(hs);
+#endif
+
+        cfs_hash_unlock(hs, 1);
+        /* can't refer to @hs anymore because it could be destroyed */
+        if (bkts == NULL)
+                return;
+#ifdef __KERNEL__
+        /* lockless readers may still walk the old table */
+        if (rcu)
+                synchronize_rcu();
+#endif
+        cfs_hash_buckets_free(bkts, bsize, keep, nbkt);
+}
+
 /**
  * Rehash the libcfs hash @hs to the given @bits.  This can be used
  * to grow the hash size when excessive chaining is detected, or to
@@ -1770,7 +2015,10 @@ CFS_EXPORT_SYMBOL(cfs_hash_for_each_key);
 void
 cfs_hash_rehash_cancel_locked(cfs_hash_t *hs)
 {
-        int     i;
+        cfs_hash_bucket_t **bkts;
+        unsigned int        keep = 0;
+        unsigned int        nbkt = 0;
+        int                 i;
 
         /* need hold cfs_hash_lock(hs, 1) */
         LASSERT(cfs_hash_with_rehash(hs) &&
@@ -1780,6 +2028,20 @@ cfs_hash_rehash_cancel_locked(cfs_hash_t *hs)
                 return;
 
         if (cfs_wi_cancel(&hs->hs_rehash_wi)) {
+                /* migration can't be dropped once it's started,
+                 * finish it (or abort it for dying hash) */
+                while (hs->hs_rehash_buckets != NULL) {
+                        bkts = NULL;
+                        if (cfs_hash_is_exiting(hs)) {
+                                bkts = cfs_hash_rehash_abort(hs, &keep, &nbkt);
+                        } else if (cfs_hash_rehash_step(hs, CFS_HASH_RH_STEP)) {
+                                hs->hs_rehash_count++;
+                                bkts = cfs_hash_rehash_switch(hs, &keep, &nbkt);
+                        }
+                        cfs_hash_rehash_unlock_free(hs, bkts, keep, nbkt);
+                        cfs_cond_resched();
+                        cfs_hash_lock(hs, 1);
+                }
                 hs->hs_rehash_bits = 0;
                 return;
         }
@@ -1835,54 +2097,44 @@ cfs_hash_rehash(cfs_hash_t *hs, int do_rehash)
 }
 CFS_EXPORT_SYMBOL(cfs_hash_rehash);
 
-static int
-cfs_hash_rehash_bd(cfs_hash_t *hs, cfs_hash_bd_t *old)
+/*
+ * Changes on hash-table migrate a step of buckets while rehashing, so
+ * rehash can finish even if the worker can't run for a while.  Switching
+ * to the new bucket-table is always left to the worker, because freeing
+ * the old one may have to wait for lockless readers.
+ */
+static void
+cfs_hash_rehash_help(cfs_hash_t *hs)
 {
-        cfs_hash_bd_t      new;
-        cfs_hlist_head_t  *hhead;
-        cfs_hlist_node_t  *hnode;
-        cfs_hlist_node_t  *pos;
-        void              *key;
-        int                c = 0;
-
-        /* hold cfs_hash_lock(hs, 1), so don't need any bucket lock */
-        cfs_hash_bd_for_each_hlist(hs, old, hhead) {
-                cfs_hlist_for_each_safe(hnode, pos, hhead) {
-                        key = cfs_hash_key(hs, hnode);
-                        LASSERT(key != NULL);
-                        /* Validate hnode is in the correct bucket. */
-                        cfs_hash_bucket_validate(hs, old, hnode);
-                        /*
-                         * Delete from old hash bucket; move to new bucket.
-                         * ops->hs_key must be defined.
-                         */
-                        cfs_hash_bd_from_key(hs, hs->hs_rehash_buckets,
-                                             hs->hs_rehash_bits, key, &new);
-                        cfs_hash_bd_move_locked(hs, old, &new, hnode);
-                        c++;
-                }
-        }
+        if (cfs_hash_with_nblk_change(hs))
+                return;
 
-        return c;
+        cfs_hash_lock(hs, 1);
+        if (hs->hs_rehash_buckets != NULL && hs->hs_iterators == 0 &&
+            !cfs_hash_is_exiting(hs))
+                cfs_hash_rehash_step(hs, CFS_HASH_RH_STEP);
+        cfs_hash_unlock(hs, 1);
 }
 
 static int
 cfs_hash_rehash_worker(cfs_workitem_t *wi)
 {
         cfs_hash_t         *hs = container_of(wi, cfs_hash_t, hs_rehash_wi);
-        cfs_hash_bucket_t **bkts;
-        cfs_hash_bd_t       bd;
+        cfs_hash_bucket_t **bkts = NULL;
         unsigned int        old_size;
         unsigned int        new_size;
-        int                 bsize;
-        int                 count = 0;
+        unsigned int        keep = 0;
+        unsigned int        nbkt = 0;
         int                 rc = 0;
-        int                 i;
 
         LASSERT (hs != NULL && cfs_hash_with_rehash(hs));
 
         cfs_hash_lock(hs, 0);
-        LASSERT(cfs_hash_is_rehashing(hs));
+        if (!cfs_hash_is_rehashing(hs) || hs->hs_rehash_buckets != NULL) {
+                /* finished by others, or resume migration */
+                cfs_hash_unlock(hs, 0);
+                goto migrate;
+        }
 
         old_size = CFS_HASH_NBKT(hs);
         new_size = CFS_HASH_RH_NBKT(hs);
@@ -1890,8 +2142,8 @@ cfs_hash_rehash_worker(cfs_workitem_t *wi)
         cfs_hash_unlock(hs, 0);
 
         /*
-         * don't need hs::hs_rwlock for hs::hs_buckets,
-         * because nobody can change bkt-table except me.
+         * don't need hs::hs_rwlock for hs::hs_buckets, because nobody
+         * can change bkt-table before hs_rehash_buckets is set.
          */
         bkts = cfs_hash_buckets_realloc(hs, hs->hs_buckets,
                                         old_size, new_size);
@@ -1906,60 +2158,64 @@ cfs_hash_rehash_worker(cfs_workitem_t *wi)
                 goto out;
         }
 
+        /* drop new bkt-table on early quit */
+        keep = old_size;
+        nbkt = new_size;
+
+        if (hs->hs_rehash_buckets != NULL ||
+            CFS_HASH_NBKT(hs) != old_size ||
+            !cfs_hash_is_rehashing(hs) || CFS_HASH_RH_NBKT(hs) != new_size) {
+                /* raced with the inline rehash, help it */
+                cfs_hash_rehash_unlock_free(hs, bkts, keep, nbkt);
+                bkts = NULL;
+                goto migrate;
+        }
+
         rc = __cfs_hash_theta(hs);
         if ((rc >= hs->hs_min_theta) && (rc <= hs->hs_max_theta)) {
                 /* free the new allocated bkt-table */
-                old_size = new_size;
-                new_size = CFS_HASH_NBKT(hs);
                 rc = -EALREADY;
                 goto out;
         }
 
-        LASSERT(hs->hs_rehash_buckets == NULL);
         hs->hs_rehash_buckets = bkts;
-
+        hs->hs_rehash_next = 0;
+        bkts = NULL;
         rc = 0;
-        cfs_hash_for_each_bucket(hs, &bd, i) {
+        cfs_hash_unlock(hs, 1);
+ migrate:
+        for (;;) {
+                cfs_hash_lock(hs, 1);
+                if (hs->hs_rehash_buckets == NULL) /* nothing to migrate */
+                        goto out_unlock;
+
                 if (cfs_hash_is_exiting(hs)) {
-                        rc = -ESRCH;
                         /* someone wants to destroy the hash, abort now */
-                        if (old_size < new_size) /* OK to free old bkt-table */
-                                break;
-                        /* it's shrinking, need free new bkt-table */
-                        hs->hs_rehash_buckets = NULL;
-                        old_size = new_size;
-                        new_size = CFS_HASH_NBKT(hs);
+                        rc = -ESRCH;
+                        bkts = cfs_hash_rehash_abort(hs, &keep, &nbkt);
                         goto out;
                 }
 
-                count += cfs_hash_rehash_bd(hs, &bd);
-                if (count < CFS_HASH_LOOP_HOG ||
-                    cfs_hash_is_iterating(hs)) { /* need to finish ASAP */
-                        continue;
-                }
+                /* paused, cfs_hash_for_each_exit() will reschedule me */
+                if (hs->hs_iterators != 0)
+                        goto out_unlock;
+
+                if (cfs_hash_rehash_step(hs, CFS_HASH_RH_STEP))
+                        break;
 
-                count = 0;
                 cfs_hash_unlock(hs, 1);
                 cfs_cond_resched();
-                cfs_hash_lock(hs, 1);
         }
 
         hs->hs_rehash_count++;
-
-        bkts = hs->hs_buckets;
-        hs->hs_buckets = hs->hs_rehash_buckets;
-        hs->hs_rehash_buckets = NULL;
-
-        hs->hs_cur_bits = hs->hs_rehash_bits;
+        bkts = cfs_hash_rehash_switch(hs, &keep, &nbkt);
  out:
-        hs->hs_rehash_bits = 0;
+        if (hs->hs_rehash_buckets == NULL)
+                hs->hs_rehash_bits = 0;
         if (rc == -ESRCH)
                 cfs_wi_exit(wi); /* never be scheduled again */
-        bsize = cfs_hash_bkt_size(hs);
-        cfs_hash_unlock(hs, 1);
-        /* can't refer to @hs anymore because it could be destroyed */
-        if (bkts != NULL)
-                cfs_hash_buckets_free(bkts, bsize, new_size, old_size);
+ out_unlock:
+        cfs_hash_rehash_unlock_free(hs, bkts, keep, nbkt);
         if (rc != 0)
                 CDEBUG(D_INFO, "early quit of of rehashing: %d\n", rc);
         /* cfs_workitem require us to always return 0 */
@@ -2016,38 +2272,15 @@ CFS_EXPORT_SYMBOL(cfs_hash_rehash_key);
 
 int cfs_hash_debug_header(char *str, int size)
 {
-        return snprintf(str, size, "%-*s%6s%6s%6s%6s%6s%6s%6s%7s%8s%8s%8s%s\n",
+        return snprintf(str, size,
+                 "%-*s%6s%6s%6s%6s%6s%6s%6s%7s%9s%8s%8s%8s%s\n",
                  CFS_HASH_BIGNAME_LEN,
                  "name", "cur", "min", "max", "theta", "t-min", "t-max",
-                 "flags", "rehash", "count", "maxdep", "maxdepb",
+                 "flags", "rehash", "maxpause", "count", "maxdep", "maxdepb",
                  " distribution");
 }
 CFS_EXPORT_SYMBOL(cfs_hash_debug_header);
 
-static cfs_hash_bucket_t **
-cfs_hash_full_bkts(cfs_hash_t *hs)
-{
-        /* NB: caller should hold hs->hs_rwlock if REHASH is set */
-        if (hs->hs_rehash_buckets == NULL)
-                return hs->hs_buckets;
-
-        LASSERT(hs->hs_rehash_bits != 0);
-        return hs->hs_rehash_bits > hs->hs_cur_bits ?
-               hs->hs_rehash_buckets : hs->hs_buckets;
-}
-
-static unsigned int
-cfs_hash_full_nbkt(cfs_hash_t *hs)
-{
-        /* NB: caller should hold hs->hs_rwlock if REHASH is set */
-        if (hs->hs_rehash_buckets == NULL)
-                return CFS_HASH_NBKT(hs);
-
-        LASSERT(hs->hs_rehash_bits != 0);
-        return hs->hs_rehash_bits > hs->hs_cur_bits ?
-               CFS_HASH_RH_NBKT(hs) : CFS_HASH_NBKT(hs);
-}
-
 int cfs_hash_debug_str(cfs_hash_t *hs, char *str, int size)
 {
         int                    dist[8] = { 0, };
@@ -2080,6 +2313,7 @@ int cfs_hash_debug_str(cfs_hash_t *hs, char *str, int size)
                       __cfs_hash_theta_frac(hs->hs_max_theta));
         c += snprintf(str + c, size - c, " 0x%02x ", hs->hs_flags);
         c += snprintf(str + c, size - c, "%6d ", hs->hs_rehash_count);
+        c += snprintf(str + c, size - c, "%8u ", hs->hs_rehash_max_pause);
 
         /*
          * The distribution is a summary of the chained hash depth in
@@ -0,0 +1,298 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.sun.com/software/products/lustre/docs/GPLv2.pdf
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa Clara,
+ * CA 95054 USA or visit www.sun.com if you need additional information or
+ * have any questions.
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * libcfs/libcfs/hash_bench.c
+ *
+ * Lookup scaling of cfs_hash with spin, rw and RCU bucket protection.
+ * Loading the module runs 1, 2, 4, ... up to hb_threads threads doing
+ * hb_loops lookups each against a hash of hb_items items in every mode, and
+ * prints the lookup rate and how close it is to linear scaling from one
+ * thread to the console.  The last mode starts with a small hash and adds
+ * half of the items while looking up the other half, to check lookups
+ * during incremental rehash, e.g.
+ *
+ *   modprobe cfs_hash_bench hb_threads=16
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <libcfs/libcfs.h>
+
+static int hb_threads;
+CFS_MODULE_PARM(hb_threads, "i", int, 0444,
+                "max # of lookup threads, default # of online CPUs");
+
+static int hb_loops = 1000000;
+CFS_MODULE_PARM(hb_loops, "i", int, 0444, "# of lookups per thread");
+
+static int hb_items = 4096;
+CFS_MODULE_PARM(hb_items, "i", int, 0444, "# of items in the hash");
+
+struct hb_item {
+        cfs_hlist_node_t        hi_hnode;
+        __u64                   hi_key;
+        cfs_atomic_t            hi_ref;
+};
+
+struct hb_mode {
+        const char             *hm_name;
+        unsigned                hm_bits;
+        unsigned                hm_flags;
+        __u64                   hm_rate1;       /* lookups/sec, 1 thread */
+};
+
+static struct hb_mode hb_modes[] = {
+        { "hash_bench_spin",   12, CFS_HASH_SPIN_BKTLOCK },
+        { "hash_bench_rw",     12, CFS_HASH_RW_BKTLOCK },
+        { "hash_bench_rcu",    12, CFS_HASH_RW_BKTLOCK | CFS_HASH_RCU_LOOKUP },
+        { "hash_bench_rehash",  4, CFS_HASH_RW_BKTLOCK | CFS_HASH_RCU_LOOKUP |
+                                   CFS_HASH_REHASH },
+};
+
+struct hb_run {
+        cfs_hash_t             *hr_hash;
+        cfs_atomic_t            hr_ready;
+        cfs_atomic_t            hr_done;
+        cfs_atomic_t            hr_misses;
+        int                     hr_nkeys;
+        cfs_waitq_t             hr_waitq;
+        int                     hr_go;
+};
+
+static unsigned
+hb_hash(cfs_hash_t *hs, const void *key, unsigned mask)
+{
+        return cfs_hash_u64_hash(*(__u64 *)key, mask);
+}
+
+static void *
+hb_key(cfs_hlist_node_t *hnode)
+{
+        return &cfs_hlist_entry(hnode, struct hb_item, hi_hnode)->hi_key;
+}
+
+static int
+hb_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+        return *(__u64 *)key ==
+               cfs_hlist_entry(hnode, struct hb_item, hi_hnode)->hi_key;
+}
+
+static void *
+hb_object(cfs_hlist_node_t *hnode)
+{
+        return cfs_hlist_entry(hnode, struct hb_item, hi_hnode);
+}
+
+static void
+hb_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        cfs_atomic_inc(&cfs_hlist_entry(hnode, struct hb_item,
+                                        hi_hnode)->hi_ref);
+}
+
+static int
+hb_get_rcu(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        return cfs_atomic_inc_not_zero(&cfs_hlist_entry(hnode, struct hb_item,
+                                                        hi_hnode)->hi_ref);
+}
+
+static void
+hb_put(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        cfs_atomic_dec(&cfs_hlist_entry(hnode, struct hb_item,
+                                        hi_hnode)->hi_ref);
+}
+
+static cfs_hash_ops_t hb_hash_ops = {
+        .hs_hash        = hb_hash,
+        .hs_key         = hb_key,
+        .hs_keycmp      = hb_keycmp,
+        .hs_object      = hb_object,
+        .hs_get         = hb_get,
+        .hs_get_rcu     = hb_get_rcu,
+        .hs_put         = hb_put,
+        .hs_put_locked  = hb_put,
+};
+
+static int
+hb_thread(void *arg)
+{
+        struct hb_run  *run = arg;
+        struct hb_item *item;
+        __u64           seed;
+        __u64           key;
+        int             misses = 0;
+        int             i;
+
+        cfs_atomic_inc(&run->hr_ready);
+        cfs_wait_event(run->hr_waitq, run->hr_go);
+
+        seed = cfs_rand();
+        for (i = 0; i < hb_loops; i++) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                /* keys of items are 0 .. hr_nkeys - 1 */
+                key = (__u32)(seed >> 32) % run->hr_nkeys;
+                item = cfs_hash_lookup(run->hr_hash, &key);
+                if (item == NULL) {
+                        misses++;
+                        continue;
+                }
+                hb_put(run->hr_hash, &item->hi_hnode);
+        }
+
+        cfs_atomic_add(misses, &run->hr_misses);
+        if (cfs_atomic_dec_and_test(&run->hr_done))
+                cfs_waitq_signal(&run->hr_waitq);
+        return 0;
+}
+
+static int
+hb_run_mode(struct hb_mode *mode, int nthreads, struct hb_item *items)
+{
+        struct hb_run   run;
+        cfs_task_t     *task;
+        cfs_time_t      start;
+        cfs_duration_t  elapsed;
+        const char     *name = mode->hm_name;
+        unsigned        bits = mode->hm_bits;
+        __u64           rate;
+        __u64           linear;
+        int             i;
+        int             rc = 0;
+
+        memset(&run, 0, sizeof(run));
+        cfs_waitq_init(&run.hr_waitq);
+        cfs_atomic_set(&run.hr_done, nthreads);
+
+        run.hr_hash = cfs_hash_create((char *)name, bits, 12, 4, 0,
+                                      CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
+                                      &hb_hash_ops,
+                                      mode->hm_flags | CFS_HASH_COUNTER);
+        if (run.hr_hash == NULL)
+                return -ENOMEM;
+
+        /* growing hash: the other half is added while looking up */
+        run.hr_nkeys = bits < 12 ? max(hb_items / 2, 1) : hb_items;
+        for (i = 0; i < hb_items; i++) {
+                CFS_INIT_HLIST_NODE(&items[i].hi_hnode);
+                items[i].hi_key = i;
+                cfs_atomic_set(&items[i].hi_ref, 0);
+                if (i < run.hr_nkeys)
+                        cfs_hash_add(run.hr_hash, &items[i].hi_key,
+                                     &items[i].hi_hnode);
+        }
+
+        for (i = 0; i < nthreads; i++) {
+                task = cfs_kthread_run(hb_thread, &run, "hash_bench_%02d", i);
+                if (IS_ERR(task)) {
+                        rc = PTR_ERR(task);
+                        /* don't wait for the threads not started */
+                        cfs_atomic_sub(nthreads - i, &run.hr_done);
+                        break;
+                }
+        }
+
+        while (cfs_atomic_read(&run.hr_ready) < i)
+                cfs_schedule_timeout_and_set_state(CFS_TASK_UNINT, 1);
+
+        start = cfs_time_current();
+        run.hr_go = 1;
+        cfs_waitq_broadcast(&run.hr_waitq);
+        for (i = run.hr_nkeys; i < hb_items; i++)
+                cfs_hash_add(run.hr_hash, &items[i].hi_key,
+                             &items[i].hi_hnode);
+        cfs_wait_event(run.hr_waitq, cfs_atomic_read(&run.hr_done) == 0);
+        elapsed = cfs_time_sub(cfs_time_current(), start);
+
+        if (rc == 0) {
+                rate = (__u64)nthreads * hb_loops * CFS_HZ;
+                do_div(rate, elapsed > 0 ? elapsed : 1);
+                if (nthreads == 1)
+                        mode->hm_rate1 = rate;
+                /* 100% is nthreads times the rate of one thread */
+                linear = rate * 100;
+                do_div(linear, max_t(__u64, mode->hm_rate1 * nthreads, 1));
+                LCONSOLE_INFO("%s: %d threads, %d lookups/thread, "
+                              "%d misses: "LPU64" lookups/sec, "LPU64"%% of "
+                              "linear\n", name, nthreads, hb_loops,
+                              cfs_atomic_read(&run.hr_misses), rate, linear);
+                if (bits < 12)
+                        LCONSOLE_INFO("%s: %u rehashes, max pause %u usec\n",
+                                      name, run.hr_hash->hs_rehash_count,
+                                      run.hr_hash->hs_rehash_max_pause);
+        }
+
+        for (i = 0; i < hb_items; i++)
+                cfs_hash_del(run.hr_hash, &items[i].hi_key,
+                             &items[i].hi_hnode);
+        cfs_hash_putref(run.hr_hash);
+
+        return rc;
+}
+
+static int __init hash_bench_init(void)
+{
+        struct hb_item *items;
+        int             nthreads;
+        int             i;
+        int             rc = 0;
+
+        if (hb_threads == 0)
+                hb_threads = cfs_num_online_cpus();
+        if (hb_threads <= 0 || hb_loops <= 0 || hb_items <= 0)
+                return -EINVAL;
+
+        LIBCFS_ALLOC(items, hb_items * sizeof(*items));
+        if (items == NULL)
+                return -ENOMEM;
+
+        for (nthreads = 1; rc == 0; nthreads *= 2) {
+                nthreads = min(nthreads, hb_threads);
+                for (i = 0; i < ARRAY_SIZE(hb_modes) && rc == 0; i++)
+                        rc = hb_run_mode(&hb_modes[i], nthreads, items);
+                if (nthreads == hb_threads)
+                        break;
+        }
+
+        LIBCFS_FREE(items, hb_items * sizeof(*items));
+        return rc;
+}
+
+static void __exit hash_bench_exit(void)
+{
+}
+
+MODULE_AUTHOR("Sun Microsystems, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("cfs_hash lookup benchmark");
+MODULE_LICENSE("GPL");
+
+module_init(hash_bench_init);
+module_exit(hash_bench_exit);
@@ -153,6 +153,23 @@ int libcfs_ukuc_msg_get(lustre_kernelcomm *link, char *buf, int maxsize,
  *   struct kuc_hdr
  */
 int libcfs_kkuc_msg_put(cfs_file_t *filp, void *payload)
+{
+        struct kuc_hdr *kuch = (struct kuc_hdr *)payload;
+
+        return libcfs_kkuc_msgs_put(filp, payload, kuch->kuc_msglen);
+}
+CFS_EXPORT_SYMBOL(libcfs_kkuc_msg_put);
+
+/**
+ * libcfs_kkuc_msgs_put - send several messages from kernel to userspace
+ * with a single write.  The receiver sees the same byte stream as if they
+ * had been sent one by one; keep \a len within PIPE_BUF so that a reader
+ * never sees part of a message.
+ * @param fp to send the messages to
+ * @param payload Back-to-back messages, each starting with struct kuc_hdr
+ * @param len Total length of the messages
+ */
+int libcfs_kkuc_msgs_put(cfs_file_t *filp, void *payload, int len)
 {
         struct kuc_hdr *kuch = (struct kuc_hdr *)payload;
         int rc = -ENOSYS;
@@ -168,8 +185,7 @@ int libcfs_kkuc_msg_put(cfs_file_t *filp, void *payload)
 #ifdef __KERNEL__
         {
                 loff_t offset = 0;
-                rc = cfs_user_write(filp, (char *)payload, kuch->kuc_msglen,
-                                    &offset);
+                rc = cfs_user_write(filp, (char *)payload, len, &offset);
         }
 #endif
 
@@ -180,7 +196,7 @@ int libcfs_kkuc_msg_put(cfs_file_t *filp, void *payload)
 
         return rc;
 }
-CFS_EXPORT_SYMBOL(libcfs_kkuc_msg_put);
+CFS_EXPORT_SYMBOL(libcfs_kkuc_msgs_put);
 
 /* Broadcast groups are global across all mounted filesystems;
  * i.e. registering for a group on 1 fs will get messages for that
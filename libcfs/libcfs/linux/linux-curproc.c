@@ -45,6 +45,7 @@
 
 #include <linux/compat.h>
 #include <linux/thread_info.h>
+#include <linux/uaccess.h>
 
 #define DEBUG_SUBSYSTEM S_LNET
 
@@ -124,6 +125,95 @@ char  *cfs_curproc_comm(void)
         return current->comm;
 }
 
+/* Copy the value of environment variable \a key of the current process to
+ * \a value, truncated to \a size bytes including the trailing '\0'.
+ * Returns -ENOENT if \a key is not set and -EINVAL for kernel threads,
+ * which have no environment.
+ *
+ * This is called on the RPC path, possibly from a page fault or mmap()
+ * with mmap_sem already held, so it never waits for mmap_sem nor faults
+ * pages of the environment in: it fails with -EDEADLK or -EFAULT
+ * instead. */
+int cfs_curproc_getenv(const char *key, char *value, int size)
+{
+        struct mm_struct *mm = current->mm;
+        unsigned long     addr;
+        unsigned long     env_end;
+        char             *buf;
+        char             *end;
+        int               keylen = strlen(key);
+        int               skip = 0;
+        int               len;
+        int               off;
+        int               rc = -ENOENT;
+
+        if (mm == NULL || size <= 0)
+                return -EINVAL;
+
+        if (!down_read_trylock(&mm->mmap_sem))
+                return -EDEADLK;
+        addr = mm->env_start;
+        env_end = mm->env_end;
+        up_read(&mm->mmap_sem);
+
+        LIBCFS_ALLOC(buf, CFS_PAGE_SIZE);
+        if (buf == NULL)
+                return -ENOMEM;
+
+        while (addr < env_end) {
+                len = min_t(unsigned long, env_end - addr, CFS_PAGE_SIZE);
+                pagefault_disable();
+                rc = __copy_from_user_inatomic(buf, (void __user *)addr, len);
+                pagefault_enable();
+                if (rc != 0) {
+                        rc = -EFAULT;
+                        break;
+                }
+                rc = -ENOENT;
+
+                off = 0;
+                if (skip) {
+                        /* the tail of an entry longer than a page */
+                        end = memchr(buf, '\0', len);
+                        if (end == NULL) {
+                                addr += len;
+                                continue;
+                        }
+                        off = end - buf + 1;
+                        skip = 0;
+                }
+
+                /* "NAME=value\0" entries complete in this page */
+                while (off < len) {
+                        end = memchr(buf + off, '\0', len - off);
+                        if (end == NULL)
+                                break;
+                        if (end - (buf + off) > keylen &&
+                            buf[off + keylen] == '=' &&
+                            memcmp(buf + off, key, keylen) == 0) {
+                                off += keylen + 1;
+                                len = min_t(int, end - (buf + off), size - 1);
+                                memcpy(value, buf + off, len);
+                                value[len] = '\0';
+                                rc = 0;
+                                goto out;
+                        }
+                        off = end - buf + 1;
+                }
+
+                if (off == 0) {
+                        if (len < CFS_PAGE_SIZE)
+                                break;
+                        skip = 1;
+                        off = len;
+                }
+                addr += off;
+        }
+out:
+        LIBCFS_FREE(buf, CFS_PAGE_SIZE);
+        return rc;
+}
+
 /* Currently all the CFS_CAP_* defines match CAP_* ones. */
 #define cfs_cap_pack(cap) (cap)
 #define cfs_cap_unpack(cap) (cap)
@@ -224,6 +314,7 @@ EXPORT_SYMBOL(cfs_curproc_fsuid);
 EXPORT_SYMBOL(cfs_curproc_fsgid);
 EXPORT_SYMBOL(cfs_curproc_umask);
 EXPORT_SYMBOL(cfs_curproc_comm);
+EXPORT_SYMBOL(cfs_curproc_getenv);
 EXPORT_SYMBOL(cfs_curproc_groups_nr);
 EXPORT_SYMBOL(cfs_curproc_groups_dump);
 EXPORT_SYMBOL(cfs_curproc_is_in_groups);
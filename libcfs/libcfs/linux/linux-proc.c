@@ -109,6 +109,12 @@ enum {
         PSDEV_LNET_FORCE_LBUG,    /* hook to force an LBUG */
         PSDEV_LNET_FAIL_LOC,      /* control test failures instrumentation */
         PSDEV_LNET_FAIL_VAL,      /* userdata for fail loc */
+        PSDEV_DEBUG_DEFERRED,     /* format debug messages when dumped */
+        PSDEV_DEBUG_SAMPLE,       /* trace one in N messages */
+        PSDEV_DEBUG_SAMPLE_MASK,  /* messages subject to sampling */
+        PSDEV_DEBUG_FILTER_NID,   /* only trace RPCs/locks of this peer */
+        PSDEV_DEBUG_FILTER_OPC,   /* only trace RPCs/locks of this opcode */
+        PSDEV_WI_STATS,           /* workitem scheduler statistics */
 };
 #else
 #define CTL_LNET                        CTL_UNNUMBERED
@@ -133,6 +139,12 @@ enum {
 #define PSDEV_LNET_FORCE_LBUG           CTL_UNNUMBERED
 #define PSDEV_LNET_FAIL_LOC             CTL_UNNUMBERED
 #define PSDEV_LNET_FAIL_VAL             CTL_UNNUMBERED
+#define PSDEV_DEBUG_DEFERRED            CTL_UNNUMBERED
+#define PSDEV_DEBUG_SAMPLE              CTL_UNNUMBERED
+#define PSDEV_DEBUG_SAMPLE_MASK         CTL_UNNUMBERED
+#define PSDEV_DEBUG_FILTER_NID          CTL_UNNUMBERED
+#define PSDEV_DEBUG_FILTER_OPC          CTL_UNNUMBERED
+#define PSDEV_WI_STATS                  CTL_UNNUMBERED
 #endif
 
 int
@@ -249,6 +261,70 @@ static int __proc_debug_mb(void *data, int write,
 
 DECLARE_PROC_HANDLER(proc_debug_mb)
 
+static int __proc_debug_filter_nid(void *data, int write,
+                                   loff_t pos, void *buffer, int nob)
+{
+        char       tmpstr[64];
+        lnet_nid_t nid;
+        int        len;
+        int        rc;
+
+        if (!write) {
+                len = snprintf(tmpstr, sizeof(tmpstr), "%s",
+                               libcfs_debug_filter_nid == LNET_NID_ANY ?
+                               "any" : libcfs_nid2str(libcfs_debug_filter_nid));
+                if (pos >= len)
+                        return 0;
+
+                return cfs_trace_copyout_string(buffer, nob, tmpstr + pos,
+                                                "\n");
+        }
+
+        rc = cfs_trace_copyin_string(tmpstr, sizeof(tmpstr), buffer, nob);
+        if (rc < 0)
+                return rc;
+
+        if (strcmp(tmpstr, "any") == 0 || strcmp(tmpstr, "*") == 0) {
+                nid = LNET_NID_ANY;
+        } else {
+                nid = libcfs_str2nid(tmpstr);
+                if (nid == LNET_NID_ANY)
+                        return -EINVAL;
+        }
+        libcfs_debug_filter_nid = nid;
+
+        return 0;
+}
+
+DECLARE_PROC_HANDLER(proc_debug_filter_nid)
+
+static int __proc_wi_stats(void *data, int write,
+                           loff_t pos, void *buffer, int nob)
+{
+        const int  tmpstrlen = 2 * CFS_PAGE_SIZE;
+        char      *tmpstr;
+        int        len;
+        int        rc;
+
+        if (write)
+                return -EPERM;
+
+        rc = cfs_trace_allocate_string_buffer(&tmpstr, tmpstrlen);
+        if (rc < 0)
+                return rc;
+
+        len = cfs_wi_stats_print(tmpstr, tmpstrlen);
+        if (pos >= len)
+                rc = 0;
+        else
+                rc = cfs_trace_copyout_string(buffer, nob, tmpstr + pos, NULL);
+
+        cfs_trace_free_string_buffer(tmpstr, tmpstrlen);
+        return rc;
+}
+
+DECLARE_PROC_HANDLER(proc_wi_stats)
+
 int LL_PROC_PROTO(proc_console_max_delay_cs)
 {
         int rc, max_delay_cs;
@@ -385,6 +461,50 @@ static cfs_sysctl_table_t lnet_table[] = {
                 .mode     = 0644,
                 .proc_handler = &proc_dobitmasks,
         },
+        {
+                .ctl_name = PSDEV_DEBUG_DEFERRED,
+                .procname = "debug_deferred",
+                .data     = &libcfs_debug_deferred,
+                .maxlen   = sizeof(int),
+                .mode     = 0644,
+                .proc_handler = &proc_dointvec
+        },
+        {
+                .ctl_name = PSDEV_DEBUG_SAMPLE,
+                .procname = "debug_sample",
+                .data     = &libcfs_debug_sample,
+                .maxlen   = sizeof(int),
+                .mode     = 0644,
+                .proc_handler = &proc_dointvec
+        },
+        {
+                .ctl_name = PSDEV_DEBUG_SAMPLE_MASK,
+                .procname = "debug_sample_mask",
+                .data     = &libcfs_debug_sample_mask,
+                .maxlen   = sizeof(int),
+                .mode     = 0644,
+                .proc_handler = &proc_dobitmasks,
+        },
+        {
+                .ctl_name = PSDEV_DEBUG_FILTER_NID,
+                .procname = "debug_filter_nid",
+                .mode     = 0644,
+                .proc_handler = &proc_debug_filter_nid,
+        },
+        {
+                .ctl_name = PSDEV_DEBUG_FILTER_OPC,
+                .procname = "debug_filter_opc",
+                .data     = &libcfs_debug_filter_opc,
+                .maxlen   = sizeof(int),
+                .mode     = 0644,
+                .proc_handler = &proc_dointvec
+        },
+        {
+                .ctl_name = PSDEV_WI_STATS,
+                .procname = "wi_stats",
+                .mode     = 0444,
+                .proc_handler = &proc_wi_stats,
+        },
         {
                 .ctl_name = PSDEV_CONSOLE_RATELIMIT,
                 .procname = "console_ratelimit",
@@ -51,6 +51,22 @@ char *cfs_trace_console_buffers[NR_CPUS][CFS_TCD_TYPE_MAX];
 
 cfs_rw_semaphore_t cfs_tracefile_sem;
 
+/* The formats of deferred records are looked up by address, which a module
+ * loaded later may reuse */
+static int cfs_trace_module_notify(struct notifier_block *nb,
+                                   unsigned long action, void *data)
+{
+        struct module *mod = data;
+
+        if (action == MODULE_STATE_GOING)
+                cfs_trace_fmt_forget(mod->module_core, mod->core_size);
+        return NOTIFY_DONE;
+}
+
+static struct notifier_block cfs_trace_module_nb = {
+        .notifier_call = cfs_trace_module_notify,
+};
+
 int cfs_tracefile_init_arch()
 {
 	int    i;
@@ -58,6 +74,7 @@ int cfs_tracefile_init_arch()
 	struct cfs_trace_cpu_data *tcd;
 
 	cfs_init_rwsem(&cfs_tracefile_sem);
+	register_module_notifier(&cfs_trace_module_nb);
 
 	/* initialize trace_data */
 	memset(cfs_trace_data, 0, sizeof(cfs_trace_data));
@@ -102,6 +119,8 @@ void cfs_tracefile_fini_arch()
 	int    i;
 	int    j;
 
+	unregister_module_notifier(&cfs_trace_module_nb);
+
 	for (i = 0; i < num_possible_cpus(); i++)
 		for (j = 0; j < 3; j++)
 			if (cfs_trace_console_buffers[i][j] != NULL) {
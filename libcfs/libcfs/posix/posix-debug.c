@@ -356,6 +356,49 @@ out_file:
         return 0;
 }
 
+/* no trace buffer to sample here, \a key is ignored */
+int
+libcfs_debug_vmsg2_key(const struct libcfs_debug_key *key,
+                       cfs_debug_limit_state_t *cdls,
+                       int subsys, int mask,
+                       const char *file, const char *fn, const int line,
+                       const char *format1, va_list args,
+                       const char *format2, ...)
+{
+        char    buf[CFS_PAGE_SIZE];
+        va_list ap;
+
+        if (format2 == NULL)
+                return libcfs_debug_vmsg2(cdls, subsys, mask, file, fn, line,
+                                          format1, args, NULL);
+
+        va_start(ap, format2);
+        vsnprintf(buf, sizeof(buf), format2, ap);
+        va_end(ap);
+
+        return libcfs_debug_vmsg2(cdls, subsys, mask, file, fn, line,
+                                  format1, args, "%s", buf);
+}
+
+/* \a key is ignored, as by libcfs_debug_vmsg2_key() */
+int
+libcfs_debug_msg_key(const struct libcfs_debug_key *key,
+                     cfs_debug_limit_state_t *cdls,
+                     int subsys, int mask,
+                     const char *file, const char *fn, const int line,
+                     const char *format, ...)
+{
+        va_list ap;
+        int     rc;
+
+        va_start(ap, format);
+        rc = libcfs_debug_vmsg2(cdls, subsys, mask, file, fn, line,
+                                format, ap, NULL);
+        va_end(ap);
+
+        return rc;
+}
+
 void
 libcfs_assertion_failed(const char *expr, const char *file, const char *func,
                         const int line)
@@ -165,6 +165,7 @@ cfs_trace_get_tage_try(struct cfs_trace_cpu_data *tcd, unsigned long len)
                 }
 
                 tage->used = 0;
+                tage->deferred = 0;
                 tage->cpu = cfs_smp_processor_id();
                 tage->type = tcd->tcd_type;
                 cfs_list_add_tail(&tage->linkage, &tcd->tcd_pages);
@@ -238,15 +239,638 @@ static struct cfs_trace_page *cfs_trace_get_tage(struct cfs_trace_cpu_data *tcd,
         if (tcd->tcd_cur_pages > 0) {
                 tage = cfs_tage_from_list(tcd->tcd_pages.next);
                 tage->used = 0;
+                tage->deferred = 0;
                 cfs_tage_to_tail(tage, &tcd->tcd_pages);
         }
         return tage;
 }
 
-int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls, int subsys, int mask,
-                       const char *file, const char *fn, const int line,
-                       const char *format1, va_list args,
-                       const char *format2, ...)
+/*
+ * Deferred formatting.
+ *
+ * When a message is not going to the console, libcfs_debug_vmsg2() can
+ * store the raw arguments instead of running vsnprintf() at the call site.
+ * Such records carry PH_FLAG_DEFERRED and are laid out as header, file,
+ * function, the ids of the two formats, arguments.  They are turned into
+ * ordinary text records when the buffer is dumped, so the files written by
+ * "lctl dk" and the trace daemon are unchanged.
+ *
+ * Format strings are copied once per call site into cfs_trace_fmts, and
+ * the record only holds the index of the copy.  The copies stay until
+ * libcfs is unloaded, so records of a module that has gone away can still
+ * be formatted.
+ */
+enum cfs_trace_argtype {
+        CTA_INT,
+        CTA_LONG,
+        CTA_LLONG,
+        CTA_PTR,
+        CTA_STR,
+        CTA_BAD         /* cannot be deferred */
+};
+
+/* space reserved for the arguments of a deferred record */
+#define CFS_TRACE_DEFER_ARGS    256
+
+/* format strings of deferred records, an open addressed hash on the
+ * address of the caller's format */
+#define CFS_TRACE_FMT_BITS      13
+#define CFS_TRACE_FMT_SIZE      (1 << CFS_TRACE_FMT_BITS)
+/* key of a slot whose module has been unloaded */
+#define CFS_TRACE_FMT_GONE      ((const char *)1)
+
+struct cfs_trace_fmt {
+        const char     *ctf_key;        /* caller's format, NULL if free */
+        char           *ctf_copy;       /* what the records are formatted
+                                         * with */
+};
+
+static struct cfs_trace_fmt *cfs_trace_fmts;
+static cfs_spinlock_t        cfs_trace_fmt_lock;
+
+/**
+ * Look up the slot of format \a fmt, starting at its hash.
+ *
+ * \retval the slot holding \a fmt, or the free slot it would go to
+ * \retval -1 if neither was found
+ */
+static int cfs_trace_fmt_find(const char *fmt)
+{
+        const char *key;
+        int i = cfs_hash_long((unsigned long)fmt, CFS_TRACE_FMT_BITS);
+        int n;
+
+        for (n = 0; n < CFS_TRACE_FMT_SIZE; n++) {
+                key = cfs_trace_fmts[i].ctf_key;
+                if (key == fmt || key == NULL)
+                        return i;
+                i = (i + 1) & (CFS_TRACE_FMT_SIZE - 1);
+        }
+        return -1;
+}
+
+/**
+ * Get the id a deferred record stores for format \a fmt.  Only the first
+ * message from a call site copies the format, later ones find it without
+ * taking a lock.  \a added is set if \a fmt was copied by this call.
+ *
+ * \retval id, never 0
+ * \retval 0 if the format cannot be stored and has to be used now
+ */
+static __u32 cfs_trace_fmt_id(const char *fmt, int *added)
+{
+        unsigned long flags;
+        char *copy;
+        int len;
+        int i;
+
+        if (fmt == NULL || cfs_trace_fmts == NULL)
+                return 0;
+
+        i = cfs_trace_fmt_find(fmt);
+        if (i < 0)
+                return 0;
+        if (cfs_trace_fmts[i].ctf_key == fmt)
+                return i + 1;
+
+        len = strlen(fmt) + 1;
+        copy = cfs_alloc(len, CFS_ALLOC_ATOMIC);
+        if (copy == NULL)
+                return 0;
+        memcpy(copy, fmt, len);
+
+        cfs_spin_lock_irqsave(&cfs_trace_fmt_lock, flags);
+        i = cfs_trace_fmt_find(fmt);
+        if (i >= 0 && cfs_trace_fmts[i].ctf_key == NULL) {
+                cfs_trace_fmts[i].ctf_copy = copy;
+                /* lookups do not lock, the copy must be seen first */
+                cfs_mb();
+                cfs_trace_fmts[i].ctf_key = fmt;
+                copy = NULL;
+                *added = 1;
+        }
+        cfs_spin_unlock_irqrestore(&cfs_trace_fmt_lock, flags);
+
+        if (copy != NULL)
+                cfs_free(copy);
+        return i + 1;
+}
+
+/* The format of id \a id, or NULL */
+static const char *cfs_trace_fmt_get(__u32 id)
+{
+        if (id == 0 || id > CFS_TRACE_FMT_SIZE || cfs_trace_fmts == NULL)
+                return NULL;
+        return cfs_trace_fmts[id - 1].ctf_copy;
+}
+
+/**
+ * Forget the formats in [\a start, \a start + \a size), the memory of a
+ * module being unloaded.  Another module may be loaded at the same address,
+ * so its formats must get new slots.  The copies are kept for the records
+ * already in the buffer.
+ */
+void cfs_trace_fmt_forget(const void *start, unsigned long size)
+{
+        unsigned long flags;
+        const char *key;
+        int i;
+
+        if (cfs_trace_fmts == NULL)
+                return;
+
+        cfs_spin_lock_irqsave(&cfs_trace_fmt_lock, flags);
+        for (i = 0; i < CFS_TRACE_FMT_SIZE; i++) {
+                key = cfs_trace_fmts[i].ctf_key;
+                if (key != NULL && key != CFS_TRACE_FMT_GONE &&
+                    key >= (const char *)start &&
+                    key < (const char *)start + size)
+                        cfs_trace_fmts[i].ctf_key = CFS_TRACE_FMT_GONE;
+        }
+        cfs_spin_unlock_irqrestore(&cfs_trace_fmt_lock, flags);
+}
+
+static inline int cfs_trace_isdigit(char c)
+{
+        return c >= '0' && c <= '9';
+}
+
+static inline int cfs_trace_isalnum(char c)
+{
+        return cfs_trace_isdigit(c) || (c >= 'a' && c <= 'z') ||
+               (c >= 'A' && c <= 'Z');
+}
+
+/**
+ * Parse the conversion specification at \a fmt, just past its '%'.
+ * \a wstar and \a pstar are set if the width or precision is taken from
+ * an argument, \a prec to a literal precision or -1.
+ *
+ * \retval length of the specification, not counting the '%'
+ */
+static int cfs_trace_fmt_spec(const char *fmt, int *type, int *wstar,
+                              int *pstar, int *prec)
+{
+        const char *p = fmt;
+        int lng = 0;
+
+        *wstar = *pstar = 0;
+        *prec = -1;
+
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+                p++;
+        if (*p == '*') {
+                *wstar = 1;
+                p++;
+        } else {
+                while (cfs_trace_isdigit(*p))
+                        p++;
+        }
+        if (*p == '.') {
+                p++;
+                if (*p == '*') {
+                        *pstar = 1;
+                        p++;
+                } else {
+                        for (*prec = 0; cfs_trace_isdigit(*p); p++)
+                                *prec = *prec * 10 + *p - '0';
+                }
+        }
+
+        switch (*p) {
+        case 'h':
+                if (*++p == 'h')
+                        p++;
+                break;
+        case 'l':
+                lng = 1;
+                if (*++p == 'l') {
+                        lng = 2;
+                        p++;
+                }
+                break;
+        case 'L':
+        case 'q':
+        case 'j':
+                lng = 2;
+                p++;
+                break;
+        case 'z':
+        case 'Z':
+        case 't':
+                lng = 1;
+                p++;
+                break;
+        }
+
+        switch (*p) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'c':
+                *type = lng == 2 ? CTA_LLONG : lng == 1 ? CTA_LONG : CTA_INT;
+                break;
+        case 's':
+                *type = lng == 0 ? CTA_STR : CTA_BAD;
+                break;
+        case 'p':
+                /* %pX extensions dereference their argument */
+                *type = cfs_trace_isalnum(p[1]) ? CTA_BAD : CTA_PTR;
+                break;
+        case '\0':
+                *type = CTA_BAD;
+                return p - fmt;
+        default:
+                /* %n, floating point and anything we do not know */
+                *type = CTA_BAD;
+                break;
+        }
+
+        return p - fmt + 1;
+}
+
+#define CTA_PUT(p, end, type, val)                                      \
+do {                                                                    \
+        type __v = (val);                                               \
+                                                                        \
+        if ((p) + sizeof(__v) > (end))                                  \
+                return -1;                                              \
+        memcpy((p), &__v, sizeof(__v));                                 \
+        (p) += sizeof(__v);                                             \
+} while (0)
+
+/**
+ * Save the arguments \a ap of \a fmt into \a buf.
+ *
+ * \retval bytes used
+ * \retval -1 if \a fmt cannot be deferred or \a buf is too small
+ */
+static int cfs_trace_args_save(char *buf, int size, const char *fmt,
+                               va_list ap)
+{
+        char *p = buf;
+        char *end = buf + size;
+        const char *s;
+        int type, wstar, pstar, prec, len;
+
+        while ((fmt = strchr(fmt, '%')) != NULL) {
+                if (*++fmt == '%') {
+                        fmt++;
+                        continue;
+                }
+                fmt += cfs_trace_fmt_spec(fmt, &type, &wstar, &pstar, &prec);
+                if (type == CTA_BAD)
+                        return -1;
+
+                if (wstar)
+                        CTA_PUT(p, end, int, va_arg(ap, int));
+                if (pstar) {
+                        prec = va_arg(ap, int);
+                        CTA_PUT(p, end, int, prec);
+                }
+
+                switch (type) {
+                case CTA_INT:
+                        CTA_PUT(p, end, int, va_arg(ap, int));
+                        break;
+                case CTA_LONG:
+                        CTA_PUT(p, end, long, va_arg(ap, long));
+                        break;
+                case CTA_LLONG:
+                        CTA_PUT(p, end, long long, va_arg(ap, long long));
+                        break;
+                case CTA_PTR:
+                        CTA_PUT(p, end, void *, va_arg(ap, void *));
+                        break;
+                case CTA_STR:
+                        s = va_arg(ap, const char *);
+                        if (s == NULL)
+                                s = "(null)";
+                        /* "%.*s" strings need not be NUL terminated */
+                        len = prec >= 0 ? strnlen(s, prec) : strlen(s);
+                        if (p + len + 1 > end)
+                                return -1;
+                        memcpy(p, s, len);
+                        p[len] = '\0';
+                        p += len + 1;
+                        break;
+                }
+        }
+
+        return p - buf;
+}
+
+#define CTA_GET(p, end, type, var)                                      \
+do {                                                                    \
+        if ((p) + sizeof(var) > (end))                                  \
+                goto out;                                               \
+        memcpy(&(var), (p), sizeof(var));                               \
+        (p) += sizeof(var);                                             \
+} while (0)
+
+#define CTA_PRINT(buf, size, spec, wstar, pstar, w, pr, v)              \
+        ((wstar) && (pstar) ? snprintf(buf, size, spec, w, pr, v) :     \
+         (wstar) ? snprintf(buf, size, spec, w, v) :                    \
+         (pstar) ? snprintf(buf, size, spec, pr, v) :                   \
+         snprintf(buf, size, spec, v))
+
+/**
+ * Format \a fmt with the arguments saved by cfs_trace_args_save() in
+ * [\a *argsp, \a end) into \a buf.  The output is truncated to \a size.
+ * \a *argsp is moved past the arguments used.
+ *
+ * \retval bytes written, not counting the terminating NUL
+ */
+static int cfs_trace_args_format(char *buf, int size, const char *fmt,
+                                 const char **argsp, const char *end)
+{
+        const char *args = *argsp;
+        char spec[32];
+        int nob = 0;
+        int type, wstar, pstar, prec, len;
+        int w = 0, pr = 0;
+
+        __LASSERT(size > 0);
+        buf[0] = '\0';
+
+        while (*fmt != '\0') {
+                const char *pct = strchr(fmt, '%');
+
+                len = pct != NULL ? pct - fmt : strlen(fmt);
+                if (len >= size - nob)
+                        len = size - nob - 1;
+                memcpy(buf + nob, fmt, len);
+                nob += len;
+                buf[nob] = '\0';
+                if (pct == NULL || nob == size - 1)
+                        break;
+
+                fmt = pct + 1;
+                if (*fmt == '%') {
+                        buf[nob++] = '%';
+                        buf[nob] = '\0';
+                        fmt++;
+                        continue;
+                }
+
+                len = cfs_trace_fmt_spec(fmt, &type, &wstar, &pstar, &prec);
+                if (type == CTA_BAD || len + 2 > sizeof(spec))
+                        break;
+                spec[0] = '%';
+                memcpy(spec + 1, fmt, len);
+                spec[len + 1] = '\0';
+                fmt += len;
+
+                if (wstar)
+                        CTA_GET(args, end, int, w);
+                if (pstar)
+                        CTA_GET(args, end, int, pr);
+
+                switch (type) {
+                case CTA_INT: {
+                        int v;
+
+                        CTA_GET(args, end, int, v);
+                        len = CTA_PRINT(buf + nob, size - nob, spec,
+                                        wstar, pstar, w, pr, v);
+                        break;
+                }
+                case CTA_LONG: {
+                        long v;
+
+                        CTA_GET(args, end, long, v);
+                        len = CTA_PRINT(buf + nob, size - nob, spec,
+                                        wstar, pstar, w, pr, v);
+                        break;
+                }
+                case CTA_LLONG: {
+                        long long v;
+
+                        CTA_GET(args, end, long long, v);
+                        len = CTA_PRINT(buf + nob, size - nob, spec,
+                                        wstar, pstar, w, pr, v);
+                        break;
+                }
+                case CTA_PTR: {
+                        void *v;
+
+                        CTA_GET(args, end, void *, v);
+                        len = CTA_PRINT(buf + nob, size - nob, spec,
+                                        wstar, pstar, w, pr, v);
+                        break;
+                }
+                case CTA_STR: {
+                        const char *v = args;
+                        const char *z = memchr(args, '\0', end - args);
+
+                        if (z == NULL)
+                                goto out;
+                        args = z + 1;
+                        len = CTA_PRINT(buf + nob, size - nob, spec,
+                                        wstar, pstar, w, pr, v);
+                        break;
+                }
+                }
+
+                if (len >= size - nob) {
+                        nob = size - 1;
+                        break;
+                }
+                nob += len;
+        }
+out:
+        *argsp = args;
+        return nob;
+}
+
+/**
+ * Format the body of a deferred record, the two format ids and their
+ * arguments in [\a p, \a end), into \a buf.
+ *
+ * \retval bytes written, not counting the terminating NUL
+ */
+static int cfs_trace_body_format(char *buf, int size, const char *p,
+                                 const char *end)
+{
+        const char *fmt;
+        __u32 ids[2];
+        int nob = 0;
+        int i;
+
+        buf[0] = '\0';
+        if (p + sizeof(ids) > end)
+                return 0;
+        memcpy(ids, p, sizeof(ids));
+        p += sizeof(ids);
+
+        for (i = 0; i < 2 && nob < size - 1; i++) {
+                fmt = cfs_trace_fmt_get(ids[i]);
+                if (fmt != NULL)
+                        nob += cfs_trace_args_format(buf + nob, size - nob,
+                                                     fmt, &p, end);
+        }
+        return nob;
+}
+
+/**
+ * Turn the deferred record \a hdr into a text record in \a buf.
+ *
+ * \retval length of the text record
+ */
+static int cfs_trace_rec_format(struct ptldebug_header *hdr, char *buf,
+                                int size)
+{
+        struct ptldebug_header *out = (struct ptldebug_header *)buf;
+        char *end = (char *)hdr + hdr->ph_len;
+        char *p = (char *)(hdr + 1);
+        int nob;
+
+        p += strlen(p) + 1;     /* file */
+        p += strlen(p) + 1;     /* function */
+
+        nob = p - (char *)hdr;
+        memcpy(buf, hdr, nob);
+        nob += cfs_trace_body_format(buf + nob, size - nob, p, end);
+        out->ph_flags &= ~PH_FLAG_DEFERRED;
+        out->ph_len = nob;
+
+        return nob;
+}
+
+/**
+ * Store a message in the trace buffer without formatting it.
+ *
+ * \retval 0 the message is recorded
+ * \retval -1 it could not be deferred and has to be formatted now
+ */
+static int cfs_trace_msg_defer(struct cfs_trace_cpu_data *tcd,
+                               struct ptldebug_header *header, int depth,
+                               const char *file, const char *fn,
+                               const char *format1, va_list args,
+                               const char *format2, va_list args2)
+{
+        struct cfs_trace_page *tage;
+        char *debug_buf;
+        char *args_buf;
+        const char *last;
+        __u32 ids[2] = { 0, 0 };
+        int added = 0;
+        int known_size;
+        int max_nob;
+        int nob = 0;
+        int rc;
+        va_list ap;
+
+        if (fn == NULL)
+                return -1;
+
+        if (format1 != NULL) {
+                ids[0] = cfs_trace_fmt_id(format1, &added);
+                if (ids[0] == 0)
+                        return -1;
+        }
+        if (format2 != NULL) {
+                added = 0;
+                ids[1] = cfs_trace_fmt_id(format2, &added);
+                if (ids[1] == 0)
+                        return -1;
+        }
+
+        /* checked once per call site, when its format is first stored */
+        last = format2 != NULL ? format2 : format1;
+        if (added && (*last == '\0' || last[strlen(last) - 1] != '\n'))
+                printk(CFS_KERN_INFO "format at %s:%d:%s doesn't end in "
+                       "newline\n", file, header->ph_line_num, fn);
+
+        known_size = sizeof(*header) + depth + strlen(file) + 1 +
+                     strlen(fn) + 1 + sizeof(ids);
+
+        tage = cfs_trace_get_tage(tcd, known_size + CFS_TRACE_DEFER_ARGS);
+        if (tage == NULL)
+                return -1;
+
+        max_nob = CFS_PAGE_SIZE - tage->used - known_size;
+        if (max_nob <= 0)
+                return -1;
+        args_buf = (char *)cfs_page_address(tage->page) + tage->used +
+                   known_size;
+
+        if (format1 != NULL) {
+                va_copy(ap, args);
+                rc = cfs_trace_args_save(args_buf, max_nob, format1, ap);
+                va_end(ap);
+                if (rc < 0)
+                        return -1;
+                nob += rc;
+        }
+        if (format2 != NULL) {
+                va_copy(ap, args2);
+                rc = cfs_trace_args_save(args_buf + nob, max_nob - nob,
+                                         format2, ap);
+                va_end(ap);
+                if (rc < 0)
+                        return -1;
+                nob += rc;
+        }
+
+        header->ph_flags |= PH_FLAG_DEFERRED;
+        header->ph_len = known_size + nob;
+
+        debug_buf = (char *)cfs_page_address(tage->page) + tage->used;
+        memcpy(debug_buf, header, sizeof(*header));
+        debug_buf += sizeof(*header);
+
+        /* indent message according to the nesting level */
+        while (depth-- > 0)
+                *(debug_buf++) = '.';
+
+        strcpy(debug_buf, file);
+        debug_buf += strlen(file) + 1;
+        strcpy(debug_buf, fn);
+        debug_buf += strlen(fn) + 1;
+
+        /* the arguments of both formats follow, in the same order */
+        memcpy(debug_buf, ids, sizeof(ids));
+        debug_buf += sizeof(ids);
+
+        __LASSERT(debug_buf == args_buf);
+
+        tage->used += header->ph_len;
+        tage->deferred = 1;
+        __LASSERT(tage->used <= CFS_PAGE_SIZE);
+
+        return 0;
+}
+
+/**
+ * Apply the nid/opcode filters to a message about the RPC or lock \a key.
+ * Sampling is done before the call, see cfs_cdebug_sampled_out().
+ *
+ * \retval 1 the message is dropped
+ */
+static int cfs_trace_filter_drop(int mask, const struct libcfs_debug_key *key)
+{
+        if (key == NULL || (mask & (D_CANTMASK | libcfs_printk)) != 0)
+                return 0;
+
+        if (libcfs_debug_filter_nid != LNET_NID_ANY &&
+            key->dk_nid != LNET_NID_ANY &&
+            key->dk_nid != libcfs_debug_filter_nid)
+                return 1;
+        if (libcfs_debug_filter_opc >= 0 && key->dk_opc >= 0 &&
+            key->dk_opc != libcfs_debug_filter_opc)
+                return 1;
+        return 0;
+}
+
+static int cfs_debug_vmsg(const struct libcfs_debug_key *key,
+                          cfs_debug_limit_state_t *cdls, int subsys, int mask,
+                          const char *file, const char *fn, const int line,
+                          const char *format1, va_list args,
+                          const char *format2, va_list args2)
 {
         struct cfs_trace_cpu_data *tcd = NULL;
         struct ptldebug_header     header = {0};
@@ -275,6 +899,11 @@ int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls, int subsys, int mask,
         if (tcd == NULL)                /* arch may not log in IRQ context */
                 goto console;
 
+        if (cfs_trace_filter_drop(mask, key)) {
+                cfs_trace_put_tcd(tcd);
+                return 1;
+        }
+
         if (tcd->tcd_cur_pages == 0)
                 header.ph_flags |= PH_FLAG_FIRST_RECORD;
 
@@ -289,6 +918,19 @@ int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls, int subsys, int mask,
         if (fn)
                 known_size += strlen(fn) + 1;
 
+        /* messages for the console are formatted here anyway */
+        if (libcfs_debug_deferred && libcfs_debug_binary &&
+            (mask & libcfs_printk) == 0) {
+                va_copy(ap, args2);
+                i = cfs_trace_msg_defer(tcd, &header, depth, file, fn,
+                                        format1, args, format2, ap);
+                va_end(ap);
+                if (i == 0) {
+                        cfs_trace_put_tcd(tcd);
+                        return 1;
+                }
+        }
+
         if (libcfs_debug_binary)
                 known_size += sizeof(header);
 
@@ -333,7 +975,7 @@ int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls, int subsys, int mask,
                         if (remain < 0)
                                 remain = 0;
 
-                        va_start(ap, format2);
+                        va_copy(ap, args2);
                         needed += vsnprintf(string_buf + needed, remain,
                                             format2, ap);
                         va_end(ap);
@@ -432,7 +1074,7 @@ console:
                 if (format2 != NULL) {
                         remain = CFS_TRACE_CONSOLE_BUFFER_SIZE - needed;
                         if (remain > 0) {
-                                va_start(ap, format2);
+                                va_copy(ap, args2);
                                 needed += vsnprintf(string_buf+needed, remain, format2, ap);
                                 va_end(ap);
                         }
@@ -459,8 +1101,65 @@ console:
 
         return 0;
 }
+int libcfs_debug_vmsg2(cfs_debug_limit_state_t *cdls, int subsys, int mask,
+                       const char *file, const char *fn, const int line,
+                       const char *format1, va_list args,
+                       const char *format2, ...)
+{
+        va_list args2;
+        int     rc;
+
+        va_start(args2, format2);
+        rc = cfs_debug_vmsg(NULL, cdls, subsys, mask, file, fn, line,
+                            format1, args, format2, args2);
+        va_end(args2);
+
+        return rc;
+}
 EXPORT_SYMBOL(libcfs_debug_vmsg2);
 
+/**
+ * As libcfs_debug_vmsg2(), for messages about an object identified by \a key
+ * so that sampling and filtering keep or drop all messages about it.
+ */
+int libcfs_debug_vmsg2_key(const struct libcfs_debug_key *key,
+                           cfs_debug_limit_state_t *cdls, int subsys, int mask,
+                           const char *file, const char *fn, const int line,
+                           const char *format1, va_list args,
+                           const char *format2, ...)
+{
+        va_list args2;
+        int     rc;
+
+        va_start(args2, format2);
+        rc = cfs_debug_vmsg(key, cdls, subsys, mask, file, fn, line,
+                            format1, args, format2, args2);
+        va_end(args2);
+
+        return rc;
+}
+EXPORT_SYMBOL(libcfs_debug_vmsg2_key);
+
+/**
+ * As libcfs_debug_msg(), for plain messages about the RPC or lock \a key.
+ */
+int libcfs_debug_msg_key(const struct libcfs_debug_key *key,
+                         cfs_debug_limit_state_t *cdls, int subsys, int mask,
+                         const char *file, const char *fn, const int line,
+                         const char *format, ...)
+{
+        va_list args;
+        int     rc;
+
+        va_start(args, format);
+        rc = cfs_debug_vmsg(key, cdls, subsys, mask, file, fn, line,
+                            format, args, NULL, args);
+        va_end(args);
+
+        return rc;
+}
+EXPORT_SYMBOL(libcfs_debug_msg_key);
+
 void
 libcfs_assertion_failed(const char *expr, const char *file,
                         const char *func, const int line)
@@ -662,7 +1361,20 @@ void cfs_trace_debug_print(void)
                         p += strlen(fn) + 1;
                         len = hdr->ph_len - (int)(p - (char *)hdr);
 
-                        cfs_print_to_console(hdr, D_EMERG, p, len, file, fn);
+                        if (hdr->ph_flags & PH_FLAG_DEFERRED) {
+                                char *buf = cfs_trace_get_console_buffer();
+                                int nob;
+
+                                nob = cfs_trace_body_format(buf,
+                                        CFS_TRACE_CONSOLE_BUFFER_SIZE, p,
+                                        p + len);
+                                cfs_print_to_console(hdr, D_EMERG, buf, nob,
+                                                     file, fn);
+                                cfs_trace_put_console_buffer(buf);
+                        } else {
+                                cfs_print_to_console(hdr, D_EMERG, p, len,
+                                                     file, fn);
+                        }
 
                         p += len;
                 }
@@ -672,12 +1384,68 @@ void cfs_trace_debug_print(void)
         }
 }
 
+static int cfs_trace_write(cfs_file_t *filp, char *buf, int len, loff_t *pos)
+{
+        int rc;
+
+        rc = cfs_filp_write(filp, buf, len, pos);
+        if (rc != len) {
+                printk(CFS_KERN_WARNING "wanted to write %u but wrote %d\n",
+                       len, rc);
+                return rc < 0 ? rc : -EIO;
+        }
+        return 0;
+}
+
+/**
+ * Write the records of \a tage to \a filp.  Deferred records are formatted
+ * into \a buf, which must be CFS_PAGE_SIZE bytes, the others are written
+ * as they are.
+ */
+static int cfs_tage_write(cfs_file_t *filp, struct cfs_trace_page *tage,
+                          char *buf, loff_t *pos)
+{
+        char *p = cfs_page_address(tage->page);
+        char *end = p + tage->used;
+        char *run = p;
+        int rc;
+
+        if (!tage->deferred)
+                return cfs_trace_write(filp, p, tage->used, pos);
+
+        while (p < end) {
+                struct ptldebug_header *hdr = (void *)p;
+
+                p += hdr->ph_len;
+                if (!(hdr->ph_flags & PH_FLAG_DEFERRED))
+                        continue;
+
+                if ((char *)hdr > run) {
+                        rc = cfs_trace_write(filp, run, (char *)hdr - run,
+                                             pos);
+                        if (rc)
+                                return rc;
+                }
+                rc = cfs_trace_write(filp, buf,
+                                     cfs_trace_rec_format(hdr, buf,
+                                                          CFS_PAGE_SIZE),
+                                     pos);
+                if (rc)
+                        return rc;
+                run = p;
+        }
+        if (end > run)
+                return cfs_trace_write(filp, run, end - run, pos);
+        return 0;
+}
+
 int cfs_tracefile_dump_all_pages(char *filename)
 {
         struct page_collection pc;
         cfs_file_t *filp;
         struct cfs_trace_page *tage;
         struct cfs_trace_page *tmp;
+        char *buf;
         int rc;
 
         CFS_DECL_MMSPACE;
@@ -702,6 +1470,14 @@ int cfs_tracefile_dump_all_pages(char *filename)
                 goto close;
         }
 
+        /* for formatting deferred records */
+        buf = cfs_alloc(CFS_PAGE_SIZE, CFS_ALLOC_STD);
+        if (buf == NULL) {
+                put_pages_back(&pc);
+                rc = -ENOMEM;
+                goto close;
+        }
+
         /* ok, for now, just write the pages.  in the future we'll be building
          * iobufs with the pages and calling generic_direct_IO */
         CFS_MMSPACE_OPEN;
@@ -710,11 +1486,8 @@ int cfs_tracefile_dump_all_pages(char *filename)
 
                 __LASSERT_TAGE_INVARIANT(tage);
 
-                rc = cfs_filp_write(filp, cfs_page_address(tage->page),
-                                    tage->used, cfs_filp_poff(filp));
-                if (rc != (int)tage->used) {
-                        printk(CFS_KERN_WARNING "wanted to write %u but wrote "
-                               "%d\n", tage->used, rc);
+                rc = cfs_tage_write(filp, tage, buf, cfs_filp_poff(filp));
+                if (rc != 0) {
                         put_pages_back(&pc);
                         __LASSERT(cfs_list_empty(&pc.pc_pages));
                         break;
@@ -723,6 +1496,7 @@ int cfs_tracefile_dump_all_pages(char *filename)
                 cfs_tage_free(tage);
         }
         CFS_MMSPACE_CLOSE;
+        cfs_free(buf);
         rc = cfs_filp_fsync(filp);
         if (rc)
                 printk(CFS_KERN_ERR "sync returns %d\n", rc);
@@ -975,6 +1749,7 @@ static int tracefiled(void *arg)
         struct cfs_trace_page *tage;
         struct cfs_trace_page *tmp;
         cfs_file_t *filp;
+        char *buf;
         int last_loop = 0;
         int rc;
 
@@ -1012,6 +1787,15 @@ static int tracefiled(void *arg)
                         goto end_loop;
                 }
 
+                /* for formatting deferred records */
+                buf = cfs_alloc(CFS_PAGE_SIZE, CFS_ALLOC_STD);
+                if (buf == NULL) {
+                        cfs_filp_close(filp);
+                        put_pages_on_daemon_list(&pc);
+                        __LASSERT(cfs_list_empty(&pc.pc_pages));
+                        goto end_loop;
+                }
+
                 CFS_MMSPACE_OPEN;
 
                 cfs_list_for_each_entry_safe_typed(tage, tmp, &pc.pc_pages,
@@ -1026,16 +1810,15 @@ static int tracefiled(void *arg)
                         else if (f_pos > (off_t)cfs_filp_size(filp))
                                 f_pos = cfs_filp_size(filp);
 
-                        rc = cfs_filp_write(filp, cfs_page_address(tage->page),
-                                            tage->used, &f_pos);
-                        if (rc != (int)tage->used) {
-                                printk(CFS_KERN_WARNING "wanted to write %u "
-                                       "but wrote %d\n", tage->used, rc);
+                        rc = cfs_tage_write(filp, tage, buf, &f_pos);
+                        if (rc != 0) {
                                 put_pages_back(&pc);
                                 __LASSERT(cfs_list_empty(&pc.pc_pages));
+                                break;
                         }
                 }
                 CFS_MMSPACE_CLOSE;
+                cfs_free(buf);
 
                 cfs_filp_close(filp);
                 put_pages_on_daemon_list(&pc);
@@ -1135,6 +1918,14 @@ int cfs_tracefile_init(int max_pages)
         if (rc != 0)
                 return rc;
 
+        /* without it messages are formatted when logged */
+        cfs_spin_lock_init(&cfs_trace_fmt_lock);
+        cfs_trace_fmts = cfs_alloc_large(CFS_TRACE_FMT_SIZE *
+                                         sizeof(*cfs_trace_fmts));
+        if (cfs_trace_fmts != NULL)
+                memset(cfs_trace_fmts, 0,
+                       CFS_TRACE_FMT_SIZE * sizeof(*cfs_trace_fmts));
+
         cfs_tcd_for_each(tcd, i, j) {
                 /* tcd_pages_factor is initialized int tracefile_init_arch. */
                 factor = tcd->tcd_pages_factor;
@@ -1188,6 +1979,16 @@ static void cfs_trace_cleanup(void)
         trace_cleanup_on_all_cpus();
 
         cfs_tracefile_fini_arch();
+
+        if (cfs_trace_fmts != NULL) {
+                int i;
+
+                for (i = 0; i < CFS_TRACE_FMT_SIZE; i++)
+                        if (cfs_trace_fmts[i].ctf_copy != NULL)
+                                cfs_free(cfs_trace_fmts[i].ctf_copy);
+                cfs_free_large(cfs_trace_fmts);
+                cfs_trace_fmts = NULL;
+        }
 }
 
 void cfs_tracefile_exit(void)
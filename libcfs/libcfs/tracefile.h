@@ -68,6 +68,7 @@ void cfs_trace_debug_print(void);
 void cfs_trace_flush_pages(void);
 int cfs_trace_start_thread(void);
 void cfs_trace_stop_thread(void);
+void cfs_trace_fmt_forget(const void *start, unsigned long size);
 int cfs_tracefile_init(int max_pages);
 void cfs_tracefile_exit(void);
 
@@ -257,6 +258,10 @@ struct cfs_trace_page {
 	 * type(context) of this page
 	 */
 	unsigned short       type;
+	/*
+	 * page holds records with PH_FLAG_DEFERRED
+	 */
+	unsigned short       deferred;
 };
 
 extern void cfs_set_ptldebug_header(struct ptldebug_header *header,
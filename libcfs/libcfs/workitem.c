@@ -56,42 +56,91 @@ typedef struct cfs_wi_sched {
         cfs_list_t      ws_rerunq;
         /** shutting down */
         int             ws_shuttingdown;
+        /** CPU partition served by this scheduler, -1 for the serial one */
+        int             ws_cpt;
+        /** # of threads of this scheduler */
+        int             ws_nthreads;
+        /** # of workitems run */
+        __u64           ws_nrun;
+        /** time spent running workitems, in microseconds */
+        __u64           ws_runtime;
 } cfs_wi_sched_t;
 
-#ifdef __KERNEL__
 /**
- * we have 2 cfs_wi_sched_t so far:
- * one for CFS_WI_SCHED_ANY, another for CFS_WI_SCHED_SERIAL
- * per-cpu implementation will be added for SMP scalability
+ * There is one cfs_wi_sched_t for each CPU partition, and the last one
+ * is for CFS_WI_SCHED_SERIAL.  Userspace always has a single partition.
  */
-
-#define CFS_WI_NSCHED   2
-#else
-/** always 2 for userspace */
-#define CFS_WI_NSCHED   2
-#endif /* __KERNEL__ */
-
 struct cfs_workitem_data {
         /** serialize */
         cfs_spinlock_t  wi_glock;
         /** number of cfs_wi_sched_t */
         int             wi_nsched;
+        /** number of CPU partitions */
+        int             wi_ncpts;
         /** number of threads (all schedulers) */
         int             wi_nthreads;
         /** default scheduler */
         cfs_wi_sched_t *wi_scheds;
+#ifdef __KERNEL__
+        /** CPU partition of each CPU */
+        int            *wi_cpu2cpt;
+#endif
 } cfs_wi_data;
 
+#ifdef __KERNEL__
+static int wi_ncpts = 0;
+CFS_MODULE_PARM(wi_ncpts, "i", int, 0444,
+                "# of CPU partitions of workitem schedulers, "
+                "0 for one per NUMA node");
+#endif
+
+int
+cfs_cpt_number(void)
+{
+        return cfs_wi_data.wi_ncpts;
+}
+CFS_EXPORT_SYMBOL(cfs_cpt_number);
+
+int
+cfs_cpt_of_cpu(int cpu)
+{
+#ifdef __KERNEL__
+        LASSERT(cpu >= 0 && cpu < CFS_NR_CPUS);
+        return cfs_wi_data.wi_cpu2cpt[cpu];
+#else
+        return 0;
+#endif
+}
+CFS_EXPORT_SYMBOL(cfs_cpt_of_cpu);
+
+int
+cfs_cpt_current(void)
+{
+#ifdef __KERNEL__
+        int cpt = cfs_cpt_of_cpu(cfs_get_cpu());
+
+        cfs_put_cpu();
+        return cpt;
+#else
+        return 0;
+#endif
+}
+CFS_EXPORT_SYMBOL(cfs_cpt_current);
+
 static inline cfs_wi_sched_t *
 cfs_wi_to_sched(cfs_workitem_t *wi)
 {
         LASSERT(wi->wi_sched_id == CFS_WI_SCHED_ANY ||
                 wi->wi_sched_id == CFS_WI_SCHED_SERIAL ||
                 (wi->wi_sched_id >= 0 &&
-                 wi->wi_sched_id < cfs_wi_data.wi_nsched));
+                 wi->wi_sched_id < cfs_wi_data.wi_ncpts));
 
+        /* spread unbound workitems over partitions by address (low bits
+         * are mostly alignment), a workitem always stays on the same
+         * one so it can't run on two schedulers at once */
         if (wi->wi_sched_id == CFS_WI_SCHED_ANY)
-                return &cfs_wi_data.wi_scheds[0];
+                return &cfs_wi_data.wi_scheds[((unsigned long)wi >> 6) %
+                                              cfs_wi_data.wi_ncpts];
         if (wi->wi_sched_id == CFS_WI_SCHED_SERIAL)
                 return &cfs_wi_data.wi_scheds[cfs_wi_data.wi_nsched - 1];
 
@@ -248,22 +297,105 @@ CFS_EXPORT_SYMBOL(cfs_wi_schedule);
 
 #ifdef __KERNEL__
 
+/**
+ * Build the CPU to partition map.  By default there is one partition per
+ * online NUMA node; with wi_ncpts=N online CPUs are split into N
+ * partitions of consecutive CPUs.
+ */
+static int
+cfs_cpt_setup(void)
+{
+        int ncpus = cfs_num_online_cpus();
+        int ncpts;
+        int rank;
+        int node;
+        int cpu;
+        int i;
+
+        LIBCFS_ALLOC(cfs_wi_data.wi_cpu2cpt, CFS_NR_CPUS * sizeof(int));
+        if (cfs_wi_data.wi_cpu2cpt == NULL)
+                return -ENOMEM;
+
+        if (wi_ncpts > 0)
+                ncpts = min(wi_ncpts, ncpus);
+        else
+                ncpts = max_t(int, cfs_num_online_nodes(), 1);
+
+        rank = 0;
+        cfs_for_each_possible_cpu(cpu) {
+                if (!cfs_cpu_online(cpu)) {
+                        cfs_wi_data.wi_cpu2cpt[cpu] = cpu % ncpts;
+                        continue;
+                }
+
+                if (wi_ncpts > 0) {
+                        cfs_wi_data.wi_cpu2cpt[cpu] = rank++ * ncpts / ncpus;
+                        continue;
+                }
+
+                /* index of the node of @cpu among online nodes */
+                i = 0;
+                cfs_for_each_online_node(node) {
+                        if (node == cfs_cpu_to_node(cpu))
+                                break;
+                        i++;
+                }
+                cfs_wi_data.wi_cpu2cpt[cpu] = i % ncpts;
+        }
+
+        cfs_wi_data.wi_ncpts = ncpts;
+        return 0;
+}
+
+/** # of online CPUs in partition @cpt */
+static int
+cfs_cpt_online_cpus(int cpt)
+{
+        int n = 0;
+        int cpu;
+
+        cfs_for_each_possible_cpu(cpu) {
+                if (cfs_cpu_online(cpu) && cfs_wi_data.wi_cpu2cpt[cpu] == cpt)
+                        n++;
+        }
+        return n;
+}
+
+/** bind current thread on CPUs of partition @cpt */
+static void
+cfs_cpt_bind(int cpt)
+{
+#if defined(CONFIG_SMP) && defined(CPU_AFFINITY)
+        cpumask_t mask = CPU_MASK_NONE;
+        int       cpu;
+
+        cfs_for_each_possible_cpu(cpu) {
+                if (cfs_cpu_online(cpu) && cfs_wi_data.wi_cpu2cpt[cpu] == cpt)
+                        cpu_set(cpu, mask);
+        }
+
+        if (!cpus_empty(mask))
+                cfs_set_cpus_allowed(current, mask);
+#endif
+}
+
+/* @arg is index of scheduler << 16 | index of thread */
+#define CFS_WI_THREAD_ARG(sched, thread)        ((sched) << 16 | (thread))
+
 static int
 cfs_wi_scheduler (void *arg)
 {
-        int             id     = (int)(long_ptr_t) arg;
-        int             serial = (id == -1);
+        int             id    = (int)(long_ptr_t) arg;
+        cfs_wi_sched_t *sched = &cfs_wi_data.wi_scheds[id >> 16];
         char            name[24];
-        cfs_wi_sched_t *sched;
 
-        if (serial) {
-                sched = &cfs_wi_data.wi_scheds[cfs_wi_data.wi_nsched - 1];
+        if (sched->ws_cpt < 0) {
                 cfs_daemonize("wi_serial_sd");
         } else {
-                /* will be sched = &cfs_wi_data.wi_scheds[id] in the future */
-                sched = &cfs_wi_data.wi_scheds[0];
-                snprintf(name, sizeof(name), "cfs_wi_sd%03d", id);
+                snprintf(name, sizeof(name), "cfs_wi_sd%02d_%02d",
+                         sched->ws_cpt, id & 0xffff);
                 cfs_daemonize(name);
+                cfs_cpt_bind(sched->ws_cpt);
         }
 
         cfs_block_allsigs();
@@ -273,6 +405,9 @@ cfs_wi_scheduler (void *arg)
         while (!sched->ws_shuttingdown) {
                 int             nloops = 0;
                 int             rc;
+                long            usec;
+                struct timeval  start;
+                struct timeval  end;
                 cfs_workitem_t *wi;
 
                 while (!cfs_list_empty(&sched->ws_runq) &&
@@ -288,9 +423,15 @@ cfs_wi_scheduler (void *arg)
                         cfs_wi_sched_unlock(sched);
                         nloops++;
 
+                        cfs_gettimeofday(&start);
                         rc = (*wi->wi_action) (wi);
+                        cfs_gettimeofday(&end);
 
+                        usec = cfs_timeval_sub(&end, &start, NULL);
                         cfs_wi_sched_lock(sched);
+                        sched->ws_nrun++;
+                        if (usec > 0)
+                                sched->ws_runtime += usec;
                         if (rc != 0) /* WI should be dead, even be freed! */
                                 continue;
 
@@ -413,34 +554,55 @@ cfs_wi_sched_shutdown(cfs_wi_sched_t *sched)
 int
 cfs_wi_startup (void)
 {
-        int i;
-        int n;
-        int rc;
+        cfs_wi_sched_t *sched;
+        int             i;
+        int             j;
+        int             rc;
 
         cfs_wi_data.wi_nthreads = 0;
-        cfs_wi_data.wi_nsched   = CFS_WI_NSCHED;
+#ifdef __KERNEL__
+        rc = cfs_cpt_setup();
+        if (rc != 0)
+                return rc;
+#else
+        cfs_wi_data.wi_ncpts = 1;
+#endif
+        cfs_wi_data.wi_nsched = cfs_wi_data.wi_ncpts + 1;
         LIBCFS_ALLOC(cfs_wi_data.wi_scheds,
                      cfs_wi_data.wi_nsched * sizeof(cfs_wi_sched_t));
-        if (cfs_wi_data.wi_scheds == NULL)
+        if (cfs_wi_data.wi_scheds == NULL) {
+                cfs_wi_shutdown();
                 return -ENOMEM;
+        }
 
         cfs_spin_lock_init(&cfs_wi_data.wi_glock);
-        for (i = 0; i < cfs_wi_data.wi_nsched; i++)
-                cfs_wi_sched_init(&cfs_wi_data.wi_scheds[i]);
+        for (i = 0; i < cfs_wi_data.wi_nsched; i++) {
+                sched = &cfs_wi_data.wi_scheds[i];
+                cfs_wi_sched_init(sched);
+                sched->ws_cpt = i < cfs_wi_data.wi_ncpts ? i : -1;
+        }
 
 #ifdef __KERNEL__
-        n = cfs_num_online_cpus();
-        for (i = 0; i <= n; i++) {
-                rc = cfs_wi_start_thread(cfs_wi_scheduler,
-                                         (void *)(long_ptr_t)(i == n ? -1 : i));
-                if (rc != 0) {
-                        CERROR ("Can't spawn workitem scheduler: %d\n", rc);
-                        cfs_wi_shutdown();
-                        return rc;
+        for (i = 0; i < cfs_wi_data.wi_nsched; i++) {
+                sched = &cfs_wi_data.wi_scheds[i];
+                /* one thread per online CPU of the partition */
+                sched->ws_nthreads = sched->ws_cpt < 0 ? 1 :
+                                     max(cfs_cpt_online_cpus(sched->ws_cpt),
+                                         1);
+                for (j = 0; j < sched->ws_nthreads; j++) {
+                        rc = cfs_wi_start_thread(cfs_wi_scheduler,
+                                        (void *)(long_ptr_t)
+                                        CFS_WI_THREAD_ARG(i, j));
+                        if (rc != 0) {
+                                CERROR ("Can't spawn workitem scheduler: "
+                                        "%d\n", rc);
+                                cfs_wi_shutdown();
+                                return rc;
+                        }
                 }
         }
 #else
-        n = rc = 0;
+        j = rc = 0;
 #endif
 
         return 0;
@@ -452,7 +614,7 @@ cfs_wi_shutdown (void)
         int i;
 
         if (cfs_wi_data.wi_scheds == NULL)
-                return;
+                goto out;
 
         for (i = 0; i < cfs_wi_data.wi_nsched; i++)
                 cfs_wi_sched_shutdown(&cfs_wi_data.wi_scheds[i]);
@@ -474,5 +636,61 @@ cfs_wi_shutdown (void)
 #endif
         LIBCFS_FREE(cfs_wi_data.wi_scheds,
                     cfs_wi_data.wi_nsched * sizeof(cfs_wi_sched_t));
+        cfs_wi_data.wi_scheds = NULL;
+ out:
+#ifdef __KERNEL__
+        if (cfs_wi_data.wi_cpu2cpt != NULL) {
+                LIBCFS_FREE(cfs_wi_data.wi_cpu2cpt, CFS_NR_CPUS * sizeof(int));
+                cfs_wi_data.wi_cpu2cpt = NULL;
+        }
+#endif
         return;
 }
+
+/**
+ * Print queue length, # of workitems run and run time of each scheduler
+ * to @buf, return # of bytes printed.
+ */
+int
+cfs_wi_stats_print(char *buf, int size)
+{
+        cfs_wi_sched_t *sched;
+        cfs_list_t     *pos;
+        char            name[16];
+        __u64           nrun;
+        __u64           runtime;
+        int             queued;
+        int             c;
+        int             i;
+
+        c = snprintf(buf, size, "%-8s %7s %7s %14s %14s\n",
+                     "sched", "threads", "queued", "run", "runtime_us");
+
+        for (i = 0; i < cfs_wi_data.wi_nsched && c < size; i++) {
+                sched = &cfs_wi_data.wi_scheds[i];
+
+                queued = 0;
+                cfs_wi_sched_lock(sched);
+                cfs_list_for_each(pos, &sched->ws_runq)
+                        queued++;
+                cfs_list_for_each(pos, &sched->ws_rerunq)
+                        queued++;
+                nrun    = sched->ws_nrun;
+                runtime = sched->ws_runtime;
+                cfs_wi_sched_unlock(sched);
+
+                if (sched->ws_cpt < 0)
+                        snprintf(name, sizeof(name), "serial");
+                else
+                        snprintf(name, sizeof(name), "cpt%d", sched->ws_cpt);
+
+                c += snprintf(buf + c, size - c,
+                              "%-8s %7d %7d %14llu %14llu\n",
+                              name, sched->ws_nthreads, queued,
+                              (unsigned long long)nrun,
+                              (unsigned long long)runtime);
+        }
+
+        return min(c, size);
+}
+CFS_EXPORT_SYMBOL(cfs_wi_stats_print);
@@ -978,6 +978,7 @@ sfw_run_batch (sfw_batch_t *tsb)
         swi_workitem_t      *wi;
         sfw_test_unit_t     *tsu;
         sfw_test_instance_t *tsi;
+        int                  cpt = 0;
 
         if (sfw_batch_active(tsb)) {
                 CDEBUG(D_NET, "Batch already active: "LPU64" (%d)\n",
@@ -1000,8 +1001,9 @@ sfw_run_batch (sfw_batch_t *tsb)
                         cfs_atomic_inc(&tsi->tsi_nactive);
                         tsu->tsu_loop = tsi->tsi_loop;
                         wi = &tsu->tsu_worker;
+                        /* spread test units over CPU partitions */
                         swi_init_workitem(wi, tsu, sfw_run_test,
-                                          CFS_WI_SCHED_ANY);
+                                          cpt++ % cfs_cpt_number());
                         swi_schedule_workitem(wi);
                 }
         }
@@ -191,7 +191,7 @@ srpc_init_server_rpc (srpc_server_rpc_t *rpc,
         memset(rpc, 0, sizeof(*rpc));
         swi_init_workitem(&rpc->srpc_wi, rpc, srpc_handle_rpc,
                           sv->sv_id <= SRPC_FRAMEWORK_SERVICE_MAX_ID ?
-                          CFS_WI_SCHED_SERIAL : CFS_WI_SCHED_ANY);
+                          CFS_WI_SCHED_SERIAL : cfs_cpt_current());
 
         rpc->srpc_ev.ev_fired = 1; /* no event expected now */
 
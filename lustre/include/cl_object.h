@@ -2370,6 +2370,8 @@ struct cl_req_attr {
         struct obdo     *cra_oa;
         /** Capability. */
         struct obd_capa *cra_capa;
+        /** Job ID of the process which dirtied or asked for the pages. */
+        char             cra_jobid[JOBSTATS_JOBID_SIZE];
 };
 
 /**
@@ -72,6 +72,8 @@ struct dt_device_param {
         unsigned           ddp_max_name_len;
         unsigned           ddp_max_nlink;
         unsigned           ddp_block_shift;
+        /** number of containers the object index is split over */
+        unsigned           ddp_oi_count;
 };
 
 /**
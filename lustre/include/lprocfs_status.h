@@ -93,6 +93,8 @@ enum {
         BRW_W_DISK_IOSIZE,
         BRW_R_DIO_FRAGS,
         BRW_W_DIO_FRAGS,
+        BRW_R_MERGED_RPCS,
+        BRW_W_MERGED_RPCS,
         BRW_LAST,
 };
 
@@ -120,12 +122,18 @@ struct brw_stats {
  * squares (for multi-valued counter samples only). This allows
  * external computation of standard deviation, but involves a 64-bit
  * multiply per counter increment.
+ *
+ * LPROCFS_CNTR_HISTOGRAM keeps a per-CPU log2 histogram of the samples
+ * (for multi-valued counter samples only), e.g. for latencies: bucket
+ * N counts the samples in [2^(N-1), 2^N).  The histogram is shown after
+ * the other fields of the counter in the stats file.
  */
 
 enum {
         LPROCFS_CNTR_EXTERNALLOCK = 0x0001,
         LPROCFS_CNTR_AVGMINMAX    = 0x0002,
         LPROCFS_CNTR_STDDEV       = 0x0004,
+        LPROCFS_CNTR_HISTOGRAM    = 0x0008,
 
         /* counter data type */
         LPROCFS_TYPE_REGS         = 0x0100,
@@ -134,16 +142,25 @@ enum {
         LPROCFS_TYPE_CYCLE        = 0x0800,
 };
 
-struct lprocfs_atomic {
-        cfs_atomic_t               la_entry;
-        cfs_atomic_t               la_exit;
-};
-
 #define LC_MIN_INIT ((~(__u64)0) >> 1)
 
+/* # of buckets of a LPROCFS_CNTR_HISTOGRAM counter */
+#define LPROCFS_HIST_MAX       32
+
+/*
+ * A counter is only updated by the CPU owning its per-CPU area, with
+ * preemption disabled (or under ls_lock for the single area of
+ * LPROCFS_STATS_FLAG_NOPERCPU stats and the shared area 0 of
+ * LPROCFS_STATS_FLAG_LAZY stats), so updates need no atomic operations.
+ * The owner makes lc_seq odd while it updates the counter, readers on
+ * other CPUs retry until they see the same even lc_seq before and after
+ * reading.
+ */
 struct lprocfs_counter {
-        struct lprocfs_atomic  lc_cntl;  /* may need to move to per set */
+        unsigned int           lc_seq;
         unsigned int           lc_config;
+        unsigned int           lc_gen;    /* lprocfs_stats_gen of the last
+                                           * update, for stats snapshots */
         __s64                  lc_count;
         __s64                  lc_sum;
         __s64                  lc_sum_irq;
@@ -152,6 +169,9 @@ struct lprocfs_counter {
         __s64                  lc_sumsquare;
         const char            *lc_name;   /* must be static */
         const char            *lc_units;  /* must be static */
+        /* LPROCFS_CNTR_HISTOGRAM: LPROCFS_HIST_MAX buckets per CPU area,
+         * shared by the counters of all areas */
+        __u32                 *lc_hist;
 };
 
 struct lprocfs_percpu {
@@ -168,6 +188,9 @@ enum lprocfs_stats_flags {
         LPROCFS_STATS_FLAG_NONE     = 0x0000, /* per cpu counter */
         LPROCFS_STATS_FLAG_NOPERCPU = 0x0001, /* stats have no percpu
                                                * area and need locking */
+        LPROCFS_STATS_FLAG_LAZY     = 0x0002, /* locked area 0 and percpu
+                                               * areas allocated on first
+                                               * update from their cpu */
 };
 
 enum lprocfs_fields_flags {
@@ -185,9 +208,24 @@ struct lprocfs_stats {
         int                    ls_flags; /* See LPROCFS_STATS_FLAG_* */
         cfs_spinlock_t         ls_lock;  /* Lock used only when there are
                                           * no percpu stats areas */
+        cfs_time_t             ls_nomem; /* LAZY: no percpu area is
+                                          * allocated before this time */
         struct lprocfs_percpu *ls_percpu[0];
 };
 
+typedef void (*cntr_init_callback)(struct lprocfs_stats *stats);
+
+/* per-job stats of a target, see lprocfs_jobstats.c */
+struct obd_job_stats {
+        cfs_hash_t            *ojs_hash;     /* job_stat by job ID */
+        cfs_list_t             ojs_list;     /* all job_stat, for job_stats */
+        cfs_rwlock_t           ojs_lock;     /* protects ojs_list */
+        int                    ojs_cntr_num; /* # of counters of a job */
+        cntr_init_callback     ojs_cntr_init_fn;
+        unsigned int           ojs_cleanup_interval; /* idle jobs expire, s */
+        time_t                 ojs_last_cleanup;
+};
+
 #define OPC_RANGE(seg) (seg ## _LAST_OPC - seg ## _FIRST_OPC)
 
 /* Pack all opcodes down into a single monotonically increasing index */
@@ -322,6 +360,7 @@ enum {
 extern cfs_proc_dir_entry_t *proc_lustre_root;
 
 struct obd_device;
+struct obd_ioctl_data;
 struct obd_histogram;
 
 /* Days / hours / mins / seconds format */
@@ -343,8 +382,31 @@ static inline void s2dhms(struct dhms *ts, time_t secs)
 
 #ifdef LPROCFS
 
+/* # of areas of stats with \a flags */
+static inline unsigned int lprocfs_stats_num_areas(int flags)
+{
+        if (flags & LPROCFS_STATS_FLAG_NOPERCPU)
+                return 1;
+        if (flags & LPROCFS_STATS_FLAG_LAZY)
+                return cfs_num_possible_cpus() + 1;
+        return cfs_num_possible_cpus();
+}
+
+extern int lprocfs_stats_alloc_one(struct lprocfs_stats *stats,
+                                   unsigned int smp_id);
+
+/*
+ * Lazy stats are allocated with area 0 only, which is as big as the area
+ * of NOPERCPU stats and is updated under ls_lock.  Cpu N allocates area
+ * N + 1 on its first update and updates it without locking from then on.
+ * When that allocation fails the update goes to area 0.  Preemption stays
+ * disabled until lprocfs_stats_unlock(), so no area of this cpu appears
+ * meanwhile: lazy stats are not updated from interrupt context.
+ */
 static inline int lprocfs_stats_lock(struct lprocfs_stats *stats, int opc)
 {
+        int smp_id;
+
         switch (opc) {
         default:
                 LBUG();
@@ -353,16 +415,24 @@ static inline int lprocfs_stats_lock(struct lprocfs_stats *stats, int opc)
                 if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU) {
                         cfs_spin_lock(&stats->ls_lock);
                         return 0;
-                } else {
-                        return cfs_get_cpu();
                 }
+                smp_id = cfs_get_cpu();
+                if (stats->ls_flags & LPROCFS_STATS_FLAG_LAZY) {
+                        smp_id++;
+                        if (unlikely(stats->ls_percpu[smp_id] == NULL) &&
+                            lprocfs_stats_alloc_one(stats, smp_id) != 0) {
+                                cfs_spin_lock(&stats->ls_lock);
+                                return 0;
+                        }
+                }
+                return smp_id;
 
         case LPROCFS_GET_NUM_CPU:
                 if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU) {
                         cfs_spin_lock(&stats->ls_lock);
                         return 1;
                 } else {
-                        return cfs_num_possible_cpus();
+                        return lprocfs_stats_num_areas(stats->ls_flags);
                 }
         }
 }
@@ -374,10 +444,14 @@ static inline void lprocfs_stats_unlock(struct lprocfs_stats *stats, int opc)
                 LBUG();
 
         case LPROCFS_GET_SMP_ID:
-                if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU)
+                if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU) {
                         cfs_spin_unlock(&stats->ls_lock);
-                else
-                        cfs_put_cpu();
+                        return;
+                }
+                if ((stats->ls_flags & LPROCFS_STATS_FLAG_LAZY) &&
+                    stats->ls_percpu[cfs_smp_processor_id() + 1] == NULL)
+                        cfs_spin_unlock(&stats->ls_lock);
+                cfs_put_cpu();
                 return;
 
         case LPROCFS_GET_NUM_CPU:
@@ -387,10 +461,66 @@ static inline void lprocfs_stats_unlock(struct lprocfs_stats *stats, int opc)
         }
 }
 
+static inline unsigned int lprocfs_stats_percpu_size(unsigned int num,
+                                                     unsigned int num_cpu)
+{
+        unsigned int percpusize;
+
+        percpusize = offsetof(struct lprocfs_percpu, lp_cntr[num]);
+        if (num_cpu > 1)
+                percpusize = CFS_L1_CACHE_ALIGN(percpusize);
+        return percpusize;
+}
+
+/* size of area \a i of \a stats, the shared area 0 of LAZY stats is not
+ * aligned, like the single area of NOPERCPU stats */
+static inline unsigned int lprocfs_stats_area_size(struct lprocfs_stats *stats,
+                                                   unsigned int i)
+{
+        if (i == 0 && (stats->ls_flags & LPROCFS_STATS_FLAG_LAZY))
+                return lprocfs_stats_percpu_size(stats->ls_num, 1);
+        return lprocfs_stats_percpu_size(stats->ls_num,
+                                lprocfs_stats_num_areas(stats->ls_flags));
+}
+
+/* bumped by every stats snapshot, see OBD_IOC_STATS_SNAPSHOT */
+extern cfs_atomic_t lprocfs_stats_gen;
+
+/* see the comment above struct lprocfs_counter */
+static inline void lprocfs_counter_write_begin(struct lprocfs_counter *lc)
+{
+        lc->lc_seq++;
+        smp_wmb();
+        lc->lc_gen = cfs_atomic_read(&lprocfs_stats_gen);
+}
+
+static inline void lprocfs_counter_write_end(struct lprocfs_counter *lc)
+{
+        smp_wmb();
+        lc->lc_seq++;
+}
+
+static inline unsigned int
+lprocfs_counter_read_begin(struct lprocfs_counter *lc)
+{
+        unsigned int seq = *(volatile unsigned int *)&lc->lc_seq;
+
+        smp_rmb();
+        return seq;
+}
+
+static inline int lprocfs_counter_read_retry(struct lprocfs_counter *lc,
+                                             unsigned int seq)
+{
+        smp_rmb();
+        return (seq & 1) != 0 ||
+               seq != *(volatile unsigned int *)&lc->lc_seq;
+}
+
 /* Two optimized LPROCFS counter increment functions are provided:
  *     lprocfs_counter_incr(cntr, value) - optimized for by-one counters
  *     lprocfs_counter_add(cntr) - use for multi-valued counters
- * Counter data layout allows config flag, counter lock and the
+ * Counter data layout allows config flag, update sequence and the
  * count itself to reside within a single cache line.
  */
 
@@ -414,9 +544,13 @@ static inline __u64 lprocfs_stats_collector(struct lprocfs_stats *stats,
         int i;
 
         LASSERT(stats != NULL);
-        for (i = 0; i < cfs_num_possible_cpus(); i++)
+        for (i = 0; i < lprocfs_stats_num_areas(stats->ls_flags); i++) {
+                /* LAZY stats may have holes */
+                if (stats->ls_percpu[i] == NULL)
+                        continue;
                 ret += lprocfs_read_helper(&(stats->ls_percpu[i]->lp_cntr[idx]),
                                            field);
+        }
         return ret;
 }
 
@@ -571,6 +705,17 @@ unsigned long lprocfs_oh_sum(struct obd_histogram *oh);
 
 void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt);
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+                                __u64 *hist);
+int lprocfs_stats_snapshot(struct obd_device *obd,
+                           struct obd_ioctl_data *data);
+
+/* lprocfs_jobstats.c */
+int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
+                           cntr_init_callback init_fn);
+void lprocfs_job_stats_fini(struct obd_device *obd);
+int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
+                          int event, long amount);
 
 /* lprocfs_status.c: recovery status */
 int lprocfs_obd_rd_recovery_status(char *page, char **start, off_t off,
@@ -905,6 +1050,25 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt)
 { return; }
 static inline
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+                                __u64 *hist)
+{ return; }
+static inline
+int lprocfs_stats_snapshot(struct obd_device *obd,
+                           struct obd_ioctl_data *data)
+{ return -EOPNOTSUPP; }
+static inline
+int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
+                           cntr_init_callback init_fn)
+{ return 0; }
+static inline
+void lprocfs_job_stats_fini(struct obd_device *obd)
+{ return; }
+static inline
+int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
+                          int event, long amount)
+{ return 0; }
+static inline
 __u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
                                enum lprocfs_fields_flags field)
 { return (__u64)0; }
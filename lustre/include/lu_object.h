@@ -537,7 +537,8 @@ struct lu_object_header {
          */
         cfs_hlist_node_t       loh_hash;
         /**
-         * Linkage into per-site LRU list. Protected by lu_site::ls_guard.
+         * Linkage into the LRU list of the hash bucket while the object is
+         * not referenced. Protected by the bucket lock.
          */
         cfs_list_t             loh_lru;
         /**
@@ -559,14 +560,19 @@ struct lu_site_bkt_data {
          */
         long                      lsb_busy;
         /**
-         * LRU list, updated on each access to object. Protected by
+         * LRU list of the unreferenced objects of this bucket. Protected by
          * bucket lock of lu_site::ls_obj_hash.
          *
-         * "Cold" end of LRU is lu_site::ls_lru.next. Accessed object are
-         * moved to the lu_site::ls_lru.prev (this is due to the non-existence
-         * of list_for_each_entry_safe_reverse()).
+         * An object is taken off the LRU when the first reference to it is
+         * taken through the hash (lookup or iteration) and put back at
+         * lsb_lru.prev when the last reference is released, so the "cold"
+         * end is lsb_lru.next.
          */
         cfs_list_t                lsb_lru;
+        /**
+         * number of objects in lsb_lru
+         */
+        long                      lsb_lru_len;
         /**
          * Wait-queue signaled when an object in this site is ultimately
          * destroyed (lu_object_free()). It is used by lu_object_find() to
@@ -585,6 +591,7 @@ enum {
         LU_SS_CACHE_RACE,
         LU_SS_CACHE_DEATH_RACE,
         LU_SS_LRU_PURGED,
+        LU_SS_PURGE_TIME,
         LU_SS_LAST_STAT
 };
 
@@ -620,6 +627,16 @@ struct lu_site {
          */
         struct lprocfs_stats     *ls_stats;
         struct lprocfs_stats     *ls_time_stats;
+        /**
+         * Maximal number of unreferenced objects cached, 0 for no limit
+         * other than memory pressure. Each bucket keeps its share of it.
+         */
+        unsigned long             ls_cache_max;
+        /**
+         * Purges the buckets over their share of ls_cache_max in the
+         * background.
+         */
+        cfs_workitem_t            ls_purge_wi;
 };
 
 static inline struct lu_site_bkt_data *
@@ -1245,6 +1262,8 @@ int  lu_env_refill(struct lu_env *env);
  * ll_rd_*()-style functions.
  */
 int lu_site_stats_print(const struct lu_site *s, char *page, int count);
+int lu_site_cache_print(const struct lu_site *s, char *page, int count);
+void lu_site_cache_max_set(struct lu_site *s, unsigned long max);
 
 /**
  * Common name structure to be passed around for various name related methods.
@@ -213,14 +213,14 @@ extern int llapi_path2fid(const char *path, lustre_fid *fid);
 extern int llapi_get_version(char *buffer, int buffer_size, char **version);
 
 /* Changelog interface.  priv is private state, managed internally
-   by these functions */
-#define CHANGELOG_FLAG_FOLLOW 0x01   /* Not yet implemented */
-#define CHANGELOG_FLAG_BLOCK  0x02   /* Blocking IO makes sense in case of
-   slow user parsing of the records, but it also prevents us from cleaning
-   up if the records are not consumed. */
-
+   by these functions.  Start flags (CHANGELOG_FLAG_*) are in lustre_user.h */
 extern int llapi_changelog_start(void **priv, int flags, const char *mdtname,
                                  long long startrec);
+/* As above, but only receive the records matching filter */
+extern int llapi_changelog_start_filter(void **priv, int flags,
+                                        const char *mdtname,
+                                        long long startrec,
+                                        const struct changelog_filter *filter);
 extern int llapi_changelog_fini(void **priv);
 extern int llapi_changelog_recv(void *priv, struct changelog_rec **rech);
 extern int llapi_changelog_free(struct changelog_rec **rech);
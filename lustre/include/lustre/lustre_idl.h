@@ -949,6 +949,8 @@ struct lustre_msg_v2 {
 
 /* without gss, ptlrpc_body is put at the first buffer. */
 #define PTLRPC_NUM_VERSIONS     4
+#define JOBSTATS_JOBID_SIZE     32      /* including the trailing '\0' */
+
 struct ptlrpc_body {
         struct lustre_handle pb_handle;
         __u32 pb_type;
@@ -968,8 +970,9 @@ struct ptlrpc_body {
         __u64 pb_slv;
         /* VBR: pre-versions */
         __u64 pb_pre_versions[PTLRPC_NUM_VERSIONS];
-        /* padding for future needs */
-        __u64 pb_padding[4];
+        /* job identifier of the request, '\0' terminated; older clients
+         * leave it zeroed, it was padding before */
+        char  pb_jobid[JOBSTATS_JOBID_SIZE];
 };
 
 extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
@@ -2556,6 +2559,9 @@ struct llog_gen_rec {
 #define LLOG_F_ZAP_WHEN_EMPTY   0x1
 #define LLOG_F_IS_CAT           0x2
 #define LLOG_F_IS_PLAIN         0x4
+/* only in the llogd_body of a LLOG_ORIGIN_HANDLE_NEXT_BLOCK reply, never on
+ * disk: the server left out the records not matching the changelog_filter */
+#define LLOG_F_FILTERED         0x80000000
 
 struct llog_log_hdr {
         struct llog_rec_hdr     llh_hdr;
@@ -2708,6 +2714,7 @@ extern void lustre_swab_lov_mds_md(struct lov_mds_md *lmm);
 extern void lustre_swab_llogd_body (struct llogd_body *d);
 extern void lustre_swab_llog_hdr (struct llog_log_hdr *h);
 extern void lustre_swab_llogd_conn_body (struct llogd_conn_body *d);
+extern void lustre_swab_changelog_filter(struct changelog_filter *clf);
 extern void lustre_swab_llog_rec(struct llog_rec_hdr  *rec,
                                  struct llog_rec_tail *tail);
 
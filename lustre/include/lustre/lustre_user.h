@@ -601,6 +601,33 @@ struct ioc_changelog {
         __u32 icc_flags;
 };
 
+/* icc_flags */
+#define CHANGELOG_FLAG_FOLLOW 0x01   /* Not yet implemented */
+#define CHANGELOG_FLAG_BLOCK  0x02   /* Blocking IO makes sense in case of
+   slow user parsing of the records, but it also prevents us from cleaning
+   up if the records are not consumed. */
+
+/** The changelog records a reader wants.  The MDS applies the filter while
+ * it reads the log, so records that do not match are never sent.  This is
+ * also sent over the wire, with LLOG_ORIGIN_HANDLE_NEXT_BLOCK. */
+struct changelog_filter {
+        __u32      clf_mask;   /**< record types wanted, 1 << CL_xxx,
+                                    0 for all */
+        __u32      clf_user;   /**< leave out the records this changelog user
+                                    has cleared, 0 for none */
+        lustre_fid clf_fid;    /**< only records of entries under this
+                                    directory, zero fid for any */
+};
+
+/** OBD_IOC_CHANGELOG_FILTER argument.  icf_size is checked against the
+ * kernel's sizeof(struct ioc_changelog_filter), so the layout can change */
+struct ioc_changelog_filter {
+        struct ioc_changelog    icf_icc;
+        __u32                   icf_size;
+        __u32                   icf_padding;
+        struct changelog_filter icf_filter;
+};
+
 enum changelog_message_type {
         CL_RECORD = 10, /* message is a changelog_rec */
         CL_EOF    = 11, /* at end of current changelog */
@@ -879,6 +906,67 @@ struct hsm_progress {
         __u16             hp_errval; /* positive val */
 } __attribute__((packed));
 
+/********* Statistics snapshot *********/
+
+/* OBD_IOC_STATS_SNAPSHOT copies all lprocfs counters of a device into one
+ * binary snapshot: an obd_stats_hdr, then for every stats set an
+ * obd_stats_set followed by oss_nnames obd_stats_name and oss_nrecs
+ * obd_stats_rec.  Counters not used yet are left out.
+ *
+ * A non-zero "since" (osh_gen of an earlier snapshot) only returns the
+ * counters changed after that snapshot, and the sets holding them.  Some
+ * counters changed just before that snapshot may be returned again. */
+#define OBD_STATS_MAGIC         0x0bd57a75
+#define OBD_STATS_VERSION       1
+
+/* snapshot flags */
+#define OBD_STATS_FL_NAMES      0x0001  /* in: add counter names */
+#define OBD_STATS_FL_TRUNC      0x0002  /* out: buffer short of osh_len */
+
+enum obd_stats_set_type {
+        OBD_STATS_SET_OBD       = 1,    /* obd ops stats */
+        OBD_STATS_SET_MD        = 2,    /* md ops stats */
+        OBD_STATS_SET_SVC       = 3,    /* target service stats */
+        OBD_STATS_SET_EXP       = 4,    /* per-client stats, by NID */
+        OBD_STATS_SET_EXP_LDLM  = 5,    /* per-client ldlm stats, by NID */
+};
+
+struct obd_stats_hdr {
+        __u32   osh_magic;
+        __u16   osh_version;
+        __u16   osh_flags;
+        __u64   osh_time;               /* usec since the epoch */
+        __u32   osh_gen;                /* "since" of the next snapshot */
+        __u32   osh_len;                /* bytes of the whole snapshot */
+        __u32   osh_nsets;
+        __u32   osh_nrecs;
+};
+
+#define OBD_STATS_NAME_LEN      40
+
+struct obd_stats_set {
+        __u32   oss_type;               /* enum obd_stats_set_type */
+        __u32   oss_num;                /* # of counters in the set */
+        __u32   oss_nnames;             /* 0 or oss_num */
+        __u32   oss_nrecs;
+        char    oss_name[OBD_STATS_NAME_LEN];   /* NID for client sets */
+};
+
+struct obd_stats_name {
+        char    osn_name[32];
+        char    osn_units[16];
+};
+
+struct obd_stats_rec {
+        __u32   osr_idx;                /* counter index in its set */
+        __u32   osr_config;             /* LPROCFS_CNTR_* */
+        __u64   osr_count;
+        __s64   osr_sum;
+        __s64   osr_min;
+        __s64   osr_max;
+        __s64   osr_sumsquare;
+};
+
 /** @} lustreuser */
 
 #endif /* _LUSTRE_USER_H */
@@ -254,6 +254,8 @@ struct lustre_mount_data {
 #define OBD_INCOMPAT_IAM_DIR    0x00000040
 /** LMA attribute contains per-inode incompatible flags */
 #define OBD_INCOMPAT_LMA        0x00000080
+/** object index is split over several "oi.16.N" containers */
+#define OBD_INCOMPAT_MULTI_OI   0x00000100
 
 
 /* Data stored per server at the head of the last_rcvd file.  In le32 order.
@@ -877,9 +877,11 @@ extern char *ldlm_it2str(int it);
 #define ldlm_lock_debug(cdls, level, lock, file, func, line, fmt, a...) do { \
         CFS_CHECK_STACK();                                              \
                                                                         \
-        if (((level) & D_CANTMASK) != 0 ||                              \
-            ((libcfs_debug & (level)) != 0 &&                           \
-             (libcfs_subsystem_debug & DEBUG_SUBSYSTEM) != 0)) {        \
+        if ((((level) & D_CANTMASK) != 0 ||                             \
+             ((libcfs_debug & (level)) != 0 &&                          \
+              (libcfs_subsystem_debug & DEBUG_SUBSYSTEM) != 0)) &&      \
+            !cfs_cdebug_sampled_out(level, line,                        \
+                                    (lock)->l_handle.h_cookie)) {       \
                 static struct libcfs_debug_msg_data _ldlm_dbg_data =    \
                 DEBUG_MSG_DATA_INIT(cdls, DEBUG_SUBSYSTEM,              \
                                     file, func, line);                  \
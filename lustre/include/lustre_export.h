@@ -97,6 +97,14 @@ struct osc_creator {
         struct obdo             oscc_oa;
         int                     oscc_flags;
         cfs_waitq_t             oscc_waitq; /* creating procs wait on this */
+        /**
+         * Objects handed out since oscc_rate_stamp, and the decaying
+         * average of objects handed out per second, used to size
+         * precreate batches after demand.
+         */
+        int                     oscc_used;
+        int                     oscc_rate;
+        time_t                  oscc_rate_stamp;
 };
 
 struct ec_export_data { /* echo client */
@@ -114,6 +122,11 @@ struct filter_export_data {
         int                        fed_mod_count;/* items in fed_writing list */
         long                       fed_pending;  /* bytes just being written */
         __u32                      fed_group;
+        /* write rate estimate used to size grant, see filter_grant_demand();
+         * protected by obd_osfs_lock */
+        __u64                      fed_write_bytes; /* in current second */
+        __u64                      fed_write_rate;  /* bytes per second */
+        time_t                     fed_write_stamp; /* current second */
 };
 
 /**
@@ -107,6 +107,9 @@ enum local_oid {
         MDT_LAST_RECV_OID       = 11UL,
         /** \see osd_mod_init */
         OSD_REM_OBJ_DIR_OID     = 12UL,
+        /** \see osd_oi_init, devices with more than one oi container */
+        OSD_OI_FID_OID_FIRST    = 5000UL,
+        OSD_OI_FID_OID_LAST     = OSD_OI_FID_OID_FIRST + 63UL,
 };
 
 static inline void lu_local_obj_fid(struct lu_fid *fid, __u32 oid)
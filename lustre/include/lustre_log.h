@@ -96,6 +96,9 @@ struct llog_handle {
         int                     lgh_cur_idx;    /* used during llog_process */
         __u64                   lgh_cur_offset; /* used during llog_process */
         struct llog_ctxt       *lgh_ctxt;
+        /* sent with reads of the plain logs of a remote changelog catalog,
+         * for the server to leave out records the reader does not want */
+        struct changelog_filter *lgh_filter;
         union {
                 struct plain_handle_data phd;
                 struct cat_handle_data   chd;
@@ -105,6 +108,12 @@ struct llog_handle {
 /* llog.c  -  general API */
 typedef int (*llog_cb_t)(struct llog_handle *, struct llog_rec_hdr *, void *);
 typedef int (*llog_fill_rec_cb_t)(struct llog_rec_hdr *rec, void *data);
+/* returns 1 if \a rec matches \a filter, 0 if not; called with rec == NULL
+ * before each block of records is filtered */
+typedef int (*llog_filter_rec_cb_t)(const struct lu_env *env,
+                                    struct llog_rec_hdr *rec,
+                                    struct changelog_filter *filter,
+                                    void *data);
 extern struct llog_handle *llog_alloc_handle(void);
 int llog_init_handle(struct llog_handle *handle, int flags,
                      struct obd_uuid *uuid);
@@ -291,6 +300,12 @@ struct llog_ctxt {
         cfs_atomic_t             loc_refcount;
         void                    *llog_proc_cb;
         long                     loc_flags; /* flags, see above defines */
+        /* called by llog_cat_add_rec() under the plain log lock just before
+         * the record is written, so it can be stamped in llog order */
+        llog_fill_rec_cb_t       loc_fill_rec;
+        /* tells llog_origin_handle_next_block() which records to send */
+        llog_filter_rec_cb_t     loc_filter_rec;
+        void                    *loc_cb_data; /* for the two above */
 };
 
 #define LCM_NAME_SIZE 64
@@ -405,6 +420,7 @@ static inline int llog_gen_lt(struct llog_gen a, struct llog_gen b)
 
 #define LLOG_PROC_BREAK 0x0001
 #define LLOG_DEL_RECORD 0x0002
+#define LLOG_SKIP_PLAIN 0x0004 /* done with this plain log, go to the next */
 
 static inline int llog_obd2ops(struct llog_ctxt *ctxt,
                                struct llog_operations **lop)
@@ -448,6 +448,54 @@ struct ptlrpc_hpreq_ops {
  * This is a staple structure used by everybody wanting to send a request
  * in Lustre.
  */
+/**
+ * Points of the handling of a request on the server, stamped in
+ * ptlrpc_request::rq_stage_time after the arrival of the request.
+ */
+enum ptlrpc_req_stamp {
+        /** taken off the incoming queue by a service thread */
+        PTLRPC_STAMP_DEQUEUE = 0,
+        /** passed to the handler of the service */
+        PTLRPC_STAMP_HANDLER,
+        /** reply sent */
+        PTLRPC_STAMP_REPLY,
+        /** handling finished */
+        PTLRPC_STAMP_DONE,
+        PTLRPC_STAMP_MAX
+};
+
+/** Waits of the handler accounted in ptlrpc_request::rq_wait_usec */
+enum ptlrpc_req_wait {
+        /** enqueue of a server-side DLM lock */
+        PTLRPC_WAIT_LOCK = 0,
+        /** transaction start to stop */
+        PTLRPC_WAIT_TXN,
+        PTLRPC_WAIT_MAX
+};
+
+/**
+ * Latency stages of a request accounted per opcode in req_stage_stats of
+ * the service.  The lock and transaction waits are part of the handler
+ * stage.
+ */
+enum ptlrpc_req_stage {
+        /** arrival to dequeue */
+        PTLRPC_STAGE_QUEUE = 0,
+        /** dequeue to handler */
+        PTLRPC_STAGE_PREP,
+        /** waiting for locks */
+        PTLRPC_STAGE_LOCK,
+        /** in transactions */
+        PTLRPC_STAGE_TXN,
+        /** handler to reply, or to the end if there is no reply */
+        PTLRPC_STAGE_HANDLER,
+        /** reply to the end */
+        PTLRPC_STAGE_FINISH,
+        /** arrival to the end */
+        PTLRPC_STAGE_TOTAL,
+        PTLRPC_STAGE_MAX
+};
+
 struct ptlrpc_request {
         /* Request type: one of PTL_RPC_MSG_* */
         int rq_type;
@@ -619,6 +667,12 @@ struct ptlrpc_request {
         /* server-side... */
         /** request arrival time */
         struct timeval       rq_arrival_time;
+        /** times the request reached the stages of its handling */
+        struct timeval       rq_stage_time[PTLRPC_STAMP_MAX];
+        /** start of the current lock or transaction wait */
+        struct timeval       rq_wait_start[PTLRPC_WAIT_MAX];
+        /** usecs spent waiting for locks and transactions */
+        long                 rq_wait_usec[PTLRPC_WAIT_MAX];
         /** separated reply state */
         struct ptlrpc_reply_state *rq_reply_state;
         /** incoming request buffer */
@@ -835,15 +889,39 @@ void _debug_req(struct ptlrpc_request *req, __u32 mask,
 do {                                                                          \
         CFS_CHECK_STACK();                                                    \
                                                                               \
-        if (((level) & D_CANTMASK) != 0 ||                                    \
-            ((libcfs_debug & (level)) != 0 &&                                 \
-             (libcfs_subsystem_debug & DEBUG_SUBSYSTEM) != 0)) {              \
+        if ((((level) & D_CANTMASK) != 0 ||                                   \
+             ((libcfs_debug & (level)) != 0 &&                                \
+              (libcfs_subsystem_debug & DEBUG_SUBSYSTEM) != 0)) &&            \
+            !cfs_cdebug_sampled_out(level, line, (req)->rq_xid)) {            \
                 static struct libcfs_debug_msg_data _req_dbg_data =           \
                 DEBUG_MSG_DATA_INIT(cdls, DEBUG_SUBSYSTEM, file, func, line); \
                 _debug_req((req), (level), &_req_dbg_data, fmt, ##a);         \
         }                                                                     \
 } while(0)
 
+void ptlrpc_req_debug_key(struct ptlrpc_request *req,
+                          struct libcfs_debug_key *key);
+
+/**
+ * CDEBUG for a message about \a req that does not print it, so that trace
+ * sampling and the nid/opcode filters keep or drop it with the DEBUG_REQ
+ * messages of \a req.
+ */
+#define CDEBUG_REQ(mask, req, fmt, a...)                                      \
+do {                                                                          \
+        CFS_CHECK_STACK();                                                    \
+                                                                              \
+        if (cfs_cdebug_show(mask, DEBUG_SUBSYSTEM) &&                         \
+            !cfs_cdebug_sampled_out(mask, __LINE__, (req)->rq_xid)) {         \
+                struct libcfs_debug_key _req_dbg_key;                         \
+                                                                              \
+                ptlrpc_req_debug_key(req, &_req_dbg_key);                     \
+                libcfs_debug_msg_key(&_req_dbg_key, NULL, DEBUG_SUBSYSTEM,    \
+                                     mask, __FILE__, __func__, __LINE__,      \
+                                     fmt, ## a);                              \
+        }                                                                     \
+} while (0)
+
 /**
  * This is the debug print function you need to use to print request sturucture
  * content into lustre debug log.
@@ -1086,6 +1164,21 @@ struct ptlrpc_service {
         cfs_proc_dir_entry_t           *srv_procroot;
         /** Pointer to statistic data for this service */
         struct lprocfs_stats           *srv_stats;
+        /** latency of the stages of requests, a block of counters per
+         * opcode allocated by its first request */
+        struct lprocfs_stats          **srv_stage_stats;
+        /** stage samples lost for lack of memory for their block */
+        cfs_atomic_t                    srv_stage_lost;
+        /** protects the slowest requests and the srv_stage_stats slots */
+        cfs_spinlock_t                  srv_slow_lock;
+        /** slowest requests handled, see req_slowest */
+        struct ptlrpc_slow_req         *srv_slow_reqs;
+        /** # of slowest requests kept, 0 to keep none */
+        int                             srv_slow_max;
+        /** # of slowest requests in srv_slow_reqs */
+        int                             srv_slow_count;
+        /** usecs of the fastest of the slowest requests once full */
+        long                            srv_slow_min;
         /** # hp per lp reqs to handle */
         int                             srv_hpreq_ratio;
         /** biggest request to receive */
@@ -1594,6 +1687,7 @@ int lustre_msg_is_v1(struct lustre_msg *msg);
 __u32 lustre_msg_get_magic(struct lustre_msg *msg);
 __u32 lustre_msg_get_timeout(struct lustre_msg *msg);
 __u32 lustre_msg_get_service_time(struct lustre_msg *msg);
+char *lustre_msg_get_jobid(struct lustre_msg *msg);
 __u32 lustre_msg_get_cksum(struct lustre_msg *msg);
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(2, 9, 0, 0)
 __u32 lustre_msg_calc_cksum(struct lustre_msg *msg, int compat18);
@@ -1614,6 +1708,7 @@ void ptlrpc_req_set_repsize(struct ptlrpc_request *req, int count, __u32 *sizes)
 void ptlrpc_request_set_replen(struct ptlrpc_request *req);
 void lustre_msg_set_timeout(struct lustre_msg *msg, __u32 timeout);
 void lustre_msg_set_service_time(struct lustre_msg *msg, __u32 service_time);
+void lustre_msg_set_jobid(struct lustre_msg *msg, const char *jobid);
 void lustre_msg_set_cksum(struct lustre_msg *msg, __u32 cksum);
 
 static inline void
@@ -1773,6 +1868,34 @@ static inline int ptlrpc_no_resend(struct ptlrpc_request *req)
         return req->rq_no_resend;
 }
 
+/** Record that server request \a req reached stage \a stamp now. */
+static inline void ptlrpc_req_stamp(struct ptlrpc_request *req,
+                                    enum ptlrpc_req_stamp stamp)
+{
+        cfs_gettimeofday(&req->rq_stage_time[stamp]);
+}
+
+static inline void ptlrpc_req_wait_begin(struct ptlrpc_request *req,
+                                         enum ptlrpc_req_wait wait)
+{
+        cfs_gettimeofday(&req->rq_wait_start[wait]);
+}
+
+/** Account the time since ptlrpc_req_wait_begin() in the \a wait of \a req */
+static inline void ptlrpc_req_wait_end(struct ptlrpc_request *req,
+                                       enum ptlrpc_req_wait wait)
+{
+        struct timeval now;
+
+        if (req->rq_wait_start[wait].tv_sec == 0)
+                return;
+        cfs_gettimeofday(&now);
+        req->rq_wait_usec[wait] += cfs_timeval_sub(&now,
+                                                   &req->rq_wait_start[wait],
+                                                   NULL);
+        req->rq_wait_start[wait].tv_sec = 0;
+}
+
 /* ldlm/ldlm_lib.c */
 /**
  * Target client logic
@@ -1858,10 +1981,13 @@ const char* ll_opcode2str(__u32 opcode);
 void ptlrpc_lprocfs_register_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_brw(struct ptlrpc_request *req, int bytes);
+int ptlrpc_lprocfs_register_job_stats(struct obd_device *obd);
 #else
 static inline void ptlrpc_lprocfs_register_obd(struct obd_device *obd) {}
 static inline void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd) {}
 static inline void ptlrpc_lprocfs_brw(struct ptlrpc_request *req, int bytes) {}
+static inline int ptlrpc_lprocfs_register_job_stats(struct obd_device *obd)
+{ return 0; }
 #endif
 /** @} */
 
@@ -269,6 +269,7 @@ extern struct req_msg_field RMF_FLD_OPC;
 extern struct req_msg_field RMF_FLD_MDFLD;
 
 extern struct req_msg_field RMF_LLOGD_BODY;
+extern struct req_msg_field RMF_CHANGELOG_FILTER;
 extern struct req_msg_field RMF_LLOG_LOG_HDR;
 extern struct req_msg_field RMF_LLOGD_CONN_BODY;
 
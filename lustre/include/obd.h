@@ -298,6 +298,8 @@ struct filter_obd {
         obd_size             fo_tot_granted;    /* all values in bytes */
         obd_size             fo_tot_pending;
         int                  fo_tot_granted_clients;
+        unsigned int         fo_grant_window;   /* seconds of writes to size
+                                                 * grant for, 0 = static */
 
         obd_size             fo_readcache_max_filesize;
         cfs_spinlock_t       fo_flags_lock;
@@ -333,6 +335,19 @@ struct filter_obd {
         struct filter_iobuf    **fo_iobuf_pool;
         int                      fo_iobuf_count;
 
+        /*
+         * Small writes to the same object arriving from different service
+         * threads within fo_wgather_usec are gathered and submitted to disk
+         * as one set of bios, see filter_wgather_do_bio().
+         *
+         * Locking: fo_wgather_lock protects fo_wgather_list and the state
+         * of all write groups linked to it.
+         */
+        cfs_spinlock_t           fo_wgather_lock;
+        cfs_list_t               fo_wgather_list;
+        unsigned int             fo_wgather_usec;      /* 0 disables */
+        unsigned int             fo_wgather_max_pages; /* per RPC */
+
         cfs_list_t               fo_llog_list;
         cfs_spinlock_t           fo_llog_list_lock;
 
@@ -387,6 +402,25 @@ enum {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/**
+ * Budget of cached pages shared by all client_obds of a mount.
+ *
+ * Every osc page is accounted against ccc_lru_left while it exists. When the
+ * budget runs out, clean pages are reclaimed from the LRU lists of the
+ * client_obds linked into ccc_lru, see osc_lru_shrink().
+ */
+struct cl_client_cache {
+        cfs_atomic_t            ccc_users;     /* # of client_obds using it */
+        cfs_spinlock_t          ccc_lru_lock;  /* protects ccc_lru */
+        cfs_list_t              ccc_lru;       /* client_obds, round-robin */
+        cfs_atomic_t            ccc_lru_left;  /* pages left in budget */
+        unsigned long           ccc_lru_max;   /* budget, in pages */
+        /* reclaim statistics */
+        cfs_atomic_t            ccc_shrink_calls;
+        cfs_atomic_t            ccc_reclaimed;
+        cfs_atomic_t            ccc_reclaimed_cancel; /* lock being cancelled */
+};
+
 struct client_obd {
         cfs_rw_semaphore_t       cl_sem;
         struct obd_uuid          cl_target_uuid;
@@ -487,6 +521,13 @@ struct client_obd {
         struct lu_client_seq    *cl_seq;
 
         cfs_atomic_t             cl_resends; /* resend count */
+
+        /* cached pages, shared budget with other client_obds of the mount */
+        struct cl_client_cache  *cl_cache;
+        cfs_list_t               cl_lru_osc;     /* linkage into ccc_lru */
+        cfs_spinlock_t           cl_lru_lock;    /* protects cl_lru_list */
+        cfs_list_t               cl_lru_list;    /* cached pages, LRU first */
+        cfs_atomic_t             cl_lru_in_list; /* pages in cl_lru_list */
 };
 #define obd2cli_tgt(obd) ((char *)(obd)->u.cli.cl_target_uuid.uuid)
 
@@ -608,6 +649,8 @@ struct lov_qos_oss {
         __u64               lqo_penalty_per_obj;/* penalty decrease every obj*/
         time_t              lqo_used;       /* last used time, seconds */
         __u32               lqo_ost_count;  /* number of osts on this oss */
+        int                 lqo_tree_head;  /* first candidate on this oss,
+                                             * only valid in alloc_qos */
 };
 
 struct ltd_qos {
@@ -660,6 +703,13 @@ struct lov_qos {
                                                         progress */
         /* qos statfs data */
         struct lov_statfs_data *lq_statfs_data;
+        /* scratch space of alloc_qos() for lq_tree_size candidates,
+         * protected by lq_rw_sem */
+        __u64              *lq_tree_sum;    /* weight_tree prefix sums */
+        __u64              *lq_tree_weight; /* weight of each candidate */
+        __u32              *lq_tree_idx;    /* candidate -> target index */
+        int                *lq_tree_next;   /* next candidate on same oss */
+        unsigned int        lq_tree_size;
         cfs_waitq_t         lq_statfs_waitq; /* waitqueue to notify statfs
                                               * requests completion */
 };
@@ -715,6 +765,9 @@ struct lov_obd {
         cfs_list_t              lov_pool_list; /* used for sequential access */
         cfs_proc_dir_entry_t   *lov_pool_proc_entry;
         enum lustre_sec_part    lov_sp_me;
+        int                     lov_submit_parallel; /* submit stripes from
+                                                        workitems */
+        struct cl_client_cache *lov_cache;     /* page budget of the mount */
 };
 
 struct lmv_tgt_desc {
@@ -1100,6 +1153,7 @@ struct obd_device {
         cfs_proc_dir_entry_t  *obd_proc_exports_entry;
         cfs_proc_dir_entry_t  *obd_svc_procroot;
         struct lprocfs_stats  *obd_svc_stats;
+        struct obd_job_stats   obd_jobstats;
         cfs_atomic_t           obd_evict_inprogress;
         cfs_waitq_t            obd_evict_inprogress_waitq;
         cfs_list_t             obd_evict_list; /* protected with pet_lock */
@@ -1131,6 +1185,8 @@ enum obd_cleanup_stage {
 #define KEY_ASYNC               "async"
 #define KEY_BLOCKSIZE_BITS      "blocksize_bits"
 #define KEY_BLOCKSIZE           "blocksize"
+#define KEY_CACHE_SET           "cache_set"
+#define KEY_CACHE_LRU_SHRINK    "cache_lru_shrink"
 #define KEY_CAPA_KEY            "capa_key"
 #define KEY_CHANGELOG_CLEAR     "changelog_clear"
 #define KEY_FID2PATH            "fid2path"
@@ -1331,6 +1387,10 @@ struct obd_ops {
         int (*o_brw)(int rw, struct obd_export *exp, struct obd_info *oinfo,
                      obd_count oa_bufs, struct brw_page *pgarr,
                      struct obd_trans_info *oti);
+        int (*o_brw_async)(int rw, struct obd_export *exp,
+                           struct obd_info *oinfo, obd_count oa_bufs,
+                           struct brw_page *pgarr, struct obd_trans_info *oti,
+                           struct ptlrpc_request_set *set);
         int (*o_merge_lvb)(struct obd_export *exp, struct lov_stripe_md *lsm,
                            struct ost_lvb *lvb, int kms_only);
         int (*o_adjust_kms)(struct obd_export *exp, struct lov_stripe_md *lsm,
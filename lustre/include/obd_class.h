@@ -66,6 +66,7 @@ extern cfs_spinlock_t obd_dev_lock;
 extern struct obd_device *class_conn2obd(struct lustre_handle *);
 extern struct obd_device *class_exp2obd(struct obd_export *);
 extern int class_handle_ioctl(unsigned int cmd, unsigned long arg);
+extern int lustre_get_jobid(char *jobid);
 
 struct lu_device_type;
 
@@ -392,7 +393,7 @@ static inline int lprocfs_nid_ldlm_stats_init(struct nid_stat* tmp)
 {
         /* Always add in ldlm_stats */
         tmp->nid_ldlm_stats = lprocfs_alloc_stats(LDLM_LAST_OPC - LDLM_FIRST_OPC
-                                                  ,LPROCFS_STATS_FLAG_NOPERCPU);
+                                                  ,LPROCFS_STATS_FLAG_LAZY);
         if (tmp->nid_ldlm_stats == NULL)
                 return -ENOMEM;
 
@@ -1343,6 +1344,32 @@ static inline int obd_brw(int cmd, struct obd_export *exp,
         RETURN(rc);
 }
 
+/* Queue the bulk RPCs for \a pg on \a set without waiting for them.  The
+ * pages are sent in full-sized RPCs to all targets in parallel and the
+ * caller gets the result from ptlrpc_set_wait(\a set).  Even on error the
+ * caller has to wait for the requests already added to \a set. */
+static inline int obd_brw_async(int cmd, struct obd_export *exp,
+                                struct obd_info *oinfo, obd_count oa_bufs,
+                                struct brw_page *pg, struct obd_trans_info *oti,
+                                struct ptlrpc_request_set *set)
+{
+        int rc;
+        ENTRY;
+
+        EXP_CHECK_DT_OP(exp, brw_async);
+        EXP_COUNTER_INCREMENT(exp, brw_async);
+
+        if (!(cmd & OBD_BRW_RWMASK)) {
+                CERROR("obd_brw_async: cmd must be OBD_BRW_READ or "
+                       "OBD_BRW_WRITE\n");
+                LBUG();
+        }
+
+        rc = OBP(exp->exp_obd, brw_async)(cmd, exp, oinfo, oa_bufs, pg, oti,
+                                          set);
+        RETURN(rc);
+}
+
 static inline int obd_preprw(int cmd, struct obd_export *exp, struct obdo *oa,
                              int objcount, struct obd_ioobj *obj,
                              struct niobuf_remote *remote, int *pages,
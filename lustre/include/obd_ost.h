@@ -45,6 +45,7 @@
 
 #include <obd_class.h>
 
+struct osc_brw_dio;
 struct osc_brw_async_args {
         struct obdo       *aa_oa;
         int                aa_requested_nob;
@@ -56,6 +57,7 @@ struct osc_brw_async_args {
         cfs_list_t         aa_oaps;
         struct obd_capa   *aa_ocapa;
         struct cl_req     *aa_clerq;
+        struct osc_brw_dio *aa_dio;     /* uncached O_DIRECT window */
 };
 
 #define osc_grant_args osc_brw_async_args
@@ -77,6 +77,11 @@ extern cfs_atomic_t obd_dirty_pages;
 extern cfs_atomic_t obd_dirty_transit_pages;
 extern unsigned int obd_alloc_fail_rate;
 
+#define JOBSTATS_JOBID_VAR_MAX_LEN      20
+#define JOBSTATS_DISABLE                "disable"
+#define JOBSTATS_PROCNAME_UID           "procname_uid"
+extern char obd_jobid_var[];
+
 /* lvfs.c */
 int obd_alloc_fail(const void *ptr, const char *name, const char *type,
                    size_t size, const char *file, int line);
@@ -103,6 +108,9 @@ int obd_alloc_fail(const void *ptr, const char *name, const char *type,
 #define HASH_EXP_LOCK_BKT_BITS  5
 #define HASH_EXP_LOCK_CUR_BITS  7
 #define HASH_EXP_LOCK_MAX_BITS  16
+#define HASH_JOB_STATS_BKT_BITS 5
+#define HASH_JOB_STATS_CUR_BITS 7
+#define HASH_JOB_STATS_MAX_BITS 12
 #define HASH_CL_ENV_BKT_BITS    5
 #define HASH_CL_ENV_BITS        10
 
@@ -446,6 +454,24 @@ static inline void obd_fail_write(int id, struct super_block *sb)
 
 #define fixme() CDEBUG(D_OTHER, "FIXME\n");
 
+/**
+ * Fold \a count events of the last one-second period into \a rate, an
+ * exponentially weighted average of events per second, and decay it over
+ * the other \a elapsed - 1 seconds, in which nothing was counted.
+ */
+static inline __u64 obd_rate_update(__u64 rate, __u64 count, time_t elapsed)
+{
+        LASSERT(elapsed > 0);
+
+        if (elapsed > 32)
+                return 0;
+        rate -= rate >> 2;
+        rate += count >> 2;
+        while (--elapsed > 0)
+                rate -= rate >> 2;
+        return rate;
+}
+
 extern cfs_atomic_t libcfs_kmemory;
 
 #ifdef LPROCFS
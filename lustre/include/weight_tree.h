@@ -0,0 +1,128 @@
+/* -*- mode: c; c-basic-offset: 8; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.sun.com/software/products/lustre/docs/GPLv2.pdf
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa Clara,
+ * CA 95054 USA or visit www.sun.com if you need additional information or
+ * have any questions.
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2008, 2010, Oracle and/or its affiliates. All rights reserved.
+ * Use is subject to license terms.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/include/weight_tree.h
+ *
+ * Prefix sums of weights (a Fenwick tree), for weighted random selection
+ * among n items in O(log n) per pick, with O(log n) weight updates.
+ */
+
+#ifndef _WEIGHT_TREE_H__
+#define _WEIGHT_TREE_H__
+
+#include <libcfs/libcfs.h>   /* LASSERT. */
+
+struct weight_tree {
+        /** wt_sum[i] holds the sum of the weights of items
+         *  (i - (i & -i), i], items are numbered from 1 */
+        __u64  *wt_sum;
+        int     wt_count;
+        /** largest power of two not above wt_count */
+        int     wt_top;
+};
+
+/* Set up \a wt over \a count items with zero weight, \a sum has room for
+ * count + 1 entries. */
+static inline void weight_tree_init(struct weight_tree *wt, __u64 *sum,
+                                    int count)
+{
+        int i;
+
+        wt->wt_sum = sum;
+        wt->wt_count = count;
+        for (wt->wt_top = 1; wt->wt_top * 2 <= count; wt->wt_top *= 2)
+                ;
+        for (i = 0; i <= count; i++)
+                sum[i] = 0;
+}
+
+/* Set up \a wt from the weights of \a count items in O(count). */
+static inline void weight_tree_build(struct weight_tree *wt, __u64 *sum,
+                                     const __u64 *weight, int count)
+{
+        int i, j;
+
+        weight_tree_init(wt, sum, count);
+        for (i = 1; i <= count; i++) {
+                sum[i] += weight[i - 1];
+                j = i + (i & -i);
+                if (j <= count)
+                        sum[j] += sum[i];
+        }
+}
+
+/* Add \a delta to the weight of item \a idx (0-based). */
+static inline void weight_tree_add(struct weight_tree *wt, int idx,
+                                   __s64 delta)
+{
+        int i;
+
+        LASSERT(idx >= 0 && idx < wt->wt_count);
+        for (i = idx + 1; i <= wt->wt_count; i += i & -i)
+                wt->wt_sum[i] += delta;
+}
+
+/* Sum of the weights of all items. */
+static inline __u64 weight_tree_total(const struct weight_tree *wt)
+{
+        __u64 total = 0;
+        int i;
+
+        for (i = wt->wt_count; i > 0; i -= i & -i)
+                total += wt->wt_sum[i];
+        return total;
+}
+
+/* Find the item whose range of cumulative weight covers \a point, that is
+ * the first item for which the sum of weights up to and including it
+ * exceeds \a point.  Items of zero weight are never returned, unless
+ * \a point is not below the total, in which case wt_count is returned. */
+static inline int weight_tree_find(const struct weight_tree *wt, __u64 point)
+{
+        int pos = 0;
+        int step;
+
+        for (step = wt->wt_top; step > 0; step >>= 1) {
+                if (pos + step <= wt->wt_count &&
+                    wt->wt_sum[pos + step] <= point) {
+                        pos += step;
+                        point -= wt->wt_sum[pos];
+                }
+        }
+        /* pos items sum to at most the original point */
+        return pos;
+}
+
+#endif
@@ -1011,6 +1011,12 @@ void ccc_req_attr_set(const struct lu_env *env,
                         oa->o_flags |= OBD_FL_MMAP;
                 }
         }
+        if (flags == (obd_valid)~0ULL) {
+                /* llite may be rewriting it, make sure it ends */
+                memcpy(attr->cra_jobid, cl_i2info(inode)->lli_jobid,
+                       JOBSTATS_JOBID_SIZE);
+                attr->cra_jobid[JOBSTATS_JOBID_SIZE - 1] = '\0';
+        }
 #endif
 }
 
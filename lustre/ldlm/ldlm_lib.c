@@ -290,6 +290,10 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
         CFS_INIT_LIST_HEAD(&cli->cl_loi_write_list);
         CFS_INIT_LIST_HEAD(&cli->cl_loi_read_list);
         client_obd_list_lock_init(&cli->cl_loi_list_lock);
+        CFS_INIT_LIST_HEAD(&cli->cl_lru_osc);
+        CFS_INIT_LIST_HEAD(&cli->cl_lru_list);
+        cfs_spin_lock_init(&cli->cl_lru_lock);
+        cfs_atomic_set(&cli->cl_lru_in_list, 0);
         cli->cl_r_in_flight = 0;
         cli->cl_w_in_flight = 0;
 
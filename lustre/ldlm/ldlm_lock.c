@@ -1953,12 +1953,21 @@ void _ldlm_lock_debug(struct ldlm_lock *lock, __u32 level,
 {
         va_list args;
         cfs_debug_limit_state_t *cdls = data->msg_cdls;
+        struct libcfs_debug_key key = {
+                .dk_id  = lock->l_handle.h_cookie,
+                .dk_nid = LNET_NID_ANY,
+                .dk_opc = -1,
+        };
+
+        if (lock->l_export != NULL && lock->l_export->exp_connection != NULL)
+                key.dk_nid = lock->l_export->exp_connection->c_peer.nid;
 
         va_start(args, fmt);
 
         if (lock->l_resource == NULL) {
-                libcfs_debug_vmsg2(cdls, data->msg_subsys, level,data->msg_file,
-                                   data->msg_fn, data->msg_line, fmt, args,
+                libcfs_debug_vmsg2_key(&key, cdls, data->msg_subsys, level,
+                                   data->msg_file, data->msg_fn,
+                                   data->msg_line, fmt, args,
                        " ns: \?\? lock: %p/"LPX64" lrc: %d/%d,%d mode: %s/%s "
                        "res: \?\? rrc=\?\? type: \?\?\? flags: "LPX64" remote: "
                        LPX64" expref: %d pid: %u timeout: %lu\n", lock,
@@ -1976,8 +1985,9 @@ void _ldlm_lock_debug(struct ldlm_lock *lock, __u32 level,
 
         switch (lock->l_resource->lr_type) {
         case LDLM_EXTENT:
-                libcfs_debug_vmsg2(cdls, data->msg_subsys, level,data->msg_file,
-                                   data->msg_fn, data->msg_line, fmt, args,
+                libcfs_debug_vmsg2_key(&key, cdls, data->msg_subsys, level,
+                                   data->msg_file, data->msg_fn,
+                                   data->msg_line, fmt, args,
                        " ns: %s lock: %p/"LPX64" lrc: %d/%d,%d mode: %s/%s "
                        "res: "LPU64"/"LPU64" rrc: %d type: %s ["LPU64"->"LPU64
                        "] (req "LPU64"->"LPU64") flags: "LPX64" remote: "LPX64
@@ -2001,8 +2011,9 @@ void _ldlm_lock_debug(struct ldlm_lock *lock, __u32 level,
                 break;
 
         case LDLM_FLOCK:
-                libcfs_debug_vmsg2(cdls, data->msg_subsys, level,data->msg_file,
-                                   data->msg_fn, data->msg_line, fmt, args,
+                libcfs_debug_vmsg2_key(&key, cdls, data->msg_subsys, level,
+                                   data->msg_file, data->msg_fn,
+                                   data->msg_line, fmt, args,
                        " ns: %s lock: %p/"LPX64" lrc: %d/%d,%d mode: %s/%s "
                        "res: "LPU64"/"LPU64" rrc: %d type: %s pid: %d "
                        "["LPU64"->"LPU64"] flags: "LPX64" remote: "LPX64
@@ -2026,8 +2037,9 @@ void _ldlm_lock_debug(struct ldlm_lock *lock, __u32 level,
                 break;
 
         case LDLM_IBITS:
-                libcfs_debug_vmsg2(cdls, data->msg_subsys, level,data->msg_file,
-                                   data->msg_fn, data->msg_line, fmt, args,
+                libcfs_debug_vmsg2_key(&key, cdls, data->msg_subsys, level,
+                                   data->msg_file, data->msg_fn,
+                                   data->msg_line, fmt, args,
                        " ns: %s lock: %p/"LPX64" lrc: %d/%d,%d mode: %s/%s "
                        "res: "LPU64"/"LPU64" bits "LPX64" rrc: %d type: %s "
                        "flags: "LPX64" remote: "LPX64" expref: %d "
@@ -2050,8 +2062,9 @@ void _ldlm_lock_debug(struct ldlm_lock *lock, __u32 level,
                 break;
 
         default:
-                libcfs_debug_vmsg2(cdls, data->msg_subsys, level,data->msg_file,
-                                   data->msg_fn, data->msg_line, fmt, args,
+                libcfs_debug_vmsg2_key(&key, cdls, data->msg_subsys, level,
+                                   data->msg_file, data->msg_fn,
+                                   data->msg_line, fmt, args,
                        " ns: %s lock: %p/"LPX64" lrc: %d/%d,%d mode: %s/%s "
                        "res: "LPU64"/"LPU64" rrc: %d type: %s flags: "LPX64" "
                        "remote: "LPX64" expref: %d pid: %u timeout %lu\n",
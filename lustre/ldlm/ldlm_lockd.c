@@ -1042,6 +1042,7 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
         ldlm_error_t err = ELDLM_OK;
         struct ldlm_lock *lock = NULL;
         void *cookie = NULL;
+        int intent;
         int rc = 0;
         ENTRY;
 
@@ -1180,7 +1181,14 @@ existing_lock:
         if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT)
                 lock->l_req_extent = lock->l_policy_data.l_extent;
 
+        /* intent enqueues run the whole operation in the intent policy,
+         * which accounts its own lock waits */
+        intent = flags & LDLM_FL_HAS_INTENT;
+        if (!intent)
+                ptlrpc_req_wait_begin(req, PTLRPC_WAIT_LOCK);
         err = ldlm_lock_enqueue(ns, &lock, cookie, (int *)&flags);
+        if (!intent)
+                ptlrpc_req_wait_end(req, PTLRPC_WAIT_LOCK);
         if (err)
                 GOTO(out, err);
 
@@ -820,7 +820,7 @@ static int copy_and_ioctl(int cmd, struct obd_export *exp, void *data, int len)
                 OBD_FREE(ptr, len);
                 return -EFAULT;
         }
-        rc = obd_iocontrol(cmd, exp, len, data, NULL);
+        rc = obd_iocontrol(cmd, exp, len, ptr, NULL);
         OBD_FREE(ptr, len);
         return rc;
 }
@@ -1367,6 +1367,10 @@ out_free:
                 rc = copy_and_ioctl(cmd, sbi->ll_md_exp, (void *)arg,
                                     sizeof(struct ioc_changelog));
                 RETURN(rc);
+        case OBD_IOC_CHANGELOG_FILTER:
+                rc = copy_and_ioctl(cmd, sbi->ll_md_exp, (void *)arg,
+                                    sizeof(struct ioc_changelog_filter));
+                RETURN(rc);
         case OBD_IOC_FID2PATH:
                 RETURN(ll_fid2path(ll_i2mdexp(inode), (void *)arg));
         case LL_IOC_HSM_CT_START:
@@ -874,6 +874,8 @@ static ssize_t ll_file_io_generic(const struct lu_env *env,
                         CERROR("Unknow IO type - %u\n", vio->cui_io_subtype);
                         LBUG();
                 }
+                /* pages dirtied now are written by ptlrpcd, on our behalf */
+                lustre_get_jobid(lli->lli_jobid);
                 result = cl_io_loop(env, io);
                 if (write_sem_locked)
                         cfs_up(&lli->lli_write_sem);
@@ -206,6 +206,9 @@ struct ll_inode_info {
          * serialize normal readdir and statahead-readdir
          */
         cfs_semaphore_t         lli_readdir_sem;
+        /* job ID of the last read or write, for the BRW RPCs which are
+         * sent later by ptlrpcd, see ccc_req_attr_set() */
+        char                    lli_jobid[JOBSTATS_JOBID_SIZE];
 };
 
 /*
@@ -326,6 +329,7 @@ enum stats_track_type {
 #define LL_SBI_SOM_PREVIEW     0x1000 /* SOM preview mount option */
 #define LL_SBI_32BIT_API       0x2000 /* generate 32 bit inodes. */
 #define LL_SBI_64BIT_HASH      0x4000 /* support 64-bits dir hash/offset */
+#define LL_SBI_DIO_FASTPATH    0x8000 /* uncached O_DIRECT bypasses cl_page */
 
 /* default value for ll_sb_info->contention_time */
 #define SBI_DEFAULT_CONTENTION_SECONDS     60
@@ -383,6 +387,8 @@ struct ll_sb_info {
 
         unsigned long             ll_async_page_max;
         unsigned long             ll_async_page_count;
+        /* page budget shared by all OSCs, ccc_lru_max == ll_async_page_max */
+        struct cl_client_cache    ll_cache;
 
         struct lprocfs_stats     *ll_ra_stats;
 
@@ -104,6 +104,15 @@ static struct ll_sb_info *ll_init_sbi(void)
                 sbi->ll_async_page_max = (pages / 4) * 3;
         }
 
+        cfs_atomic_set(&sbi->ll_cache.ccc_users, 0);
+        cfs_spin_lock_init(&sbi->ll_cache.ccc_lru_lock);
+        CFS_INIT_LIST_HEAD(&sbi->ll_cache.ccc_lru);
+        sbi->ll_cache.ccc_lru_max = sbi->ll_async_page_max;
+        cfs_atomic_set(&sbi->ll_cache.ccc_lru_left, sbi->ll_async_page_max);
+        cfs_atomic_set(&sbi->ll_cache.ccc_shrink_calls, 0);
+        cfs_atomic_set(&sbi->ll_cache.ccc_reclaimed, 0);
+        cfs_atomic_set(&sbi->ll_cache.ccc_reclaimed_cancel, 0);
+
         sbi->ll_ra_info.ra_max_pages_per_file = min(pages / 32,
                                            SBI_DEFAULT_READAHEAD_MAX);
         sbi->ll_ra_info.ra_max_pages = sbi->ll_ra_info.ra_max_pages_per_file;
@@ -127,6 +136,7 @@ static struct ll_sb_info *ll_init_sbi(void)
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         sbi->ll_flags |= LL_SBI_LRU_RESIZE;
 #endif
+        sbi->ll_flags |= LL_SBI_DIO_FASTPATH;
 
         for (i = 0; i <= LL_PROCESS_HIST_MAX; i++) {
                 cfs_spin_lock_init(&sbi->ll_rw_extents_info.pp_extents[i]. \
@@ -501,6 +511,9 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
         err = obd_set_info_async(sbi->ll_dt_exp, sizeof(KEY_CHECKSUM),
                                  KEY_CHECKSUM, sizeof(checksum), &checksum,
                                  NULL);
+        err = obd_set_info_async(sbi->ll_dt_exp, sizeof(KEY_CACHE_SET),
+                                 KEY_CACHE_SET, sizeof(sbi->ll_cache),
+                                 &sbi->ll_cache, NULL);
         cl_sb_init(sb);
 
         sb->s_root = d_alloc_root(root);
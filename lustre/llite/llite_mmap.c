@@ -157,6 +157,8 @@ struct cl_io *ll_fault_io_init(struct vm_area_struct *vma,
         fio->ft_index      = index;
         fio->ft_writable   = (vma->vm_flags&writable) == writable;
         fio->ft_executable = vma->vm_flags&VM_EXEC;
+        if (fio->ft_writable)
+                lustre_get_jobid(ll_i2info(inode)->lli_jobid);
 
         /*
          * disable VM_SEQ_READ and use VM_RAND_READ to make sure that
@@ -382,6 +382,8 @@ static int ll_wr_max_cached_mb(struct file *file, const char *buffer,
         struct super_block *sb = data;
         struct ll_sb_info *sbi = ll_s2sbi(sb);
         int mult, rc, pages_number;
+        long diff;
+        int nr;
 
         mult = 1 << (20 - CFS_PAGE_SHIFT);
         rc = lprocfs_write_frac_helper(buffer, count, &pages_number, mult);
@@ -395,16 +397,47 @@ static int ll_wr_max_cached_mb(struct file *file, const char *buffer,
         }
 
         cfs_spin_lock(&sbi->ll_lock);
-        sbi->ll_async_page_max = pages_number ;
+        diff = (long)pages_number - (long)sbi->ll_async_page_max;
+        sbi->ll_async_page_max = pages_number;
+        sbi->ll_cache.ccc_lru_max = pages_number;
         cfs_spin_unlock(&sbi->ll_lock);
 
-        if (!sbi->ll_dt_exp)
-                /* Not set up yet, don't call llap_shrink_cache */
-                return count;
-
+        cfs_atomic_add(diff, &sbi->ll_cache.ccc_lru_left);
+        /* reclaim whatever exceeds the new budget right away */
+        nr = -cfs_atomic_read(&sbi->ll_cache.ccc_lru_left);
+        if (nr > 0 && sbi->ll_dt_exp != NULL)
+                obd_set_info_async(sbi->ll_dt_exp,
+                                   sizeof(KEY_CACHE_LRU_SHRINK),
+                                   KEY_CACHE_LRU_SHRINK, sizeof(nr), &nr,
+                                   NULL);
         return count;
 }
 
+static int ll_rd_cache_lru(char *page, char **start, off_t off,
+                           int count, int *eof, void *data)
+{
+        struct super_block     *sb    = data;
+        struct ll_sb_info      *sbi   = ll_s2sbi(sb);
+        struct cl_client_cache *cache = &sbi->ll_cache;
+        int shift = 20 - CFS_PAGE_SHIFT;
+        long used;
+
+        used = cache->ccc_lru_max - cfs_atomic_read(&cache->ccc_lru_left);
+        *eof = 1;
+        return snprintf(page, count,
+                        "users: %d\n"
+                        "max_cached_mb: %lu\n"
+                        "used_mb: %ld\n"
+                        "shrink_calls: %d\n"
+                        "reclaimed_pages: %d\n"
+                        "reclaimed_cancelling: %d\n",
+                        cfs_atomic_read(&cache->ccc_users),
+                        cache->ccc_lru_max >> shift, used >> shift,
+                        cfs_atomic_read(&cache->ccc_shrink_calls),
+                        cfs_atomic_read(&cache->ccc_reclaimed),
+                        cfs_atomic_read(&cache->ccc_reclaimed_cancel));
+}
+
 static int ll_rd_checksum(char *page, char **start, off_t off,
                           int count, int *eof, void *data)
 {
@@ -604,6 +637,35 @@ static int ll_wr_lazystatfs(struct file *file, const char *buffer,
         return count;
 }
 
+static int ll_rd_dio_fastpath(char *page, char **start, off_t off,
+                              int count, int *eof, void *data)
+{
+        struct super_block *sb = data;
+        struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+        return snprintf(page, count, "%u\n",
+                        (sbi->ll_flags & LL_SBI_DIO_FASTPATH) ? 1 : 0);
+}
+
+static int ll_wr_dio_fastpath(struct file *file, const char *buffer,
+                              unsigned long count, void *data)
+{
+        struct super_block *sb = data;
+        struct ll_sb_info *sbi = ll_s2sbi(sb);
+        int val, rc;
+
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        if (val)
+                sbi->ll_flags |= LL_SBI_DIO_FASTPATH;
+        else
+                sbi->ll_flags &= ~LL_SBI_DIO_FASTPATH;
+
+        return count;
+}
+
 static struct lprocfs_vars lprocfs_llite_obd_vars[] = {
         { "uuid",         ll_rd_sb_uuid,          0, 0 },
         //{ "mntpt_path",   ll_rd_path,             0, 0 },
@@ -624,6 +686,7 @@ static struct lprocfs_vars lprocfs_llite_obd_vars[] = {
         { "max_read_ahead_whole_mb", ll_rd_max_read_ahead_whole_mb,
                                      ll_wr_max_read_ahead_whole_mb, 0 },
         { "max_cached_mb",    ll_rd_max_cached_mb, ll_wr_max_cached_mb, 0 },
+        { "cache_lru",        ll_rd_cache_lru, 0, 0 },
         { "checksum_pages",   ll_rd_checksum, ll_wr_checksum, 0 },
         { "max_rw_chunk",     ll_rd_max_rw_chunk, ll_wr_max_rw_chunk, 0 },
         { "stats_track_pid",  ll_rd_track_pid, ll_wr_track_pid, 0 },
@@ -632,6 +695,7 @@ static struct lprocfs_vars lprocfs_llite_obd_vars[] = {
         { "statahead_max",    ll_rd_statahead_max, ll_wr_statahead_max, 0 },
         { "statahead_stats",  ll_rd_statahead_stats, 0, 0 },
         { "lazystatfs",         ll_rd_lazystatfs, ll_wr_lazystatfs, 0 },
+        { "direct_io_fastpath", ll_rd_dio_fastpath, ll_wr_dio_fastpath, 0 },
         { 0 }
 };
 
@@ -340,6 +340,89 @@ static ssize_t ll_direct_IO_26_seg(const struct lu_env *env, struct cl_io *io,
     return ll_direct_rw_pages(env, io, rw, inode, &pvec);
 }
 
+/*
+ * Transfer the pinned user pages straight to the OSTs, without creating
+ * cl_pages for them.  The pages are described by a brw_page array which
+ * LOV splits by stripe, and all of the resulting full-sized RPCs are sent
+ * in parallel.  Only used if no page of the file is cached on this client,
+ * so there is nothing to keep coherent with the transfer; the extent locks
+ * are held by the caller's cl_io as for the cl_page path.
+ */
+static ssize_t ll_direct_IO_26_brw(struct inode *inode, int rw, size_t size,
+                                   loff_t file_offset, struct page **pages,
+                                   int page_count)
+{
+        struct ll_inode_info      *lli = ll_i2info(inode);
+        struct lov_stripe_md      *lsm = lli->lli_smd;
+        struct obd_info            oinfo = { { { 0 } } };
+        struct ptlrpc_request_set *set;
+        struct brw_page           *pga;
+        obd_flag                   flags = OBD_BRW_NOCACHE;
+        ssize_t                    rc;
+        int                        err;
+        int                        i;
+        ENTRY;
+
+        OBD_ALLOC_LARGE(pga, sizeof(*pga) * page_count);
+        if (pga == NULL)
+                RETURN(-ENOMEM);
+
+        OBDO_ALLOC(oinfo.oi_oa);
+        if (oinfo.oi_oa == NULL)
+                GOTO(out_pga, rc = -ENOMEM);
+
+        if (rw == WRITE) {
+                flags |= OBD_BRW_SYNC;
+                if (!(ll_i2sbi(inode)->ll_flags & LL_SBI_RMT_CLIENT) &&
+                    cfs_capable(CFS_CAP_SYS_RESOURCE))
+                        flags |= OBD_BRW_NOQUOTA;
+        }
+
+        for (i = 0; i < page_count; i++) {
+                pga[i].pg = pages[i];
+                pga[i].off = file_offset + ((loff_t)i << CFS_PAGE_SHIFT);
+                pga[i].count = min_t(size_t, CFS_PAGE_SIZE,
+                                     size - ((size_t)i << CFS_PAGE_SHIFT));
+                pga[i].flag = flags;
+        }
+
+        oinfo.oi_oa->o_id = lsm->lsm_object_id;
+        oinfo.oi_oa->o_seq = lsm->lsm_object_seq;
+        oinfo.oi_oa->o_valid = OBD_MD_FLID | OBD_MD_FLGROUP;
+        obdo_from_inode(oinfo.oi_oa, inode, &lli->lli_fid,
+                        OBD_MD_FLTYPE | OBD_MD_FLATIME | OBD_MD_FLMTIME |
+                        OBD_MD_FLCTIME | OBD_MD_FLGROUP);
+        oinfo.oi_md = lsm;
+        oinfo.oi_capa = ll_osscapa_get(inode, rw == WRITE ?
+                                       CAPA_OPC_OSS_WRITE : CAPA_OPC_OSS_READ);
+
+        set = ptlrpc_prep_set();
+        if (set == NULL)
+                GOTO(out_capa, rc = -ENOMEM);
+
+        rc = obd_brw_async(rw == WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
+                           ll_i2dtexp(inode), &oinfo, page_count, pga, NULL,
+                           set);
+        err = ptlrpc_set_wait(set);
+        ptlrpc_set_destroy(set);
+        if (rc == 0)
+                rc = err;
+        if (rc == 0) {
+                rc = size;
+                ll_stats_ops_tally(ll_i2sbi(inode), rw == WRITE ?
+                                   LPROC_LL_DIRECT_WRITE : LPROC_LL_DIRECT_READ,
+                                   page_count);
+        }
+
+        EXIT;
+out_capa:
+        capa_put(oinfo.oi_capa);
+        OBDO_FREE(oinfo.oi_oa);
+out_pga:
+        OBD_FREE_LARGE(pga, sizeof(*pga) * page_count);
+        return rc;
+}
+
 /* This is the maximum size of a single O_DIRECT request, based on a 128kB
  * kmalloc limit.  We need to fit all of the brw_page structs, each one
  * representing PAGE_SIZE worth of user data, into a single buffer, and
@@ -361,6 +444,8 @@ static ssize_t ll_direct_IO_26(int rw, struct kiocb *iocb,
         struct lov_stripe_md *lsm = lli->lli_smd;
         unsigned long seg = 0;
         long size = MAX_DIO_SIZE;
+        loff_t start = file_offset;
+        int fastpath;
         int refcheck;
         ENTRY;
 
@@ -396,6 +481,13 @@ static ssize_t ll_direct_IO_26(int rw, struct kiocb *iocb,
                 LOCK_INODE_MUTEX(inode);
 
         LASSERT(obj->cob_transient_pages == 0);
+        /* with no cached pages there is no need for cl_page coherency.
+         * Nothing stops a page fault from caching a page while the I/O is
+         * in flight, so the file must not be mapped either, and a page that
+         * still slipped in through a new mapping is dropped below. */
+        fastpath = (ll_i2sbi(inode)->ll_flags & LL_SBI_DIO_FASTPATH) &&
+                   file->f_mapping->nrpages == 0 &&
+                   !mapping_mapped(file->f_mapping);
         for (seg = 0; seg < nr_segs; seg++) {
                 long iov_left = iov[seg].iov_len;
                 unsigned long user_addr = (unsigned long)iov[seg].iov_base;
@@ -418,7 +510,14 @@ static ssize_t ll_direct_IO_26(int rw, struct kiocb *iocb,
                         if (likely(page_count > 0)) {
                                 if (unlikely(page_count <  max_pages))
                                         bytes = page_count << CFS_PAGE_SHIFT;
-                                result = ll_direct_IO_26_seg(env, io, rw, inode,
+                                if (fastpath)
+                                        result = ll_direct_IO_26_brw(inode, rw,
+                                                             bytes,
+                                                             file_offset, pages,
+                                                             page_count);
+                                else
+                                        result = ll_direct_IO_26_seg(env, io,
+                                                             rw, inode,
                                                              file->f_mapping,
                                                              bytes,
                                                              file_offset, pages,
@@ -457,6 +556,17 @@ static ssize_t ll_direct_IO_26(int rw, struct kiocb *iocb,
         }
 out:
         LASSERT(obj->cob_transient_pages == 0);
+        if (fastpath && rw == WRITE && tot_bytes > 0 &&
+            file->f_mapping->nrpages != 0) {
+                /* a page faulted in during the write may hold stale data,
+                 * like the generic O_DIRECT write path drop it afterwards */
+                ll_teardown_mmaps(file->f_mapping, start,
+                                  start + tot_bytes - 1);
+                invalidate_mapping_pages(file->f_mapping,
+                                         start >> CFS_PAGE_SHIFT,
+                                         (start + tot_bytes - 1) >>
+                                         CFS_PAGE_SHIFT);
+        }
         if (rw == READ)
                 UNLOCK_INODE_MUTEX(inode);
 
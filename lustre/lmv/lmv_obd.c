@@ -814,14 +814,16 @@ static int lmv_iocontrol(unsigned int cmd, struct obd_export *exp,
                 break;
         }
         case OBD_IOC_CHANGELOG_SEND:
+        case OBD_IOC_CHANGELOG_FILTER:
         case OBD_IOC_CHANGELOG_CLEAR: {
+                /* ioc_changelog_filter starts with an ioc_changelog */
                 struct ioc_changelog *icc = karg;
 
                 if (icc->icc_mdtindex >= count)
                         RETURN(-ENODEV);
 
                 rc = obd_iocontrol(cmd, lmv->tgts[icc->icc_mdtindex].ltd_exp,
-                                   sizeof(*icc), icc, NULL);
+                                   len, icc, NULL);
                 break;
         }
         case LL_IOC_GET_CONNECT_FLAGS: {
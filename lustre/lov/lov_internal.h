@@ -187,6 +187,7 @@ void qos_update(struct lov_obd *lov);
 void qos_statfs_done(struct lov_obd *lov);
 void qos_statfs_update(struct obd_device *obd, __u64 max_age, int wait);
 int qos_remedy_create(struct lov_request_set *set, struct lov_request *req);
+void qos_tree_free(struct lov_obd *lov);
 
 /* lov_request.c */
 void lov_set_add_req(struct lov_request *req, struct lov_request_set *set);
@@ -315,6 +316,13 @@ static inline void lprocfs_lov_init_vars(struct lprocfs_static_vars *lvars)
 /* lov_cl.c */
 extern struct lu_device_type lov_device_type;
 
+/* lov_io.c */
+#ifdef __KERNEL__
+void lov_submit_pool_init(void);
+int  lov_submit_pool_start(void);
+void lov_submit_pool_stop(void);
+#endif
+
 /* pools */
 extern cfs_hash_ops_t pool_hash_operations;
 /* ost_pool methods */
@@ -539,6 +539,373 @@ static struct cl_page_list *lov_io_submit_qin(struct lov_device *ld,
         return alloc ? &qin[idx] : &ld->ld_emrg[idx]->emrg_page_list;
 }
 
+#ifdef __KERNEL__
+/**
+ * Threads submitting the per-stripe sub-lists of a parallel lov_io_submit().
+ *
+ * Submission can sleep (memory allocation, RPC building), so it runs in
+ * threads of its own instead of the shared libcfs workitem schedulers. The
+ * threads are started when lov.*.submit_parallel is first enabled and
+ * stopped when the module is unloaded.
+ */
+static struct lov_submit_pool {
+        cfs_spinlock_t          lsp_lock;
+        /** queued lov_submit_item's, protected by lsp_lock */
+        cfs_list_t              lsp_items;
+        cfs_waitq_t             lsp_waitq;
+        cfs_waitq_t             lsp_exit_waitq;
+        /** serializes lov_submit_pool_start() */
+        cfs_mutex_t             lsp_mutex;
+        int                     lsp_nr_threads;
+        int                     lsp_stopping;
+} lov_submit_pool;
+
+#define LOV_SUBMIT_THREADS_MAX  8
+
+/**
+ * State shared by all stripes of one parallel submission.
+ */
+struct lov_submit_batch {
+        /** stripes not done yet, protected by lsp_lock */
+        int                     lsb_pending;
+        /** first error, no stripe is submitted after it, under lsp_lock */
+        int                     lsb_rc;
+        cfs_completion_t        lsb_done;
+};
+
+/**
+ * Stripe handed over to a lov_submit thread.
+ *
+ * The pages are passed as a plain array rather than a cl_page_list: a page
+ * list holds cl_page::cp_mutex of its pages, which has to be released by the
+ * thread that took it. The submitting thread therefore moves the pages off
+ * its list into lsi_pages (lov_submit_pages_give()) and the lov_submit
+ * thread builds its own list from them (lov_submit_pages_take()), and the
+ * other way around once the stripe is submitted.
+ */
+struct lov_submit_item {
+        cfs_list_t              lsi_link;
+        struct lov_submit_batch *lsi_batch;
+        struct lov_io_sub      *lsi_sub;
+        int                     lsi_stripe;
+        enum cl_req_type        lsi_crt;
+        enum cl_req_priority    lsi_prio;
+        struct cl_2queue        lsi_queue;
+        /** pages of the stripe; after submission the first lsi_nr_out of
+         * them are the submitted ones */
+        struct cl_page        **lsi_pages;
+        int                     lsi_nr;
+        int                     lsi_nr_out;
+};
+
+/**
+ * Moves all pages of \a plist to \a pages, keeping a reference on each, and
+ * returns their number.
+ */
+static int lov_submit_pages_give(const struct lu_env *env,
+                                 struct cl_page_list *plist,
+                                 struct cl_page **pages)
+{
+        struct cl_page *page;
+        struct cl_page *tmp;
+        int             nr = 0;
+
+        cl_page_list_for_each_safe(page, tmp, plist) {
+                cl_page_get(page);
+                cl_page_list_del(env, plist, page);
+                pages[nr++] = page;
+        }
+        return nr;
+}
+
+/**
+ * Adds \a nr pages given by lov_submit_pages_give() to \a plist, owned by
+ * the calling thread.
+ */
+static void lov_submit_pages_take(const struct lu_env *env,
+                                  struct cl_page_list *plist,
+                                  struct cl_page **pages, int nr)
+{
+        int i;
+
+        for (i = 0; i < nr; i++) {
+                cl_page_list_add(plist, pages[i]);
+                cl_page_put(env, pages[i]);
+        }
+}
+
+static int lov_submit_batch_rc(struct lov_submit_batch *lsb)
+{
+        int rc;
+
+        cfs_spin_lock(&lov_submit_pool.lsp_lock);
+        rc = lsb->lsb_rc;
+        cfs_spin_unlock(&lov_submit_pool.lsp_lock);
+        return rc;
+}
+
+static void lov_submit_batch_done(struct lov_submit_batch *lsb, int rc)
+{
+        int last;
+
+        cfs_spin_lock(&lov_submit_pool.lsp_lock);
+        if (rc != 0 && lsb->lsb_rc == 0)
+                lsb->lsb_rc = rc;
+        last = --lsb->lsb_pending == 0;
+        cfs_spin_unlock(&lov_submit_pool.lsp_lock);
+
+        /* @lsb can be freed by the submitter as soon as it is completed */
+        if (last)
+                cfs_complete(&lsb->lsb_done);
+}
+
+static void lov_submit_item_run(struct lov_submit_item *lsi)
+{
+        struct lov_submit_batch *lsb   = lsi->lsi_batch;
+        struct lov_io_sub       *sub   = lsi->lsi_sub;
+        struct lu_env           *env   = sub->sub_env;
+        struct cl_2queue        *queue = &lsi->lsi_queue;
+        void                    *cookie;
+        int                      refcheck;
+        int                      rc;
+
+        cookie = cl_env_reenter();
+        cl_env_implant(env, &refcheck);
+
+        cl_2queue_init(queue);
+        lov_submit_pages_take(env, &queue->c2_qin, lsi->lsi_pages,
+                              lsi->lsi_nr);
+
+        /* like lov_io_submit(), stop at the first error */
+        rc = lov_submit_batch_rc(lsb);
+        if (rc == 0)
+                rc = cl_io_submit_rw(env, sub->sub_io, lsi->lsi_crt, queue,
+                                     lsi->lsi_prio);
+
+        lsi->lsi_nr_out = lov_submit_pages_give(env, &queue->c2_qout,
+                                                lsi->lsi_pages);
+        lov_submit_pages_give(env, &queue->c2_qin,
+                              lsi->lsi_pages + lsi->lsi_nr_out);
+
+        cl_env_unplant(env, &refcheck);
+        cl_env_reexit(cookie);
+
+        lov_submit_batch_done(lsb, rc);
+}
+
+static int lov_submit_thread(void *arg)
+{
+        struct lov_submit_pool *lsp = &lov_submit_pool;
+        struct lov_submit_item *lsi;
+        char                    name[20];
+        ENTRY;
+
+        snprintf(name, sizeof(name), "lov_submit_%02ld", (long)arg);
+        cfs_daemonize(name);
+
+        cfs_spin_lock(&lsp->lsp_lock);
+        while (1) {
+                struct l_wait_info lwi = { 0 };
+
+                if (!cfs_list_empty(&lsp->lsp_items)) {
+                        lsi = cfs_list_entry(lsp->lsp_items.next,
+                                             struct lov_submit_item,
+                                             lsi_link);
+                        cfs_list_del_init(&lsi->lsi_link);
+                        cfs_spin_unlock(&lsp->lsp_lock);
+
+                        lov_submit_item_run(lsi);
+
+                        cfs_spin_lock(&lsp->lsp_lock);
+                        continue;
+                }
+                if (lsp->lsp_stopping)
+                        break;
+                cfs_spin_unlock(&lsp->lsp_lock);
+
+                l_wait_event_exclusive(lsp->lsp_waitq,
+                                       !cfs_list_empty(&lsp->lsp_items) ||
+                                       lsp->lsp_stopping, &lwi);
+                cfs_spin_lock(&lsp->lsp_lock);
+        }
+        lsp->lsp_nr_threads--;
+        cfs_spin_unlock(&lsp->lsp_lock);
+        cfs_waitq_broadcast(&lsp->lsp_exit_waitq);
+
+        RETURN(0);
+}
+
+void lov_submit_pool_init(void)
+{
+        struct lov_submit_pool *lsp = &lov_submit_pool;
+
+        cfs_spin_lock_init(&lsp->lsp_lock);
+        CFS_INIT_LIST_HEAD(&lsp->lsp_items);
+        cfs_waitq_init(&lsp->lsp_waitq);
+        cfs_waitq_init(&lsp->lsp_exit_waitq);
+        cfs_mutex_init(&lsp->lsp_mutex);
+        lsp->lsp_nr_threads = 0;
+        lsp->lsp_stopping = 0;
+}
+
+/**
+ * Starts the lov_submit threads, one per CPU up to LOV_SUBMIT_THREADS_MAX,
+ * unless they are running already.
+ */
+int lov_submit_pool_start(void)
+{
+        struct lov_submit_pool *lsp = &lov_submit_pool;
+        int                     nr;
+        int                     rc = 0;
+        ENTRY;
+
+        nr = min(cfs_num_online_cpus(), LOV_SUBMIT_THREADS_MAX);
+
+        cfs_mutex_lock(&lsp->lsp_mutex);
+        while (lsp->lsp_nr_threads < nr) {
+                cfs_spin_lock(&lsp->lsp_lock);
+                lsp->lsp_nr_threads++;
+                cfs_spin_unlock(&lsp->lsp_lock);
+
+                rc = cfs_kernel_thread(lov_submit_thread,
+                                       (void *)(long)(lsp->lsp_nr_threads - 1),
+                                       0);
+                if (rc < 0) {
+                        CERROR("cannot start lov_submit thread: rc = %d\n",
+                               rc);
+                        cfs_spin_lock(&lsp->lsp_lock);
+                        lsp->lsp_nr_threads--;
+                        cfs_spin_unlock(&lsp->lsp_lock);
+                        break;
+                }
+                rc = 0;
+        }
+        /* a few threads are still better than none */
+        if (lsp->lsp_nr_threads > 0)
+                rc = 0;
+        cfs_mutex_unlock(&lsp->lsp_mutex);
+
+        RETURN(rc);
+}
+
+void lov_submit_pool_stop(void)
+{
+        struct lov_submit_pool *lsp = &lov_submit_pool;
+
+        cfs_spin_lock(&lsp->lsp_lock);
+        lsp->lsp_stopping = 1;
+        cfs_spin_unlock(&lsp->lsp_lock);
+
+        cfs_waitq_broadcast(&lsp->lsp_waitq);
+        cfs_wait_event(lsp->lsp_exit_waitq, lsp->lsp_nr_threads == 0);
+}
+
+static int lov_submit_pool_running(void)
+{
+        return lov_submit_pool.lsp_nr_threads > 0;
+}
+
+/**
+ * Submits per-stripe sub-lists of \a stripes_qin concurrently.
+ *
+ * Sub-io's are looked up by the calling thread, because lov_sub_get() is not
+ * thread safe. Every non-empty stripe but the first one is handed over to a
+ * lov_submit thread, see struct lov_submit_item, and the first one is
+ * submitted by the caller itself, so that the page preparation and RPC
+ * building for wide-striped files is no longer done for one stripe after
+ * the other. Once a stripe fails, stripes which are not started yet are not
+ * submitted any more. Pages come back to \a queue in the calling thread.
+ */
+static int lov_io_submit_parallel(const struct lu_env *env,
+                                  struct lov_io *lio, enum cl_req_type crt,
+                                  struct cl_2queue *queue,
+                                  struct cl_page_list *stripes_qin,
+                                  struct lov_submit_item *items,
+                                  struct cl_page **pages,
+                                  enum cl_req_priority priority)
+{
+        struct lov_submit_pool  *lsp  = &lov_submit_pool;
+        struct cl_2queue        *cl2q = &lov_env_info(env)->lti_cl2q;
+        struct lov_submit_batch  lsb;
+        struct lov_submit_item  *lsi;
+        struct lov_io_sub       *sub;
+        int                      stripe;
+        int                      nr = 0;
+        int                      rc = 0;
+        int                      i;
+        ENTRY;
+
+        for (stripe = 0; stripe < lio->lis_nr_subios; stripe++) {
+                if (cfs_list_empty(&stripes_qin[stripe].pl_pages))
+                        continue;
+
+                sub = lov_sub_get(env, lio, stripe);
+                if (IS_ERR(sub)) {
+                        rc = PTR_ERR(sub);
+                        break;
+                }
+                lsi = &items[nr++];
+                lsi->lsi_sub    = sub;
+                lsi->lsi_stripe = stripe;
+                lsi->lsi_crt    = crt;
+                lsi->lsi_prio   = priority;
+                lsi->lsi_batch  = &lsb;
+                /* the first stripe stays in stripes_qin for the caller */
+                lsi->lsi_nr     = 0;
+                lsi->lsi_nr_out = 0;
+                if (nr > 1) {
+                        lsi->lsi_pages = pages;
+                        lsi->lsi_nr = lov_submit_pages_give(env,
+                                                        &stripes_qin[stripe],
+                                                        pages);
+                        pages += lsi->lsi_nr;
+                }
+        }
+
+        if (rc == 0 && nr > 0) {
+                lsb.lsb_pending = nr;
+                lsb.lsb_rc = 0;
+                cfs_init_completion(&lsb.lsb_done);
+
+                cfs_spin_lock(&lsp->lsp_lock);
+                for (i = 1; i < nr; i++)
+                        cfs_list_add_tail(&items[i].lsi_link,
+                                          &lsp->lsp_items);
+                cfs_spin_unlock(&lsp->lsp_lock);
+                cfs_waitq_broadcast(&lsp->lsp_waitq);
+
+                sub = items[0].lsi_sub;
+                cl_2queue_init(cl2q);
+                cl_page_list_splice(&stripes_qin[items[0].lsi_stripe],
+                                    &cl2q->c2_qin);
+                rc = lov_submit_batch_rc(&lsb);
+                if (rc == 0)
+                        rc = cl_io_submit_rw(sub->sub_env, sub->sub_io, crt,
+                                             cl2q, priority);
+                cl_page_list_splice(&cl2q->c2_qin,  &queue->c2_qin);
+                cl_page_list_splice(&cl2q->c2_qout, &queue->c2_qout);
+                lov_submit_batch_done(&lsb, rc);
+
+                cfs_wait_for_completion(&lsb.lsb_done);
+                rc = lsb.lsb_rc;
+        }
+
+        for (i = 0; i < nr; i++) {
+                lsi = &items[i];
+                if (i > 0) {
+                        lov_submit_pages_take(env, &queue->c2_qout,
+                                              lsi->lsi_pages,
+                                              lsi->lsi_nr_out);
+                        lov_submit_pages_take(env, &queue->c2_qin,
+                                              lsi->lsi_pages + lsi->lsi_nr_out,
+                                              lsi->lsi_nr - lsi->lsi_nr_out);
+                }
+                lov_sub_put(lsi->lsi_sub);
+        }
+        RETURN(rc);
+}
+#endif
+
 /**
  * lov implementation of cl_operations::cio_submit() method. It takes a list
  * of pages in \a queue, splits it into per-stripe sub-lists, invokes
@@ -553,6 +920,10 @@ static struct cl_page_list *lov_io_submit_qin(struct lov_device *ld,
  * not-memory cleansing context), and in case of memory shortage, these
  * pre-allocated resources are used by lov_io_submit() under
  * lov_device::ld_mutex mutex.
+ *
+ * When lov_obd::lov_submit_parallel is set, sub-lists of different stripes
+ * are submitted concurrently, see lov_io_submit_parallel(). This is never
+ * done in memory cleansing context.
  */
 static int lov_io_submit(const struct lu_env *env,
                          const struct cl_io_slice *ios,
@@ -565,6 +936,12 @@ static int lov_io_submit(const struct lu_env *env,
         struct cl_page_list    *qin = &queue->c2_qin;
         struct cl_2queue      *cl2q = &lov_env_info(env)->lti_cl2q;
         struct cl_page_list *stripes_qin = NULL;
+#ifdef __KERNEL__
+        struct lov_submit_item *items = NULL;
+        struct cl_page **pages = NULL;
+        int nr_items = 0;
+        int nr_pages = 0;
+#endif
         struct cl_page *page;
         struct cl_page *tmp;
         int stripe;
@@ -618,6 +995,26 @@ static int lov_io_submit(const struct lu_env *env,
                 cl_page_list_move(QIN(stripe), qin, page);
         }
 
+#ifdef __KERNEL__
+        if (alloc && ld->ld_lov->lov_submit_parallel &&
+            lov_submit_pool_running()) {
+                for (stripe = 0; stripe < lio->lis_nr_subios; stripe++) {
+                        if (cfs_list_empty(&stripes_qin[stripe].pl_pages))
+                                continue;
+                        /* pages of the first stripe are not handed over */
+                        if (nr_items++ > 0)
+                                nr_pages += stripes_qin[stripe].pl_nr;
+                }
+                if (nr_items > 1) {
+                        OBD_ALLOC_LARGE(items, sizeof(*items) * nr_items);
+                        OBD_ALLOC_LARGE(pages, sizeof(*pages) * nr_pages);
+                }
+        }
+        if (items != NULL && pages != NULL) {
+                rc = lov_io_submit_parallel(env, lio, crt, queue, stripes_qin,
+                                            items, pages, priority);
+        } else
+#endif
         for (stripe = 0; stripe < lio->lis_nr_subios; stripe++) {
                 struct lov_io_sub   *sub;
                 struct cl_page_list *sub_qin = QIN(stripe);
@@ -648,6 +1045,12 @@ static int lov_io_submit(const struct lu_env *env,
                 cl_page_list_splice(sub_qin, qin);
         }
 
+#ifdef __KERNEL__
+        if (items != NULL)
+                OBD_FREE_LARGE(items, sizeof(*items) * nr_items);
+        if (pages != NULL)
+                OBD_FREE_LARGE(pages, sizeof(*pages) * nr_pages);
+#endif
         if (alloc) {
                 OBD_FREE_LARGE(stripes_qin,
                          sizeof(*stripes_qin) * lio->lis_nr_subios);
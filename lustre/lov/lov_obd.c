@@ -226,6 +226,17 @@ int lov_connect_obd(struct obd_device *obd, __u32 index, int activate,
         if (rc)
                 CERROR("qos_add_tgt failed %d\n", rc);
 
+        /* a target added after mount shares the page budget as well */
+        if (lov->lov_cache != NULL) {
+                rc = obd_set_info_async(lov->lov_tgts[index]->ltd_exp,
+                                        sizeof(KEY_CACHE_SET), KEY_CACHE_SET,
+                                        sizeof(struct cl_client_cache),
+                                        lov->lov_cache, NULL);
+                if (rc)
+                        CERROR("%s: cannot share page cache budget: %d\n",
+                               obd_uuid2str(tgt_uuid), rc);
+        }
+
         RETURN(0);
 }
 
@@ -933,6 +944,7 @@ static int lov_cleanup(struct obd_device *obd)
         /* clear pools parent proc entry only after all pools is killed */
         lprocfs_obd_cleanup(obd);
 
+        qos_tree_free(lov);
         OBD_FREE_PTR(lov->lov_qos.lq_statfs_data);
         RETURN(0);
 }
@@ -1706,6 +1718,64 @@ static int lov_brw(int cmd, struct obd_export *exp, struct obd_info *oinfo,
         RETURN(rc);
 }
 
+static int lov_brw_interpret(struct ptlrpc_request_set *reqset, void *data,
+                             int rc)
+{
+        struct lov_request_set *lovset = data;
+        int err;
+        ENTRY;
+
+        if (rc)
+                lovset->set_completes = 0;
+        err = lov_fini_brw_set(lovset);
+        RETURN(rc ? rc : err);
+}
+
+static int lov_brw_async(int cmd, struct obd_export *exp,
+                         struct obd_info *oinfo, obd_count oa_bufs,
+                         struct brw_page *pga, struct obd_trans_info *oti,
+                         struct ptlrpc_request_set *set)
+{
+        struct lov_request_set *lovset;
+        struct lov_request *req;
+        struct lov_obd *lov = &exp->exp_obd->u.lov;
+        int err, rc = 0;
+        ENTRY;
+
+        ASSERT_LSM_MAGIC(oinfo->oi_md);
+
+        rc = lov_prep_brw_set(exp, oinfo, oa_bufs, pga, oti, &lovset);
+        if (rc)
+                RETURN(rc);
+
+        /* queue the RPCs of all stripes before any of them is waited for */
+        cfs_list_for_each_entry(req, &lovset->set_list, rq_link) {
+                struct obd_export *sub_exp;
+                struct brw_page *sub_pga;
+
+                sub_exp = lov->lov_tgts[req->rq_idx]->ltd_exp;
+                sub_pga = lovset->set_pga + req->rq_pgaidx;
+                rc = obd_brw_async(cmd, sub_exp, &req->rq_oi, req->rq_oabufs,
+                                   sub_pga, oti, set);
+                if (rc)
+                        break;
+                lov_update_common_set(lovset, req, rc);
+        }
+
+        if (!cfs_list_empty(&set->set_requests)) {
+                /* the page array of lovset is in use until the set is done */
+                LASSERT(set->set_interpret == NULL);
+                set->set_interpret = lov_brw_interpret;
+                set->set_arg = (void *)lovset;
+                RETURN(rc);
+        }
+
+        if (rc)
+                lovset->set_completes = 0;
+        err = lov_fini_brw_set(lovset);
+        RETURN(rc ? rc : err);
+}
+
 static int lov_enqueue_interpret(struct ptlrpc_request_set *rqset,
                                  void *data, int rc)
 {
@@ -2695,6 +2765,10 @@ static int lov_set_info_async(struct obd_export *exp, obd_count keylen,
                 mds_con = 1;
         } else if (KEY_IS(KEY_CAPA_KEY)) {
                 capa = 1;
+        } else if (KEY_IS(KEY_CACHE_SET)) {
+                LASSERT(lov->lov_cache == NULL);
+                lov->lov_cache = val;
+                do_inactive = 1;
         }
 
         for (i = 0; i < count; i++, val = (char *)val + incr) {
@@ -2844,6 +2918,7 @@ struct obd_ops lov_obd_ops = {
         .o_setattr             = lov_setattr,
         .o_setattr_async       = lov_setattr_async,
         .o_brw                 = lov_brw,
+        .o_brw_async           = lov_brw_async,
         .o_merge_lvb           = lov_merge_lvb,
         .o_adjust_kms          = lov_adjust_kms,
         .o_punch               = lov_punch,
@@ -2898,6 +2973,9 @@ int __init lov_init(void)
                 return -ENOMEM;
         }
         lprocfs_lov_init_vars(&lvars);
+#ifdef __KERNEL__
+        lov_submit_pool_init();
+#endif
 
         cfs_request_module("lquota");
         quota_interface = PORTAL_SYMBOL_GET(lov_quota_interface);
@@ -2922,6 +3000,7 @@ static void /*__exit*/ lov_exit(void)
 {
         int rc;
 
+        lov_submit_pool_stop();
         lu_device_type_fini(&lov_device_type);
         lu_kmem_fini(lov_caches);
 
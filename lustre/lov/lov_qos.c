@@ -48,6 +48,7 @@
 #include <obd_class.h>
 #include <obd_lov.h>
 #include <lustre/lustre_idl.h>
+#include <weight_tree.h>
 #include "lov_internal.h"
 
 /* #define QOS_DEBUG 1 */
@@ -282,12 +283,12 @@ static int qos_calc_weight(struct lov_obd *lov, int i)
         return 0;
 }
 
-/* We just used this index for a stripe; adjust everyone's weights */
-static int qos_used(struct lov_obd *lov, struct ost_pool *osts,
-                    __u32 index, __u64 *total_wt)
+/* We just used this index for a stripe; adjust its own and its OSS's
+   penalties.  Decreasing everyone's penalties is batched in qos_decay()
+   once the whole allocation is done. */
+static void qos_used(struct lov_obd *lov, __u32 index)
 {
         struct lov_qos_oss *oss;
-        int j;
         ENTRY;
 
         /* Don't allocate from this stripe anymore, until the next alloc_qos */
@@ -310,42 +311,43 @@ static int qos_used(struct lov_obd *lov, struct ost_pool *osts,
                 lov->desc.ld_active_tgt_count;
         oss->lqo_penalty += oss->lqo_penalty_per_obj *
                 lov->lov_qos.lq_active_oss_count;
+        EXIT;
+}
+
+/* Decrease all OSS and OST penalties for the @used objects just allocated */
+static void qos_decay(struct lov_obd *lov, struct ost_pool *osts, int used)
+{
+        struct lov_qos_oss *oss;
+        __u64 dec;
+        int j;
 
-        /* Decrease all OSS penalties */
         cfs_list_for_each_entry(oss, &lov->lov_qos.lq_oss_list, lqo_oss_list) {
-                if (oss->lqo_penalty < oss->lqo_penalty_per_obj)
+                dec = oss->lqo_penalty_per_obj * used;
+                if (oss->lqo_penalty < dec)
                         oss->lqo_penalty = 0;
                 else
-                        oss->lqo_penalty -= oss->lqo_penalty_per_obj;
+                        oss->lqo_penalty -= dec;
         }
 
-        *total_wt = 0;
-        /* Decrease all OST penalties */
         for (j = 0; j < osts->op_count; j++) {
                 int i;
 
                 i = osts->op_array[j];
                 if (!lov->lov_tgts[i] || !lov->lov_tgts[i]->ltd_active)
                         continue;
-                if (lov->lov_tgts[i]->ltd_qos.ltq_penalty <
-                    lov->lov_tgts[i]->ltd_qos.ltq_penalty_per_obj)
+                dec = lov->lov_tgts[i]->ltd_qos.ltq_penalty_per_obj * used;
+                if (lov->lov_tgts[i]->ltd_qos.ltq_penalty < dec)
                         lov->lov_tgts[i]->ltd_qos.ltq_penalty = 0;
                 else
-                        lov->lov_tgts[i]->ltd_qos.ltq_penalty -=
-                        lov->lov_tgts[i]->ltd_qos.ltq_penalty_per_obj;
+                        lov->lov_tgts[i]->ltd_qos.ltq_penalty -= dec;
 
                 qos_calc_weight(lov, i);
 
-                /* Recalc the total weight of usable osts */
-                if (lov->lov_tgts[i]->ltd_qos.ltq_usable)
-                        *total_wt += lov->lov_tgts[i]->ltd_qos.ltq_weight;
-
 #ifdef QOS_DEBUG
-                CDEBUG(D_QOS, "recalc tgt %d usable=%d avail="LPU64
+                CDEBUG(D_QOS, "recalc tgt %d avail="LPU64
                        " ostppo="LPU64" ostp="LPU64" ossppo="LPU64
                        " ossp="LPU64" wt="LPU64"\n",
-                       i, lov->lov_tgts[i]->ltd_qos.ltq_usable,
-                       TGT_BAVAIL(i) >> 10,
+                       i, TGT_BAVAIL(i) >> 10,
                        lov->lov_tgts[i]->ltd_qos.ltq_penalty_per_obj >> 10,
                        lov->lov_tgts[i]->ltd_qos.ltq_penalty >> 10,
                        lov->lov_tgts[i]->ltd_qos.ltq_oss->lqo_penalty_per_obj>>10,
@@ -353,8 +355,55 @@ static int qos_used(struct lov_obd *lov, struct ost_pool *osts,
                        lov->lov_tgts[i]->ltd_qos.ltq_weight >> 10);
 #endif
         }
+}
 
-        RETURN(0);
+void qos_tree_free(struct lov_obd *lov)
+{
+        struct lov_qos *lq = &lov->lov_qos;
+
+        if (lq->lq_tree_sum != NULL)
+                OBD_FREE_LARGE(lq->lq_tree_sum,
+                               sizeof(*lq->lq_tree_sum) *
+                               (lq->lq_tree_size + 1));
+        if (lq->lq_tree_weight != NULL)
+                OBD_FREE_LARGE(lq->lq_tree_weight,
+                               sizeof(*lq->lq_tree_weight) * lq->lq_tree_size);
+        if (lq->lq_tree_idx != NULL)
+                OBD_FREE_LARGE(lq->lq_tree_idx,
+                               sizeof(*lq->lq_tree_idx) * lq->lq_tree_size);
+        if (lq->lq_tree_next != NULL)
+                OBD_FREE_LARGE(lq->lq_tree_next,
+                               sizeof(*lq->lq_tree_next) * lq->lq_tree_size);
+        lq->lq_tree_sum = NULL;
+        lq->lq_tree_weight = NULL;
+        lq->lq_tree_idx = NULL;
+        lq->lq_tree_next = NULL;
+        lq->lq_tree_size = 0;
+}
+
+/* Make room for @count candidates in the alloc_qos() scratch space, which
+   is kept between allocations.  Called under lq_rw_sem write lock. */
+static int qos_tree_reserve(struct lov_obd *lov, unsigned int count)
+{
+        struct lov_qos *lq = &lov->lov_qos;
+
+        if (count <= lq->lq_tree_size)
+                return 0;
+
+        qos_tree_free(lov);
+        /* grow by the full target count, so this happens about once */
+        count = max(count, lov->desc.ld_tgt_count);
+        lq->lq_tree_size = count;
+        OBD_ALLOC_LARGE(lq->lq_tree_sum, sizeof(*lq->lq_tree_sum) * (count + 1));
+        OBD_ALLOC_LARGE(lq->lq_tree_weight, sizeof(*lq->lq_tree_weight) * count);
+        OBD_ALLOC_LARGE(lq->lq_tree_idx, sizeof(*lq->lq_tree_idx) * count);
+        OBD_ALLOC_LARGE(lq->lq_tree_next, sizeof(*lq->lq_tree_next) * count);
+        if (lq->lq_tree_sum == NULL || lq->lq_tree_weight == NULL ||
+            lq->lq_tree_idx == NULL || lq->lq_tree_next == NULL) {
+                qos_tree_free(lov);
+                return -ENOMEM;
+        }
+        return 0;
 }
 
 #define LOV_QOS_EMPTY ((__u32)-1)
@@ -785,9 +834,14 @@ static int alloc_qos(struct obd_export *exp, int *idx_arr, int *stripe_cnt,
                      char *poolname, int flags)
 {
         struct lov_obd *lov = &exp->exp_obd->u.lov;
+        struct lov_qos *lq = &lov->lov_qos;
+        struct lov_qos_oss *oss;
+        struct lov_tgt_desc *tgt;
+        struct weight_tree wt;
         __u64 total_weight = 0;
-        int nfound, good_osts, i, rc = 0;
+        int nfound, good_osts, i, j, k, n, rc = 0;
         int stripe_cnt_min = min_stripe_count(*stripe_cnt, flags);
+        int speed = 0;
         struct pool_desc *pool;
         struct ost_pool *osts;
         struct lov_qos_rr *lqr;
@@ -834,11 +888,15 @@ static int alloc_qos(struct obd_export *exp, int *idx_arr, int *stripe_cnt,
         if (rc)
                 GOTO(out, rc);
 
+repeat_find:
         good_osts = 0;
         /* Find all the OSTs that are valid stripe candidates */
         for (i = 0; i < osts->op_count; i++) {
-                if (!lov->lov_tgts[osts->op_array[i]] ||
-                    !lov->lov_tgts[osts->op_array[i]]->ltd_active)
+                if (!lov->lov_tgts[osts->op_array[i]])
+                        continue;
+
+                lov->lov_tgts[osts->op_array[i]]->ltd_qos.ltq_usable = 0;
+                if (!lov->lov_tgts[osts->op_array[i]]->ltd_active)
                         continue;
 
                 /* Fail Check before osc_precreate() is called
@@ -846,20 +904,28 @@ static int alloc_qos(struct obd_export *exp, int *idx_arr, int *stripe_cnt,
                 if (OBD_FAIL_CHECK(OBD_FAIL_MDS_OSC_PRECREATE) && osts->op_array[i] == 0)
                         continue;
 
-                if (obd_precreate(lov->lov_tgts[osts->op_array[i]]->ltd_exp) > 2)
+                /* First consider only OSTs with precreated objects ready,
+                 * so that the create does not wait for a refill */
+                if (obd_precreate(lov->lov_tgts[osts->op_array[i]]->ltd_exp) >
+                    speed)
                         continue;
 
                 lov->lov_tgts[osts->op_array[i]]->ltd_qos.ltq_usable = 1;
                 qos_calc_weight(lov, osts->op_array[i]);
-                total_weight += lov->lov_tgts[osts->op_array[i]]->ltd_qos.ltq_weight;
 
                 good_osts++;
         }
 
 #ifdef QOS_DEBUG
-        CDEBUG(D_QOS, "found %d good osts\n", good_osts);
+        CDEBUG(D_QOS, "found %d good osts at speed %d\n", good_osts, speed);
 #endif
 
+        if (good_osts < *stripe_cnt && speed < 2) {
+                /* Try again, allowing OSTs that are still precreating */
+                speed = 2;
+                goto repeat_find;
+        }
+
         if (good_osts < stripe_cnt_min)
                 GOTO(out, rc = -EAGAIN);
 
@@ -870,13 +936,35 @@ static int alloc_qos(struct obd_export *exp, int *idx_arr, int *stripe_cnt,
         if (!*stripe_cnt)
                 GOTO(out, rc = -EAGAIN);
 
+        rc = qos_tree_reserve(lov, good_osts);
+        if (rc)
+                GOTO(out, rc);
+
+        /* Lay the candidates out in a weight tree, and chain the candidates
+           of each OSS, whose weights change together in qos_used(). */
+        cfs_list_for_each_entry(oss, &lov->lov_qos.lq_oss_list, lqo_oss_list)
+                oss->lqo_tree_head = -1;
+        for (i = 0, n = 0; i < osts->op_count; i++) {
+                tgt = lov->lov_tgts[osts->op_array[i]];
+                if (!tgt || !tgt->ltd_qos.ltq_usable)
+                        continue;
+
+                lq->lq_tree_idx[n] = osts->op_array[i];
+                lq->lq_tree_weight[n] = tgt->ltd_qos.ltq_weight;
+                lq->lq_tree_next[n] = tgt->ltd_qos.ltq_oss->lqo_tree_head;
+                tgt->ltd_qos.ltq_oss->lqo_tree_head = n;
+                n++;
+        }
+        LASSERT(n == good_osts);
+        weight_tree_build(&wt, lq->lq_tree_sum, lq->lq_tree_weight, n);
+
         /* Find enough OSTs with weighted random allocation. */
         nfound = 0;
         while (nfound < *stripe_cnt) {
-                __u64 rand, cur_weight;
+                __u64 rand;
 
-                cur_weight = 0;
                 rc = -ENODEV;
+                total_weight = weight_tree_total(&wt);
 
                 if (total_weight) {
 #if BITS_PER_LONG == 32
@@ -904,35 +992,46 @@ static int alloc_qos(struct obd_export *exp, int *idx_arr, int *stripe_cnt,
                 }
 
                 /* On average, this will hit larger-weighted osts more often.
-                   0-weight osts will always get used last (only when rand=0).*/
-                for (i = 0; i < osts->op_count; i++) {
-                        if (!lov->lov_tgts[osts->op_array[i]] ||
-                            !lov->lov_tgts[osts->op_array[i]]->ltd_qos.ltq_usable)
-                                continue;
-
-                        cur_weight += lov->lov_tgts[osts->op_array[i]]->ltd_qos.ltq_weight;
-#ifdef QOS_DEBUG
-                        CDEBUG(D_QOS, "stripe_cnt=%d nfound=%d cur_weight="LPU64
-                                      " rand="LPU64" total_weight="LPU64"\n",
-                               *stripe_cnt, nfound, cur_weight, rand, total_weight);
-#endif
-                        if (cur_weight >= rand) {
-#ifdef QOS_DEBUG
-                                CDEBUG(D_QOS, "assigned stripe=%d to idx=%d\n",
-                                       nfound, osts->op_array[i]);
-#endif
-                                idx_arr[nfound++] = osts->op_array[i];
-                                qos_used(lov, osts, osts->op_array[i], &total_weight);
-                                rc = 0;
-                                break;
-                        }
+                   0-weight osts will always get used last (only when all
+                   weights left are 0). */
+                j = weight_tree_find(&wt, rand);
+                if (j >= n) {
+                        for (j = 0; j < n; j++)
+                                if (lov->lov_tgts[lq->lq_tree_idx[j]]->
+                                    ltd_qos.ltq_usable)
+                                        break;
                 }
                 /* should never satisfy below condition */
-                if (rc) {
+                if (j >= n) {
                         CERROR("Didn't find any OSTs?\n");
                         break;
                 }
+#ifdef QOS_DEBUG
+                CDEBUG(D_QOS, "assigned stripe=%d to idx=%d rand="LPU64
+                       " total_weight="LPU64"\n", nfound, lq->lq_tree_idx[j],
+                       rand, total_weight);
+#endif
+                idx_arr[nfound++] = lq->lq_tree_idx[j];
+                qos_used(lov, lq->lq_tree_idx[j]);
+                rc = 0;
+
+                /* Take it out of the tree, and refresh the weights of the
+                   other candidates on its OSS, whose penalty just grew. */
+                weight_tree_add(&wt, j, -(__s64)lq->lq_tree_weight[j]);
+                lq->lq_tree_weight[j] = 0;
+                tgt = lov->lov_tgts[lq->lq_tree_idx[j]];
+                for (k = tgt->ltd_qos.ltq_oss->lqo_tree_head; k >= 0;
+                     k = lq->lq_tree_next[k]) {
+                        tgt = lov->lov_tgts[lq->lq_tree_idx[k]];
+                        if (!tgt->ltd_qos.ltq_usable)
+                                continue;
+                        qos_calc_weight(lov, lq->lq_tree_idx[k]);
+                        weight_tree_add(&wt, k, tgt->ltd_qos.ltq_weight -
+                                                lq->lq_tree_weight[k]);
+                        lq->lq_tree_weight[k] = tgt->ltd_qos.ltq_weight;
+                }
         }
+        qos_decay(lov, osts, nfound);
         LASSERT(nfound == *stripe_cnt);
 
 out:
@@ -302,6 +302,36 @@ static int lov_wr_qos_maxage(struct file *file, const char *buffer,
         return count;
 }
 
+static int lov_rd_submit_parallel(char *page, char **start, off_t off,
+                                  int count, int *eof, void *data)
+{
+        struct obd_device *dev = (struct obd_device *)data;
+
+        LASSERT(dev != NULL);
+        *eof = 1;
+        return snprintf(page, count, "%d\n", dev->u.lov.lov_submit_parallel);
+}
+
+static int lov_wr_submit_parallel(struct file *file, const char *buffer,
+                                  unsigned long count, void *data)
+{
+        struct obd_device *dev = (struct obd_device *)data;
+        int val, rc;
+
+        LASSERT(dev != NULL);
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        if (val) {
+                rc = lov_submit_pool_start();
+                if (rc)
+                        return rc;
+        }
+        dev->u.lov.lov_submit_parallel = !!val;
+        return count;
+}
+
 static void *lov_tgt_seq_start(struct seq_file *p, loff_t *pos)
 {
         struct obd_device *dev = p->private;
@@ -383,6 +413,8 @@ struct lprocfs_vars lprocfs_lov_obd_vars[] = {
         { "qos_prio_free",lov_rd_qos_priofree,    lov_wr_qos_priofree, 0 },
         { "qos_threshold_rr",  lov_rd_qos_thresholdrr, lov_wr_qos_thresholdrr, 0 },
         { "qos_maxage",   lov_rd_qos_maxage,      lov_wr_qos_maxage, 0 },
+        { "submit_parallel", lov_rd_submit_parallel,
+                             lov_wr_submit_parallel, 0 },
         { 0 }
 };
 
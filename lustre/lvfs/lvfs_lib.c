@@ -71,6 +71,62 @@ int obd_alloc_fail(const void *ptr, const char *name, const char *type,
 EXPORT_SYMBOL(obd_alloc_fail);
 
 #ifdef LPROCFS
+cfs_atomic_t lprocfs_stats_gen = CFS_ATOMIC_INIT(1);
+EXPORT_SYMBOL(lprocfs_stats_gen);
+
+/*
+ * Allocate area \a smp_id of LPROCFS_STATS_FLAG_LAZY stats on the first
+ * update from its cpu.  Called by that cpu with preemption disabled, so
+ * nobody else installs the area; readers skip it until it is published.
+ * The caller may hold spinlocks, hence the atomic allocation.  After a
+ * failure the updates go to area 0 for a second before the next attempt.
+ */
+int lprocfs_stats_alloc_one(struct lprocfs_stats *stats, unsigned int smp_id)
+{
+        struct lprocfs_percpu  *percpu;
+        struct lprocfs_counter *cntr;
+        struct lprocfs_counter *cntr0;
+        unsigned int            i;
+
+        if (stats->ls_nomem != 0 &&
+            cfs_time_before(cfs_time_current(), stats->ls_nomem))
+                return -ENOMEM;
+
+        OBD_ALLOC_GFP(percpu, lprocfs_stats_area_size(stats, smp_id),
+                      CFS_ALLOC_ATOMIC);
+        if (percpu == NULL) {
+                stats->ls_nomem = cfs_time_shift(1);
+                return -ENOMEM;
+        }
+
+        /* area 0 is set up by lprocfs_counter_init() */
+        for (i = 0; i < stats->ls_num; i++) {
+                cntr = &percpu->lp_cntr[i];
+                cntr0 = &stats->ls_percpu[0]->lp_cntr[i];
+                cntr->lc_config = cntr0->lc_config;
+                cntr->lc_min = LC_MIN_INIT;
+                cntr->lc_name = cntr0->lc_name;
+                cntr->lc_units = cntr0->lc_units;
+                cntr->lc_hist = cntr0->lc_hist;
+        }
+
+        smp_wmb();
+        stats->ls_percpu[smp_id] = percpu;
+        return 0;
+}
+EXPORT_SYMBOL(lprocfs_stats_alloc_one);
+
+static inline unsigned int lprocfs_hist_bucket(long amount)
+{
+        unsigned int bucket = 0;
+
+        while (amount > 0 && bucket < LPROCFS_HIST_MAX - 1) {
+                amount >>= 1;
+                bucket++;
+        }
+        return bucket;
+}
+
 void lprocfs_counter_add(struct lprocfs_stats *stats, int idx,
                                        long amount)
 {
@@ -85,8 +141,7 @@ void lprocfs_counter_add(struct lprocfs_stats *stats, int idx,
         smp_id = lprocfs_stats_lock(stats, LPROCFS_GET_SMP_ID);
 
         percpu_cntr = &(stats->ls_percpu[smp_id]->lp_cntr[idx]);
-        if (!(stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU))
-                cfs_atomic_inc(&percpu_cntr->lc_cntl.la_entry);
+        lprocfs_counter_write_begin(percpu_cntr);
         percpu_cntr->lc_count++;
 
         if (percpu_cntr->lc_config & LPROCFS_CNTR_AVGMINMAX) {
@@ -100,9 +155,11 @@ void lprocfs_counter_add(struct lprocfs_stats *stats, int idx,
                         percpu_cntr->lc_min = amount;
                 if (amount > percpu_cntr->lc_max)
                         percpu_cntr->lc_max = amount;
+                if (percpu_cntr->lc_config & LPROCFS_CNTR_HISTOGRAM)
+                        percpu_cntr->lc_hist[smp_id * LPROCFS_HIST_MAX +
+                                             lprocfs_hist_bucket(amount)]++;
         }
-        if (!(stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU))
-                cfs_atomic_inc(&percpu_cntr->lc_cntl.la_exit);
+        lprocfs_counter_write_end(percpu_cntr);
         lprocfs_stats_unlock(stats, LPROCFS_GET_SMP_ID);
 }
 EXPORT_SYMBOL(lprocfs_counter_add);
@@ -121,8 +178,6 @@ void lprocfs_counter_sub(struct lprocfs_stats *stats, int idx,
         smp_id = lprocfs_stats_lock(stats, LPROCFS_GET_SMP_ID);
 
         percpu_cntr = &(stats->ls_percpu[smp_id]->lp_cntr[idx]);
-        if (!(stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU))
-                cfs_atomic_inc(&percpu_cntr->lc_cntl.la_entry);
         if (percpu_cntr->lc_config & LPROCFS_CNTR_AVGMINMAX) {
                 /*
                  * currently lprocfs_count_add() can only be called in thread
@@ -130,15 +185,17 @@ void lprocfs_counter_sub(struct lprocfs_stats *stats, int idx,
                  * which calls lprocfs_counter_sub(), and RCU callbacks may
                  * execute in softirq context - right now that's the only case
                  * we're in softirq context here, use separate counter for that.
-                 * bz20650.
+                 * bz20650.  The softirq may interrupt an update of this
+                 * counter, so lc_sum_irq is updated outside lc_seq.
                  */
-                if (cfs_in_interrupt())
+                if (cfs_in_interrupt()) {
                         percpu_cntr->lc_sum_irq -= amount;
-                else
+                } else {
+                        lprocfs_counter_write_begin(percpu_cntr);
                         percpu_cntr->lc_sum -= amount;
+                        lprocfs_counter_write_end(percpu_cntr);
+                }
         }
-        if (!(stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU))
-                cfs_atomic_inc(&percpu_cntr->lc_cntl.la_exit);
         lprocfs_stats_unlock(stats, LPROCFS_GET_SMP_ID);
 }
 EXPORT_SYMBOL(lprocfs_counter_sub);
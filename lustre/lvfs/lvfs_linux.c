@@ -586,12 +586,12 @@ __s64 lprocfs_read_helper(struct lprocfs_counter *lc,
                           enum lprocfs_fields_flags field)
 {
         __s64 ret = 0;
-        int centry;
+        unsigned int seq;
 
         if (!lc)
                 RETURN(0);
         do {
-                centry = cfs_atomic_read(&lc->lc_cntl.la_entry);
+                seq = lprocfs_counter_read_begin(lc);
 
                 switch (field) {
                         case LPROCFS_FIELDS_FLAGS_CONFIG:
@@ -618,8 +618,7 @@ __s64 lprocfs_read_helper(struct lprocfs_counter *lc,
                         default:
                                 break;
                 };
-        } while (centry != cfs_atomic_read(&lc->lc_cntl.la_entry) &&
-                 centry != cfs_atomic_read(&lc->lc_cntl.la_exit));
+        } while (lprocfs_counter_read_retry(lc, seq));
 
         RETURN(ret);
 }
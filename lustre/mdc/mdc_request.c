@@ -1194,14 +1194,88 @@ static struct kuc_hdr *changelog_kuc_hdr(char *buf, int len, int flags)
 
 #define D_CHANGELOG 0
 
+/* Records are queued and written to the pipe in batches of up to PIPE_BUF
+ * bytes, which the pipe delivers atomically. */
+#define CHANGELOG_BATCH_SIZE PIPE_BUF
+
 struct changelog_show {
         __u64       cs_startrec;
         __u32       cs_flags;
+        struct changelog_filter cs_filter; /* records wanted */
         cfs_file_t *cs_fp;
-        char       *cs_buf;
+        char       *cs_buf;    /* queued messages */
+        int         cs_len;    /* bytes queued in cs_buf */
+        char       *cs_blk;    /* for reading the last block of a plain log */
+        struct llog_handle *cs_llh; /* plain log being sent */
         struct obd_device *cs_obd;
 };
 
+/* Write out the messages queued in cs_buf */
+static int changelog_flush(struct changelog_show *cs)
+{
+        int rc;
+
+        if (cs->cs_len == 0)
+                return 0;
+
+        rc = libcfs_kkuc_msgs_put(cs->cs_fp, cs->cs_buf, cs->cs_len);
+        CDEBUG(D_CHANGELOG, "kucmsg fp %p len %d rc %d\n", cs->cs_fp,
+               cs->cs_len, rc);
+        cs->cs_len = 0;
+
+        return rc < 0 ? rc : 0;
+}
+
+/**
+ * Check whether all records of a plain log are before the start record.
+ * Only full logs are checked, the last one may still be growing.  The MDD
+ * assigns cr_index in llog order, so the last record has the highest index.
+ *
+ * \retval 1 the whole log can be skipped
+ * \retval 0 the log must be processed
+ */
+static int changelog_log_is_old(struct changelog_show *cs,
+                                struct llog_handle *llh)
+{
+        struct llog_rec_hdr *rec;
+        int last = llh->lgh_last_idx;
+        int rc;
+
+        if (last < LLOG_BITMAP_SIZE(llh->lgh_hdr) - 1)
+                return 0;
+
+        if (cs->cs_blk == NULL) {
+                OBD_ALLOC(cs->cs_blk, LLOG_CHUNK_SIZE);
+                if (cs->cs_blk == NULL)
+                        return 0;
+        }
+
+        memset(cs->cs_blk, 0, LLOG_CHUNK_SIZE);
+        rc = llog_prev_block(llh, last, cs->cs_blk, LLOG_CHUNK_SIZE);
+        if (rc)
+                return 0;
+
+        for (rec = (struct llog_rec_hdr *)cs->cs_blk;
+             (char *)rec < cs->cs_blk + LLOG_CHUNK_SIZE;
+             rec = (struct llog_rec_hdr *)((char *)rec + rec->lrh_len)) {
+                struct llog_changelog_rec *cr;
+
+                if (LLOG_REC_HDR_NEEDS_SWABBING(rec))
+                        lustre_swab_llog_rec(rec, NULL);
+                if (rec->lrh_len == 0 || rec->lrh_len > LLOG_CHUNK_SIZE)
+                        break;
+                if (rec->lrh_index != last)
+                        continue;
+
+                cr = (struct llog_changelog_rec *)rec;
+                if (rec->lrh_type != CHANGELOG_REC)
+                        break;
+                return cr->cr.cr_index < cs->cs_startrec;
+        }
+
+        return 0;
+}
+
 static int changelog_show_cb(struct llog_handle *llh, struct llog_rec_hdr *hdr,
                              void *data)
 {
@@ -1219,11 +1293,27 @@ static int changelog_show_cb(struct llog_handle *llh, struct llog_rec_hdr *hdr,
         }
 
         if (rec->cr.cr_index < cs->cs_startrec) {
+                /* On entering a new plain log, skip it entirely if it ends
+                 * before the start record, rather than reading it through */
+                if (llh != cs->cs_llh) {
+                        cs->cs_llh = llh;
+                        if (changelog_log_is_old(cs, llh)) {
+                                CDEBUG(D_CHANGELOG, "skip log "LPX64
+                                       " start="LPU64"\n",
+                                       llh->lgh_id.lgl_oid, cs->cs_startrec);
+                                RETURN(LLOG_SKIP_PLAIN);
+                        }
+                }
                 /* Skip entries earlier than what we are interested in */
                 CDEBUG(D_CHANGELOG, "rec="LPU64" start="LPU64"\n",
                        rec->cr.cr_index, cs->cs_startrec);
                 RETURN(0);
         }
+        cs->cs_llh = llh;
+
+        /* the MDS does this too, but older ones do not */
+        if (!(cs->cs_filter.clf_mask & (1 << rec->cr.cr_type)))
+                RETURN(0);
 
         CDEBUG(D_CHANGELOG, LPU64" %02d%-5s "LPU64" 0x%x t="DFID" p="DFID
                " %.*s\n", rec->cr.cr_index, rec->cr.cr_type,
@@ -1234,14 +1324,18 @@ static int changelog_show_cb(struct llog_handle *llh, struct llog_rec_hdr *hdr,
 
         len = sizeof(*lh) + sizeof(rec->cr) + rec->cr.cr_namelen;
 
-        /* Set up the message */
-        lh = changelog_kuc_hdr(cs->cs_buf, len, cs->cs_flags);
-        memcpy(lh + 1, &rec->cr, len - sizeof(*lh));
+        if (cs->cs_len + len > CHANGELOG_BATCH_SIZE) {
+                rc = changelog_flush(cs);
+                if (rc)
+                        RETURN(rc);
+        }
 
-        rc = libcfs_kkuc_msg_put(cs->cs_fp, lh);
-        CDEBUG(D_CHANGELOG, "kucmsg fp %p len %d rc %d\n", cs->cs_fp, len,rc);
+        /* Queue the message */
+        lh = changelog_kuc_hdr(cs->cs_buf + cs->cs_len, len, cs->cs_flags);
+        memcpy(lh + 1, &rec->cr, len - sizeof(*lh));
+        cs->cs_len += len;
 
-        RETURN(rc);
+        RETURN(0);
 }
 
 static int mdc_changelog_send_thread(void *csdata)
@@ -1281,9 +1375,18 @@ static int mdc_changelog_send_thread(void *csdata)
                 GOTO(out, rc);
         }
 
+        /* have the MDS leave out the records we do not want */
+        if (cs->cs_filter.clf_mask != CHANGELOG_ALLMASK ||
+            cs->cs_filter.clf_user != 0 ||
+            !fid_is_zero(&cs->cs_filter.clf_fid))
+                llh->lgh_filter = &cs->cs_filter;
+
         rc = llog_cat_process_flags(llh, changelog_show_cb, cs, 0, 0, 0);
+        if (rc == 0)
+                rc = changelog_flush(cs);
 
         /* Send EOF no matter what our result */
+        cs->cs_len = 0;
         if ((kuch = changelog_kuc_hdr(cs->cs_buf, sizeof(*kuch),
                                       cs->cs_flags))) {
                 kuch->kuc_msgtype = CL_EOF;
@@ -1298,6 +1401,8 @@ out:
                 llog_ctxt_put(ctxt);
         if (cs->cs_buf)
                 OBD_FREE(cs->cs_buf, CR_MAXSIZE);
+        if (cs->cs_blk)
+                OBD_FREE(cs->cs_blk, LLOG_CHUNK_SIZE);
         OBD_FREE_PTR(cs);
         /* detach from parent process so we get cleaned up */
         cfs_daemonize("cl_send");
@@ -1305,7 +1410,8 @@ out:
 }
 
 static int mdc_ioc_changelog_send(struct obd_device *obd,
-                                  struct ioc_changelog *icc)
+                                  struct ioc_changelog *icc,
+                                  struct changelog_filter *filter)
 {
         struct changelog_show *cs;
         int rc;
@@ -1320,6 +1426,10 @@ static int mdc_ioc_changelog_send(struct obd_device *obd,
         /* matching cfs_put_file in mdc_changelog_send_thread */
         cs->cs_fp = cfs_get_fd(icc->icc_id);
         cs->cs_flags = icc->icc_flags;
+        if (filter != NULL)
+                cs->cs_filter = *filter;
+        if (cs->cs_filter.clf_mask == 0)
+                cs->cs_filter.clf_mask = CHANGELOG_ALLMASK;
 
         /* New thread because we should return to user app before
            writing into our pipe */
@@ -1357,8 +1467,17 @@ static int mdc_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
                 rc = mdc_ioc_hsm_ct_start(exp, karg);
                 GOTO(out, rc);
         case OBD_IOC_CHANGELOG_SEND:
-                rc = mdc_ioc_changelog_send(obd, karg);
+                rc = mdc_ioc_changelog_send(obd, karg, NULL);
                 GOTO(out, rc);
+        case OBD_IOC_CHANGELOG_FILTER: {
+                struct ioc_changelog_filter *icf = karg;
+
+                if (icf->icf_size != sizeof(*icf))
+                        GOTO(out, rc = -EINVAL);
+                rc = mdc_ioc_changelog_send(obd, &icf->icf_icc,
+                                            &icf->icf_filter);
+                GOTO(out, rc);
+        }
         case OBD_IOC_CHANGELOG_CLEAR: {
                 struct ioc_changelog *icc = karg;
                 struct changelog_setinfo cs =
@@ -97,6 +97,7 @@ static int mdd_device_init(const struct lu_env *env, struct lu_device *d,
         mdd->mdd_atime_diff = MAX_ATIME_DIFF;
         /* sync permission changes */
         mdd->mdd_sync_permission = 1;
+        mdd_orphan_cleanup_init(mdd);
 
         rc = mdd_procfs_init(mdd, name);
         RETURN(rc);
@@ -124,6 +125,7 @@ static void mdd_device_shutdown(const struct lu_env *env,
                                 struct mdd_device *m, struct lustre_cfg *cfg)
 {
         ENTRY;
+        mdd_orphan_cleanup_stop(m);
         mdd_changelog_fini(env, m);
         dt_txn_callback_del(m->mdd_child, &m->mdd_txn_cb);
         if (m->mdd_dot_lustre_objs.mdd_obf)
@@ -158,6 +160,60 @@ static int changelog_init_cb(struct llog_handle *llh, struct llog_rec_hdr *hdr,
         RETURN(LLOG_PROC_BREAK);
 }
 
+/* Find changelog user \a id in mc_users; called under mc_user_lock */
+static struct mdd_changelog_user *
+mdd_changelog_user_find(struct mdd_device *mdd, __u32 id)
+{
+        struct mdd_changelog_user *mcu;
+
+        cfs_list_for_each_entry(mcu, &mdd->mdd_cl.mc_users, mcu_list)
+                if (mcu->mcu_id == id)
+                        return mcu;
+        return NULL;
+}
+
+/** Add changelog user \a id to the in-memory list, or update its endrec */
+static int mdd_changelog_user_set(struct mdd_device *mdd, __u32 id,
+                                  __u64 endrec)
+{
+        struct mdd_changelog_user *mcu;
+        struct mdd_changelog_user *new;
+
+        OBD_ALLOC_PTR(new);
+        if (new == NULL)
+                return -ENOMEM;
+
+        cfs_spin_lock(&mdd->mdd_cl.mc_user_lock);
+        mcu = mdd_changelog_user_find(mdd, id);
+        if (mcu == NULL) {
+                new->mcu_id = id;
+                new->mcu_endrec = endrec;
+                cfs_list_add_tail(&new->mcu_list, &mdd->mdd_cl.mc_users);
+                new = NULL;
+        } else {
+                mcu->mcu_endrec = max(mcu->mcu_endrec, endrec);
+        }
+        cfs_spin_unlock(&mdd->mdd_cl.mc_user_lock);
+
+        if (new != NULL)
+                OBD_FREE_PTR(new);
+        return 0;
+}
+
+static void mdd_changelog_user_del(struct mdd_device *mdd, __u32 id)
+{
+        struct mdd_changelog_user *mcu;
+
+        cfs_spin_lock(&mdd->mdd_cl.mc_user_lock);
+        mcu = mdd_changelog_user_find(mdd, id);
+        if (mcu != NULL)
+                cfs_list_del(&mcu->mcu_list);
+        cfs_spin_unlock(&mdd->mdd_cl.mc_user_lock);
+
+        if (mcu != NULL)
+                OBD_FREE_PTR(mcu);
+}
+
 static int changelog_user_init_cb(struct llog_handle *llh,
                                   struct llog_rec_hdr *hdr, void *data)
 {
@@ -173,11 +229,138 @@ static int changelog_user_init_cb(struct llog_handle *llh,
                " in log "LPX64"\n", hdr->lrh_index, rec->cur_hdr.lrh_index,
                rec->cur_id, rec->cur_endrec, llh->lgh_id.lgl_oid);
 
+        /* Ids are handed out in increasing order, the first one seen going
+         * backwards is the last one */
         cfs_spin_lock(&mdd->mdd_cl.mc_user_lock);
-        mdd->mdd_cl.mc_lastuser = rec->cur_id;
+        if (mdd->mdd_cl.mc_lastuser == 0)
+                mdd->mdd_cl.mc_lastuser = rec->cur_id;
         cfs_spin_unlock(&mdd->mdd_cl.mc_user_lock);
 
-        RETURN(LLOG_PROC_BREAK);
+        /* All users are kept in memory for the changelog read filter */
+        RETURN(mdd_changelog_user_set(mdd, rec->cur_id, rec->cur_endrec));
+}
+
+/**
+ * Stamp the index of changelog record \a hdr.  llog_cat_add_rec() calls this
+ * under the lock of the plain log the record goes to, so cr_index follows
+ * llog order without serializing writers any further.
+ */
+static int mdd_changelog_fill_rec(struct llog_rec_hdr *hdr, void *data)
+{
+        struct mdd_device *mdd = data;
+        struct llog_changelog_rec *rec = (struct llog_changelog_rec *)hdr;
+
+        cfs_spin_lock(&mdd->mdd_cl.mc_lock);
+        rec->cr.cr_index = ++mdd->mdd_cl.mc_index;
+        cfs_spin_unlock(&mdd->mdd_cl.mc_lock);
+        return 0;
+}
+
+/**
+ * Tell whether changelog record \a rec is about an entry in the tree under
+ * directory \a root.  Namespace records give the parent directory, the
+ * others only the target; from there the first link of each entry is
+ * followed up.  Records of entries that are gone or remote are kept, as it
+ * cannot be told where they were.
+ */
+static int mdd_changelog_in_tree(const struct lu_env *env,
+                                 struct mdd_device *mdd,
+                                 struct llog_changelog_rec *rec,
+                                 const struct lu_fid *root)
+{
+        struct mdd_thread_info *info = mdd_env_info(env);
+        struct link_ea_header  *leh;
+        struct mdd_object      *obj;
+        struct lu_buf          *buf;
+        struct lu_name          lname;
+        struct lu_fid           fid;
+        int                     reclen;
+        int                     depth;
+        int                     rc = 1;
+
+        fid = fid_is_zero(&rec->cr.cr_pfid) ? rec->cr.cr_tfid :
+                                              rec->cr.cr_pfid;
+        /* records in a row are often about the same directory */
+        if (lu_fid_eq(&fid, &info->mti_cl_fid))
+                return info->mti_cl_in;
+        info->mti_cl_fid = fid;
+
+        for (depth = 0; depth < MAX_PATH_DEPTH; depth++) {
+                if (lu_fid_eq(&fid, root))
+                        GOTO(out, rc = 1);
+                if (mdd_is_root(mdd, &fid))
+                        GOTO(out, rc = 0);
+
+                obj = mdd_object_find(env, mdd, &fid);
+                if (obj == NULL || IS_ERR(obj))
+                        GOTO(out, rc = 1);
+                if (mdd_object_exists(obj) <= 0) {
+                        mdd_object_put(env, obj);
+                        GOTO(out, rc = 1);
+                }
+
+                mdd_read_lock(env, obj, MOR_TGT_CHILD);
+                buf = mdd_links_get(env, obj);
+                mdd_read_unlock(env, obj);
+                mdd_object_put(env, obj);
+                if (IS_ERR(buf))
+                        GOTO(out, rc = 1);
+
+                leh = buf->lb_buf;
+                if (leh->leh_reccount == 0)
+                        GOTO(out, rc = 1);
+                mdd_lee_unpack((struct link_ea_entry *)(leh + 1), &reclen,
+                               &lname, &fid);
+        }
+out:
+        info->mti_cl_in = rc;
+        return rc;
+}
+
+/**
+ * Changelog read filter, see llog_origin_handle_next_block().
+ * \retval 1 send record \a hdr to the reader
+ * \retval 0 leave it out
+ */
+static int mdd_changelog_filter_rec(const struct lu_env *env,
+                                    struct llog_rec_hdr *hdr,
+                                    struct changelog_filter *filter,
+                                    void *data)
+{
+        struct mdd_device *mdd = data;
+        struct llog_changelog_rec *rec = (struct llog_changelog_rec *)hdr;
+        struct mdd_changelog_user *mcu;
+        __u64 endrec = 0;
+
+        if (env == NULL)
+                return 1;
+
+        if (hdr == NULL) {
+                /* new block: directories may have moved since the last */
+                fid_zero(&mdd_env_info(env)->mti_cl_fid);
+                return 1;
+        }
+
+        if (hdr->lrh_type != CHANGELOG_REC)
+                return 1;
+
+        if (!(filter->clf_mask & (1 << rec->cr.cr_type)))
+                return 0;
+
+        if (filter->clf_user != 0) {
+                cfs_spin_lock(&mdd->mdd_cl.mc_user_lock);
+                mcu = mdd_changelog_user_find(mdd, filter->clf_user);
+                if (mcu != NULL)
+                        endrec = mcu->mcu_endrec;
+                cfs_spin_unlock(&mdd->mdd_cl.mc_user_lock);
+                if (rec->cr.cr_index <= endrec)
+                        return 0;
+        }
+
+        if (fid_is_zero(&filter->clf_fid) || rec->cr.cr_type == CL_MARK)
+                return 1;
+
+        return mdd_changelog_in_tree(env, mdd, rec, &filter->clf_fid);
 }
 
 
@@ -199,6 +382,11 @@ static int mdd_changelog_llog_init(struct mdd_device *mdd)
         }
 
         rc = llog_cat_reverse_process(ctxt->loc_handle, changelog_init_cb, mdd);
+        if (rc >= 0) {
+                ctxt->loc_cb_data = mdd;
+                ctxt->loc_fill_rec = mdd_changelog_fill_rec;
+                ctxt->loc_filter_rec = mdd_changelog_filter_rec;
+        }
         llog_ctxt_put(ctxt);
 
         if (rc < 0) {
@@ -246,6 +434,7 @@ static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
         mdd->mdd_cl.mc_mask = CHANGELOG_DEFMASK;
         cfs_spin_lock_init(&mdd->mdd_cl.mc_user_lock);
         mdd->mdd_cl.mc_lastuser = 0;
+        CFS_INIT_LIST_HEAD(&mdd->mdd_cl.mc_users);
 
         rc = mdd_changelog_llog_init(mdd);
         if (rc) {
@@ -258,7 +447,24 @@ static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
 
 static void mdd_changelog_fini(const struct lu_env *env, struct mdd_device *mdd)
 {
+        struct mdd_changelog_user *mcu, *tmp;
+        struct llog_ctxt *ctxt;
+
         mdd->mdd_cl.mc_flags = 0;
+
+        ctxt = llog_get_context(mdd2obd_dev(mdd), LLOG_CHANGELOG_ORIG_CTXT);
+        if (ctxt != NULL) {
+                ctxt->loc_fill_rec = NULL;
+                ctxt->loc_filter_rec = NULL;
+                ctxt->loc_cb_data = NULL;
+                llog_ctxt_put(ctxt);
+        }
+
+        cfs_list_for_each_entry_safe(mcu, tmp, &mdd->mdd_cl.mc_users,
+                                     mcu_list) {
+                cfs_list_del(&mcu->mcu_list);
+                OBD_FREE_PTR(mcu);
+        }
 }
 
 /* Start / stop recording */
@@ -309,26 +515,30 @@ int mdd_changelog_llog_write(struct mdd_device         *mdd,
 {
         struct obd_device *obd = mdd2obd_dev(mdd);
         struct llog_ctxt *ctxt;
+        struct timeval start;
+        struct timeval end;
         int rc;
 
+        cfs_gettimeofday(&start);
         rec->cr_hdr.lrh_len = llog_data_len(sizeof(*rec) + rec->cr.cr_namelen);
         /* llog_lvfs_write_rec sets the llog tail len */
         rec->cr_hdr.lrh_type = CHANGELOG_REC;
         rec->cr.cr_time = cl_time();
-        cfs_spin_lock(&mdd->mdd_cl.mc_lock);
-        /* NB: I suppose it's possible llog_add adds out of order wrt cr_index,
-           but as long as the MDD transactions are ordered correctly for e.g.
-           rename conflicts, I don't think this should matter. */
-        rec->cr.cr_index = ++mdd->mdd_cl.mc_index;
-        cfs_spin_unlock(&mdd->mdd_cl.mc_lock);
         ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
         if (ctxt == NULL)
                 return -ENXIO;
 
+        /* cr_index is stamped by mdd_changelog_fill_rec() under the plain
+         * log lock, so it grows with the llog index.  Readers rely on that
+         * to skip whole plain logs that end before their start record. */
         /* nested journal transaction */
         rc = llog_add(ctxt, &rec->cr_hdr, NULL, NULL, 0);
         llog_ctxt_put(ctxt);
 
+        /* changelog cost per record, shown in lu_stats */
+        cfs_gettimeofday(&end);
+        lprocfs_counter_add(mdd->mdd_stats, LPROC_MDD_CHANGELOG_WRITE,
+                            cfs_timeval_sub(&end, &start, NULL));
         return rc;
 }
 
@@ -1072,8 +1282,11 @@ static int mdd_recovery_complete(const struct lu_env *env,
         cfs_spin_unlock(&obd->obd_dev_lock);
         obd->obd_type->typ_dt_ops->o_postrecov(obd);
 
-        /* XXX: orphans handling. */
-        __mdd_orphan_cleanup(env, mdd);
+        /* Orphans are cleaned up in the background, so that clients
+         * do not wait for a large PENDING directory to be emptied. */
+        rc = mdd_orphan_cleanup_start(mdd);
+        if (rc)
+                __mdd_orphan_cleanup(env, mdd);
         rc = next->ld_ops->ldo_recovery_complete(env, next);
 
         RETURN(rc);
@@ -1339,6 +1552,9 @@ static int mdd_changelog_user_register(struct mdd_device *mdd, int *id)
         cfs_spin_unlock(&mdd->mdd_cl.mc_user_lock);
 
         rc = llog_add(ctxt, &rec->cur_hdr, NULL, NULL, 0);
+        if (rc >= 0)
+                rc = mdd_changelog_user_set(mdd, rec->cur_id,
+                                            rec->cur_endrec);
 
         CDEBUG(D_IOCTL, "Registered changelog user %d\n", *id);
 out:
@@ -1348,6 +1564,7 @@ out:
 }
 
 struct mdd_changelog_user_data {
+        struct mdd_device *mcud_mdd;
         __u64 mcud_endrec; /**< purge record for this user */
         __u64 mcud_minrec; /**< lowest changelog recno still referenced */
         __u32 mcud_id;
@@ -1400,8 +1617,11 @@ static int mdd_changelog_user_purge_cb(struct llog_handle *llh,
                 cookie.lgc_index = hdr->lrh_index;
                 rc = llog_cat_cancel_records(llh->u.phd.phd_cat_handle,
                                              1, &cookie);
-                if (rc == 0)
+                if (rc == 0) {
                         mcud->mcud_usercount--;
+                        mdd_changelog_user_del(mcud->mcud_mdd,
+                                               mcud->mcud_id);
+                }
                 RETURN(rc);
         }
 
@@ -1413,6 +1633,9 @@ static int mdd_changelog_user_purge_cb(struct llog_handle *llh,
         hdr->lrh_len -= sizeof(*hdr) + sizeof(struct llog_rec_tail);
         rc = llog_write_rec(llh, hdr, NULL, 0, (void *)(hdr + 1),
                             hdr->lrh_index);
+        if (rc >= 0)
+                mdd_changelog_user_set(mcud->mcud_mdd, rec->cur_id,
+                                       rec->cur_endrec);
 
         RETURN(rc);
 }
@@ -1427,6 +1650,7 @@ static int mdd_changelog_user_purge(struct mdd_device *mdd, int id,
 
         CDEBUG(D_IOCTL, "Purge request: id=%d, endrec=%lld\n", id, endrec);
 
+        data.mcud_mdd = mdd;
         data.mcud_id = id;
         data.mcud_minid = 0;
         data.mcud_minrec = 0;
@@ -111,6 +111,29 @@ struct mdd_changelog {
         __u64                            mc_starttime;
         cfs_spinlock_t                   mc_user_lock;
         int                              mc_lastuser;
+        cfs_list_t                       mc_users;   /* mdd_changelog_user */
+};
+
+/** In-memory copy of a changelog user record, for the read filter */
+struct mdd_changelog_user {
+        cfs_list_t                       mcu_list;
+        __u32                            mcu_id;
+        __u64                            mcu_endrec;
+};
+
+/** Background orphan cleanup started at the end of recovery */
+struct mdd_orphan_cleanup {
+        struct ptlrpc_thread             moc_thread;
+        cfs_spinlock_t                   moc_lock;
+        /** orphans handled per second, 0 means no limit */
+        unsigned int                     moc_rate;
+        __u64                            moc_scanned;
+        __u64                            moc_destroyed;
+        /** orphans still open, left for the last close */
+        __u64                            moc_busy;
+        __u64                            moc_errors;
+        time_t                           moc_start;
+        time_t                           moc_end;
 };
 
 /** Objects in .lustre dir */
@@ -134,6 +157,7 @@ struct mdd_device {
         struct mdd_object               *mdd_dot_lustre;
         struct mdd_dot_lustre_objs       mdd_dot_lustre_objs;
         unsigned int                     mdd_sync_permission;
+        struct mdd_orphan_cleanup        mdd_orph_cleanup;
 };
 
 enum mod_flags {
@@ -193,6 +217,8 @@ struct mdd_thread_info {
         int                       mti_max_cookie_size;
         struct dt_object_format   mti_dof;
         struct obd_quotactl       mti_oqctl;
+        struct lu_fid             mti_cl_fid; /* changelog filter: last */
+        int                       mti_cl_in;  /* fid checked, is it in tree */
 };
 
 extern const char orph_index_name[];
@@ -327,6 +353,12 @@ struct lu_buf *mdd_links_get(const struct lu_env *env,
 void mdd_lee_unpack(const struct link_ea_entry *lee, int *reclen,
                     struct lu_name *lname, struct lu_fid *pfid);
 
+/** The maximum depth that fid2path() will search.
+ * This is limited only because we want to store the fids for
+ * historical path lookup purposes.
+ */
+#define MAX_PATH_DEPTH 100
+
 /* mdd_lov.c */
 int mdd_unlink_log(const struct lu_env *env, struct mdd_device *mdd,
                    struct mdd_object *mdd_cobj, struct md_attr *ma);
@@ -350,6 +382,9 @@ const struct lu_buf *mdd_buf_get_const(const struct lu_env *env,
                                        const void *area, ssize_t len);
 
 int __mdd_orphan_cleanup(const struct lu_env *env, struct mdd_device *d);
+void mdd_orphan_cleanup_init(struct mdd_device *d);
+int mdd_orphan_cleanup_start(struct mdd_device *d);
+void mdd_orphan_cleanup_stop(struct mdd_device *d);
 int __mdd_orphan_add(const struct lu_env *, struct mdd_object *,
                      struct thandle *);
 int __mdd_orphan_del(const struct lu_env *, struct mdd_object *,
@@ -637,6 +672,8 @@ static inline void mdd_set_capainfo(const struct lu_env *env, int offset,
 #define MAX_ATIME_DIFF 60
 
 enum {
+        /** time spent appending a changelog record, in usec */
+        LPROC_MDD_CHANGELOG_WRITE,
         LPROC_MDD_NR
 };
 
@@ -60,6 +60,7 @@
 #include "mdd_internal.h"
 
 static const char *mdd_counter_names[LPROC_MDD_NR] = {
+        [LPROC_MDD_CHANGELOG_WRITE] = "changelog_write",
 };
 
 int mdd_procfs_init(struct mdd_device *mdd, const char *name)
@@ -299,6 +300,76 @@ static int lprocfs_wr_sync_perm(struct file *file, const char *buffer,
         return count;
 }
 
+static int lprocfs_rd_orphan_cleanup(char *page, char **start, off_t off,
+                                     int count, int *eof, void *data)
+{
+        struct mdd_device *mdd = data;
+        struct mdd_orphan_cleanup *moc;
+        __u64 scanned, destroyed, busy, errors;
+        time_t start_time, end_time;
+        const char *state;
+
+        LASSERT(mdd != NULL);
+        moc = &mdd->mdd_orph_cleanup;
+
+        cfs_spin_lock(&moc->moc_lock);
+        scanned = moc->moc_scanned;
+        destroyed = moc->moc_destroyed;
+        busy = moc->moc_busy;
+        errors = moc->moc_errors;
+        start_time = moc->moc_start;
+        end_time = moc->moc_end;
+        if (moc->moc_thread.t_flags & SVC_RUNNING)
+                state = "running";
+        else if (start_time == 0)
+                state = "idle";
+        else
+                state = "done";
+        cfs_spin_unlock(&moc->moc_lock);
+
+        if (start_time != 0 && end_time == 0)
+                end_time = cfs_time_current_sec();
+
+        *eof = 1;
+        return snprintf(page, count,
+                        "state: %s\n"
+                        "scanned: "LPU64"\n"
+                        "destroyed: "LPU64"\n"
+                        "open: "LPU64"\n"
+                        "errors: "LPU64"\n"
+                        "elapsed: %ld\n",
+                        state, scanned, destroyed, busy, errors,
+                        (long)(end_time - start_time));
+}
+
+static int lprocfs_rd_orphan_cleanup_rate(char *page, char **start, off_t off,
+                                          int count, int *eof, void *data)
+{
+        struct mdd_device *mdd = data;
+
+        LASSERT(mdd != NULL);
+        return snprintf(page, count, "%u\n",
+                        mdd->mdd_orph_cleanup.moc_rate);
+}
+
+static int lprocfs_wr_orphan_cleanup_rate(struct file *file,
+                                          const char *buffer,
+                                          unsigned long count, void *data)
+{
+        struct mdd_device *mdd = data;
+        int val, rc;
+
+        LASSERT(mdd != NULL);
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+        if (val < 0)
+                return -EINVAL;
+
+        mdd->mdd_orph_cleanup.moc_rate = val;
+        return count;
+}
+
 static struct lprocfs_vars lprocfs_mdd_obd_vars[] = {
         { "atime_diff",      lprocfs_rd_atime_diff, lprocfs_wr_atime_diff, 0 },
         { "changelog_mask",  lprocfs_rd_changelog_mask,
@@ -309,6 +380,9 @@ static struct lprocfs_vars lprocfs_mdd_obd_vars[] = {
                              mdd_lprocfs_quota_wr_type, 0 },
 #endif
         { "sync_permission", lprocfs_rd_sync_perm, lprocfs_wr_sync_perm, 0 },
+        { "orphan_cleanup",  lprocfs_rd_orphan_cleanup, 0, 0 },
+        { "orphan_cleanup_rate", lprocfs_rd_orphan_cleanup_rate,
+                                 lprocfs_wr_orphan_cleanup_rate, 0 },
         { 0 }
 };
 
@@ -247,9 +247,8 @@ static int orphan_object_kill(const struct lu_env *env,
         int rc = 0;
         ENTRY;
 
-        /* No need to lock this object as its recovery phase, and
-         * no other thread can access it. But we need to lock it
-         * as its precondition for osd api we using. */
+        /* The caller holds the object write lock, which keeps the last
+         * close of a reopened orphan away while it is killed. */
 
         mdo_ref_del(env, obj, th);
         if (S_ISDIR(mdd_object_type(obj))) {
@@ -331,9 +330,16 @@ static int orphan_object_destroy(const struct lu_env *env,
                 rc = mdd_orphan_delete_obj(env, mdd, key, th);
                 if (!rc)
                         orphan_object_kill(env, obj, mdd, th);
+                else if (rc == -ENOENT)
+                        /* the last close got there first */
+                        CDEBUG(D_HA, "orphan "DFID" already deleted\n",
+                               PFID(mdo2fid(obj)));
                 else
                         CERROR("could not delete object: rc = %d\n",rc);
                 mdd_orphan_write_unlock(env, mdd);
+        } else {
+                /* reopened by fid since it was found */
+                rc = -EBUSY;
         }
         mdd_write_unlock(env, obj);
         mdd_trans_stop(env, mdd, 0, th);
@@ -356,7 +362,7 @@ static int orph_key_test_and_del(const struct lu_env *env,
 
         rc = -EBUSY;
         if (mdo->mod_count == 0) {
-                CWARN("Found orphan! Delete it\n");
+                CDEBUG(D_HA, "Found orphan "DFID", delete it\n", PFID(lf));
                 rc = orphan_object_destroy(env, mdo, key);
         } else {
                 mdd_write_lock(env, mdo, MOR_TGT_CHILD);
@@ -372,81 +378,170 @@ static int orph_key_test_and_del(const struct lu_env *env,
         return rc;
 }
 
-static int orph_index_iterate(const struct lu_env *env,
-                              struct mdd_device *mdd)
+/* Orphans collected per index scan. They are handled with the iterator
+ * released, so that no object lock is taken under the index walk and
+ * the walk can be resumed after sleeping. */
+#define ORPH_BATCH              64
+/* "%016llx:%08x:%08x:%2x" is 37 characters */
+#define ORPH_KEY_LEN            48
+
+struct orph_batch_ent {
+        struct lu_fid           obe_fid;
+        char                    obe_key[ORPH_KEY_LEN];
+};
+
+/**
+ * Collect up to ORPH_BATCH orphans from the index, starting at \a cookie.
+ *
+ * \retval 0   batch is full, \a cookie is where the next scan starts
+ * \retval 1   end of the index reached
+ * \retval -ve error
+ */
+static int orph_index_scan(const struct lu_env *env,
+                           struct mdd_device *mdd,
+                           struct orph_batch_ent *ents, int *count,
+                           __u64 *cookie)
 {
         struct dt_object *dor = mdd->mdd_orphans;
-        char             *mti_key = mdd_env_info(env)->mti_orph_key;
         const struct dt_it_ops *iops;
+        struct orph_batch_ent *ent;
         struct dt_it     *it;
         char             *key;
-        struct lu_fid     fid;
-        int               result = 0;
-        int               key_sz = 0;
-        int               rc;
-        __u64             cookie;
+        int               key_sz;
+        int               result;
         ENTRY;
 
-        /* In recovery phase, do not need for any lock here */
-
+        *count = 0;
         iops = &dor->do_index_ops->dio_it;
         it = iops->init(env, dor, LUDA_64BITHASH, BYPASS_CAPA);
-        if (!IS_ERR(it)) {
-                result = iops->load(env, it, 0);
-                if (result > 0) {
-                        /* main cycle */
-                        do {
-
-                                key = (void *)iops->key(env, it);
-                                if (IS_ERR(key)) {
-                                        CERROR("key failed when clean pending.\n");
-                                        goto next;
-                                }
-                                key_sz = iops->key_size(env, it);
-
-                                /* filter out "." and ".." entries from
-                                 * PENDING dir. */
-                                if (key_sz < 8)
-                                        goto next;
-
-                                memcpy(mti_key, key, key_sz);
-                                mti_key[key_sz] = 0;
-
-                                if (orphan_key_to_fid(mti_key, &fid))
-                                        goto next;
-                                if (!fid_is_sane(&fid)) {
-                                        CERROR("fid is not sane when clean pending.\n");
-                                        goto next;
-                                }
-
-                                /* kill orphan object */
-                                cookie =  iops->store(env, it);
-                                iops->put(env, it);
-                                rc = orph_key_test_and_del(env, mdd, &fid,
-                                                (struct dt_key *)mti_key);
-
-                                /* after index delete reset iterator */
-                                if (!rc)
-                                        result = iops->get(env, it,
-                                                           (const void *)"");
-                                else
-                                        result = iops->load(env, it, cookie);
-next:
-                                result = iops->next(env, it);
-                        } while (result == 0);
-                        result = 0;
-                } else if (result == 0) {
-                        CERROR("Input/Output for clean pending.\n");
-                        /* Index contains no zero key? */
-                        result = -EIO;
-                }
-                iops->put(env, it);
-                iops->fini(env, it);
-        } else {
+        if (IS_ERR(it)) {
                 result = PTR_ERR(it);
                 CERROR("Cannot clean pending (%d).\n", result);
+                RETURN(result);
         }
 
+        result = iops->load(env, it, *cookie);
+        if (result > 0) {
+                do {
+                        if (*count == ORPH_BATCH) {
+                                /* resume from this entry next time */
+                                *cookie = iops->store(env, it);
+                                break;
+                        }
+
+                        key = (void *)iops->key(env, it);
+                        if (IS_ERR(key)) {
+                                CERROR("key failed when clean pending.\n");
+                                goto next;
+                        }
+                        key_sz = iops->key_size(env, it);
+
+                        /* filter out "." and ".." entries from
+                         * PENDING dir. */
+                        if (key_sz < 8 || key_sz >= ORPH_KEY_LEN)
+                                goto next;
+
+                        ent = &ents[*count];
+                        memcpy(ent->obe_key, key, key_sz);
+                        ent->obe_key[key_sz] = 0;
+
+                        if (orphan_key_to_fid(ent->obe_key, &ent->obe_fid))
+                                goto next;
+                        if (!fid_is_sane(&ent->obe_fid)) {
+                                CERROR("fid is not sane when clean pending.\n");
+                                goto next;
+                        }
+                        (*count)++;
+next:
+                        result = iops->next(env, it);
+                } while (result == 0);
+                result = result != 0 ? 1 : 0;
+        } else if (result == 0) {
+                CERROR("Input/Output for clean pending.\n");
+                /* Index contains no zero key? */
+                result = -EIO;
+        } else if (*cookie != 0) {
+                /* the entry to resume from was the last one and has
+                 * been removed meanwhile */
+                result = 1;
+        }
+        iops->put(env, it);
+        iops->fini(env, it);
+
+        RETURN(result);
+}
+
+static inline int orph_cleanup_stopping(struct mdd_orphan_cleanup *moc)
+{
+        return !!(moc->moc_thread.t_flags & SVC_STOPPING);
+}
+
+/* Keep the cleanup under moc_rate orphans per second, sleeping out the
+ * rest of the current second once the budget is spent. */
+static void orph_cleanup_throttle(struct mdd_orphan_cleanup *moc,
+                                  time_t *window, unsigned int *done)
+{
+        struct ptlrpc_thread *thread = &moc->moc_thread;
+        struct l_wait_info    lwi;
+        unsigned int          rate = moc->moc_rate;
+
+        if (rate == 0 || ++(*done) <= rate)
+                return;
+
+        if (cfs_time_current_sec() == *window) {
+                lwi = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
+                l_wait_event(thread->t_ctl_waitq,
+                             orph_cleanup_stopping(moc), &lwi);
+        }
+        *window = cfs_time_current_sec();
+        *done = 1;
+}
+
+static int orph_index_iterate(const struct lu_env *env,
+                              struct mdd_device *mdd)
+{
+        struct mdd_orphan_cleanup *moc = &mdd->mdd_orph_cleanup;
+        struct orph_batch_ent     *ents;
+        __u64                      cookie = 0;
+        time_t                     window = cfs_time_current_sec();
+        unsigned int               done = 0;
+        int                        count;
+        int                        result;
+        int                        rc;
+        int                        i;
+        ENTRY;
+
+        OBD_ALLOC(ents, ORPH_BATCH * sizeof(*ents));
+        if (ents == NULL)
+                RETURN(-ENOMEM);
+
+        do {
+                result = orph_index_scan(env, mdd, ents, &count, &cookie);
+                if (result < 0)
+                        break;
+
+                for (i = 0; i < count; i++) {
+                        if (orph_cleanup_stopping(moc))
+                                GOTO(out, result = 0);
+                        orph_cleanup_throttle(moc, &window, &done);
+
+                        rc = orph_key_test_and_del(env, mdd, &ents[i].obe_fid,
+                                           (struct dt_key *)ents[i].obe_key);
+                        cfs_spin_lock(&moc->moc_lock);
+                        moc->moc_scanned++;
+                        if (rc == 0)
+                                moc->moc_destroyed++;
+                        else if (rc == -EBUSY)
+                                moc->moc_busy++;
+                        else if (rc != -ENOENT)
+                                moc->moc_errors++;
+                        cfs_spin_unlock(&moc->moc_lock);
+                }
+        } while (result == 0 && !orph_cleanup_stopping(moc));
+        if (result > 0)
+                result = 0;
+out:
+        OBD_FREE(ents, ORPH_BATCH * sizeof(*ents));
         RETURN(result);
 }
 
@@ -492,7 +587,105 @@ void orph_index_fini(const struct lu_env *env, struct mdd_device *mdd)
 
 int __mdd_orphan_cleanup(const struct lu_env *env, struct mdd_device *d)
 {
-        return orph_index_iterate(env, d);
+        struct mdd_orphan_cleanup *moc = &d->mdd_orph_cleanup;
+        int rc;
+
+        moc->moc_start = cfs_time_current_sec();
+        rc = orph_index_iterate(env, d);
+        moc->moc_end = cfs_time_current_sec();
+
+        if (moc->moc_scanned != 0)
+                CWARN("%s: orphan cleanup %s: "LPU64" destroyed, "LPU64
+                      " still open, "LPU64" errors in %lds: rc = %d\n",
+                      mdd2obd_dev(d)->obd_name,
+                      orph_cleanup_stopping(moc) ? "interrupted" : "done",
+                      moc->moc_destroyed, moc->moc_busy, moc->moc_errors,
+                      (long)(moc->moc_end - moc->moc_start), rc);
+        return rc;
+}
+
+static int mdd_orphan_cleanup_main(void *args)
+{
+        struct mdd_device         *mdd = args;
+        struct mdd_orphan_cleanup *moc = &mdd->mdd_orph_cleanup;
+        struct ptlrpc_thread      *thread = &moc->moc_thread;
+        struct lu_env              env;
+        int                        rc;
+        ENTRY;
+
+        cfs_daemonize_ctxt("mdd_orphan");
+        cfs_block_allsigs();
+
+        thread->t_flags = SVC_RUNNING;
+        cfs_waitq_signal(&thread->t_ctl_waitq);
+
+        rc = lu_env_init(&env, LCT_MD_THREAD);
+        if (rc == 0) {
+                rc = __mdd_orphan_cleanup(&env, mdd);
+                lu_env_fini(&env);
+        } else {
+                CERROR("%s: cannot init orphan cleanup env: rc = %d\n",
+                       mdd2obd_dev(mdd)->obd_name, rc);
+        }
+
+        cfs_spin_lock(&moc->moc_lock);
+        thread->t_flags = SVC_STOPPED;
+        cfs_spin_unlock(&moc->moc_lock);
+        cfs_waitq_signal(&thread->t_ctl_waitq);
+
+        RETURN(rc);
+}
+
+void mdd_orphan_cleanup_init(struct mdd_device *mdd)
+{
+        struct mdd_orphan_cleanup *moc = &mdd->mdd_orph_cleanup;
+
+        memset(moc, 0, sizeof(*moc));
+        cfs_waitq_init(&moc->moc_thread.t_ctl_waitq);
+        cfs_spin_lock_init(&moc->moc_lock);
+}
+
+/**
+ *  Start the orphan cleanup thread. Clients are served while it runs,
+ *  it can only race with the last close of an orphan, which is sorted
+ *  out under the object lock in orphan_object_destroy().
+ */
+int mdd_orphan_cleanup_start(struct mdd_device *mdd)
+{
+        struct ptlrpc_thread *thread = &mdd->mdd_orph_cleanup.moc_thread;
+        int rc;
+
+        if (thread->t_flags & SVC_RUNNING)
+                return 0;
+
+        thread->t_flags = 0;
+        rc = cfs_kernel_thread(mdd_orphan_cleanup_main, mdd,
+                               (CLONE_VM | CLONE_FILES));
+        if (rc < 0) {
+                CERROR("cannot start mdd_orphan thread, rc = %d\n", rc);
+                return rc;
+        }
+
+        l_wait_condition(thread->t_ctl_waitq,
+                         thread->t_flags & (SVC_RUNNING | SVC_STOPPED));
+        return 0;
+}
+
+void mdd_orphan_cleanup_stop(struct mdd_device *mdd)
+{
+        struct mdd_orphan_cleanup *moc = &mdd->mdd_orph_cleanup;
+        struct ptlrpc_thread      *thread = &moc->moc_thread;
+
+        cfs_spin_lock(&moc->moc_lock);
+        if (!(thread->t_flags & SVC_RUNNING)) {
+                cfs_spin_unlock(&moc->moc_lock);
+                return;
+        }
+        thread->t_flags |= SVC_STOPPING;
+        cfs_spin_unlock(&moc->moc_lock);
+
+        cfs_waitq_signal(&thread->t_ctl_waitq);
+        l_wait_condition(thread->t_ctl_waitq, thread->t_flags & SVC_STOPPED);
 }
 
 /**
@@ -67,7 +67,7 @@ int mdt_export_stats_init(struct obd_device *obd,
                 num_stats = (sizeof(*obd->obd_type->typ_md_ops) / sizeof(void *)) +
                             LPROC_MDT_LAST;
                 tmp->nid_stats = lprocfs_alloc_stats(num_stats,
-                                                     LPROCFS_STATS_FLAG_NOPERCPU);
+                                                     LPROCFS_STATS_FLAG_LAZY);
                 if (tmp->nid_stats == NULL)
                         return -ENOMEM;
                 lprocfs_init_mps_stats(LPROC_MDT_LAST, tmp->nid_stats);
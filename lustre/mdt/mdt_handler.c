@@ -2190,6 +2190,7 @@ int mdt_object_lock(struct mdt_thread_info *info, struct mdt_object *o,
         struct ldlm_namespace *ns = info->mti_mdt->mdt_namespace;
         ldlm_policy_data_t *policy = &info->mti_policy;
         struct ldlm_res_id *res_id = &info->mti_res_id;
+        struct ptlrpc_request *req = mdt_info_req(info);
         int rc;
         ENTRY;
 
@@ -2240,9 +2241,13 @@ int mdt_object_lock(struct mdt_thread_info *info, struct mdt_object *o,
                          * want it slowed down due to possible cancels.
                          */
                         policy->l_inodebits.bits = MDS_INODELOCK_UPDATE;
+                        if (req != NULL)
+                                ptlrpc_req_wait_begin(req, PTLRPC_WAIT_LOCK);
                         rc = mdt_fid_lock(ns, &lh->mlh_pdo_lh, lh->mlh_pdo_mode,
                                           policy, res_id, LDLM_FL_ATOMIC_CB,
                                           &info->mti_exp->exp_handle.h_cookie);
+                        if (req != NULL)
+                                ptlrpc_req_wait_end(req, PTLRPC_WAIT_LOCK);
                         if (unlikely(rc))
                                 RETURN(rc);
                 }
@@ -2261,9 +2266,13 @@ int mdt_object_lock(struct mdt_thread_info *info, struct mdt_object *o,
          * going to be sent to client. If it is - mdt_intent_policy() path will
          * fix it up and turn FL_LOCAL flag off.
          */
+        if (req != NULL)
+                ptlrpc_req_wait_begin(req, PTLRPC_WAIT_LOCK);
         rc = mdt_fid_lock(ns, &lh->mlh_reg_lh, lh->mlh_reg_mode, policy,
                           res_id, LDLM_FL_LOCAL_ONLY | LDLM_FL_ATOMIC_CB,
                           &info->mti_exp->exp_handle.h_cookie);
+        if (req != NULL)
+                ptlrpc_req_wait_end(req, PTLRPC_WAIT_LOCK);
         if (rc)
                 mdt_object_unlock(info, o, lh, 1);
         else if (unlikely(OBD_FAIL_PRECHECK(OBD_FAIL_MDS_PDO_LOCK)) &&
@@ -114,6 +114,8 @@ int mdt_procfs_init(struct mdt_device *mdt, const char *name)
         rc = lprocfs_alloc_md_stats(obd, LPROC_MDT_LAST);
         if (rc == 0)
                 mdt_stats_counter_init(obd->md_stats);
+        if (rc == 0)
+                rc = ptlrpc_lprocfs_register_job_stats(obd);
 
         RETURN(rc);
 }
@@ -132,6 +134,7 @@ int mdt_procfs_fini(struct mdt_device *mdt)
                 lprocfs_remove_proc_entry("clear", obd->obd_proc_exports_entry);
                 obd->obd_proc_exports_entry = NULL;
         }
+        lprocfs_job_stats_fini(obd);
         ptlrpc_lprocfs_unregister_obd(obd);
         lprocfs_free_md_stats(obd);
         lprocfs_obd_cleanup(obd);
@@ -408,6 +411,33 @@ static int lprocfs_rd_site_stats(char *page, char **start, off_t off,
         return lu_site_stats_print(mdt_lu_site(mdt), page, count);
 }
 
+static int lprocfs_rd_site_cache(char *page, char **start, off_t off,
+                                 int count, int *eof, void *data)
+{
+        struct obd_device *obd = data;
+        struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+        *eof = 1;
+        return lu_site_cache_print(mdt_lu_site(mdt), page, count);
+}
+
+/* maximal number of unreferenced objects cached, 0 for no limit */
+static int lprocfs_wr_site_cache(struct file *file, const char *buffer,
+                                 unsigned long count, void *data)
+{
+        struct obd_device *obd = data;
+        struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+        __u64 val;
+        int rc;
+
+        rc = lprocfs_write_u64_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        lu_site_cache_max_set(mdt_lu_site(mdt), val);
+        return count;
+}
+
 static int lprocfs_rd_capa_timeout(char *page, char **start, off_t off,
                                    int count, int *eof, void *data)
 {
@@ -794,6 +824,8 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
                                         lprocfs_wr_ck_timeout,              0 },
         { "capa_count",                 lprocfs_rd_capa_count,           0, 0 },
         { "site_stats",                 lprocfs_rd_site_stats,           0, 0 },
+        { "site_cache",                 lprocfs_rd_site_cache,
+                                        lprocfs_wr_site_cache,              0 },
         { "evict_client",               0, lprocfs_mdt_wr_evict_client,     0 },
         { "hash_stats",                 lprocfs_obd_rd_hash,    0, 0 },
         { "sec_level",                  lprocfs_rd_sec_level,
@@ -342,6 +342,7 @@ static int mdt_server_data_init(const struct lu_env *env,
         struct dt_object       *obj;
         struct lu_attr         *la;
         struct lustre_disk_data  *ldd;
+        struct dt_device_param  dtp;
         unsigned long last_rcvd_size;
         __u64 mount_count;
         int rc;
@@ -431,6 +432,11 @@ static int mdt_server_data_init(const struct lu_env *env,
         if (ldd->ldd_flags & LDD_F_IAM_DIR)
                 lsd->lsd_feature_incompat |= OBD_INCOMPAT_IAM_DIR;
 
+        /* servers that only know "oi.16" would lose all fid mappings */
+        mdt->mdt_bottom->dd_ops->dt_conf_get(env, mdt->mdt_bottom, &dtp);
+        if (dtp.ddp_oi_count > 1)
+                lsd->lsd_feature_incompat |= OBD_INCOMPAT_MULTI_OI;
+
         lsd->lsd_feature_incompat |= OBD_INCOMPAT_FID;
 
         cfs_spin_lock(&mdt->mdt_lut.lut_translock);
@@ -819,6 +825,13 @@ static int mdt_txn_start_cb(const struct lu_env *env,
                             struct txn_param *param, void *cookie)
 {
         struct mdt_device *mdt = cookie;
+        struct mdt_thread_info *mti;
+        struct ptlrpc_request *req;
+
+        mti = lu_context_key_get(&env->le_ctx, &mdt_thread_key);
+        req = mdt_info_req(mti);
+        if (req != NULL)
+                ptlrpc_req_wait_begin(req, PTLRPC_WAIT_TXN);
 
         param->tp_credits += mdt_trans_credit_get(env, mdt,
                                                   MDT_TXN_LAST_RCVD_WRITE_OP);
@@ -848,6 +861,8 @@ static int mdt_txn_stop_cb(const struct lu_env *env,
         txi = lu_context_key_get(&txn->th_ctx, &mdt_txn_key);
         mti = lu_context_key_get(&env->le_ctx, &mdt_thread_key);
         req = mdt_info_req(mti);
+        if (req != NULL)
+                ptlrpc_req_wait_end(req, PTLRPC_WAIT_TXN);
 
         if (mti->mti_mdt == NULL || req == NULL || mti->mti_no_need_trans) {
                 txi->txi_transno = 0;
@@ -1092,6 +1092,142 @@ static int mdt_rename_sanity(struct mdt_thread_info *info, struct lu_fid *fid)
         RETURN(rc);
 }
 
+/*
+ * Only a directory moved to another parent can create a loop in the
+ * namespace, so only such renames need the filesystem-wide rename lock
+ * (which serializes them against each other for mdt_rename_sanity()).
+ */
+static inline int mdt_rename_needs_lock(struct mdt_object *obj)
+{
+        /* remote objects are assumed to be directories */
+        return mdt_object_exists(obj) <= 0 ||
+               S_ISDIR(lu_object_attr(&obj->mot_obj.mo_lu));
+}
+
+/*
+ * Unlocked guess whether the object being renamed needs the rename lock.
+ * The guess is checked again in mdt_reint_rename() once the object is
+ * locked. Errors are reported as "needs lock" and left to the locked path.
+ */
+static int mdt_rename_source_needs_lock(struct mdt_thread_info *info)
+{
+        struct mdt_reint_record *rr  = &info->mti_rr;
+        struct lu_fid           *fid = &info->mti_tmp_fid1;
+        struct mdt_object       *obj;
+        struct lu_name          *lname;
+        int                      rc;
+        ENTRY;
+
+        obj = mdt_object_find(info->mti_env, info->mti_mdt, rr->rr_fid1);
+        if (IS_ERR(obj))
+                RETURN(1);
+
+        lname = mdt_name(info->mti_env, (char *)rr->rr_name, rr->rr_namelen);
+        rc = mdo_lookup(info->mti_env, mdt_object_child(obj), lname, fid,
+                        &info->mti_spec);
+        mdt_object_put(info->mti_env, obj);
+        if (rc != 0)
+                RETURN(1);
+
+        obj = mdt_object_find(info->mti_env, info->mti_mdt, fid);
+        if (IS_ERR(obj))
+                RETURN(1);
+
+        rc = mdt_rename_needs_lock(obj);
+        mdt_object_put(info->mti_env, obj);
+        RETURN(rc);
+}
+
+/*
+ * Locks the parents of a rename. Two renames swapping the same pair of names
+ * (c/x <-> c/y, or d1/x <-> d2/y) need the same two locks, so these are
+ * always taken in one order: by name hash within a directory, by FID across
+ * directories. A remote target dir is not locked here.
+ */
+static int mdt_rename_lock_parents(struct mdt_thread_info *info,
+                                   struct mdt_object *msrcdir,
+                                   struct mdt_object *mtgtdir)
+{
+        struct mdt_lock_handle *lh_src = &info->mti_lh[MDT_LH_PARENT];
+        struct mdt_lock_handle *lh_tgt = &info->mti_lh[MDT_LH_CHILD];
+        struct mdt_lock_handle *lh1;
+        struct mdt_lock_handle *lh2;
+        int                     rc;
+        ENTRY;
+
+        if (msrcdir == mtgtdir) {
+                if (lh_tgt->mlh_pdo_hash < lh_src->mlh_pdo_hash) {
+                        lh1 = lh_tgt;
+                        lh2 = lh_src;
+                } else {
+                        lh1 = lh_src;
+                        lh2 = lh_tgt;
+                }
+                rc = mdt_object_lock(info, msrcdir, lh1, MDS_INODELOCK_UPDATE,
+                                     MDT_LOCAL_LOCK);
+                if (rc == 0 && lh2->mlh_pdo_hash != lh1->mlh_pdo_hash) {
+                        rc = mdt_pdir_hash_lock(info, lh2, msrcdir,
+                                                MDS_INODELOCK_UPDATE);
+                        OBD_FAIL_TIMEOUT(OBD_FAIL_MDS_PDO_LOCK2, 10);
+                }
+                RETURN(rc);
+        }
+
+        /* the remote target dir is locked by its own MDT */
+        if (mdt_object_exists(mtgtdir) < 0)
+                RETURN(mdt_object_lock(info, msrcdir, lh_src,
+                                       MDS_INODELOCK_UPDATE, MDT_LOCAL_LOCK));
+
+        if (lu_fid_cmp(mdt_object_fid(mtgtdir), mdt_object_fid(msrcdir)) < 0) {
+                rc = mdt_object_lock(info, mtgtdir, lh_tgt,
+                                     MDS_INODELOCK_UPDATE, MDT_LOCAL_LOCK);
+                if (rc == 0)
+                        rc = mdt_object_lock(info, msrcdir, lh_src,
+                                             MDS_INODELOCK_UPDATE,
+                                             MDT_LOCAL_LOCK);
+        } else {
+                rc = mdt_object_lock(info, msrcdir, lh_src,
+                                     MDS_INODELOCK_UPDATE, MDT_LOCAL_LOCK);
+                if (rc == 0)
+                        rc = mdt_object_lock(info, mtgtdir, lh_tgt,
+                                             MDS_INODELOCK_UPDATE,
+                                             MDT_LOCAL_LOCK);
+        }
+        RETURN(rc);
+}
+
+/*
+ * Locks the renamed object and the one it replaces, if any, in FID order:
+ * a concurrent rename can reach the same two objects through other names.
+ */
+static int mdt_rename_lock_children(struct mdt_thread_info *info,
+                                    struct mdt_object *mold,
+                                    struct mdt_object *mnew)
+{
+        struct mdt_lock_handle *lh_old = &info->mti_lh[MDT_LH_OLD];
+        struct mdt_lock_handle *lh_new = &info->mti_lh[MDT_LH_NEW];
+        int                     rc;
+        ENTRY;
+
+        if (mnew != NULL &&
+            lu_fid_cmp(mdt_object_fid(mnew), mdt_object_fid(mold)) < 0) {
+                rc = mdt_object_lock(info, mnew, lh_new, MDS_INODELOCK_FULL,
+                                     MDT_CROSS_LOCK);
+                if (rc == 0)
+                        rc = mdt_object_lock(info, mold, lh_old,
+                                             MDS_INODELOCK_LOOKUP,
+                                             MDT_CROSS_LOCK);
+        } else {
+                rc = mdt_object_lock(info, mold, lh_old, MDS_INODELOCK_LOOKUP,
+                                     MDT_CROSS_LOCK);
+                if (rc == 0 && mnew != NULL)
+                        rc = mdt_object_lock(info, mnew, lh_new,
+                                             MDS_INODELOCK_FULL,
+                                             MDT_CROSS_LOCK);
+        }
+        RETURN(rc);
+}
+
 /*
  * VBR: rename versions in reply: 0 - src parent; 1 - tgt parent;
  * 2 - src child; 3 - tgt child.
@@ -1116,6 +1252,8 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
         struct lustre_handle     rename_lh = { 0 };
         struct lu_name           slname = { 0 };
         struct lu_name          *lname;
+        int                      need_lock = 0;
+        int                      relock = 0;
         int                      rc;
         ENTRY;
 
@@ -1131,41 +1269,34 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
                   PFID(rr->rr_fid1), rr->rr_name,
                   PFID(rr->rr_fid2), rr->rr_tgt);
 
-        rc = mdt_rename_lock(info, &rename_lh);
-        if (rc) {
-                CERROR("Can't lock FS for rename, rc %d\n", rc);
-                RETURN(rc);
+        /* renames within one directory, and of non-directories, are
+         * serialized by the parent PDO locks alone */
+        if (!lu_fid_eq(rr->rr_fid1, rr->rr_fid2))
+                need_lock = mdt_rename_source_needs_lock(info);
+again:
+        if (need_lock) {
+                rc = mdt_rename_lock(info, &rename_lh);
+                if (rc) {
+                        CERROR("Can't lock FS for rename, rc %d\n", rc);
+                        RETURN(rc);
+                }
         }
 
-        lh_newp = &info->mti_lh[MDT_LH_NEW];
-
-        /* step 1: lock the source dir. */
+        /* step 1: find the source and target dirs. */
         lh_srcdirp = &info->mti_lh[MDT_LH_PARENT];
         mdt_lock_pdo_init(lh_srcdirp, LCK_PW, rr->rr_name,
                           rr->rr_namelen);
-        msrcdir = mdt_object_find_lock(info, rr->rr_fid1, lh_srcdirp,
-                                       MDS_INODELOCK_UPDATE);
-        if (IS_ERR(msrcdir))
-                GOTO(out_rename_lock, rc = PTR_ERR(msrcdir));
-
-        rc = mdt_version_get_check_save(info, msrcdir, 0);
-        if (rc)
-                GOTO(out_unlock_source, rc);
-
-        /* step 2: find & lock the target dir. */
         lh_tgtdirp = &info->mti_lh[MDT_LH_CHILD];
         mdt_lock_pdo_init(lh_tgtdirp, LCK_PW, rr->rr_tgt,
                           rr->rr_tgtlen);
+
+        msrcdir = mdt_object_find(info->mti_env, info->mti_mdt, rr->rr_fid1);
+        if (IS_ERR(msrcdir))
+                GOTO(out_rename_lock, rc = PTR_ERR(msrcdir));
+
         if (lu_fid_eq(rr->rr_fid1, rr->rr_fid2)) {
                 mdt_object_get(info->mti_env, msrcdir);
                 mtgtdir = msrcdir;
-                if (lh_tgtdirp->mlh_pdo_hash != lh_srcdirp->mlh_pdo_hash) {
-                         rc = mdt_pdir_hash_lock(info, lh_tgtdirp, mtgtdir,
-                                                 MDS_INODELOCK_UPDATE);
-                         if (rc)
-                                 GOTO(out_unlock_source, rc);
-                         OBD_FAIL_TIMEOUT(OBD_FAIL_MDS_PDO_LOCK2, 10);
-                }
         } else {
                 mtgtdir = mdt_object_find(info->mti_env, info->mti_mdt,
                                           rr->rr_fid2);
@@ -1177,22 +1308,23 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
                 if (rc)
                         GOTO(out_put_target, rc);
 
-                rc = mdt_object_exists(mtgtdir);
-                if (rc == 0) {
+                if (mdt_object_exists(mtgtdir) == 0)
                         GOTO(out_put_target, rc = -ESTALE);
-                } else if (rc > 0) {
-                        /* we lock the target dir if it is local */
-                        rc = mdt_object_lock(info, mtgtdir, lh_tgtdirp,
-                                             MDS_INODELOCK_UPDATE,
-                                             MDT_LOCAL_LOCK);
-                        if (rc != 0)
-                                GOTO(out_put_target, rc);
-                        /* get and save correct version after locking */
-                        mdt_version_get_save(info, mtgtdir, 1);
-                }
         }
 
-        /* step 3: find & lock the old object. */
+        /* step 2: lock them. */
+        rc = mdt_rename_lock_parents(info, msrcdir, mtgtdir);
+        if (rc)
+                GOTO(out_unlock_target, rc);
+
+        rc = mdt_version_get_check_save(info, msrcdir, 0);
+        if (rc)
+                GOTO(out_unlock_target, rc);
+        /* get and save correct version after locking */
+        if (mtgtdir != msrcdir && mdt_object_exists(mtgtdir) > 0)
+                mdt_version_get_save(info, mtgtdir, 1);
+
+        /* step 3: find the old object. */
         lname = mdt_name(info->mti_env, (char *)rr->rr_name, rr->rr_namelen);
         mdt_name_copy(&slname, lname);
         rc = mdt_lookup_version_check(info, msrcdir, &slname, old_fid, 2);
@@ -1208,19 +1340,10 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
 
         lh_oldp = &info->mti_lh[MDT_LH_OLD];
         mdt_lock_reg_init(lh_oldp, LCK_EX);
-        rc = mdt_object_lock(info, mold, lh_oldp, MDS_INODELOCK_LOOKUP,
-                             MDT_CROSS_LOCK);
-        if (rc != 0) {
-                mdt_object_put(info->mti_env, mold);
-                GOTO(out_unlock_target, rc);
-        }
-
-        info->mti_mos = mold;
-        /* save version after locking */
-        mdt_version_get_save(info, mold, 2);
-        mdt_set_capainfo(info, 2, old_fid, BYPASS_CAPA);
+        lh_newp = &info->mti_lh[MDT_LH_NEW];
+        mdt_lock_reg_init(lh_newp, LCK_EX);
 
-        /* step 4: find & lock the new object. */
+        /* step 4: find the new object. */
         /* new target object may not exist now */
         lname = mdt_name(info->mti_env, (char *)rr->rr_tgt, rr->rr_tgtlen);
         /* lookup with version checking */
@@ -1234,27 +1357,41 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
                     lu_fid_eq(new_fid, rr->rr_fid2))
                         GOTO(out_unlock_old, rc = -EINVAL);
 
-                mdt_lock_reg_init(lh_newp, LCK_EX);
                 mnew = mdt_object_find(info->mti_env, info->mti_mdt, new_fid);
-                if (IS_ERR(mnew))
-                        GOTO(out_unlock_old, rc = PTR_ERR(mnew));
-
-                rc = mdt_object_lock(info, mnew, lh_newp,
-                                     MDS_INODELOCK_FULL, MDT_CROSS_LOCK);
-                if (rc != 0) {
-                        mdt_object_put(info->mti_env, mnew);
+                if (IS_ERR(mnew)) {
+                        rc = PTR_ERR(mnew);
+                        mnew = NULL;
                         GOTO(out_unlock_old, rc);
                 }
-                /* get and save version after locking */
-                mdt_version_get_save(info, mnew, 3);
-                mdt_set_capainfo(info, 3, new_fid, BYPASS_CAPA);
         } else if (rc != -EREMOTE && rc != -ENOENT) {
                 GOTO(out_unlock_old, rc);
         } else {
                 mdt_enoent_version_save(info, 3);
         }
 
-        /* step 5: rename it */
+        /* step 5: lock the old and new objects. */
+        rc = mdt_rename_lock_children(info, mold, mnew);
+        if (rc != 0)
+                GOTO(out_unlock_new, rc);
+
+        /* the object changed under us into one needing the rename lock:
+         * drop everything and take the locks again in the right order */
+        if (!need_lock && !lu_fid_eq(rr->rr_fid1, rr->rr_fid2) &&
+            mdt_rename_needs_lock(mold)) {
+                need_lock = relock = 1;
+                GOTO(out_unlock_new, rc = -EAGAIN);
+        }
+
+        info->mti_mos = mold;
+        /* save versions after locking */
+        mdt_version_get_save(info, mold, 2);
+        mdt_set_capainfo(info, 2, old_fid, BYPASS_CAPA);
+        if (mnew != NULL) {
+                mdt_version_get_save(info, mnew, 3);
+                mdt_set_capainfo(info, 3, new_fid, BYPASS_CAPA);
+        }
+
+        /* step 6: rename it */
         mdt_reint_init_ma(info, ma);
         if (!ma->ma_lmm || !ma->ma_cookie)
                 GOTO(out_unlock_new, rc = -EINVAL);
@@ -1264,9 +1401,11 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
 
 
         /* Check if @dst is subdir of @src. */
-        rc = mdt_rename_sanity(info, old_fid);
-        if (rc)
-                GOTO(out_unlock_new, rc);
+        if (need_lock) {
+                rc = mdt_rename_sanity(info, old_fid);
+                if (rc)
+                        GOTO(out_unlock_new, rc);
+        }
 
         rc = mdo_rename(info->mti_env, mdt_object_child(msrcdir),
                         mdt_object_child(mtgtdir), old_fid, &slname,
@@ -1293,7 +1432,15 @@ out_put_target:
 out_unlock_source:
         mdt_object_unlock_put(info, msrcdir, lh_srcdirp, rc);
 out_rename_lock:
-        mdt_rename_unlock(&rename_lh);
+        if (lustre_handle_is_used(&rename_lh)) {
+                mdt_rename_unlock(&rename_lh);
+                rename_lh.cookie = 0;
+        }
+        if (relock) {
+                relock = 0;
+                mnew = NULL;
+                goto again;
+        }
         return rc;
 }
 
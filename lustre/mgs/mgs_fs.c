@@ -81,7 +81,7 @@ int mgs_export_stats_init(struct obd_device *obd, struct obd_export *exp,
                 num_stats = (sizeof(*obd->obd_type->typ_dt_ops) / sizeof(void *)) +
                             LPROC_MGS_LAST - 1;
                 tmp->nid_stats = lprocfs_alloc_stats(num_stats,
-                                                     LPROCFS_STATS_FLAG_NOPERCPU);
+                                                     LPROCFS_STATS_FLAG_LAZY);
                 if (tmp->nid_stats == NULL)
                         return -ENOMEM;
                 lprocfs_init_ops_stats(LPROC_MGS_LAST, tmp->nid_stats);
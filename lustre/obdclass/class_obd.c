@@ -82,10 +82,109 @@ unsigned int at_max = 600;
 unsigned int at_history = 600;
 int at_early_margin = 10;
 int at_extra = 30;
+/* where clients take the job ID of an RPC from, see lustre_get_jobid() */
+char obd_jobid_var[JOBSTATS_JOBID_VAR_MAX_LEN + 1] = JOBSTATS_DISABLE;
 
 cfs_atomic_t obd_dirty_pages;
 cfs_atomic_t obd_dirty_transit_pages;
 
+#ifdef __KERNEL__
+/*
+ * Job IDs of the processes which sent RPCs recently, by pid, so that the
+ * environment is not read for each RPC.  An entry is used for
+ * JOBID_CACHE_AGE seconds and while obd_jobid_var stays the same.
+ */
+#define JOBID_CACHE_BITS        6
+#define JOBID_CACHE_AGE         10
+
+struct jobid_cache_entry {
+        pid_t                   jce_pid;
+        time_t                  jce_time;
+        char                    jce_jobid[JOBSTATS_JOBID_SIZE];
+};
+
+static struct jobid_cache_entry jobid_cache[1 << JOBID_CACHE_BITS];
+static char jobid_cache_var[JOBSTATS_JOBID_VAR_MAX_LEN + 1];
+static cfs_spinlock_t jobid_cache_lock = CFS_SPIN_LOCK_UNLOCKED;
+
+static int jobid_cache_lookup(pid_t pid, char *jobid)
+{
+        struct jobid_cache_entry *jce;
+        int                       found = 0;
+
+        jce = &jobid_cache[pid & ((1 << JOBID_CACHE_BITS) - 1)];
+        cfs_spin_lock(&jobid_cache_lock);
+        if (strcmp(jobid_cache_var, obd_jobid_var) != 0) {
+                /* jobid_var changed, forget everything */
+                memset(jobid_cache, 0, sizeof(jobid_cache));
+                strncpy(jobid_cache_var, obd_jobid_var,
+                        sizeof(jobid_cache_var) - 1);
+        } else if (jce->jce_pid == pid &&
+                   cfs_time_current_sec() < jce->jce_time + JOBID_CACHE_AGE) {
+                memcpy(jobid, jce->jce_jobid, JOBSTATS_JOBID_SIZE);
+                found = 1;
+        }
+        cfs_spin_unlock(&jobid_cache_lock);
+        return found;
+}
+
+static void jobid_cache_add(pid_t pid, const char *jobid)
+{
+        struct jobid_cache_entry *jce;
+
+        jce = &jobid_cache[pid & ((1 << JOBID_CACHE_BITS) - 1)];
+        cfs_spin_lock(&jobid_cache_lock);
+        jce->jce_pid = pid;
+        jce->jce_time = cfs_time_current_sec();
+        memcpy(jce->jce_jobid, jobid, JOBSTATS_JOBID_SIZE);
+        cfs_spin_unlock(&jobid_cache_lock);
+}
+#endif
+
+/* Fill \a jobid (JOBSTATS_JOBID_SIZE bytes) with the job ID of the current
+ * process for the RPCs it sends: depending on obd_jobid_var, the value of
+ * that environment variable, "<command>.<uid>" for JOBSTATS_PROCNAME_UID or
+ * nothing for JOBSTATS_DISABLE.  Kernel threads sending RPCs on behalf of a
+ * process (e.g. writeback) get the job ID that llite recorded in the inode
+ * when the data was dirtied, see cl_req_attr::cra_jobid. */
+int lustre_get_jobid(char *jobid)
+{
+#ifdef __KERNEL__
+        pid_t pid;
+#endif
+        int   rc = 0;
+        ENTRY;
+
+        memset(jobid, 0, JOBSTATS_JOBID_SIZE);
+#ifdef __KERNEL__
+        if (strcmp(obd_jobid_var, JOBSTATS_DISABLE) == 0)
+                RETURN(0);
+
+        if (strcmp(obd_jobid_var, JOBSTATS_PROCNAME_UID) == 0) {
+                snprintf(jobid, JOBSTATS_JOBID_SIZE, "%s.%u",
+                         cfs_curproc_comm(), cfs_curproc_uid());
+                RETURN(0);
+        }
+
+        pid = cfs_curproc_pid();
+        if (jobid_cache_lookup(pid, jobid))
+                RETURN(0);
+
+        rc = cfs_curproc_getenv(obd_jobid_var, jobid, JOBSTATS_JOBID_SIZE);
+        if (rc != 0) {
+                CDEBUG(rc == -ENOENT || rc == -EINVAL ? D_INFO : D_HA,
+                       "cannot get job ID from %s: rc = %d\n",
+                       obd_jobid_var, rc);
+                jobid[0] = '\0';
+        }
+        /* -EDEADLK and -EFAULT are transient, try again next time */
+        if (rc == 0 || rc == -ENOENT || rc == -EINVAL)
+                jobid_cache_add(pid, jobid);
+#endif
+        RETURN(rc);
+}
+EXPORT_SYMBOL(lustre_get_jobid);
+
 static inline void obd_data2conn(struct lustre_handle *conn,
                                  struct obd_ioctl_data *data)
 {
@@ -324,6 +423,10 @@ int class_handle_ioctl(unsigned int cmd, unsigned long arg)
                 GOTO(out, err = 0);
         }
 
+        case OBD_IOC_STATS_SNAPSHOT:
+                err = lprocfs_stats_snapshot(obd, data);
+                GOTO(out, err);
+
         default: {
                 err = obd_iocontrol(cmd, obd->obd_self_export, len, data, NULL);
                 if (err)
@@ -364,6 +467,7 @@ EXPORT_SYMBOL(at_max);
 EXPORT_SYMBOL(at_extra);
 EXPORT_SYMBOL(at_early_margin);
 EXPORT_SYMBOL(at_history);
+EXPORT_SYMBOL(obd_jobid_var);
 EXPORT_SYMBOL(ptlrpc_put_connection_superhack);
 
 EXPORT_SYMBOL(proc_lustre_root);
@@ -80,6 +80,7 @@ enum {
         OBD_AT_EXTRA,
         OBD_AT_EARLY_MARGIN,
         OBD_AT_HISTORY,
+        OBD_JOBID_VAR,          /* source of the job ID of client RPCs */
 };
 
 #else
@@ -105,6 +106,7 @@ enum {
 #define OBD_AT_EXTRA            CTL_UNNUMBERED
 #define OBD_AT_EARLY_MARGIN     CTL_UNNUMBERED
 #define OBD_AT_HISTORY          CTL_UNNUMBERED
+#define OBD_JOBID_VAR           CTL_UNNUMBERED
 
 #endif
 
@@ -442,6 +444,14 @@ static cfs_sysctl_table_t obd_table[] = {
                 .mode     = 0644,
                 .proc_handler = &proc_at_history
         },
+        {
+                .ctl_name = OBD_JOBID_VAR,
+                .procname = "jobid_var",
+                .data     = obd_jobid_var,
+                .maxlen   = JOBSTATS_JOBID_VAR_MAX_LEN + 1,
+                .mode     = 0644,
+                .proc_handler = &proc_dostring,
+        },
         { 0 }
 };
 
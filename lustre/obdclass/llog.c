@@ -309,6 +309,14 @@ static int llog_process_thread(void *arg)
                                 continue;
                         }
 
+                        /* A server filtering the block for us leaves out
+                         * the records that did not match */
+                        if (rec->lrh_index > index) {
+                                index = rec->lrh_index;
+                                if (index > last_index)
+                                        GOTO(out, rc = 0);
+                        }
+
                         CDEBUG(D_OTHER,
                                "lrh_index: %d lrh_len: %d (%d remains)\n",
                                rec->lrh_index, rec->lrh_len,
@@ -318,13 +326,18 @@ static int llog_process_thread(void *arg)
                         loghandle->lgh_cur_offset = (char *)rec - (char *)buf +
                                                     last_offset;
 
-                        /* if set, process the callback on this record */
-                        if (ext2_test_bit(index, llh->llh_bitmap)) {
+                        /* if set, process the callback on this record;
+                         * padding, which may stand for records left out by
+                         * the server, is never passed on */
+                        if (rec->lrh_type != LLOG_PAD_MAGIC &&
+                            ext2_test_bit(index, llh->llh_bitmap)) {
                                 rc = lpi->lpi_cb(loghandle, rec,
                                                  lpi->lpi_cbdata);
                                 last_called_index = index;
                                 if (rc == LLOG_PROC_BREAK) {
                                         GOTO(out, rc);
+                                } else if (rc == LLOG_SKIP_PLAIN) {
+                                        GOTO(out, rc = 0);
                                 } else if (rc == LLOG_DEL_RECORD) {
                                         llog_cancel_rec(loghandle,
                                                         rec->lrh_index);
@@ -463,8 +476,11 @@ int llog_reverse_process(struct llog_handle *loghandle, llog_cb_t cb,
                         if (rec->lrh_index == 0)
                                 GOTO(out, 0); /* no more records */
 
-                        /* if set, process the callback on this record */
-                        if (ext2_test_bit(index, llh->llh_bitmap)) {
+                        /* if set, process the callback on this record;
+                         * padding, which may stand for records left out by
+                         * the server, is never passed on */
+                        if (rec->lrh_type != LLOG_PAD_MAGIC &&
+                            ext2_test_bit(index, llh->llh_bitmap)) {
                                 rc = cb(loghandle, rec, data);
                                 if (rc == LLOG_PROC_BREAK) {
                                         GOTO(out, rc);
@@ -180,6 +180,7 @@ int llog_cat_id2handle(struct llog_handle *cathandle, struct llog_handle **res,
                 }
         }
         if (!rc) {
+                loghandle->lgh_filter = cathandle->lgh_filter;
                 loghandle->u.phd.phd_cat_handle = cathandle;
                 loghandle->u.phd.phd_cookie.lgc_lgl = cathandle->lgh_id;
                 loghandle->u.phd.phd_cookie.lgc_index =
@@ -216,6 +217,17 @@ enum {
         LLOGH_LOG
 };
 
+/*
+ * A record may need a padding record before it, see llog_lvfs_write_rec():
+ * a plain log is full once it has no room for both, so that the write of a
+ * record filled in by llog_cat_fill_rec() does not fail for lack of indexes.
+ */
+static inline int llog_cat_log_full(struct llog_handle *loghandle)
+{
+        return loghandle->lgh_last_idx >=
+               LLOG_BITMAP_SIZE(loghandle->lgh_hdr) - 2;
+}
+
 /** Return the currently active log handle.  If the current log handle doesn't
  * have enough space left for the current record, start a new one.
  *
@@ -235,9 +247,8 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
         cfs_down_read_nested(&cathandle->lgh_lock, LLOGH_CAT);
         loghandle = cathandle->u.chd.chd_current_log;
         if (loghandle) {
-                struct llog_log_hdr *llh = loghandle->lgh_hdr;
                 cfs_down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
-                if (loghandle->lgh_last_idx < LLOG_BITMAP_SIZE(llh) - 1) {
+                if (!llog_cat_log_full(loghandle)) {
                         cfs_up_read(&cathandle->lgh_lock);
                         RETURN(loghandle);
                 } else {
@@ -258,9 +269,8 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
         cfs_down_write_nested(&cathandle->lgh_lock, LLOGH_CAT);
         loghandle = cathandle->u.chd.chd_current_log;
         if (loghandle) {
-                struct llog_log_hdr *llh = loghandle->lgh_hdr;
                 cfs_down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
-                if (loghandle->lgh_last_idx < LLOG_BITMAP_SIZE(llh) - 1) {
+                if (!llog_cat_log_full(loghandle)) {
                         cfs_up_write(&cathandle->lgh_lock);
                         RETURN(loghandle);
                 } else {
@@ -281,6 +291,17 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
  *
  * Assumes caller has already pushed us into the kernel context.
  */
+/* Let the owner of the log fill in \a rec, under the plain log lock */
+static inline int llog_cat_fill_rec(struct llog_handle *cathandle,
+                                    struct llog_rec_hdr *rec)
+{
+        struct llog_ctxt *ctxt = cathandle->lgh_ctxt;
+
+        if (ctxt == NULL || ctxt->loc_fill_rec == NULL)
+                return 0;
+        return ctxt->loc_fill_rec(rec, ctxt->loc_cb_data);
+}
+
 int llog_cat_add_rec(struct llog_handle *cathandle, struct llog_rec_hdr *rec,
                      struct llog_cookie *reccookie, void *buf)
 {
@@ -293,12 +314,17 @@ int llog_cat_add_rec(struct llog_handle *cathandle, struct llog_rec_hdr *rec,
         if (IS_ERR(loghandle))
                 RETURN(PTR_ERR(loghandle));
         /* loghandle is already locked by llog_cat_current_log() for us */
-        rc = llog_write_rec(loghandle, rec, reccookie, 1, buf, -1);
+        rc = llog_cat_fill_rec(cathandle, rec);
+        if (rc == 0)
+                rc = llog_write_rec(loghandle, rec, reccookie, 1, buf, -1);
         if (rc < 0)
                 CERROR("llog_write_rec %d: lh=%p\n", rc, loghandle);
         cfs_up_write(&loghandle->lgh_lock);
         if (rc == -ENOSPC) {
-                /* to create a new plain log */
+                /* to create a new plain log.  The record keeps what was
+                 * filled in above, filling it in again would leave a hole
+                 * in the changelog indexes.  llog_cat_log_full() leaves
+                 * room for it, so this is about the disk being full. */
                 loghandle = llog_cat_current_log(cathandle, 1);
                 if (IS_ERR(loghandle))
                         RETURN(PTR_ERR(loghandle));
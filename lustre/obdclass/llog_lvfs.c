@@ -217,6 +217,47 @@ static int llog_lvfs_read_header(struct llog_handle *handle)
 
 /* returns negative in on error; 0 if success && reccookie == 0; 1 otherwise */
 /* appends if idx == -1, otherwise overwrites record idx. */
+/*
+ * Appending a record only changes llh_count, one bitmap word and the tail
+ * index of the log header. Once the header is on disk write just those
+ * fields instead of rewriting the whole LLOG_CHUNK_SIZE header for every
+ * record. The writes nest in the caller's journal handle, so they commit
+ * together exactly like the single header write did.
+ */
+static int llog_lvfs_write_hdr_bit(struct obd_device *obd,
+                                   struct l_file *file,
+                                   struct llog_log_hdr *llh, int index)
+{
+        loff_t saved_off = file->f_pos;
+        loff_t off;
+        int rc;
+
+        if (i_size_read(file->f_dentry->d_inode) < llh->llh_hdr.lrh_len)
+                return llog_lvfs_write_blob(obd, file, &llh->llh_hdr, NULL, 0);
+
+        off = offsetof(struct llog_log_hdr, llh_count);
+        rc = fsfilt_write_record(obd, file, &llh->llh_count,
+                                 sizeof(llh->llh_count), &off, 0);
+        if (rc)
+                goto out;
+
+        off = offsetof(struct llog_log_hdr, llh_bitmap) +
+              (index / 32) * sizeof(llh->llh_bitmap[0]);
+        rc = fsfilt_write_record(obd, file, &llh->llh_bitmap[index / 32],
+                                 sizeof(llh->llh_bitmap[0]), &off, 0);
+        if (rc)
+                goto out;
+
+        off = offsetof(struct llog_log_hdr, llh_tail);
+        rc = fsfilt_write_record(obd, file, &llh->llh_tail,
+                                 sizeof(llh->llh_tail), &off, 0);
+out:
+        if (rc)
+                CERROR("error writing log header: rc %d\n", rc);
+        file->f_pos = saved_off;
+        return rc;
+}
+
 static int llog_lvfs_write_rec(struct llog_handle *loghandle,
                                struct llog_rec_hdr *rec,
                                struct llog_cookie *reccookie, int cookiecount,
@@ -353,7 +394,7 @@ static int llog_lvfs_write_rec(struct llog_handle *loghandle,
         llh->llh_count++;
         llh->llh_tail.lrt_index = index;
 
-        rc = llog_lvfs_write_blob(obd, file, &llh->llh_hdr, NULL, 0);
+        rc = llog_lvfs_write_hdr_bit(obd, file, llh, index);
         if (rc)
                 RETURN(rc);
 
@@ -91,6 +91,14 @@ void lustre_swab_llogd_conn_body (struct llogd_conn_body *d)
 }
 EXPORT_SYMBOL(lustre_swab_llogd_conn_body);
 
+void lustre_swab_changelog_filter(struct changelog_filter *clf)
+{
+        __swab32s (&clf->clf_mask);
+        __swab32s (&clf->clf_user);
+        lustre_swab_lu_fid(&clf->clf_fid);
+}
+EXPORT_SYMBOL(lustre_swab_changelog_filter);
+
 void lustre_swab_ll_fid(struct ll_fid *fid)
 {
         __swab64s (&fid->id);
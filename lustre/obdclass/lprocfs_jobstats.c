@@ -0,0 +1,442 @@
+/* -*- mode: c; c-basic-offset: 8; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.sun.com/software/products/lustre/docs/GPLv2.pdf
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa Clara,
+ * CA 95054 USA or visit www.sun.com if you need additional information or
+ * have any questions.
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/obdclass/lprocfs_jobstats.c
+ *
+ * Per-job statistics of a server target.  Clients put the job ID of the
+ * process that caused an RPC in the ptlrpc body (see lustre_get_jobid());
+ * the target keeps one lprocfs_stats per job ID in a hash and shows them
+ * all in "job_stats".  Jobs idle for "job_cleanup_interval" seconds are
+ * dropped, writing to "job_stats" drops all of them.
+ */
+
+#ifndef EXPORT_SYMTAB
+# define EXPORT_SYMTAB
+#endif
+#define DEBUG_SUBSYSTEM S_CLASS
+
+#ifndef __KERNEL__
+# include <liblustre.h>
+#endif
+
+#include <obd_class.h>
+#include <lprocfs_status.h>
+#include <lustre/lustre_idl.h>
+
+#if defined(LPROCFS)
+
+struct job_stat {
+        cfs_hlist_node_t        js_hash;        /* in ojs_hash */
+        cfs_list_t              js_list;        /* in ojs_list */
+        cfs_atomic_t            js_refcount;    /* hash + users */
+        char                    js_jobid[JOBSTATS_JOBID_SIZE];
+        time_t                  js_timestamp;   /* last use, seconds */
+        struct lprocfs_stats   *js_stats;
+        struct obd_job_stats   *js_jobstats;
+};
+
+static void job_free(struct job_stat *job)
+{
+        struct obd_job_stats *stats = job->js_jobstats;
+
+        cfs_write_lock(&stats->ojs_lock);
+        cfs_list_del_init(&job->js_list);
+        cfs_write_unlock(&stats->ojs_lock);
+
+        lprocfs_free_stats(&job->js_stats);
+        OBD_FREE_PTR(job);
+}
+
+static void job_getref(struct job_stat *job)
+{
+        LASSERT(cfs_atomic_read(&job->js_refcount) > 0);
+        cfs_atomic_inc(&job->js_refcount);
+}
+
+static void job_putref(struct job_stat *job)
+{
+        LASSERT(cfs_atomic_read(&job->js_refcount) > 0);
+        if (cfs_atomic_dec_and_test(&job->js_refcount))
+                job_free(job);
+}
+
+static struct job_stat *job_alloc(struct obd_job_stats *stats, char *jobid)
+{
+        struct job_stat *job;
+
+        OBD_ALLOC_PTR(job);
+        if (job == NULL)
+                return NULL;
+
+        /* most jobs are served by a few service threads of the target */
+        job->js_stats = lprocfs_alloc_stats(stats->ojs_cntr_num,
+                                            LPROCFS_STATS_FLAG_LAZY);
+        if (job->js_stats == NULL) {
+                OBD_FREE_PTR(job);
+                return NULL;
+        }
+        stats->ojs_cntr_init_fn(job->js_stats);
+
+        CFS_INIT_HLIST_NODE(&job->js_hash);
+        CFS_INIT_LIST_HEAD(&job->js_list);
+        cfs_atomic_set(&job->js_refcount, 1);
+        strncpy(job->js_jobid, jobid, sizeof(job->js_jobid) - 1);
+        job->js_timestamp = cfs_time_current_sec();
+        job->js_jobstats = stats;
+        return job;
+}
+
+/*
+ * jobid<->job_stat hash operations
+ */
+
+static unsigned
+job_stat_hash(cfs_hash_t *hs, const void *key, unsigned mask)
+{
+        return cfs_hash_djb2_hash(key, strlen(key), mask);
+}
+
+static void *
+job_stat_key(cfs_hlist_node_t *hnode)
+{
+        return cfs_hlist_entry(hnode, struct job_stat, js_hash)->js_jobid;
+}
+
+static int
+job_stat_keycmp(const void *key, cfs_hlist_node_t *hnode)
+{
+        return strncmp(job_stat_key(hnode), key, JOBSTATS_JOBID_SIZE) == 0;
+}
+
+static void *
+job_stat_object(cfs_hlist_node_t *hnode)
+{
+        return cfs_hlist_entry(hnode, struct job_stat, js_hash);
+}
+
+static void
+job_stat_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        job_getref(cfs_hlist_entry(hnode, struct job_stat, js_hash));
+}
+
+static void
+job_stat_put_locked(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        job_putref(cfs_hlist_entry(hnode, struct job_stat, js_hash));
+}
+
+static cfs_hash_ops_t job_stats_hash_ops = {
+        .hs_hash        = job_stat_hash,
+        .hs_key         = job_stat_key,
+        .hs_keycmp      = job_stat_keycmp,
+        .hs_object      = job_stat_object,
+        .hs_get         = job_stat_get,
+        .hs_put_locked  = job_stat_put_locked,
+};
+
+static int job_cleanup_iter_callback(void *obj, void *data)
+{
+        struct job_stat *job = obj;
+
+        return job->js_timestamp < *(time_t *)data;
+}
+
+/* Drop the jobs idle for ojs_cleanup_interval, or all of them if \a all. */
+static void lprocfs_job_cleanup(struct obd_job_stats *stats, int all)
+{
+        time_t now = cfs_time_current_sec();
+        time_t oldest;
+
+        if (all) {
+                oldest = now + 1;
+        } else {
+                if (stats->ojs_cleanup_interval == 0 ||
+                    now < stats->ojs_last_cleanup +
+                          stats->ojs_cleanup_interval)
+                        return;
+                oldest = now - stats->ojs_cleanup_interval;
+        }
+        stats->ojs_last_cleanup = now;
+
+        cfs_hash_cond_del(stats->ojs_hash, job_cleanup_iter_callback, &oldest);
+}
+
+/**
+ * Add \a amount to counter \a event of job \a jobid on \a obd, creating the
+ * job if it is new.  Nothing is accounted if job stats are not set up on
+ * \a obd or the request carried no job ID.
+ */
+int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
+                          int event, long amount)
+{
+        struct obd_job_stats *stats = &obd->obd_jobstats;
+        struct job_stat      *job;
+        struct job_stat      *job2;
+        ENTRY;
+
+        if (stats->ojs_hash == NULL || jobid == NULL || jobid[0] == '\0')
+                RETURN(-EINVAL);
+
+        LASSERT(event >= 0 && event < stats->ojs_cntr_num);
+
+        lprocfs_job_cleanup(stats, 0);
+
+        job = cfs_hash_lookup(stats->ojs_hash, jobid);
+        if (job == NULL) {
+                job = job_alloc(stats, jobid);
+                if (job == NULL)
+                        RETURN(-ENOMEM);
+
+                job2 = cfs_hash_findadd_unique(stats->ojs_hash, job->js_jobid,
+                                               &job->js_hash);
+                if (job2 != job) {
+                        /* added by another thread meanwhile */
+                        job_putref(job);
+                        job = job2;
+                } else {
+                        cfs_write_lock(&stats->ojs_lock);
+                        cfs_list_add_tail(&job->js_list, &stats->ojs_list);
+                        cfs_write_unlock(&stats->ojs_lock);
+                }
+        }
+
+        job->js_timestamp = cfs_time_current_sec();
+        lprocfs_counter_add(job->js_stats, event, amount);
+
+        job_putref(job);
+        RETURN(0);
+}
+EXPORT_SYMBOL(lprocfs_job_stats_log);
+
+static void *lprocfs_jobstats_seq_start(struct seq_file *p, loff_t *pos)
+{
+        struct obd_job_stats *stats = p->private;
+        struct job_stat      *job;
+        loff_t                off = *pos;
+
+        cfs_read_lock(&stats->ojs_lock);
+        if (off == 0)
+                return SEQ_START_TOKEN;
+        off--;
+        cfs_list_for_each_entry(job, &stats->ojs_list, js_list) {
+                if (off-- == 0)
+                        return job;
+        }
+        return NULL;
+}
+
+static void lprocfs_jobstats_seq_stop(struct seq_file *p, void *v)
+{
+        struct obd_job_stats *stats = p->private;
+
+        cfs_read_unlock(&stats->ojs_lock);
+}
+
+static void *lprocfs_jobstats_seq_next(struct seq_file *p, void *v,
+                                       loff_t *pos)
+{
+        struct obd_job_stats *stats = p->private;
+        cfs_list_t           *next;
+
+        ++*pos;
+        if (v == SEQ_START_TOKEN)
+                next = stats->ojs_list.next;
+        else
+                next = ((struct job_stat *)v)->js_list.next;
+
+        return next == &stats->ojs_list ? NULL :
+               cfs_list_entry(next, struct job_stat, js_list);
+}
+
+/*
+ * job_stats:
+ * - job_id:         dd.500
+ *   snapshot_time:  1304030000
+ *   write_bytes:    { samples: 16, unit: bytes, min: 1048576, ... }
+ */
+static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
+{
+        struct job_stat        *job = v;
+        struct lprocfs_stats   *s;
+        struct lprocfs_counter  ret;
+        struct lprocfs_counter *cntr;
+        char                    name[MAX_OBD_NAME];
+        int                     i;
+        int                     rc;
+
+        if (v == SEQ_START_TOKEN)
+                return seq_printf(p, "job_stats:\n");
+
+        rc = seq_printf(p, "- %-16s %s\n", "job_id:", job->js_jobid);
+        if (rc < 0)
+                return rc;
+        rc = seq_printf(p, "  %-16s %ld\n", "snapshot_time:",
+                        job->js_timestamp);
+        if (rc < 0)
+                return rc;
+
+        s = job->js_stats;
+        for (i = 0; i < s->ls_num; i++) {
+                cntr = &s->ls_percpu[0]->lp_cntr[i];
+                lprocfs_stats_collect(s, i, &ret);
+                if (ret.lc_count == 0)
+                        continue;
+
+                snprintf(name, sizeof(name), "%s:", cntr->lc_name);
+                rc = seq_printf(p, "  %-16s { samples: "LPU64", unit: %s, "
+                                "min: "LPU64", max: "LPU64", sum: "LPU64
+                                " }\n", name, ret.lc_count, cntr->lc_units,
+                                ret.lc_min, ret.lc_max, ret.lc_sum);
+                if (rc < 0)
+                        return rc;
+        }
+        return 0;
+}
+
+static struct seq_operations lprocfs_jobstats_seq_sops = {
+        start: lprocfs_jobstats_seq_start,
+        stop:  lprocfs_jobstats_seq_stop,
+        next:  lprocfs_jobstats_seq_next,
+        show:  lprocfs_jobstats_seq_show,
+};
+
+static int lprocfs_jobstats_seq_open(struct inode *inode, struct file *file)
+{
+        struct proc_dir_entry *dp = PDE(inode);
+        struct seq_file *seq;
+        int rc;
+
+        if (LPROCFS_ENTRY_AND_CHECK(dp))
+                return -ENOENT;
+
+        rc = seq_open(file, &lprocfs_jobstats_seq_sops);
+        if (rc) {
+                LPROCFS_EXIT();
+                return rc;
+        }
+        seq = file->private_data;
+        seq->private = dp->data;
+        return 0;
+}
+
+static ssize_t lprocfs_jobstats_seq_write(struct file *file, const char *buf,
+                                          size_t len, loff_t *off)
+{
+        struct seq_file *seq = file->private_data;
+
+        lprocfs_job_cleanup(seq->private, 1);
+        return len;
+}
+
+static struct file_operations lprocfs_jobstats_seq_fops = {
+        .owner   = THIS_MODULE,
+        .open    = lprocfs_jobstats_seq_open,
+        .read    = seq_read,
+        .write   = lprocfs_jobstats_seq_write,
+        .llseek  = seq_lseek,
+        .release = lprocfs_seq_release,
+};
+
+/**
+ * Set up job stats of \a obd: every job gets \a cntr_num counters, named by
+ * \a init_fn.  Called by targets after lprocfs_obd_setup().
+ */
+int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
+                           cntr_init_callback init_fn)
+{
+        struct obd_job_stats  *stats = &obd->obd_jobstats;
+        cfs_proc_dir_entry_t  *entry;
+        int                    rc;
+        ENTRY;
+
+        LASSERT(obd->obd_proc_entry != NULL);
+        LASSERT(stats->ojs_hash == NULL);
+        LASSERT(cntr_num > 0 && init_fn != NULL);
+
+        stats->ojs_hash = cfs_hash_create("JOB_STATS",
+                                          HASH_JOB_STATS_CUR_BITS,
+                                          HASH_JOB_STATS_MAX_BITS,
+                                          HASH_JOB_STATS_BKT_BITS, 0,
+                                          CFS_HASH_MIN_THETA,
+                                          CFS_HASH_MAX_THETA,
+                                          &job_stats_hash_ops,
+                                          CFS_HASH_DEFAULT);
+        if (stats->ojs_hash == NULL)
+                RETURN(-ENOMEM);
+
+        CFS_INIT_LIST_HEAD(&stats->ojs_list);
+        cfs_rwlock_init(&stats->ojs_lock);
+        stats->ojs_cntr_num = cntr_num;
+        stats->ojs_cntr_init_fn = init_fn;
+        stats->ojs_cleanup_interval = 600; /* 10 minutes */
+        stats->ojs_last_cleanup = cfs_time_current_sec();
+
+        rc = lprocfs_seq_create(obd->obd_proc_entry, "job_stats", 0644,
+                                &lprocfs_jobstats_seq_fops, stats);
+        if (rc)
+                GOTO(out_hash, rc);
+
+        entry = lprocfs_add_simple(obd->obd_proc_entry, "job_cleanup_interval",
+                                   lprocfs_rd_uint, lprocfs_wr_uint,
+                                   &stats->ojs_cleanup_interval, NULL);
+        if (IS_ERR(entry)) {
+                lprocfs_remove_proc_entry("job_stats", obd->obd_proc_entry);
+                GOTO(out_hash, rc = PTR_ERR(entry));
+        }
+        RETURN(0);
+
+out_hash:
+        cfs_hash_putref(stats->ojs_hash);
+        stats->ojs_hash = NULL;
+        return rc;
+}
+EXPORT_SYMBOL(lprocfs_job_stats_init);
+
+void lprocfs_job_stats_fini(struct obd_device *obd)
+{
+        struct obd_job_stats *stats = &obd->obd_jobstats;
+
+        if (stats->ojs_hash == NULL)
+                return;
+
+        lprocfs_remove_proc_entry("job_cleanup_interval",
+                                  obd->obd_proc_entry);
+        lprocfs_remove_proc_entry("job_stats", obd->obd_proc_entry);
+
+        /* frees all the jobs */
+        cfs_hash_putref(stats->ojs_hash);
+        stats->ojs_hash = NULL;
+        LASSERT(cfs_list_empty(&stats->ojs_list));
+}
+EXPORT_SYMBOL(lprocfs_job_stats_fini);
+
+#endif /* LPROCFS */
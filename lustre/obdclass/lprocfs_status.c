@@ -703,7 +703,8 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
         unsigned int num_cpu;
         struct lprocfs_counter t;
         struct lprocfs_counter *percpu_cntr;
-        int centry, i;
+        unsigned int seq;
+        int i;
 
         memset(cnt, 0, sizeof(*cnt));
 
@@ -718,20 +719,20 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
         num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU);
 
         for (i = 0; i < num_cpu; i++) {
+                /* LAZY stats may have holes */
+                if (stats->ls_percpu[i] == NULL)
+                        continue;
                 percpu_cntr = &(stats->ls_percpu[i])->lp_cntr[idx];
 
                 do {
-                        centry = cfs_atomic_read(&percpu_cntr-> \
-                                                 lc_cntl.la_entry);
+                        seq = lprocfs_counter_read_begin(percpu_cntr);
                         t.lc_count = percpu_cntr->lc_count;
                         t.lc_sum = percpu_cntr->lc_sum;
                         t.lc_min = percpu_cntr->lc_min;
                         t.lc_max = percpu_cntr->lc_max;
                         t.lc_sumsquare = percpu_cntr->lc_sumsquare;
-                } while (centry != cfs_atomic_read(&percpu_cntr->lc_cntl. \
-                                                   la_entry) &&
-                         centry != cfs_atomic_read(&percpu_cntr->lc_cntl. \
-                                                   la_exit));
+                        t.lc_gen = percpu_cntr->lc_gen;
+                } while (lprocfs_counter_read_retry(percpu_cntr, seq));
                 cnt->lc_count += t.lc_count;
                 cnt->lc_sum += t.lc_sum;
                 if (t.lc_min < cnt->lc_min)
@@ -739,12 +740,39 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                 if (t.lc_max > cnt->lc_max)
                         cnt->lc_max = t.lc_max;
                 cnt->lc_sumsquare += t.lc_sumsquare;
+                if (t.lc_gen > cnt->lc_gen)
+                        cnt->lc_gen = t.lc_gen;
         }
 
         cnt->lc_units = stats->ls_percpu[0]->lp_cntr[idx].lc_units;
         lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU);
 }
 
+/** add up the per-cpu histograms of a LPROCFS_CNTR_HISTOGRAM counter */
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+                                __u64 *hist)
+{
+        __u32 *row;
+        unsigned int num_cpu;
+        int i, j;
+
+        memset(hist, 0, LPROCFS_HIST_MAX * sizeof(*hist));
+        if (stats == NULL)
+                return;
+
+        row = stats->ls_percpu[0]->lp_cntr[idx].lc_hist;
+        if (row == NULL)
+                return;
+
+        /* buckets are 32 bits, they are read without retrying */
+        num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU);
+        for (i = 0; i < num_cpu; i++, row += LPROCFS_HIST_MAX)
+                for (j = 0; j < LPROCFS_HIST_MAX; j++)
+                        hist[j] += row[j];
+        lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU);
+}
+EXPORT_SYMBOL(lprocfs_stats_collect_hist);
+
 /**
  * Append a space separated list of current set flags to str.
  */
@@ -1185,30 +1213,27 @@ struct lprocfs_stats *lprocfs_alloc_stats(unsigned int num,
         if (num == 0)
                 return NULL;
 
-        if (flags & LPROCFS_STATS_FLAG_NOPERCPU)
-                num_cpu = 1;
-        else
-                num_cpu = cfs_num_possible_cpus();
+        num_cpu = lprocfs_stats_num_areas(flags);
 
         OBD_ALLOC(stats, offsetof(typeof(*stats), ls_percpu[num_cpu]));
         if (stats == NULL)
                 return NULL;
 
-        if (flags & LPROCFS_STATS_FLAG_NOPERCPU) {
-                stats->ls_flags = flags;
-                cfs_spin_lock_init(&stats->ls_lock);
-                /* Use this lock only if there are no percpu areas */
-        } else {
-                stats->ls_flags = 0;
-        }
+        stats->ls_flags = flags;
+        /* Use this lock only if there are no percpu areas */
+        cfs_spin_lock_init(&stats->ls_lock);
 
-        percpusize = offsetof(struct lprocfs_percpu, lp_cntr[num]);
-        if (num_cpu > 1)
-                percpusize = CFS_L1_CACHE_ALIGN(percpusize);
+        percpusize = lprocfs_stats_percpu_size(num, num_cpu);
 
-        for (i = 0; i < num_cpu; i++) {
-                OBD_ALLOC(stats->ls_percpu[i], percpusize);
-                if (stats->ls_percpu[i] == NULL) {
+        if (flags & LPROCFS_STATS_FLAG_LAZY) {
+                /* the percpu areas are allocated on first update */
+                OBD_ALLOC(stats->ls_percpu[0],
+                          lprocfs_stats_percpu_size(num, 1));
+        } else {
+                for (i = 0; i < num_cpu; i++) {
+                        OBD_ALLOC(stats->ls_percpu[i], percpusize);
+                        if (stats->ls_percpu[i] != NULL)
+                                continue;
                         for (j = 0; j < i; j++) {
                                 OBD_FREE(stats->ls_percpu[j], percpusize);
                                 stats->ls_percpu[j] = NULL;
@@ -1230,23 +1255,26 @@ void lprocfs_free_stats(struct lprocfs_stats **statsh)
 {
         struct lprocfs_stats *stats = *statsh;
         unsigned int num_cpu;
-        unsigned int percpusize;
         unsigned int i;
+        __u32 *hist;
 
         if (stats == NULL || stats->ls_num == 0)
                 return;
         *statsh = NULL;
 
-        if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU)
-                num_cpu = 1;
-        else
-                num_cpu = cfs_num_possible_cpus();
+        num_cpu = lprocfs_stats_num_areas(stats->ls_flags);
+
+        for (i = 0; i < stats->ls_num; i++) {
+                hist = stats->ls_percpu[0]->lp_cntr[i].lc_hist;
+                if (hist != NULL)
+                        OBD_FREE(hist, num_cpu * LPROCFS_HIST_MAX *
+                                       sizeof(*hist));
+        }
 
-        percpusize = offsetof(struct lprocfs_percpu, lp_cntr[stats->ls_num]);
-        if (num_cpu > 1)
-                percpusize = CFS_L1_CACHE_ALIGN(percpusize);
         for (i = 0; i < num_cpu; i++)
-                OBD_FREE(stats->ls_percpu[i], percpusize);
+                if (stats->ls_percpu[i] != NULL)
+                        OBD_FREE(stats->ls_percpu[i],
+                                 lprocfs_stats_area_size(stats, i));
         OBD_FREE(stats, offsetof(typeof(*stats), ls_percpu[num_cpu]));
 }
 
@@ -1258,19 +1286,31 @@ void lprocfs_clear_stats(struct lprocfs_stats *stats)
 
         num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU);
 
+        /* counters are only written by their own cpu, an update racing
+         * with the clear may survive it, which does no harm */
         for (i = 0; i < num_cpu; i++) {
+                if (stats->ls_percpu[i] == NULL)
+                        continue;
                 for (j = 0; j < stats->ls_num; j++) {
                         percpu_cntr = &(stats->ls_percpu[i])->lp_cntr[j];
-                        cfs_atomic_inc(&percpu_cntr->lc_cntl.la_entry);
                         percpu_cntr->lc_count = 0;
                         percpu_cntr->lc_sum = 0;
                         percpu_cntr->lc_min = LC_MIN_INIT;
                         percpu_cntr->lc_max = 0;
                         percpu_cntr->lc_sumsquare = 0;
-                        cfs_atomic_inc(&percpu_cntr->lc_cntl.la_exit);
+                        /* let snapshots see the clear */
+                        percpu_cntr->lc_gen =
+                                cfs_atomic_read(&lprocfs_stats_gen);
                 }
         }
 
+        for (j = 0; j < stats->ls_num; j++) {
+                percpu_cntr = &(stats->ls_percpu[0])->lp_cntr[j];
+                if (percpu_cntr->lc_hist != NULL)
+                        memset(percpu_cntr->lc_hist, 0, num_cpu *
+                               LPROCFS_HIST_MAX * sizeof(__u32));
+        }
+
         lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU);
 }
 
@@ -1344,6 +1384,22 @@ static int lprocfs_stats_seq_show(struct seq_file *p, void *v)
                if (rc < 0)
                        goto out;
        }
+       if (cntr->lc_config & LPROCFS_CNTR_HISTOGRAM) {
+               __u64 hist[LPROCFS_HIST_MAX];
+               int i;
+
+               /* "hist <lower bound>:<samples> ..." for non-empty buckets */
+               lprocfs_stats_collect_hist(stats, idx, hist);
+               rc = seq_printf(p, " hist");
+               for (i = 0; i < LPROCFS_HIST_MAX && rc >= 0; i++) {
+                       if (hist[i] != 0)
+                               rc = seq_printf(p, " %lu:"LPU64,
+                                               i == 0 ? 0UL : 1UL << (i - 1),
+                                               hist[i]);
+               }
+               if (rc < 0)
+                       goto out;
+       }
        rc = seq_printf(p, "\n");
  out:
        return (rc < 0) ? rc : 0;
@@ -1405,18 +1461,201 @@ int lprocfs_register_stats(struct proc_dir_entry *root, const char *name,
         return 0;
 }
 
+/* largest snapshot buffer allocated by the kernel */
+#define OBD_STATS_MAX_LEN       (64 << 20)
+
+/* state of one OBD_IOC_STATS_SNAPSHOT */
+struct lprocfs_snapshot {
+        char                   *lss_buf;
+        __u32                   lss_size;       /* bytes of lss_buf */
+        __u32                   lss_len;        /* bytes of the snapshot */
+        __u32                   lss_since;
+        __u32                   lss_flags;
+        struct obd_stats_hdr   *lss_hdr;
+};
+
+/* the snapshot grows past lss_size so the caller learns the size needed */
+static void *lprocfs_snapshot_reserve(struct lprocfs_snapshot *snap,
+                                      __u32 len)
+{
+        void *ptr = NULL;
+
+        if (snap->lss_len + len <= snap->lss_size)
+                ptr = snap->lss_buf + snap->lss_len;
+        snap->lss_len += len;
+        return ptr;
+}
+
+static void lprocfs_snapshot_add(struct lprocfs_snapshot *snap, __u32 type,
+                                 const char *name, struct lprocfs_stats *stats)
+{
+        struct obd_stats_set    set;
+        struct obd_stats_set   *setp;
+        struct obd_stats_name  *osn;
+        struct obd_stats_rec   *osr;
+        struct lprocfs_counter *cntr;
+        struct lprocfs_counter  ret;
+        __u32                   start = snap->lss_len;
+        int                     i;
+
+        if (stats == NULL)
+                return;
+
+        memset(&set, 0, sizeof(set));
+        set.oss_type = type;
+        set.oss_num = stats->ls_num;
+        strncpy(set.oss_name, name, sizeof(set.oss_name) - 1);
+        setp = lprocfs_snapshot_reserve(snap, sizeof(set));
+
+        if (snap->lss_flags & OBD_STATS_FL_NAMES) {
+                set.oss_nnames = stats->ls_num;
+                for (i = 0; i < stats->ls_num; i++) {
+                        cntr = &stats->ls_percpu[0]->lp_cntr[i];
+                        osn = lprocfs_snapshot_reserve(snap, sizeof(*osn));
+                        if (osn == NULL)
+                                continue;
+                        if (cntr->lc_name != NULL)
+                                strncpy(osn->osn_name, cntr->lc_name,
+                                        sizeof(osn->osn_name) - 1);
+                        if (cntr->lc_units != NULL)
+                                strncpy(osn->osn_units, cntr->lc_units,
+                                        sizeof(osn->osn_units) - 1);
+                }
+        }
+
+        for (i = 0; i < stats->ls_num; i++) {
+                lprocfs_stats_collect(stats, i, &ret);
+                /* an update racing with the previous snapshot may carry
+                 * the generation before it */
+                if (snap->lss_since == 0 ? ret.lc_count == 0 :
+                    ret.lc_gen + 1 < snap->lss_since)
+                        continue;
+
+                set.oss_nrecs++;
+                osr = lprocfs_snapshot_reserve(snap, sizeof(*osr));
+                if (osr == NULL)
+                        continue;
+                osr->osr_idx = i;
+                osr->osr_config = stats->ls_percpu[0]->lp_cntr[i].lc_config;
+                osr->osr_count = ret.lc_count;
+                osr->osr_sum = ret.lc_sum;
+                osr->osr_min = ret.lc_min;
+                osr->osr_max = ret.lc_max;
+                osr->osr_sumsquare = ret.lc_sumsquare;
+        }
+
+        /* leave out sets with nothing to report */
+        if (set.oss_nnames == 0 && set.oss_nrecs == 0) {
+                snap->lss_len = start;
+                return;
+        }
+
+        if (setp != NULL)
+                memcpy(setp, &set, sizeof(set));
+        snap->lss_hdr->osh_nsets++;
+        snap->lss_hdr->osh_nrecs += set.oss_nrecs;
+}
+
+static int lprocfs_snapshot_nid_cb(cfs_hash_t *hs, cfs_hash_bd_t *bd,
+                                   cfs_hlist_node_t *hnode, void *data)
+{
+        struct nid_stat         *stat = cfs_hash_object(hs, hnode);
+        struct lprocfs_snapshot *snap = data;
+
+        lprocfs_snapshot_add(snap, OBD_STATS_SET_EXP,
+                             libcfs_nid2str(stat->nid), stat->nid_stats);
+        lprocfs_snapshot_add(snap, OBD_STATS_SET_EXP_LDLM,
+                             libcfs_nid2str(stat->nid), stat->nid_ldlm_stats);
+        return 0;
+}
+
+/**
+ * Copy the counters of all stats of \a obd to the user buffer ioc_pbuf1 in
+ * one binary snapshot, see struct obd_stats_hdr.  ioc_count is the "since"
+ * generation, ioc_type the OBD_STATS_FL_* flags.  A short buffer gets the
+ * beginning of the snapshot, with OBD_STATS_FL_TRUNC set and the size
+ * needed in osh_len.
+ */
+int lprocfs_stats_snapshot(struct obd_device *obd,
+                           struct obd_ioctl_data *data)
+{
+        struct lprocfs_snapshot snap;
+        struct obd_stats_hdr   *hdr;
+        struct timeval          now;
+        int                     rc = 0;
+        ENTRY;
+
+        if (data->ioc_pbuf1 == NULL ||
+            data->ioc_plen1 < sizeof(struct obd_stats_hdr))
+                RETURN(-EINVAL);
+
+        memset(&snap, 0, sizeof(snap));
+        snap.lss_size = min_t(__u32, data->ioc_plen1, OBD_STATS_MAX_LEN);
+        snap.lss_since = data->ioc_count;
+        snap.lss_flags = data->ioc_type & OBD_STATS_FL_NAMES;
+        OBD_ALLOC_LARGE(snap.lss_buf, snap.lss_size);
+        if (snap.lss_buf == NULL)
+                RETURN(-ENOMEM);
+
+        hdr = lprocfs_snapshot_reserve(&snap, sizeof(*hdr));
+        snap.lss_hdr = hdr;
+        hdr->osh_magic = OBD_STATS_MAGIC;
+        hdr->osh_version = OBD_STATS_VERSION;
+        cfs_gettimeofday(&now);
+        hdr->osh_time = (__u64)now.tv_sec * 1000000 + now.tv_usec;
+        /* counters updated from now on carry the new generation */
+        hdr->osh_gen = cfs_atomic_inc_return(&lprocfs_stats_gen);
+
+        lprocfs_snapshot_add(&snap, OBD_STATS_SET_OBD, "stats",
+                             obd->obd_stats);
+        lprocfs_snapshot_add(&snap, OBD_STATS_SET_MD, "md_stats",
+                             obd->md_stats);
+        lprocfs_snapshot_add(&snap, OBD_STATS_SET_SVC, "svc_stats",
+                             obd->obd_svc_stats);
+        if (obd->obd_nid_stats_hash != NULL)
+                cfs_hash_for_each(obd->obd_nid_stats_hash,
+                                  lprocfs_snapshot_nid_cb, &snap);
+
+        hdr->osh_len = snap.lss_len;
+        if (snap.lss_len > snap.lss_size)
+                hdr->osh_flags |= OBD_STATS_FL_TRUNC;
+
+        if (cfs_copy_to_user(data->ioc_pbuf1, snap.lss_buf,
+                             min(snap.lss_len, snap.lss_size)))
+                rc = -EFAULT;
+
+        OBD_FREE_LARGE(snap.lss_buf, snap.lss_size);
+        RETURN(rc);
+}
+EXPORT_SYMBOL(lprocfs_stats_snapshot);
+
 void lprocfs_counter_init(struct lprocfs_stats *stats, int index,
                           unsigned conf, const char *name, const char *units)
 {
         struct lprocfs_counter *c;
         int i;
         unsigned int num_cpu;
+        __u32 *hist = NULL;
 
         LASSERT(stats != NULL);
 
+        /* one row of buckets per cpu area, shared by all areas */
+        if ((conf & LPROCFS_CNTR_HISTOGRAM) &&
+            stats->ls_percpu[0]->lp_cntr[index].lc_hist == NULL) {
+                LASSERT(conf & LPROCFS_CNTR_AVGMINMAX);
+                num_cpu = lprocfs_stats_num_areas(stats->ls_flags);
+                OBD_ALLOC(hist, num_cpu * LPROCFS_HIST_MAX * sizeof(*hist));
+                /* without buckets it is still a valid counter */
+                if (hist == NULL)
+                        conf &= ~LPROCFS_CNTR_HISTOGRAM;
+        }
+
         num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU);
 
         for (i = 0; i < num_cpu; i++) {
+                /* the areas of LAZY stats copy area 0 when allocated */
+                if (stats->ls_percpu[i] == NULL)
+                        continue;
                 c = &(stats->ls_percpu[i]->lp_cntr[index]);
                 c->lc_config = conf;
                 c->lc_count = 0;
@@ -1425,6 +1664,8 @@ void lprocfs_counter_init(struct lprocfs_stats *stats, int index,
                 c->lc_max = 0;
                 c->lc_name = name;
                 c->lc_units = units;
+                if (hist != NULL)
+                        c->lc_hist = hist;
         }
 
         lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU);
@@ -1473,6 +1714,7 @@ void lprocfs_init_ops_stats(int num_private_stats, struct lprocfs_stats *stats)
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, getattr);
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, getattr_async);
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, brw);
+        LPROCFS_OBD_OP_INIT(num_private_stats, stats, brw_async);
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, merge_lvb);
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, adjust_kms);
         LPROCFS_OBD_OP_INIT(num_private_stats, stats, punch);
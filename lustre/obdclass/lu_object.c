@@ -66,6 +66,14 @@
 
 static void lu_object_free(const struct lu_env *env, struct lu_object *o);
 
+/**
+ * Share of lu_site::ls_cache_max of one hash bucket.
+ */
+static inline long lu_site_bkt_max(const struct lu_site *s)
+{
+        return s->ls_cache_max / CFS_HASH_NBKT(s->ls_obj_hash) + 1;
+}
+
 /**
  * Decrease reference counter on object. If last reference is freed, return
  * object to the cache, unless lu_object_is_dying(o) holds. In the latter
@@ -110,6 +118,13 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
         }
 
         if (!lu_object_is_dying(top)) {
+                /* back to the hot end of the LRU, see lu_obj_hop_get() */
+                LASSERT(cfs_list_empty(&top->loh_lru));
+                cfs_list_add_tail(&top->loh_lru, &bkt->lsb_lru);
+                bkt->lsb_lru_len++;
+                if (site->ls_cache_max != 0 &&
+                    bkt->lsb_lru_len > lu_site_bkt_max(site))
+                        cfs_wi_schedule(&site->ls_purge_wi);
                 cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
                 return;
         }
@@ -249,22 +264,76 @@ static void lu_object_free(const struct lu_env *env, struct lu_object *o)
 }
 
 /**
- * Free \a nr objects from the cold end of the site LRU list.
+ * Move up to \a nr (all if negative) objects from the cold end of the LRU of
+ * bucket \a bd, locked by the caller, to \a dispose, removing them from the
+ * hash table. Returns the number of objects moved.
  */
-int lu_site_purge(const struct lu_env *env, struct lu_site *s, int nr)
+static int lu_site_bkt_purge(struct lu_site *s, cfs_hash_bd_t *bd, int nr,
+                             cfs_list_t *dispose)
 {
+        struct lu_site_bkt_data *bkt;
         struct lu_object_header *h;
         struct lu_object_header *temp;
-        struct lu_site_bkt_data *bkt;
-        cfs_hash_bd_t            bd;
         cfs_hash_bd_t            bd2;
+        int                      count = 0;
+
+        bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, bd);
+        cfs_list_for_each_entry_safe(h, temp, &bkt->lsb_lru, loh_lru) {
+                if (count == nr)
+                        break;
+                /*
+                 * Objects leave the LRU on their first reference, see
+                 * lu_obj_hop_get(), this only guards against a reference
+                 * taken without the hash.
+                 */
+                if (cfs_atomic_read(&h->loh_ref) > 0)
+                        continue;
+
+                cfs_hash_bd_get(s->ls_obj_hash, &h->loh_fid, &bd2);
+                LASSERT(bd->bd_bucket == bd2.bd_bucket);
+
+                cfs_hash_bd_del_locked(s->ls_obj_hash, &bd2, &h->loh_hash);
+                cfs_list_move(&h->loh_lru, dispose);
+                bkt->lsb_lru_len--;
+                count++;
+        }
+        return count;
+}
+
+/**
+ * Free everything on the \a dispose list. This is safe against races due to
+ * the reasons described in lu_object_put().
+ */
+static void lu_site_dispose(const struct lu_env *env, struct lu_site *s,
+                            cfs_list_t *dispose)
+{
+        struct lu_object_header *h;
+
+        while (!cfs_list_empty(dispose)) {
+                h = container_of0(dispose->next,
+                                  struct lu_object_header, loh_lru);
+                cfs_list_del_init(&h->loh_lru);
+                lu_object_free(env, lu_object_top(h));
+                lprocfs_counter_incr(s->ls_stats, LU_SS_LRU_PURGED);
+        }
+}
+
+/**
+ * Free \a nr objects from the cold end of the site LRU list.
+ */
+int lu_site_purge(const struct lu_env *env, struct lu_site *s, int nr)
+{
+        cfs_hash_bd_t            bd;
         cfs_list_t               dispose;
+        struct timeval           start_time;
+        struct timeval           end_time;
         int                      did_sth;
         int                      start;
         int                      count;
         int                      bnr;
         int                      i;
 
+        cfs_gettimeofday(&start_time);
         CFS_INIT_LIST_HEAD(&dispose);
         /*
          * Under LRU list lock, scan LRU list and move unreferenced objects to
@@ -277,56 +346,18 @@ int lu_site_purge(const struct lu_env *env, struct lu_site *s, int nr)
         cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
                 if (i < start)
                         continue;
-                count = bnr;
                 cfs_hash_bd_lock(s->ls_obj_hash, &bd, 1);
-                bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
-
-                cfs_list_for_each_entry_safe(h, temp, &bkt->lsb_lru, loh_lru) {
-                        /*
-                         * Objects are sorted in lru order, and "busy"
-                         * objects (ones with h->loh_ref > 0) naturally tend to
-                         * live near hot end that we scan last. Unfortunately,
-                         * sites usually have small (less then ten) number of
-                         * busy yet rarely accessed objects (some global
-                         * objects, accessed directly through pointers,
-                         * bypassing hash table).
-                         * Currently algorithm scans them over and over again.
-                         * Probably we should move busy objects out of LRU,
-                         * or we can live with that.
-                         */
-                        if (cfs_atomic_read(&h->loh_ref) > 0)
-                                continue;
-
-                        cfs_hash_bd_get(s->ls_obj_hash, &h->loh_fid, &bd2);
-                        LASSERT(bd.bd_bucket == bd2.bd_bucket);
-
-                        cfs_hash_bd_del_locked(s->ls_obj_hash,
-                                               &bd2, &h->loh_hash);
-                        cfs_list_move(&h->loh_lru, &dispose);
-                        if (did_sth == 0)
-                                did_sth = 1;
-
-                        if (nr != ~0 && --nr == 0)
-                                break;
-
-                        if (count > 0 && --count == 0)
-                                break;
-
-                }
+                count = lu_site_bkt_purge(s, &bd, nr == ~0 ? -1 :
+                                          min(nr, bnr), &dispose);
                 cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
                 cfs_cond_resched();
-                /*
-                 * Free everything on the dispose list. This is safe against
-                 * races due to the reasons described in lu_object_put().
-                 */
-                while (!cfs_list_empty(&dispose)) {
-                        h = container_of0(dispose.next,
-                                          struct lu_object_header, loh_lru);
-                        cfs_list_del_init(&h->loh_lru);
-                        lu_object_free(env, lu_object_top(h));
-                        lprocfs_counter_incr(s->ls_stats, LU_SS_LRU_PURGED);
-                }
+                lu_site_dispose(env, s, &dispose);
 
+                if (count > 0) {
+                        did_sth = 1;
+                        if (nr != ~0)
+                                nr -= count;
+                }
                 if (nr == 0)
                         break;
         }
@@ -338,6 +369,9 @@ int lu_site_purge(const struct lu_env *env, struct lu_site *s, int nr)
         /* race on s->ls_purge_start, but nobody cares */
         s->ls_purge_start = i % CFS_HASH_NBKT(s->ls_obj_hash);
 
+        cfs_gettimeofday(&end_time);
+        lprocfs_counter_add(s->ls_stats, LU_SS_PURGE_TIME,
+                            cfs_timeval_sub(&end_time, &start_time, NULL));
         return nr;
 }
 EXPORT_SYMBOL(lu_site_purge);
@@ -599,9 +633,9 @@ static struct lu_object *lu_object_find_try(const struct lu_env *env,
         if (likely(shadow == NULL)) {
                 struct lu_site_bkt_data *bkt;
 
+                /* referenced, it goes to the LRU in lu_object_put() */
                 bkt = cfs_hash_bd_extra_get(hs, &bd);
                 cfs_hash_bd_add_locked(hs, &bd, &o->lo_header->loh_hash);
-                cfs_list_add_tail(&o->lo_header->loh_lru, &bkt->lsb_lru);
                 bkt->lsb_busy++;
                 cfs_hash_bd_unlock(hs, &bd, 1);
                 return o;
@@ -757,19 +791,22 @@ enum {
         LU_CACHE_PERCENT   = 20,
 };
 
+static unsigned int lu_cache_percent = LU_CACHE_PERCENT;
+CFS_MODULE_PARM(lu_cache_percent, "i", uint, 0644,
+                "Percentage of memory to be used as lu_object cache");
+
 /**
- * Return desired hash table order.
+ * Return the number of objects fitting in lu_cache_percent of memory.
  */
-static int lu_htable_order(void)
+static unsigned long lu_cache_objects(void)
 {
         unsigned long cache_size;
-        int bits;
+        unsigned int  percent = lu_cache_percent;
+
+        if (percent == 0 || percent > 100)
+                percent = LU_CACHE_PERCENT;
 
         /*
-         * Calculate hash table size, assuming that we want reasonable
-         * performance when 20% of total memory is occupied by cache of
-         * lu_objects.
-         *
          * Size of lu_object is (arbitrary) taken as 1K (together with inode).
          */
         cache_size = cfs_num_physpages;
@@ -780,8 +817,23 @@ static int lu_htable_order(void)
                 cache_size = 1 << (30 - CFS_PAGE_SHIFT) * 3 / 4;
 #endif
 
-        cache_size = cache_size / 100 * LU_CACHE_PERCENT *
-                (CFS_PAGE_SIZE / 1024);
+        return cache_size / 100 * percent * (CFS_PAGE_SIZE / 1024);
+}
+
+/**
+ * Return desired hash table order.
+ */
+static int lu_htable_order(void)
+{
+        unsigned long cache_size;
+        int bits;
+
+        /*
+         * Calculate hash table size, assuming that we want reasonable
+         * performance when lu_cache_percent of total memory is occupied by
+         * cache of lu_objects.
+         */
+        cache_size = lu_cache_objects();
 
         for (bits = 1; (1 << bits) < cache_size; ++bits) {
                 ;
@@ -789,6 +841,102 @@ static int lu_htable_order(void)
         return bits;
 }
 
+/**
+ * Total length of the LRU lists of \a s, read without bucket locks.
+ */
+static unsigned long lu_site_lru_len(const struct lu_site *s)
+{
+        struct lu_site_bkt_data *bkt;
+        cfs_hash_bd_t            bd;
+        unsigned long            len = 0;
+        int                      i;
+
+        cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
+                bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+                len += bkt->lsb_lru_len;
+        }
+        return len;
+}
+
+/**
+ * Workitem purging the buckets of a site which have more unreferenced
+ * objects than their share of lu_site::ls_cache_max, scheduled by
+ * lu_object_put(). This frees the cold objects early, before the memory
+ * pressure makes the shrinker stall the threads reclaiming memory, and out
+ * of the context of the thread releasing the object.
+ */
+static int lu_site_purge_wi(cfs_workitem_t *wi)
+{
+        struct lu_site          *s = wi->wi_data;
+        struct lu_site_bkt_data *bkt;
+        struct lu_env            env;
+        cfs_hash_bd_t            bd;
+        cfs_list_t               dispose;
+        struct timeval           start_time;
+        struct timeval           end_time;
+        long                     max;
+        int                      i;
+
+        if (lu_env_init(&env, LCT_SHRINKER) != 0)
+                return 0;
+
+        cfs_gettimeofday(&start_time);
+        CFS_INIT_LIST_HEAD(&dispose);
+        cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
+                bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+                cfs_hash_bd_lock(s->ls_obj_hash, &bd, 1);
+                if (s->ls_cache_max == 0) {
+                        /* limit lifted or site stopping */
+                        cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
+                        break;
+                }
+                /* down to 7/8 of the share, not to be rescheduled at once */
+                max = lu_site_bkt_max(s);
+                if (bkt->lsb_lru_len > max)
+                        lu_site_bkt_purge(s, &bd, bkt->lsb_lru_len - max +
+                                          max / 8, &dispose);
+                cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
+                lu_site_dispose(&env, s, &dispose);
+                cfs_cond_resched();
+        }
+        cfs_gettimeofday(&end_time);
+        lprocfs_counter_add(s->ls_stats, LU_SS_PURGE_TIME,
+                            cfs_timeval_sub(&end_time, &start_time, NULL));
+
+        lu_env_fini(&env);
+        return 0;
+}
+
+/**
+ * Set the maximal number of unreferenced objects cached by \a s, 0 for no
+ * limit.
+ */
+void lu_site_cache_max_set(struct lu_site *s, unsigned long max)
+{
+        s->ls_cache_max = max;
+        if (max != 0)
+                cfs_wi_schedule(&s->ls_purge_wi);
+}
+EXPORT_SYMBOL(lu_site_cache_max_set);
+
+/**
+ * Stop the early purge of \a s, waiting for it to complete if it runs.
+ */
+static void lu_site_purge_stop(struct lu_site *s)
+{
+        cfs_hash_bd_t bd;
+        int           i;
+
+        s->ls_cache_max = 0;
+        /* lu_object_put() schedules the purge under the bucket lock */
+        cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
+                cfs_hash_bd_lock(s->ls_obj_hash, &bd, 1);
+                cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
+        }
+        while (!cfs_wi_cancel(&s->ls_purge_wi))
+                cfs_schedule_timeout_and_set_state(CFS_TASK_UNINT, 1);
+}
+
 static unsigned lu_obj_hop_hash(cfs_hash_t *hs,
                                 const void *key, unsigned mask)
 {
@@ -821,6 +969,12 @@ static int lu_obj_hop_keycmp(const void *key, cfs_hlist_node_t *hnode)
         return lu_fid_eq(&h->loh_fid, (struct lu_fid *)key);
 }
 
+/*
+ * Called with the bucket locked by every way of taking a reference through
+ * the hash: htable_lookup(), but also iterations like the ones of
+ * vvp_pgcache_obj_get().  The LRU only has unreferenced objects, so the first
+ * reference takes the object off it, lu_object_put() puts it back.
+ */
 static void lu_obj_hop_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
 {
         struct lu_object_header *h;
@@ -833,6 +987,10 @@ static void lu_obj_hop_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
                 cfs_hash_bd_get(hs, &h->loh_fid, &bd);
                 bkt = cfs_hash_bd_extra_get(hs, &bd);
                 bkt->lsb_busy++;
+                if (!cfs_list_empty(&h->loh_lru)) {
+                        cfs_list_del_init(&h->loh_lru);
+                        bkt->lsb_lru_len--;
+                }
         }
 }
 
@@ -896,6 +1054,10 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
                 CFS_INIT_LIST_HEAD(&bkt->lsb_lru);
                 cfs_waitq_init(&bkt->lsb_marche_funebre);
         }
+        s->ls_cache_max = lu_cache_objects();
+        /* freeing objects may block, keep it off the shared schedulers */
+        cfs_wi_init(&s->ls_purge_wi, s, lu_site_purge_wi,
+                    CFS_WI_SCHED_SERIAL);
 
         s->ls_stats = lprocfs_alloc_stats(LU_SS_LAST_STAT, 0);
         if (s->ls_stats == NULL) {
@@ -916,6 +1078,9 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
                              0, "cache_death_race", "cache_death_race");
         lprocfs_counter_init(s->ls_stats, LU_SS_LRU_PURGED,
                              0, "lru_purged", "lru_purged");
+        lprocfs_counter_init(s->ls_stats, LU_SS_PURGE_TIME,
+                             LPROCFS_CNTR_AVGMINMAX | LPROCFS_CNTR_HISTOGRAM,
+                             "purge_time", "usec");
 
         CFS_INIT_LIST_HEAD(&s->ls_linkage);
         s->ls_top_dev = top;
@@ -937,6 +1102,7 @@ void lu_site_fini(struct lu_site *s)
         cfs_up(&lu_sites_guard);
 
         if (s->ls_obj_hash != NULL) {
+                lu_site_purge_stop(s);
                 cfs_hash_putref(s->ls_obj_hash);
                 s->ls_obj_hash = NULL;
         }
@@ -1142,6 +1308,8 @@ void lu_stack_fini(const struct lu_env *env, struct lu_device *top)
         struct lu_device *scan;
         struct lu_device *next;
 
+        /* no background purge while the devices go away */
+        lu_site_purge_stop(site);
         lu_site_purge(env, site, ~0);
         for (scan = top; scan != NULL; scan = next) {
                 next = scan->ld_type->ldt_ops->ldto_device_fini(env, scan);
@@ -1630,7 +1798,6 @@ static void lu_site_stats_get(cfs_hash_t *hs,
 static int lu_cache_shrink(SHRINKER_FIRST_ARG int nr_to_scan,
                            unsigned int gfp_mask)
 {
-        lu_site_stats_t stats;
         struct lu_site *s;
         struct lu_site *tmp;
         int cached = 0;
@@ -1643,7 +1810,12 @@ static int lu_cache_shrink(SHRINKER_FIRST_ARG int nr_to_scan,
                 CDEBUG(D_INODE, "Shrink %d objects\n", nr_to_scan);
         }
 
-        cfs_down(&lu_sites_guard);
+        /*
+         * Don't make the threads reclaiming memory wait for the one already
+         * shrinking the sites, nor for a site being set up or cleaned up.
+         */
+        if (cfs_mutex_down_trylock(&lu_sites_guard) != 0)
+                return nr_to_scan != 0 ? -1 : 0;
         cfs_list_for_each_entry_safe(s, tmp, &lu_sites, ls_linkage) {
                 if (nr_to_scan != 0) {
                         remain = lu_site_purge(&lu_shrink_env, s, remain);
@@ -1654,9 +1826,7 @@ static int lu_cache_shrink(SHRINKER_FIRST_ARG int nr_to_scan,
                         cfs_list_move_tail(&s->ls_linkage, &splice);
                 }
 
-                memset(&stats, 0, sizeof(stats));
-                lu_site_stats_get(s->ls_obj_hash, &stats, 0);
-                cached += stats.lss_total - stats.lss_busy;
+                cached += lu_site_lru_len(s);
                 if (nr_to_scan && remain <= 0)
                         break;
         }
@@ -1864,6 +2034,40 @@ int lu_site_stats_print(const struct lu_site *s, char *page, int count)
 }
 EXPORT_SYMBOL(lu_site_stats_print);
 
+/**
+ * Output the state of the object cache of a site into a buffer: the limit
+ * and number of unreferenced objects cached, the hit ratio of lookups and
+ * the time spent purging. Suitable for lprocfs_rd_*()-style functions.
+ */
+int lu_site_cache_print(const struct lu_site *s, char *page, int count)
+{
+        struct lprocfs_counter purge;
+        __u64                  hit;
+        __u32                  lookups;
+
+        memset(&purge, 0, sizeof(purge));
+#ifdef LPROCFS
+        lprocfs_stats_collect(s->ls_stats, LU_SS_PURGE_TIME, &purge);
+#endif
+        hit = ls_stats_read(s->ls_stats, LU_SS_CACHE_HIT);
+        lookups = hit + ls_stats_read(s->ls_stats, LU_SS_CACHE_MISS);
+        if (lookups != 0) {
+                hit *= 100;
+                do_div(hit, lookups);
+        }
+
+        return snprintf(page, count,
+                        "cache_max: %lu\n"
+                        "cache_lru: %lu\n"
+                        "hit_ratio: "LPU64"%%\n"
+                        "purge_time: "LPD64" samples [usec] "LPD64" "LPD64
+                        " "LPD64"\n",
+                        s->ls_cache_max, lu_site_lru_len(s), hit,
+                        purge.lc_count, purge.lc_min, purge.lc_max,
+                        purge.lc_sum);
+}
+EXPORT_SYMBOL(lu_site_cache_print);
+
 const char *lu_time_names[LU_TIME_NR] = {
         [LU_TIME_FIND_LOOKUP] = "find_lookup",
         [LU_TIME_FIND_ALLOC]  = "find_alloc",
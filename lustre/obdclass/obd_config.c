@@ -448,7 +448,8 @@ int class_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
                                              HASH_UUID_BKT_BITS, 0,
                                              CFS_HASH_MIN_THETA,
                                              CFS_HASH_MAX_THETA,
-                                             &uuid_hash_ops, CFS_HASH_DEFAULT);
+                                             &uuid_hash_ops, CFS_HASH_DEFAULT |
+                                             CFS_HASH_RCU_LOOKUP);
         if (!obd->obd_uuid_hash)
                 GOTO(err_hash, err = -ENOMEM);
 
@@ -459,7 +460,8 @@ int class_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
                                             HASH_NID_BKT_BITS, 0,
                                             CFS_HASH_MIN_THETA,
                                             CFS_HASH_MAX_THETA,
-                                            &nid_hash_ops, CFS_HASH_DEFAULT);
+                                            &nid_hash_ops, CFS_HASH_DEFAULT |
+                                            CFS_HASH_RCU_LOOKUP);
         if (!obd->obd_nid_hash)
                 GOTO(err_hash, err = -ENOMEM);
 
@@ -1585,6 +1587,16 @@ uuid_export_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
         class_export_get(exp);
 }
 
+/* exports are freed after a grace period, see class_export_destroy() */
+static int
+uuid_export_get_rcu(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        struct obd_export *exp;
+
+        exp = cfs_hlist_entry(hnode, struct obd_export, exp_uuid_hash);
+        return cfs_atomic_inc_not_zero(&exp->exp_refcount);
+}
+
 static void
 uuid_export_put_locked(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
 {
@@ -1600,6 +1612,7 @@ static cfs_hash_ops_t uuid_hash_ops = {
         .hs_keycmp      = uuid_keycmp,
         .hs_object      = uuid_export_object,
         .hs_get         = uuid_export_get,
+        .hs_get_rcu     = uuid_export_get_rcu,
         .hs_put_locked  = uuid_export_put_locked,
 };
 
@@ -1655,6 +1668,16 @@ nid_export_get(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
         class_export_get(exp);
 }
 
+/* exports are freed after a grace period, see class_export_destroy() */
+static int
+nid_export_get_rcu(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
+{
+        struct obd_export *exp;
+
+        exp = cfs_hlist_entry(hnode, struct obd_export, exp_nid_hash);
+        return cfs_atomic_inc_not_zero(&exp->exp_refcount);
+}
+
 static void
 nid_export_put_locked(cfs_hash_t *hs, cfs_hlist_node_t *hnode)
 {
@@ -1670,6 +1693,7 @@ static cfs_hash_ops_t nid_hash_ops = {
         .hs_keycmp      = nid_kepcmp,
         .hs_object      = nid_export_object,
         .hs_get         = nid_export_get,
+        .hs_get_rcu     = nid_export_get_rcu,
         .hs_put_locked  = nid_export_put_locked,
 };
 
@@ -0,0 +1,306 @@
+/* -*- mode: c; c-basic-offset: 8; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.sun.com/software/products/lustre/docs/GPLv2.pdf
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa Clara,
+ * CA 95054 USA or visit www.sun.com if you need additional information or
+ * have any questions.
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/obdclass/stats_bench.c
+ *
+ * Cost of lprocfs stats on the RPC path.  Loading the module runs
+ * sb_threads threads, each "handling" sb_rpcs RPCs the way a service
+ * thread accounts them: wait time, queue depth and active requests in the
+ * service stats and one op in the export stats of one of sb_exports
+ * exports.  Every kind of stats is measured in turn and the cost per RPC
+ * and the memory of the export stats, before and after the run, are
+ * printed to the console.  The first run updates the service counters
+ * the way they were updated before lc_seq, bracketed by the lc_cntl
+ * entry/exit atomics, as the reference for the others, e.g.
+ *
+ *   modprobe obd_stats_bench sb_threads=8
+ */
+
+#ifndef EXPORT_SYMTAB
+# define EXPORT_SYMTAB
+#endif
+#define DEBUG_SUBSYSTEM S_CLASS
+
+#include <linux/module.h>
+#include <linux/init.h>
+
+#include <obd_class.h>
+#include <lprocfs_status.h>
+
+static int sb_threads = 4;
+CFS_MODULE_PARM(sb_threads, "i", int, 0444, "# of service threads");
+
+static int sb_rpcs = 1000000;
+CFS_MODULE_PARM(sb_rpcs, "i", int, 0444, "# of RPCs per thread");
+
+static int sb_exports = 64;
+CFS_MODULE_PARM(sb_exports, "i", int, 0444, "# of exports");
+
+enum {
+        SB_REQWAIT = 0,
+        SB_QDEPTH,
+        SB_ACTIVE,
+        SB_SVC_LAST
+};
+
+#define SB_EXP_OPS      16
+
+/* a service counter updated with the old lc_cntl entry/exit atomics */
+struct sb_cntl_counter {
+        cfs_atomic_t            sc_entry;
+        __s64                   sc_count;
+        __s64                   sc_sum;
+        __s64                   sc_min;
+        __s64                   sc_max;
+        cfs_atomic_t            sc_exit;
+};
+
+/* per-cpu areas of SB_SVC_LAST sb_cntl_counters */
+#define SB_CNTL_AREA_SIZE                                               \
+        CFS_L1_CACHE_ALIGN(SB_SVC_LAST * sizeof(struct sb_cntl_counter))
+
+struct sb_run {
+        char                   *sr_cntl;     /* NULL: use sr_svc_stats */
+        struct lprocfs_stats   *sr_svc_stats;
+        struct lprocfs_stats  **sr_exp_stats;
+        cfs_atomic_t            sr_ready;
+        cfs_atomic_t            sr_done;
+        cfs_waitq_t             sr_waitq;
+        int                     sr_go;
+};
+
+static void
+sb_cntl_add(struct sb_run *run, int idx, long amount)
+{
+        struct sb_cntl_counter *cntr;
+
+        cntr = (struct sb_cntl_counter *)(run->sr_cntl +
+                                          cfs_get_cpu() * SB_CNTL_AREA_SIZE);
+        cntr += idx;
+        cfs_atomic_inc(&cntr->sc_entry);
+        cntr->sc_count++;
+        cntr->sc_sum += amount;
+        if (amount < cntr->sc_min)
+                cntr->sc_min = amount;
+        if (amount > cntr->sc_max)
+                cntr->sc_max = amount;
+        cfs_atomic_inc(&cntr->sc_exit);
+        cfs_put_cpu();
+}
+
+static void
+sb_svc_add(struct sb_run *run, int idx, long amount)
+{
+        if (run->sr_cntl != NULL)
+                sb_cntl_add(run, idx, amount);
+        else
+                lprocfs_counter_add(run->sr_svc_stats, idx, amount);
+}
+
+static int
+sb_thread(void *arg)
+{
+        struct sb_run  *run = arg;
+        __u64           seed;
+        int             i;
+
+        cfs_atomic_inc(&run->sr_ready);
+        cfs_wait_event(run->sr_waitq, run->sr_go);
+
+        seed = cfs_rand();
+        for (i = 0; i < sb_rpcs; i++) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                sb_svc_add(run, SB_REQWAIT, (seed >> 32) & 0xffff);
+                sb_svc_add(run, SB_QDEPTH, i & 0xff);
+                sb_svc_add(run, SB_ACTIVE, 1);
+                lprocfs_counter_incr(run->sr_exp_stats[(__u32)(seed >> 40) %
+                                                       sb_exports],
+                                     (seed >> 20) % SB_EXP_OPS);
+        }
+
+        if (cfs_atomic_dec_and_test(&run->sr_done))
+                cfs_waitq_signal(&run->sr_waitq);
+        return 0;
+}
+
+/* bytes allocated for \a stats */
+static __u64
+sb_stats_size(struct lprocfs_stats *stats)
+{
+        unsigned int    num = lprocfs_stats_num_areas(stats->ls_flags);
+        __u64           size = offsetof(typeof(*stats), ls_percpu[num]);
+        unsigned int    i;
+
+        for (i = 0; i < num; i++)
+                if (stats->ls_percpu[i] != NULL)
+                        size += lprocfs_stats_area_size(stats, i);
+        return size;
+}
+
+static int
+sb_run_mode(const char *name, int cntl, enum lprocfs_stats_flags svc_flags,
+            unsigned svc_conf, enum lprocfs_stats_flags exp_flags)
+{
+        struct sb_run           run;
+        cfs_task_t             *task;
+        struct timeval          start;
+        struct timeval          end;
+        __u64                   usec;
+        __u64                   idle = 0;
+        __u64                   busy = 0;
+        int                     i;
+        int                     j;
+        int                     rc = 0;
+
+        memset(&run, 0, sizeof(run));
+        cfs_waitq_init(&run.sr_waitq);
+        cfs_atomic_set(&run.sr_done, sb_threads);
+
+        OBD_ALLOC(run.sr_exp_stats, sb_exports * sizeof(*run.sr_exp_stats));
+        if (run.sr_exp_stats == NULL)
+                return -ENOMEM;
+
+        if (cntl) {
+                OBD_ALLOC(run.sr_cntl,
+                          cfs_num_possible_cpus() * SB_CNTL_AREA_SIZE);
+                if (run.sr_cntl == NULL)
+                        GOTO(out, rc = -ENOMEM);
+                for (i = 0; i < cfs_num_possible_cpus(); i++)
+                        for (j = 0; j < SB_SVC_LAST; j++)
+                                ((struct sb_cntl_counter *)(run.sr_cntl +
+                                 i * SB_CNTL_AREA_SIZE))[j].sc_min =
+                                        LC_MIN_INIT;
+        }
+
+        run.sr_svc_stats = lprocfs_alloc_stats(SB_SVC_LAST, svc_flags);
+        if (run.sr_svc_stats == NULL)
+                GOTO(out, rc = -ENOMEM);
+        lprocfs_counter_init(run.sr_svc_stats, SB_REQWAIT, svc_conf,
+                             "req_waittime", "usec");
+        lprocfs_counter_init(run.sr_svc_stats, SB_QDEPTH,
+                             LPROCFS_CNTR_AVGMINMAX, "req_qdepth", "reqs");
+        lprocfs_counter_init(run.sr_svc_stats, SB_ACTIVE,
+                             LPROCFS_CNTR_AVGMINMAX, "req_active", "reqs");
+
+        for (i = 0; i < sb_exports; i++) {
+                run.sr_exp_stats[i] = lprocfs_alloc_stats(SB_EXP_OPS,
+                                                          exp_flags);
+                if (run.sr_exp_stats[i] == NULL)
+                        GOTO(out, rc = -ENOMEM);
+                for (j = 0; j < SB_EXP_OPS; j++)
+                        lprocfs_counter_init(run.sr_exp_stats[i], j, 0,
+                                             "op", "reqs");
+                idle += sb_stats_size(run.sr_exp_stats[i]);
+        }
+
+        for (i = 0; i < sb_threads; i++) {
+                task = cfs_kthread_run(sb_thread, &run, "stats_bench_%02d", i);
+                if (IS_ERR(task)) {
+                        rc = PTR_ERR(task);
+                        /* don't wait for the threads not started */
+                        cfs_atomic_sub(sb_threads - i, &run.sr_done);
+                        break;
+                }
+        }
+
+        while (cfs_atomic_read(&run.sr_ready) < i)
+                cfs_schedule_timeout_and_set_state(CFS_TASK_UNINT, 1);
+
+        cfs_gettimeofday(&start);
+        run.sr_go = 1;
+        cfs_waitq_broadcast(&run.sr_waitq);
+        cfs_wait_event(run.sr_waitq, cfs_atomic_read(&run.sr_done) == 0);
+        cfs_gettimeofday(&end);
+
+        if (rc != 0)
+                GOTO(out, rc);
+
+        for (i = 0; i < sb_exports; i++)
+                busy += sb_stats_size(run.sr_exp_stats[i]);
+        do_div(idle, sb_exports);
+        do_div(busy, sb_exports);
+
+        /* wall clock time of one thread handling one RPC */
+        usec = cfs_timeval_sub(&end, &start, NULL);
+        usec *= 1000;
+        do_div(usec, sb_rpcs);
+        LCONSOLE_INFO("%s: %d threads, %d RPCs/thread, %d exports: "
+                      LPU64" ns/RPC, "LPU64" bytes/export idle, "LPU64
+                      " busy\n", name, sb_threads, sb_rpcs, sb_exports,
+                      usec, idle, busy);
+out:
+        for (i = 0; i < sb_exports; i++)
+                lprocfs_free_stats(&run.sr_exp_stats[i]);
+        lprocfs_free_stats(&run.sr_svc_stats);
+        OBD_FREE(run.sr_exp_stats, sb_exports * sizeof(*run.sr_exp_stats));
+        if (run.sr_cntl != NULL)
+                OBD_FREE(run.sr_cntl,
+                         cfs_num_possible_cpus() * SB_CNTL_AREA_SIZE);
+        return rc;
+}
+
+static int __init stats_bench_init(void)
+{
+        int rc;
+
+        if (sb_threads <= 0 || sb_rpcs <= 0 || sb_exports <= 0)
+                return -EINVAL;
+
+        /* lc_cntl service counters and exports with a single locked area,
+         * as before lc_seq and lazy stats */
+        rc = sb_run_mode("stats_bench_cntl", 1, 0, LPROCFS_CNTR_AVGMINMAX,
+                         LPROCFS_STATS_FLAG_NOPERCPU);
+        if (rc == 0)
+                rc = sb_run_mode("stats_bench_nopercpu", 0, 0,
+                                 LPROCFS_CNTR_AVGMINMAX,
+                                 LPROCFS_STATS_FLAG_NOPERCPU);
+        if (rc == 0)
+                rc = sb_run_mode("stats_bench_lazy", 0, 0,
+                                 LPROCFS_CNTR_AVGMINMAX,
+                                 LPROCFS_STATS_FLAG_LAZY);
+        if (rc == 0)
+                rc = sb_run_mode("stats_bench_hist", 0, 0,
+                                 LPROCFS_CNTR_AVGMINMAX |
+                                 LPROCFS_CNTR_HISTOGRAM,
+                                 LPROCFS_STATS_FLAG_LAZY);
+        return rc;
+}
+
+static void __exit stats_bench_exit(void)
+{
+}
+
+MODULE_AUTHOR("Sun Microsystems, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("lprocfs stats benchmark");
+MODULE_LICENSE("GPL");
+
+module_init(stats_bench_init);
+module_exit(stats_bench_exit);
@@ -235,7 +235,7 @@ static int lprocfs_init_rw_stats(struct obd_device *obd,
 
         num_stats = (sizeof(*obd->obd_type->typ_dt_ops) / sizeof(void *)) +
                                                         LPROC_FILTER_LAST - 1;
-        *stats = lprocfs_alloc_stats(num_stats, LPROCFS_STATS_FLAG_NOPERCPU);
+        *stats = lprocfs_alloc_stats(num_stats, LPROCFS_STATS_FLAG_LAZY);
         if (*stats == NULL)
                 return -ENOMEM;
 
@@ -285,6 +285,12 @@ static int filter_export_stats_init(struct obd_device *obd,
                 if (rc)
                         CWARN("Error adding the brw_stats file\n");
 
+                rc = lprocfs_seq_create(exp->exp_nid_stats->nid_proc, "grant",
+                                        0444, &filter_per_nid_grant_fops,
+                                        exp->exp_nid_stats);
+                if (rc)
+                        CWARN("Error adding the grant file\n");
+
                 rc = lprocfs_init_rw_stats(obd, &exp->exp_nid_stats->nid_stats);
                 if (rc)
                         GOTO(clean, rc);
@@ -2055,6 +2061,11 @@ int filter_common_setup(struct obd_device *obd, struct lustre_cfg* lcfg,
         filter->fo_fmd_max_num = FILTER_FMD_MAX_NUM_DEFAULT;
         filter->fo_fmd_max_age = FILTER_FMD_MAX_AGE_DEFAULT;
         filter->fo_syncjournal = 0; /* Don't sync journals on i/o by default */
+        cfs_spin_lock_init(&filter->fo_wgather_lock);
+        CFS_INIT_LIST_HEAD(&filter->fo_wgather_list);
+        filter->fo_wgather_usec = FILTER_WGATHER_USEC_DEFAULT;
+        filter->fo_wgather_max_pages = FILTER_WGATHER_MAX_PAGES_DEFAULT;
+        filter->fo_grant_window = FILTER_GRANT_WINDOW_DEFAULT;
         filter_slc_set(filter); /* initialize sync on lock cancel */
 
         rc = filter_prep(obd);
@@ -2196,6 +2207,12 @@ static int filter_setup(struct obd_device *obd, struct lustre_cfg* lcfg)
         lprocfs_counter_init(obd->obd_stats, LPROC_FILTER_CACHE_MISS,
                              LPROCFS_CNTR_AVGMINMAX, "cache_miss", "pages");
 
+        rc = ptlrpc_lprocfs_register_job_stats(obd);
+        if (rc) {
+                CERROR("%s: job stats setup failed: %d.\n", obd->obd_name, rc);
+                GOTO(free_obd_stats, rc);
+        }
+
         rc = lproc_filter_attach_seqstat(obd);
         if (rc) {
                 CERROR("%s: create seqstat failed: %d.\n", obd->obd_name, rc);
@@ -2242,6 +2259,7 @@ static int filter_setup(struct obd_device *obd, struct lustre_cfg* lcfg)
 remove_entry_clear:
         lprocfs_remove_proc_entry("clear", obd->obd_proc_exports_entry);
 free_obd_stats:
+        lprocfs_job_stats_fini(obd);
         lprocfs_free_obd_stats(obd);
 obd_cleanup:
         lprocfs_obd_cleanup(obd);
@@ -2630,6 +2648,7 @@ static int filter_cleanup(struct obd_device *obd)
 
         lprocfs_remove_proc_entry("clear", obd->obd_proc_exports_entry);
         lprocfs_free_per_client_stats(obd);
+        lprocfs_job_stats_fini(obd);
         lprocfs_free_obd_stats(obd);
         lprocfs_obd_cleanup(obd);
         lquota_cleanup(filter_quota_interface_ref, obd);
@@ -61,9 +61,12 @@
 #define FILTER_GRANT_CHUNK (2ULL * PTLRPC_MAX_BRW_SIZE)
 #define FILTER_GRANT_SHRINK_LIMIT (16ULL * FILTER_GRANT_CHUNK)
 #define GRANT_FOR_LLOG(obd) 16
+/* default write history (in seconds) grant is sized for under space pressure */
+#define FILTER_GRANT_WINDOW_DEFAULT 4
 
 extern struct file_operations filter_per_export_stats_fops;
 extern struct file_operations filter_per_nid_stats_fops;
+extern struct file_operations filter_per_nid_grant_fops;
 
 /* Limit the returned fields marked valid to those that we actually might set */
 #define FILTER_VALID_FLAGS (OBD_MD_FLTYPE | OBD_MD_FLMODE | OBD_MD_FLGENER  |\
@@ -89,6 +92,12 @@ struct filter_mod_data {
 /* Client cache seconds */
 #define FILTER_FMD_MAX_AGE_DEFAULT ((obd_timeout + 10) * CFS_HZ)
 
+/* Write gathering: how long (usec) the first writer of an object waits for
+ * other small writes to the same object before submitting them together,
+ * and the largest RPC (in pages) that is still considered a small write. */
+#define FILTER_WGATHER_USEC_DEFAULT      200
+#define FILTER_WGATHER_MAX_PAGES_DEFAULT 16
+
 #ifndef HAVE_PAGE_CONSTANT
 #define mapping_cap_page_constant_write(mapping) 0
 #define SetPageConstant(page) do {} while (0)
@@ -186,6 +195,7 @@ long filter_grant(struct obd_export *exp, obd_size current_grant,
 void filter_grant_commit(struct obd_export *exp, int niocount,
                          struct niobuf_local *res);
 void filter_grant_incoming(struct obd_export *exp, struct obdo *oa);
+obd_size filter_grant_demand(struct obd_export *exp);
 struct filter_iobuf *filter_alloc_iobuf(struct filter_obd *, int rw,
                                         int num_pages);
 void filter_free_iobuf(struct filter_iobuf *iobuf);
@@ -198,6 +208,9 @@ int filter_direct_io(int rw, struct dentry *dchild, struct filter_iobuf *iobuf,
                      struct obd_export *exp, struct iattr *attr,
                      struct obd_trans_info *oti, void **wait_handle);
 int filter_clear_truncated_page(struct inode *inode);
+int filter_wgather_get(struct filter_obd *filter, struct filter_iobuf *iobuf,
+                       struct inode *inode);
+void filter_wgather_put(struct filter_obd *filter, struct filter_iobuf *iobuf);
 
 /* filter_log.c */
 struct ost_filterdata {
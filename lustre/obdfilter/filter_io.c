@@ -56,6 +56,53 @@
 
 int *obdfilter_created_scratchpad;
 
+/* Fold @bytes written by the client into its write rate estimate.  The rate
+ * is an exponentially weighted average over one-second periods, so periods
+ * without writes decay it towards zero.
+ * Caller must hold osfs lock */
+static void filter_grant_rate_update(struct filter_export_data *fed,
+                                     obd_size bytes)
+{
+        time_t now = cfs_time_current_sec();
+        time_t elapsed = now - fed->fed_write_stamp;
+
+        if (elapsed > 0) {
+                fed->fed_write_rate = obd_rate_update(fed->fed_write_rate,
+                                                      fed->fed_write_bytes,
+                                                      elapsed);
+                fed->fed_write_bytes = 0;
+                fed->fed_write_stamp = now;
+        }
+        fed->fed_write_bytes += bytes;
+}
+
+/* How much grant this client needs to keep fo_grant_window seconds of writes
+ * in flight at its recent write rate.  Never less than FILTER_GRANT_CHUNK, so
+ * that an idle client can still start writing without waiting for grant.
+ * Caller must hold osfs lock */
+obd_size filter_grant_demand(struct obd_export *exp)
+{
+        struct filter_export_data *fed = &exp->exp_filter_data;
+
+        LASSERT_SPIN_LOCKED(&exp->exp_obd->obd_osfs_lock);
+
+        filter_grant_rate_update(fed, 0);
+        return max_t(obd_size, FILTER_GRANT_CHUNK, fed->fed_write_rate *
+                     exp->exp_obd->u.filter.fo_grant_window);
+}
+
+/* Grant is sized after client demand only when free space is short compared
+ * to what all clients could hold; otherwise the static policy is kept. */
+static inline int filter_grant_constrained(struct obd_device *obd,
+                                           obd_size left_space)
+{
+        struct filter_obd *filter = &obd->u.filter;
+
+        return filter->fo_grant_window != 0 &&
+               left_space < filter->fo_tot_granted_clients *
+                            FILTER_GRANT_SHRINK_LIMIT;
+}
+
 /* Grab the dirty and seen grant announcements from the incoming obdo.
  * We will later calculate the clients new grant and return it.
  * Caller must hold osfs lock */
@@ -113,10 +160,13 @@ void filter_grant_incoming(struct obd_export *exp, struct obdo *oa)
                 obd_size left_space = filter_grant_space_left(exp);
                 struct filter_obd *filter = &exp->exp_obd->u.filter;
 
-                /*Only if left_space < fo_tot_clients * 32M,
-                 *then the grant space could be shrinked */
+                /* Only if left_space < fo_tot_clients * 32M, or the client
+                 * holds more than its recent writes need, the grant space
+                 * could be shrinked */
                 if (left_space < filter->fo_tot_granted_clients *
-                                 FILTER_GRANT_SHRINK_LIMIT) {
+                                 FILTER_GRANT_SHRINK_LIMIT ||
+                    (filter->fo_grant_window != 0 &&
+                     fed->fed_grant > filter_grant_demand(exp))) {
                         fed->fed_grant -= oa->o_grant;
                         filter->fo_tot_granted -= oa->o_grant;
                         CDEBUG(D_CACHE, "%s: cli %s/%p shrink "LPU64
@@ -214,6 +264,14 @@ long filter_grant(struct obd_export *exp, obd_size current_grant,
 
         LASSERT_SPIN_LOCKED(&obd->obd_osfs_lock);
 
+        /* Space is short: do not let a client grow its grant past what its
+         * recent writes need, so that grant goes to the clients actually
+         * writing rather than to the idle ones.  @want is the total grant
+         * the client asks for, so it is capped at the demand itself. */
+        if (want <= 0x7fffffff &&
+            filter_grant_constrained(obd, fs_space_left))
+                want = min(want, filter_grant_demand(exp));
+
         /* Grant some fraction of the client's requested grant space so that
          * they are not always waiting for write credits (not all of it to
          * avoid overgranting in face of multiple RPCs in flight).  This
@@ -608,6 +666,8 @@ static int filter_grant_check(struct obd_export *exp, struct obdo *oa,
         fed->fed_pending += used + ungranted;
         exp->exp_obd->u.filter.fo_tot_granted += ungranted;
         exp->exp_obd->u.filter.fo_tot_pending += used + ungranted;
+        if (!resend)
+                filter_grant_rate_update(fed, used + ungranted);
 
         CDEBUG(D_CACHE,
                "%s: cli %s/%p used: %lu ungranted: %lu grant: %lu dirty: %lu\n",
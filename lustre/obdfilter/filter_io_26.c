@@ -47,6 +47,7 @@
 #include <linux/pagemap.h> // XXX kill me soon
 #include <linux/version.h>
 #include <linux/buffer_head.h>
+#include <linux/hrtimer.h>
 
 #define DEBUG_SUBSYSTEM S_FILTER
 
@@ -65,8 +66,41 @@ struct filter_iobuf {
         int                dr_error;
         struct page      **dr_pages;
         unsigned long     *dr_blocks;
-        unsigned int       dr_ignore_quota:1;
+        unsigned int       dr_ignore_quota:1,
+                           dr_wg_ready:1, /* reached the bio stage */
+                           dr_wg_done:1;  /* I/O submitted by the leader */
         struct filter_obd *dr_filter;
+        struct obd_export *dr_exp;        /* owner of the pages, for stats */
+        struct filter_wgather *dr_wgather;
+        cfs_list_t         dr_wg_link;    /* linkage into fwg_batch */
+};
+
+/*
+ * Write group: all small writes to one object which are in progress on
+ * this OST.  The first writer reaching filter_do_bio() becomes the leader
+ * of the group, waits up to fo_wgather_usec for the other registered
+ * writers to reach the same point, and then submits the pages of all of
+ * them as one sorted set of bios.  Followers sleep until the leader has
+ * completed the merged I/O and return its result, so their replies are
+ * only sent once the data is on disk, as before.
+ */
+struct filter_wgather {
+        cfs_list_t         fwg_list;      /* linkage into fo_wgather_list */
+        struct inode      *fwg_inode;     /* object being written */
+        int                fwg_refcount;  /* writers holding this group */
+        int                fwg_pending;   /* writers not at bio stage yet */
+        int                fwg_npages;    /* pages queued in fwg_batch */
+        int                fwg_nrpcs;     /* iobufs queued in fwg_batch */
+        pgoff_t            fwg_start;     /* file range of fwg_batch */
+        pgoff_t            fwg_end;
+        unsigned int       fwg_leader:1,  /* a leader collects fwg_batch */
+                           fwg_closed:1;  /* fwg_batch is being submitted */
+        cfs_list_t         fwg_batch;     /* iobufs sorted by first block */
+        cfs_waitq_t        fwg_waitq;
+        /* gather window of the leader; fo_wgather_usec is well below a
+         * jiffy, so this is a hrtimer rather than a timed waitq sleep */
+        struct hrtimer     fwg_timer;
+        int                fwg_expired;
 };
 
 static void record_start_io(struct filter_iobuf *iobuf, int rw, int size,
@@ -234,6 +268,7 @@ struct filter_iobuf *filter_alloc_iobuf(struct filter_obd *filter,
                 goto failed_2;
 
         iobuf->dr_filter = filter;
+        CFS_INIT_LIST_HEAD(&iobuf->dr_wg_link);
         cfs_waitq_init(&iobuf->dr_wait);
         cfs_atomic_set(&iobuf->dr_numreqs, 0);
         iobuf->dr_max_pages = num_pages;
@@ -253,8 +288,13 @@ struct filter_iobuf *filter_alloc_iobuf(struct filter_obd *filter,
 
 static void filter_clear_iobuf(struct filter_iobuf *iobuf)
 {
+        LASSERT(iobuf->dr_wgather == NULL);
+        LASSERT(cfs_list_empty(&iobuf->dr_wg_link));
+
         iobuf->dr_npages = 0;
         iobuf->dr_error = 0;
+        iobuf->dr_wg_ready = 0;
+        iobuf->dr_wg_done = 0;
         cfs_atomic_set(&iobuf->dr_numreqs, 0);
 }
 
@@ -297,10 +337,20 @@ int filter_iobuf_add_page(struct obd_device *obd, struct filter_iobuf *iobuf,
         return 0;
 }
 
-int filter_do_bio(struct obd_export *exp, struct inode *inode,
-                  struct filter_iobuf *iobuf, int rw)
+/*
+ * Map the pages of \a iobuf to bios.  \a biop is the bio being built, which
+ * is submitted and replaced whenever the next block is not contiguous, so
+ * that it can be carried over from one iobuf to the next; \a bio_exp is the
+ * export whose pages started it, which its I/O size is accounted to.  All
+ * bios complete into \a owner.  \a pages_left is the number of pages still
+ * to be mapped, including those of \a iobuf, and is used to size new bios.
+ */
+static int filter_iobuf_bios(struct inode *inode, struct filter_iobuf *iobuf,
+                             struct filter_iobuf *owner, int rw,
+                             struct bio **biop, struct obd_export **bio_exp,
+                             int *frags, int pages_left)
 {
-        struct obd_device *obd = exp->exp_obd;
+        struct obd_device *obd = iobuf->dr_exp->exp_obd;
         int            blocks_per_page = CFS_PAGE_SIZE >> inode->i_blkbits;
         struct page  **pages = iobuf->dr_pages;
         int            npages = iobuf->dr_npages;
@@ -308,9 +358,7 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
         int            total_blocks = npages * blocks_per_page;
         int            sector_bits = inode->i_sb->s_blocksize_bits - 9;
         unsigned int   blocksize = inode->i_sb->s_blocksize;
-        struct bio    *bio = NULL;
-        int            frags = 0;
-        unsigned long  start_time = jiffies;
+        struct bio    *bio = *biop;
         struct page   *page;
         unsigned int   page_offset;
         sector_t       sector;
@@ -319,14 +367,12 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
         int            page_idx;
         int            i;
         int            rc = 0;
-        ENTRY;
 
-        LASSERT(iobuf->dr_npages == npages);
         LASSERT(total_blocks <= OBDFILTER_CREATED_SCRATCHPAD_ENTRIES);
 
         for (page_idx = 0, block_idx = 0;
              page_idx < npages;
-             page_idx++, block_idx += blocks_per_page) {
+             page_idx++, block_idx += blocks_per_page, pages_left--) {
 
                 page = pages[page_idx];
                 LASSERT (block_idx + blocks_per_page <= total_blocks);
@@ -387,32 +433,35 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
                                        (unsigned long long)bio->bi_sector,
                                        (unsigned long long)sector);
 
-                                record_start_io(iobuf, rw, bio->bi_size, exp);
+                                *biop = NULL;
+                                record_start_io(owner, rw, bio->bi_size,
+                                                *bio_exp);
                                 rc = fsfilt_send_bio(rw, obd, inode, bio);
                                 if (rc < 0) {
                                         CERROR("Can't send bio: %d\n", rc);
-                                        record_finish_io(iobuf, rw, rc);
-                                        goto out;
+                                        record_finish_io(owner, rw, rc);
+                                        return rc;
                                 }
-                                frags++;
+                                (*frags)++;
                         }
 
                         /* allocate new bio, limited by max BIO size, b=9945 */
                         bio = bio_alloc(GFP_NOIO, min(BIO_MAX_PAGES,
-                                                      (npages - page_idx) *
+                                                      pages_left *
                                                       blocks_per_page));
                         if (bio == NULL) {
                                 CERROR("Can't allocate bio %u*%u = %u pages\n",
-                                       (npages - page_idx), blocks_per_page,
-                                       (npages - page_idx) * blocks_per_page);
-                                rc = -ENOMEM;
-                                goto out;
+                                       pages_left, blocks_per_page,
+                                       pages_left * blocks_per_page);
+                                return -ENOMEM;
                         }
 
                         bio->bi_bdev = inode->i_sb->s_bdev;
                         bio->bi_sector = sector;
                         bio->bi_end_io = dio_complete_routine;
-                        bio->bi_private = iobuf;
+                        bio->bi_private = owner;
+                        *biop = bio;
+                        *bio_exp = iobuf->dr_exp;
 
                         rc = bio_add_page(bio, page,
                                           blocksize * nblocks, page_offset);
@@ -420,21 +469,71 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
                 }
         }
 
+        return 0;
+}
+
+/* Is \a iobuf the first one on \a list from its export?  The per-export
+ * statistics of a merged I/O are accounted once to every export in it. */
+static int filter_iobuf_first_of_exp(cfs_list_t *list,
+                                     struct filter_iobuf *iobuf)
+{
+        struct filter_iobuf *tmp;
+
+        cfs_list_for_each_entry(tmp, list, dr_wg_link) {
+                if (tmp == iobuf)
+                        break;
+                if (tmp->dr_exp == iobuf->dr_exp)
+                        return 0;
+        }
+        return 1;
+}
+
+/*
+ * Submit the pages of all iobufs on \a list, which must be sorted by their
+ * first block, and wait for the I/O to complete.  Contiguous blocks of
+ * neighbouring iobufs are merged into the same bio.  All bios complete
+ * into \a owner, which collects the I/O error for the whole list.
+ */
+static int filter_do_bio_list(struct inode *inode, cfs_list_t *list,
+                              struct filter_iobuf *owner, int rw)
+{
+        struct obd_device *obd = owner->dr_exp->exp_obd;
+        struct filter_iobuf *iobuf;
+        struct obd_export *exp;
+        struct obd_export *bio_exp = NULL;
+        struct bio    *bio = NULL;
+        int            frags = 0;
+        unsigned long  start_time = jiffies;
+        int            pages_left = 0;
+        int            rc = 0;
+        ENTRY;
+
+        cfs_list_for_each_entry(iobuf, list, dr_wg_link)
+                pages_left += iobuf->dr_npages;
+
+        cfs_list_for_each_entry(iobuf, list, dr_wg_link) {
+                rc = filter_iobuf_bios(inode, iobuf, owner, rw, &bio, &bio_exp,
+                                       &frags, pages_left);
+                if (rc < 0)
+                        goto out;
+                pages_left -= iobuf->dr_npages;
+        }
+
         if (bio != NULL) {
-                record_start_io(iobuf, rw, bio->bi_size, exp);
+                record_start_io(owner, rw, bio->bi_size, bio_exp);
                 rc = fsfilt_send_bio(rw, obd, inode, bio);
                 if (rc >= 0) {
                         frags++;
                         rc = 0;
                 } else {
                         CERROR("Can't send bio: %d\n", rc);
-                        record_finish_io(iobuf, rw, rc);
+                        record_finish_io(owner, rw, rc);
                 }
         }
 
  out:
-        cfs_wait_event(iobuf->dr_wait,
-                       cfs_atomic_read(&iobuf->dr_numreqs) == 0);
+        cfs_wait_event(owner->dr_wait,
+                       cfs_atomic_read(&owner->dr_numreqs) == 0);
 
         if (rw == OBD_BRW_READ) {
                 lprocfs_oh_tally(&obd->u.filter.fo_filter_stats.
@@ -443,21 +542,29 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
                 lprocfs_oh_tally_log2(&obd->u.filter.
                                        fo_filter_stats.hist[BRW_R_IO_TIME],
                                       jiffies - start_time);
-                if (exp->exp_nid_stats && exp->exp_nid_stats->nid_brw_stats) {
-                        lprocfs_oh_tally(&exp->exp_nid_stats->nid_brw_stats->
-                                          hist[BRW_R_DIO_FRAGS],
-                                         frags);
-                        lprocfs_oh_tally_log2(&exp->exp_nid_stats->
-                                             nid_brw_stats->hist[BRW_R_IO_TIME],
-                                              jiffies - start_time);
-                }
         } else {
                 lprocfs_oh_tally(&obd->u.filter.fo_filter_stats.
                                   hist[BRW_W_DIO_FRAGS], frags);
                 lprocfs_oh_tally_log2(&obd->u.filter.fo_filter_stats.
                                        hist[BRW_W_IO_TIME],
                                       jiffies - start_time);
-                if (exp->exp_nid_stats && exp->exp_nid_stats->nid_brw_stats) {
+        }
+
+        cfs_list_for_each_entry(iobuf, list, dr_wg_link) {
+                exp = iobuf->dr_exp;
+                if (exp->exp_nid_stats == NULL ||
+                    exp->exp_nid_stats->nid_brw_stats == NULL ||
+                    !filter_iobuf_first_of_exp(list, iobuf))
+                        continue;
+
+                if (rw == OBD_BRW_READ) {
+                        lprocfs_oh_tally(&exp->exp_nid_stats->nid_brw_stats->
+                                          hist[BRW_R_DIO_FRAGS],
+                                         frags);
+                        lprocfs_oh_tally_log2(&exp->exp_nid_stats->
+                                             nid_brw_stats->hist[BRW_R_IO_TIME],
+                                              jiffies - start_time);
+                } else {
                         lprocfs_oh_tally(&exp->exp_nid_stats->nid_brw_stats->
                                           hist[BRW_W_DIO_FRAGS],
                                          frags);
@@ -468,10 +575,245 @@ int filter_do_bio(struct obd_export *exp, struct inode *inode,
         }
 
         if (rc == 0)
-                rc = iobuf->dr_error;
+                rc = owner->dr_error;
         RETURN(rc);
 }
 
+/* End of the gather window of the leader, called in hrtimer context. */
+static enum hrtimer_restart filter_wgather_expire(struct hrtimer *timer)
+{
+        struct filter_wgather *wg = container_of(timer, struct filter_wgather,
+                                                 fwg_timer);
+
+        wg->fwg_expired = 1;
+        cfs_waitq_broadcast(&wg->fwg_waitq);
+        return HRTIMER_NORESTART;
+}
+
+/**
+ * Register a small write with the write group of \a inode, so that the
+ * first writer to reach filter_do_bio() waits for it.  Returns 1 if the
+ * iobuf joined a group, 0 if write gathering does not apply.
+ */
+int filter_wgather_get(struct filter_obd *filter, struct filter_iobuf *iobuf,
+                       struct inode *inode)
+{
+        struct filter_wgather *wg;
+        struct filter_wgather *new = NULL;
+        ENTRY;
+
+        LASSERT(iobuf->dr_wgather == NULL);
+
+        if (filter->fo_wgather_usec == 0 || iobuf->dr_npages == 0 ||
+            iobuf->dr_npages > filter->fo_wgather_max_pages)
+                RETURN(0);
+
+        OBD_ALLOC_PTR(new);
+        if (new == NULL)
+                RETURN(0);
+
+        cfs_spin_lock(&filter->fo_wgather_lock);
+        cfs_list_for_each_entry(wg, &filter->fo_wgather_list, fwg_list) {
+                if (wg->fwg_inode == inode)
+                        goto found;
+        }
+
+        wg = new;
+        new = NULL;
+        wg->fwg_inode = inode;
+        CFS_INIT_LIST_HEAD(&wg->fwg_batch);
+        cfs_waitq_init(&wg->fwg_waitq);
+        hrtimer_init(&wg->fwg_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+        wg->fwg_timer.function = filter_wgather_expire;
+        cfs_list_add(&wg->fwg_list, &filter->fo_wgather_list);
+found:
+        wg->fwg_refcount++;
+        wg->fwg_pending++;
+        iobuf->dr_wgather = wg;
+        cfs_spin_unlock(&filter->fo_wgather_lock);
+
+        if (new != NULL)
+                OBD_FREE_PTR(new);
+        RETURN(1);
+}
+
+/**
+ * Drop the write group reference taken by filter_wgather_get().  If the
+ * writer never reached the bio stage (e.g. its transaction failed) the
+ * leader must not wait for it any longer.
+ */
+void filter_wgather_put(struct filter_obd *filter, struct filter_iobuf *iobuf)
+{
+        struct filter_wgather *wg = iobuf->dr_wgather;
+
+        if (wg == NULL)
+                return;
+
+        cfs_spin_lock(&filter->fo_wgather_lock);
+        LASSERT(cfs_list_empty(&iobuf->dr_wg_link));
+        if (!iobuf->dr_wg_ready)
+                wg->fwg_pending--;
+        iobuf->dr_wgather = NULL;
+        LASSERT(wg->fwg_refcount > 0);
+        if (--wg->fwg_refcount > 0) {
+                cfs_spin_unlock(&filter->fo_wgather_lock);
+                cfs_waitq_broadcast(&wg->fwg_waitq);
+                return;
+        }
+        LASSERT(wg->fwg_pending == 0 && !wg->fwg_leader);
+        cfs_list_del(&wg->fwg_list);
+        cfs_spin_unlock(&filter->fo_wgather_lock);
+
+        OBD_FREE_PTR(wg);
+}
+
+/* Queue \a iobuf into the batch of \a wg, keeping the batch sorted by
+ * the first disk block so that adjacent writes end up in the same bio. */
+static void filter_wgather_queue(struct filter_wgather *wg,
+                                 struct filter_iobuf *iobuf)
+{
+        struct filter_iobuf *tmp;
+        pgoff_t start = iobuf->dr_pages[0]->index;
+        pgoff_t end = iobuf->dr_pages[iobuf->dr_npages - 1]->index;
+
+        cfs_list_for_each_entry(tmp, &wg->fwg_batch, dr_wg_link) {
+                if (tmp->dr_blocks[0] > iobuf->dr_blocks[0])
+                        break;
+        }
+        cfs_list_add_tail(&iobuf->dr_wg_link, &tmp->dr_wg_link);
+
+        if (wg->fwg_nrpcs == 0 || start < wg->fwg_start)
+                wg->fwg_start = start;
+        if (wg->fwg_nrpcs == 0 || end > wg->fwg_end)
+                wg->fwg_end = end;
+        wg->fwg_npages += iobuf->dr_npages;
+        wg->fwg_nrpcs++;
+}
+
+/* Can \a iobuf join the batch currently collected by the leader of \a wg?
+ * Only writes close to the already queued range are worth merging. */
+static int filter_wgather_can_join(struct filter_wgather *wg,
+                                   struct filter_iobuf *iobuf)
+{
+        pgoff_t start = iobuf->dr_pages[0]->index;
+        pgoff_t end = iobuf->dr_pages[iobuf->dr_npages - 1]->index;
+
+        if (!wg->fwg_leader || wg->fwg_closed)
+                return 0;
+        if (wg->fwg_npages + iobuf->dr_npages > PTLRPC_MAX_BRW_PAGES)
+                return 0;
+        return start <= wg->fwg_end + PTLRPC_MAX_BRW_PAGES &&
+               end + PTLRPC_MAX_BRW_PAGES >= wg->fwg_start;
+}
+
+static int filter_wgather_do_bio(struct inode *inode,
+                                 struct filter_iobuf *iobuf)
+{
+        struct filter_obd     *filter = iobuf->dr_filter;
+        struct filter_wgather *wg = iobuf->dr_wgather;
+        struct filter_iobuf   *tmp;
+        struct filter_iobuf   *next;
+        CFS_LIST_HEAD(batch);
+        int                    nrpcs;
+        int                    rc;
+        ENTRY;
+
+        cfs_spin_lock(&filter->fo_wgather_lock);
+        LASSERT(!iobuf->dr_wg_ready);
+        iobuf->dr_wg_ready = 1;
+        wg->fwg_pending--;
+
+        if (filter_wgather_can_join(wg, iobuf)) {
+                /* follower: the leader submits our pages */
+                filter_wgather_queue(wg, iobuf);
+                cfs_spin_unlock(&filter->fo_wgather_lock);
+                cfs_waitq_broadcast(&wg->fwg_waitq);
+
+                cfs_wait_event(wg->fwg_waitq, iobuf->dr_wg_done);
+                RETURN(iobuf->dr_error);
+        }
+
+        if (wg->fwg_leader) {
+                /* the current batch is full or too far away */
+                cfs_spin_unlock(&filter->fo_wgather_lock);
+                cfs_list_add(&iobuf->dr_wg_link, &batch);
+                rc = filter_do_bio_list(inode, &batch, iobuf, OBD_BRW_WRITE);
+                cfs_list_del_init(&iobuf->dr_wg_link);
+                RETURN(rc);
+        }
+
+        /* leader: wait a little for the other writers of this object */
+        wg->fwg_leader = 1;
+        filter_wgather_queue(wg, iobuf);
+        cfs_spin_unlock(&filter->fo_wgather_lock);
+
+        wg->fwg_expired = 0;
+        hrtimer_start(&wg->fwg_timer,
+                      ktime_set(0, filter->fo_wgather_usec * NSEC_PER_USEC),
+                      HRTIMER_MODE_REL);
+        cfs_wait_event(wg->fwg_waitq, wg->fwg_pending == 0 ||
+                       wg->fwg_npages >= PTLRPC_MAX_BRW_PAGES ||
+                       wg->fwg_expired);
+        hrtimer_cancel(&wg->fwg_timer);
+
+        cfs_spin_lock(&filter->fo_wgather_lock);
+        wg->fwg_closed = 1;
+        nrpcs = wg->fwg_nrpcs;
+        cfs_list_splice_init(&wg->fwg_batch, &batch);
+        cfs_spin_unlock(&filter->fo_wgather_lock);
+
+        if (nrpcs > 1)
+                CDEBUG(D_INODE, "inode %lu: merged %d write RPCs\n",
+                       inode->i_ino, nrpcs);
+
+        rc = filter_do_bio_list(inode, &batch, iobuf, OBD_BRW_WRITE);
+
+        lprocfs_oh_tally(&filter->fo_filter_stats.hist[BRW_W_MERGED_RPCS],
+                         nrpcs);
+        cfs_list_for_each_entry(tmp, &batch, dr_wg_link) {
+                struct nid_stat *stats = tmp->dr_exp->exp_nid_stats;
+
+                if (stats != NULL && stats->nid_brw_stats != NULL &&
+                    filter_iobuf_first_of_exp(&batch, tmp))
+                        lprocfs_oh_tally(&stats->nid_brw_stats->
+                                         hist[BRW_W_MERGED_RPCS], nrpcs);
+        }
+
+        cfs_spin_lock(&filter->fo_wgather_lock);
+        cfs_list_for_each_entry_safe(tmp, next, &batch, dr_wg_link) {
+                cfs_list_del_init(&tmp->dr_wg_link);
+                if (tmp == iobuf)
+                        continue;
+                tmp->dr_error = rc;
+                tmp->dr_wg_done = 1;
+        }
+        wg->fwg_leader = 0;
+        wg->fwg_closed = 0;
+        wg->fwg_npages = 0;
+        wg->fwg_nrpcs = 0;
+        cfs_spin_unlock(&filter->fo_wgather_lock);
+        cfs_waitq_broadcast(&wg->fwg_waitq);
+
+        RETURN(rc);
+}
+
+int filter_do_bio(struct obd_export *exp, struct inode *inode,
+                  struct filter_iobuf *iobuf, int rw)
+{
+        CFS_LIST_HEAD(list);
+        int rc;
+
+        iobuf->dr_exp = exp;
+        if (rw == OBD_BRW_WRITE && iobuf->dr_wgather != NULL)
+                return filter_wgather_do_bio(inode, iobuf);
+
+        cfs_list_add(&iobuf->dr_wg_link, &list);
+        rc = filter_do_bio_list(inode, &list, iobuf, rw);
+        cfs_list_del_init(&iobuf->dr_wg_link);
+
+        return rc;
+}
+
 /* Must be called with i_mutex taken for writes; this will drop it */
 int filter_direct_io(int rw, struct dentry *dchild, struct filter_iobuf *iobuf,
                      struct obd_export *exp, struct iattr *attr,
@@ -684,6 +1026,9 @@ int filter_commitrw_write(struct obd_export *exp, struct obdo *oa,
         ll_vfs_dq_init(inode);
         fsfilt_check_slow(obd, now, "quota init");
 
+        /* only small writes are gathered, see filter_wgather_do_bio() */
+        filter_wgather_get(fo, iobuf, inode);
+
         LOCK_INODE_MUTEX(inode);
         fsfilt_check_slow(obd, now, "i_mutex");
         oti->oti_handle = fsfilt_brw_start(obd, objcount, &fso, niocount, res,
@@ -779,6 +1124,7 @@ cleanup:
                 pop_ctxt(&saved, &obd->obd_lvfs_ctxt, NULL);
                 LASSERT(current->journal_info == NULL);
         case 1:
+                filter_wgather_put(&obd->u.filter, iobuf);
                 filter_iobuf_put(&obd->u.filter, iobuf, oti);
         case 0:
                 /*
@@ -384,6 +384,89 @@ int lprocfs_filter_wr_syncjournal(struct file *file, const char *buffer,
         return count;
 }
 
+int lprocfs_filter_rd_wgather_usec(char *page, char **start, off_t off,
+                                   int count, int *eof, void *data)
+{
+        struct obd_device *obd = data;
+
+        *eof = 1;
+        return snprintf(page, count, "%u\n", obd->u.filter.fo_wgather_usec);
+}
+
+int lprocfs_filter_wr_wgather_usec(struct file *file, const char *buffer,
+                                   unsigned long count, void *data)
+{
+        struct obd_device *obd = data;
+        int val;
+        int rc;
+
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        /* a longer window only delays the writes of lone clients */
+        if (val < 0 || val > 100000)
+                return -EINVAL;
+
+        obd->u.filter.fo_wgather_usec = val;
+        return count;
+}
+
+int lprocfs_filter_rd_wgather_max_pages(char *page, char **start, off_t off,
+                                        int count, int *eof, void *data)
+{
+        struct obd_device *obd = data;
+
+        *eof = 1;
+        return snprintf(page, count, "%u\n",
+                        obd->u.filter.fo_wgather_max_pages);
+}
+
+int lprocfs_filter_wr_wgather_max_pages(struct file *file, const char *buffer,
+                                        unsigned long count, void *data)
+{
+        struct obd_device *obd = data;
+        int val;
+        int rc;
+
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        if (val < 1 || val > PTLRPC_MAX_BRW_PAGES)
+                return -EINVAL;
+
+        obd->u.filter.fo_wgather_max_pages = val;
+        return count;
+}
+
+int lprocfs_filter_rd_grant_window(char *page, char **start, off_t off,
+                                   int count, int *eof, void *data)
+{
+        struct obd_device *obd = data;
+
+        *eof = 1;
+        return snprintf(page, count, "%u\n", obd->u.filter.fo_grant_window);
+}
+
+int lprocfs_filter_wr_grant_window(struct file *file, const char *buffer,
+                                   unsigned long count, void *data)
+{
+        struct obd_device *obd = data;
+        int val;
+        int rc;
+
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc)
+                return rc;
+
+        if (val < 0 || val > 3600)
+                return -EINVAL;
+
+        obd->u.filter.fo_grant_window = val;
+        return count;
+}
+
 static char *sync_on_cancel_states[] = {"never",
                                         "blocking",
                                         "always" };
@@ -477,6 +560,12 @@ static struct lprocfs_vars lprocfs_filter_obd_vars[] = {
                           lprocfs_filter_wr_syncjournal, 0 },
         { "sync_on_lock_cancel", lprocfs_filter_rd_sync_lock_cancel,
                                  lprocfs_filter_wr_sync_lock_cancel, 0 },
+        { "write_gather_usec", lprocfs_filter_rd_wgather_usec,
+                               lprocfs_filter_wr_wgather_usec, 0 },
+        { "write_gather_max_pages", lprocfs_filter_rd_wgather_max_pages,
+                                    lprocfs_filter_wr_wgather_max_pages, 0 },
+        { "grant_window", lprocfs_filter_rd_grant_window,
+                          lprocfs_filter_wr_grant_window, 0 },
         { 0 }
 };
 
@@ -611,6 +700,10 @@ static void brw_stats_show(struct seq_file *seq, struct brw_stats *brw_stats)
         display_brw_stats(seq, "disk I/O size", "ios",
                           &brw_stats->hist[BRW_R_DISK_IOSIZE],
                           &brw_stats->hist[BRW_W_DISK_IOSIZE], 1);
+
+        display_brw_stats(seq, "RPCs merged per disk I/O", "ios",
+                          &brw_stats->hist[BRW_R_MERGED_RPCS],
+                          &brw_stats->hist[BRW_W_MERGED_RPCS], 0);
 }
 
 #undef pct
@@ -679,4 +772,35 @@ static ssize_t filter_per_nid_stats_seq_write(struct file *file,
 }
 
 LPROC_SEQ_FOPS(filter_per_nid_stats);
+
+static int filter_per_nid_grant_seq_show(struct seq_file *seq, void *v)
+{
+        nid_stat_t                *stat = seq->private;
+        struct obd_device         *obd = stat->nid_obd;
+        struct filter_export_data *fed;
+        struct obd_export         *exp;
+
+        cfs_spin_lock(&obd->obd_osfs_lock);
+        cfs_spin_lock(&obd->obd_dev_lock);
+        cfs_list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+                if (exp->exp_nid_stats != stat)
+                        continue;
+                fed = &exp->exp_filter_data;
+                seq_printf(seq, "%s:\n"
+                           "    grant:   %ld\n"
+                           "    dirty:   %ld\n"
+                           "    pending: %ld\n"
+                           "    rate:    "LPU64"\n"
+                           "    demand:  "LPU64"\n",
+                           exp->exp_client_uuid.uuid, fed->fed_grant,
+                           fed->fed_dirty, fed->fed_pending,
+                           fed->fed_write_rate, filter_grant_demand(exp));
+        }
+        cfs_spin_unlock(&obd->obd_dev_lock);
+        cfs_spin_unlock(&obd->obd_osfs_lock);
+
+        return 0;
+}
+
+LPROC_SEQ_FOPS_RO(filter_per_nid_grant);
 #endif /* LPROCFS */
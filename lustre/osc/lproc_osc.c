@@ -444,6 +444,18 @@ static int osc_rd_prealloc_last_id(char *page, char **start, off_t off,
                         obd->u.cli.cl_oscc.oscc_last_id);
 }
 
+static int osc_rd_create_rate(char *page, char **start, off_t off,
+                              int count, int *eof, void *data)
+{
+        struct obd_device *obd = data;
+
+        if (obd == NULL)
+                return 0;
+
+        return snprintf(page, count, "%d\n",
+                        obd->u.cli.cl_oscc.oscc_rate);
+}
+
 static int osc_rd_checksum(char *page, char **start, off_t off, int count,
                            int *eof, void *data)
 {
@@ -635,6 +647,7 @@ static struct lprocfs_vars lprocfs_osc_obd_vars[] = {
                               osc_wr_max_create_count, 0},
         { "prealloc_next_id", osc_rd_prealloc_next_id, 0, 0 },
         { "prealloc_last_id", osc_rd_prealloc_last_id, 0, 0 },
+        { "create_rate",     osc_rd_create_rate, 0, 0 },
         { "checksums",       osc_rd_checksum, osc_wr_checksum, 0 },
         { "checksum_type",   osc_rd_checksum_type, osc_wd_checksum_type, 0 },
         { "resend_count",    osc_rd_resend_count, osc_wr_resend_count, 0},
@@ -322,6 +322,11 @@ struct osc_page {
          * \see osc_page_addref_lock(), osc_page_putref_lock().
          */
         struct cl_lock       *ops_lock;
+        /**
+         * Linkage into client_obd::cl_lru_list, protected by
+         * client_obd::cl_lru_lock.
+         */
+        cfs_list_t            ops_lru;
 };
 
 extern cfs_mem_cache_t *osc_page_kmem;
@@ -347,6 +352,7 @@ int osc_req_init (const struct lu_env *env, struct cl_device *dev,
 struct lu_object *osc_object_alloc(const struct lu_env *env,
                                    const struct lu_object_header *hdr,
                                    struct lu_device *dev);
+int osc_lru_shrink(struct client_obd *cli, int target);
 struct cl_page   *osc_page_init   (const struct lu_env *env,
                                    struct cl_object *obj,
                                    struct cl_page *page, cfs_page_t *vmpage);
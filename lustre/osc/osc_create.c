@@ -64,6 +64,9 @@
 /* XXX need AT adjust ? */
 #define osc_create_timeout      (obd_timeout / 2)
 
+/* seconds of creates at the recent rate kept precreated ahead */
+#define OSCC_PRECREATE_AHEAD    2
+
 struct osc_create_async_args {
         struct osc_creator      *rq_oscc;
         struct lov_stripe_md    *rq_lsm;
@@ -71,9 +74,52 @@ struct osc_create_async_args {
         int                      rq_grow_count;
 };
 
+static int oscc_has_objects_nolock(struct osc_creator *oscc, int count)
+{
+        return ((__s64)(oscc->oscc_last_id - oscc->oscc_next_id) >= count);
+}
+
 static int oscc_internal_create(struct osc_creator *oscc);
 static int handle_async_create(struct ptlrpc_request *req, int rc);
 
+/* Fold the objects handed out since the last update into oscc_rate, a
+ * decaying average of objects handed out per second.  Caller must hold
+ * oscc_lock. */
+static void oscc_rate_update(struct osc_creator *oscc, int used)
+{
+        time_t now = cfs_time_current_sec();
+        time_t elapsed = now - oscc->oscc_rate_stamp;
+
+        LASSERT_SPIN_LOCKED(&oscc->oscc_lock);
+
+        if (elapsed > 0) {
+                oscc->oscc_rate = obd_rate_update(oscc->oscc_rate,
+                                                  oscc->oscc_used, elapsed);
+                oscc->oscc_used = 0;
+                oscc->oscc_rate_stamp = now;
+        }
+        oscc->oscc_used += used;
+}
+
+/* Hand out the next precreated object id.  Caller must hold oscc_lock and
+ * have checked that an object is available. */
+static obd_id oscc_next_object(struct osc_creator *oscc)
+{
+        LASSERT(oscc_has_objects_nolock(oscc, 1));
+
+        oscc_rate_update(oscc, 1);
+        return oscc->oscc_next_id++;
+}
+
+/* How many objects a precreate should ask for to stay OSCC_PRECREATE_AHEAD
+ * seconds ahead of the recent create rate.  Caller must hold oscc_lock. */
+static int oscc_demand(struct osc_creator *oscc)
+{
+        oscc_rate_update(oscc, 0);
+        return min(oscc->oscc_rate * OSCC_PRECREATE_AHEAD,
+                   oscc->oscc_max_grow_count / 2);
+}
+
 static int osc_interpret_create(const struct lu_env *env,
                                 struct ptlrpc_request *req, void *data, int rc)
 {
@@ -214,6 +260,12 @@ static int oscc_internal_create(struct osc_creator *oscc)
                 oscc->oscc_grow_count *= 2;
         }
 
+        /* a create storm should not have to wait for grow_count to double
+         * once per precreate round trip: jump to the observed demand */
+        if ((oscc->oscc_flags & OSCC_FLAG_LOW) == 0 &&
+            oscc->oscc_grow_count < oscc_demand(oscc))
+                oscc->oscc_grow_count = oscc_demand(oscc);
+
         if (oscc->oscc_flags & OSCC_FLAG_CREATING) {
                 cfs_spin_unlock(&oscc->oscc_lock);
                 RETURN(0);
@@ -271,11 +323,6 @@ static int oscc_internal_create(struct osc_creator *oscc)
         RETURN(0);
 }
 
-static int oscc_has_objects_nolock(struct osc_creator *oscc, int count)
-{
-        return ((__s64)(oscc->oscc_last_id - oscc->oscc_next_id) >= count);
-}
-
 
 static int oscc_has_objects(struct osc_creator *oscc, int count)
 {
@@ -368,7 +415,10 @@ int osc_precreate(struct obd_export *exp)
             (oscc->oscc_flags & OSCC_FLAG_DEGRADED))
                 GOTO(out, rc = 2);
 
-        if (oscc_has_objects_nolock(oscc, oscc->oscc_grow_count / 2))
+        /* refill early enough that the recent create rate does not drain
+         * the pool while the precreate RPC is in flight */
+        if (oscc_has_objects_nolock(oscc, max(oscc->oscc_grow_count / 2,
+                                              oscc_demand(oscc))))
                 GOTO(out, rc = 0);
 
         /* Return 0, if we have at least one object - bug 22884 */
@@ -421,9 +471,8 @@ static int handle_async_create(struct ptlrpc_request *req, int rc)
 
         if (oscc_has_objects_nolock(oscc, 1)) {
                 memcpy(oa, &oscc->oscc_oa, sizeof(*oa));
-                oa->o_id = oscc->oscc_next_id;
-                lsm->lsm_object_id = oscc->oscc_next_id;
-                oscc->oscc_next_id++;
+                oa->o_id = oscc_next_object(oscc);
+                lsm->lsm_object_id = oa->o_id;
 
                 CDEBUG(D_RPCTRACE, " set oscc_next_id = "LPU64"\n",
                        oscc->oscc_next_id);
@@ -671,10 +720,9 @@ int osc_create(struct obd_export *exp, struct obdo *oa,
 
                 if (oscc_has_objects_nolock(oscc, 1)) {
                         memcpy(oa, &oscc->oscc_oa, sizeof(*oa));
-                        oa->o_id = oscc->oscc_next_id;
-                        lsm->lsm_object_id = oscc->oscc_next_id;
+                        oa->o_id = oscc_next_object(oscc);
+                        lsm->lsm_object_id = oa->o_id;
                         *ea = lsm;
-                        oscc->oscc_next_id++;
                         cfs_spin_unlock(&oscc->oscc_lock);
 
                         CDEBUG(D_RPCTRACE, "%s: set oscc_next_id = "LPU64"\n",
@@ -717,6 +765,7 @@ void oscc_init(struct obd_device *obd)
 
         oscc->oscc_next_id = 2;
         oscc->oscc_last_id = 1;
+        oscc->oscc_rate_stamp = cfs_time_current_sec();
         oscc->oscc_flags |= OSCC_FLAG_RECOVERING;
 
         CFS_INIT_LIST_HEAD(&oscc->oscc_wait_create_list);
@@ -42,6 +42,8 @@
 
 #include "osc_cl_internal.h"
 
+static void osc_lru_use(struct osc_page *opg);
+
 /** \addtogroup osc 
  *  @{ 
  */
@@ -163,6 +165,7 @@ static void osc_page_fini(const struct lu_env *env,
         struct osc_page *opg = cl2osc_page(slice);
         CDEBUG(D_TRACE, "%p\n", opg);
         LASSERT(opg->ops_lock == NULL);
+        LASSERT(cfs_list_empty(&opg->ops_lru));
         OBD_SLAB_FREE_PTR(opg, osc_page_kmem);
 }
 
@@ -233,10 +236,12 @@ static int osc_page_cache_add(const struct lu_env *env,
         result = osc_queue_async_io(env, osc_export(obj), NULL, obj->oo_oinfo,
                                     &opg->ops_oap, OBD_BRW_WRITE | noquota,
                                     0, 0, brw_flags, 0);
-        if (result != 0)
+        if (result != 0) {
                 osc_page_transfer_put(env, opg);
-        else
+        } else {
                 osc_page_transfer_add(env, opg, CRT_WRITE);
+                osc_lru_use(opg);
+        }
         RETURN(result);
 }
 
@@ -298,6 +303,7 @@ static int osc_page_is_under_lock(const struct lu_env *env,
         int             result;
 
         ENTRY;
+        osc_lru_use(cl2osc_page(slice));
         lock = cl_lock_at_page(env, slice->cpl_obj, slice->cpl_page,
                                NULL, 1, 0);
         if (lock != NULL &&
@@ -408,6 +414,264 @@ static int osc_page_print(const struct lu_env *env,
                           osc_list(&loi->loi_write_lop.lop_urgent));
 }
 
+/*****************************************************************************
+ *
+ * LRU of cached pages.
+ *
+ * Each client_obd keeps its pages on cl_lru_list, least recently used first,
+ * and accounts them against the cl_client_cache budget it shares with the
+ * other client_obds of the mount. Pages move to the tail when Lustre sees
+ * them used (read under lock, dirtied); cache hits served by the kernel
+ * without calling into Lustre are caught by the VM referenced bit, which
+ * gives the page a second pass at scan time. When the budget is exhausted,
+ * a thread creating a new page reclaims a batch of clean, unused pages,
+ * first from its own client_obd and then round-robin from the others.
+ *
+ */
+
+static void osc_lru_add(struct client_obd *cli, struct osc_page *opg)
+{
+        if (cli->cl_cache == NULL)
+                return;
+
+        cfs_spin_lock(&cli->cl_lru_lock);
+        cfs_list_add_tail(&opg->ops_lru, &cli->cl_lru_list);
+        cfs_atomic_inc(&cli->cl_lru_in_list);
+        cfs_spin_unlock(&cli->cl_lru_lock);
+        cfs_atomic_dec(&cli->cl_cache->ccc_lru_left);
+}
+
+/**
+ * Moves \a opg to the most recently used end of its client_obd list.
+ */
+static void osc_lru_use(struct osc_page *opg)
+{
+        struct client_obd *cli = opg->ops_oap.oap_cli;
+
+        if (cfs_list_empty(&opg->ops_lru))
+                return;
+
+        cfs_spin_lock(&cli->cl_lru_lock);
+        if (!cfs_list_empty(&opg->ops_lru))
+                cfs_list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+        cfs_spin_unlock(&cli->cl_lru_lock);
+}
+
+/**
+ * True iff the VM saw \a page accessed since the last scan; clears the bit
+ * so that the page is only spared once.
+ */
+static int osc_lru_page_referenced(const struct lu_env *env,
+                                   struct cl_page *page)
+{
+#ifdef __KERNEL__
+        return TestClearPageReferenced(cl_page_vmpage(env, page));
+#else
+        return 0;
+#endif
+}
+
+static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
+{
+        if (cfs_list_empty(&opg->ops_lru))
+                return;
+
+        LASSERT(cli->cl_cache != NULL);
+        cfs_spin_lock(&cli->cl_lru_lock);
+        cfs_list_del_init(&opg->ops_lru);
+        cfs_atomic_dec(&cli->cl_lru_in_list);
+        cfs_spin_unlock(&cli->cl_lru_lock);
+        cfs_atomic_inc(&cli->cl_cache->ccc_lru_left);
+}
+
+/**
+ * True iff the lock covering the page is being cancelled, or no lock covers
+ * it at all. Such a page is going to be discarded soon anyway, so it is the
+ * cheapest one to reclaim.
+ */
+static int osc_lru_page_cancelling(const struct lu_env *env,
+                                   struct osc_page *opg)
+{
+        struct cl_page *page = opg->ops_cl.cpl_page;
+        struct cl_lock *lock;
+        int result = 1;
+
+        lock = cl_lock_at_page(env, opg->ops_cl.cpl_obj, page, NULL, 1, 1);
+        if (lock != NULL) {
+                const struct cl_lock_slice *slice;
+                struct ldlm_lock *dlmlock;
+
+                slice = cl_lock_at(lock, &osc_device_type);
+                dlmlock = slice != NULL ? cl2osc_lock(slice)->ols_lock : NULL;
+                result = (lock->cll_flags & (CLF_CANCELPEND|CLF_CANCELLED)) ||
+                         (dlmlock != NULL &&
+                          dlmlock->l_flags & LDLM_FL_CBPENDING);
+                cl_lock_put(env, lock);
+        }
+        return result;
+}
+
+/**
+ * Clean pages not queued for or under transfer can be dropped. Stable once
+ * the page is owned, as queueing a page requires owning it.
+ */
+static int osc_lru_page_reclaimable(struct osc_page *opg)
+{
+        struct osc_async_page *oap = &opg->ops_oap;
+
+        return !opg->ops_transfer_pinned &&
+               cfs_list_empty(&oap->oap_pending_item) &&
+               cfs_list_empty(&oap->oap_urgent_item) &&
+               cfs_list_empty(&oap->oap_rpc_item);
+}
+
+/**
+ * Scans at most 2 * \a target pages from the head of \a cli LRU list and
+ * discards up to \a target of them, sparing those referenced since the last
+ * scan. If \a cancelling is set, only pages whose covering lock is being
+ * cancelled are taken.
+ */
+static int osc_lru_shrink0(const struct lu_env *env, struct client_obd *cli,
+                           int target, int cancelling)
+{
+        struct cl_io     *io    = &cl_env_info(env)->clt_io;
+        struct cl_object *clobj = NULL;
+        struct osc_page  *opg;
+        struct cl_page   *page;
+        int               count = 0;
+        int               maxscan;
+        int               rc = 0;
+
+        cfs_spin_lock(&cli->cl_lru_lock);
+        maxscan = min(target << 1, cfs_atomic_read(&cli->cl_lru_in_list));
+        while (!cfs_list_empty(&cli->cl_lru_list) && maxscan-- > 0 &&
+               count < target) {
+                opg = cfs_list_entry(cli->cl_lru_list.next, struct osc_page,
+                                     ops_lru);
+                /* rotate, whether or not the page is reclaimed */
+                cfs_list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+                if (!osc_lru_page_reclaimable(opg))
+                        continue;
+
+                page = cl_page_top(opg->ops_cl.cpl_page);
+                if (page->cp_state != CPS_CACHED)
+                        continue;
+                /* recently used pages get another trip round the list,
+                 * unless their lock is going away anyway */
+                if (!cancelling && osc_lru_page_referenced(env, page))
+                        continue;
+                cl_page_get(page);
+                cfs_spin_unlock(&cli->cl_lru_lock);
+
+                if (cancelling && !osc_lru_page_cancelling(env, opg))
+                        goto next;
+
+                if (clobj != page->cp_obj) {
+                        if (clobj != NULL) {
+                                cl_io_fini(env, io);
+                                cl_object_put(env, clobj);
+                        }
+                        /* cl_io_fini() is due even if cl_io_init() fails */
+                        clobj = page->cp_obj;
+                        cl_object_get(clobj);
+                        memset(io, 0, sizeof(*io));
+                        io->ci_obj = clobj;
+                        rc = cl_io_init(env, io, CIT_MISC, clobj);
+                        if (rc != 0) {
+                                cl_page_put(env, page);
+                                cfs_spin_lock(&cli->cl_lru_lock);
+                                break;
+                        }
+                }
+
+                if (cl_page_own_try(env, io, page) == 0) {
+                        if (osc_lru_page_reclaimable(opg)) {
+                                cl_page_unmap(env, io, page);
+                                cl_page_discard(env, io, page);
+                                ++count;
+                        }
+                        cl_page_disown(env, io, page);
+                }
+next:
+                cl_page_put(env, page);
+                cfs_spin_lock(&cli->cl_lru_lock);
+        }
+        cfs_spin_unlock(&cli->cl_lru_lock);
+
+        if (clobj != NULL) {
+                cl_io_fini(env, io);
+                cl_object_put(env, clobj);
+        }
+        return count;
+}
+
+/**
+ * Reclaims up to \a target pages from \a cli, preferring those whose lock is
+ * being cancelled. Returns the number of pages discarded.
+ */
+int osc_lru_shrink(struct client_obd *cli, int target)
+{
+        struct cl_client_cache *cache = cli->cl_cache;
+        struct cl_env_nest      nest;
+        struct lu_env          *env;
+        int                     count;
+
+        if (cache == NULL || target <= 0 ||
+            cfs_atomic_read(&cli->cl_lru_in_list) == 0)
+                return 0;
+
+        env = cl_env_nested_get(&nest);
+        if (IS_ERR(env))
+                return 0;
+
+        cfs_atomic_inc(&cache->ccc_shrink_calls);
+        count = osc_lru_shrink0(env, cli, target, 1);
+        cfs_atomic_add(count, &cache->ccc_reclaimed_cancel);
+        if (count < target)
+                count += osc_lru_shrink0(env, cli, target - count, 0);
+        cfs_atomic_add(count, &cache->ccc_reclaimed);
+
+        cl_env_nested_put(&nest, env);
+        return count;
+}
+
+/**
+ * Called before a new page is accounted. If the budget is exhausted, reclaim
+ * a batch of pages, from \a cli first and then from the other client_obds
+ * sharing the budget. Never blocks waiting for budget: if nothing can be
+ * reclaimed, the budget is temporarily overcommitted.
+ */
+static void osc_lru_reserve(struct client_obd *cli)
+{
+        struct cl_client_cache *cache = cli->cl_cache;
+        struct client_obd      *victim;
+        int                     target = cli->cl_max_pages_per_rpc;
+        int                     tries;
+
+        if (cache == NULL || cfs_atomic_read(&cache->ccc_lru_left) > 0 ||
+            cfs_memory_pressure_get())
+                return;
+
+        if (osc_lru_shrink(cli, target) > 0)
+                return;
+
+        tries = cfs_atomic_read(&cache->ccc_users);
+        while (tries-- > 0 && cfs_atomic_read(&cache->ccc_lru_left) <= 0) {
+                cfs_spin_lock(&cache->ccc_lru_lock);
+                if (cfs_list_empty(&cache->ccc_lru)) {
+                        cfs_spin_unlock(&cache->ccc_lru_lock);
+                        break;
+                }
+                victim = cfs_list_entry(cache->ccc_lru.next,
+                                        struct client_obd, cl_lru_osc);
+                cfs_list_move_tail(&victim->cl_lru_osc, &cache->ccc_lru);
+                cfs_spin_unlock(&cache->ccc_lru_lock);
+
+                if (victim != cli && osc_lru_shrink(victim, target) > 0)
+                        break;
+        }
+}
+
 static void osc_page_delete(const struct lu_env *env,
                             const struct cl_page_slice *slice)
 {
@@ -430,6 +694,7 @@ static void osc_page_delete(const struct lu_env *env,
         cfs_spin_lock(&obj->oo_seatbelt);
         cfs_list_del_init(&opg->ops_inflight);
         cfs_spin_unlock(&obj->oo_seatbelt);
+        osc_lru_del(oap->oap_cli, opg);
         EXIT;
 }
 
@@ -636,11 +901,16 @@ struct cl_page *osc_page_init(const struct lu_env *env,
                                              cl_offset(obj, page->cp_index),
                                              &osc_async_page_ops,
                                              opg, (void **)&oap, 1, NULL);
+                CFS_INIT_LIST_HEAD(&opg->ops_lru);
                 if (result == 0) {
                         struct osc_io *oio = osc_env_io(env);
+                        struct client_obd *cli = opg->ops_oap.oap_cli;
+
                         opg->ops_srvlock = osc_io_srvlock(oio);
                         cl_page_slice_add(page, &opg->ops_cl, obj,
                                           &osc_page_ops);
+                        osc_lru_reserve(cli);
+                        osc_lru_add(cli, opg);
                 }
                 /*
                  * Cannot assert osc_page_protected() here as read-ahead
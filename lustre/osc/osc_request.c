@@ -1954,6 +1954,223 @@ out:
         RETURN(rc);
 }
 
+/*
+ * Window of the uncached O_DIRECT RPCs built by one osc_brw_async() call.
+ * The RPCs are only added to the caller's set while fewer than
+ * cl_max_rpcs_in_flight RPCs are in flight, and are accounted in
+ * cl_{r,w}_in_flight like cached I/O.  Each completion lets the next one in
+ * from osc_brw_async_interpret(), which runs in the context of the set.
+ */
+struct osc_brw_dio {
+        struct ptlrpc_request_set *bd_set;
+        cfs_list_t                 bd_pending;   /* RPCs not yet in bd_set,
+                                                  * linked by rq_set_chain */
+        int                        bd_in_flight; /* RPCs of bd_set in flight */
+};
+
+/* Move RPCs of \a dio into its set while there are free RPC slots.  One RPC
+ * of each window is always let in, so that uncached I/O still progresses
+ * while cached I/O holds all slots.  Must be called with the loi lock held. */
+static void osc_brw_dio_admit(struct client_obd *cli, struct osc_brw_dio *dio)
+{
+        struct ptlrpc_request *req;
+
+        while (!cfs_list_empty(&dio->bd_pending) &&
+               (dio->bd_in_flight == 0 ||
+                rpcs_in_flight(cli) < cli->cl_max_rpcs_in_flight)) {
+                req = cfs_list_entry(dio->bd_pending.next,
+                                     struct ptlrpc_request, rq_set_chain);
+                cfs_list_del_init(&req->rq_set_chain);
+
+                if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+                        lprocfs_oh_tally(&cli->cl_write_rpc_hist,
+                                         cli->cl_w_in_flight);
+                        cli->cl_w_in_flight++;
+                } else {
+                        lprocfs_oh_tally(&cli->cl_read_rpc_hist,
+                                         cli->cl_r_in_flight);
+                        cli->cl_r_in_flight++;
+                }
+                dio->bd_in_flight++;
+                ptlrpc_set_add_req(dio->bd_set, req);
+        }
+}
+
+/* Release an RPC of a window which was never sent. */
+static void osc_brw_dio_release(struct ptlrpc_request *req)
+{
+        struct osc_brw_async_args *aa = ptlrpc_req_async_args(req);
+
+        if (aa->aa_ocapa) {
+                capa_put(aa->aa_ocapa);
+                aa->aa_ocapa = NULL;
+        }
+        OBDO_FREE(aa->aa_oa);
+        osc_release_ppga(aa->aa_ppga, aa->aa_page_count);
+        ptlrpc_req_finished(req);
+}
+
+/* Account the end of an RPC of \a dio and let the next ones in, or, after an
+ * error, drop the RPCs not sent yet.  \a opc is 0 when called at the end of
+ * osc_brw_async() itself.  Frees \a dio with its last RPC. */
+static void osc_brw_dio_done(const struct lu_env *env, struct client_obd *cli,
+                             struct osc_brw_dio *dio, int opc, int rc)
+{
+        struct ptlrpc_request *req;
+        struct ptlrpc_request *next;
+        CFS_LIST_HEAD(drop);
+        int last;
+
+        client_obd_list_lock(&cli->cl_loi_list_lock);
+        if (opc == OST_WRITE)
+                cli->cl_w_in_flight--;
+        else if (opc == OST_READ)
+                cli->cl_r_in_flight--;
+        if (opc != 0)
+                dio->bd_in_flight--;
+
+        /* like lov_brw(), stop at the first error */
+        if (rc != 0)
+                cfs_list_splice_init(&dio->bd_pending, &drop);
+        else
+                osc_brw_dio_admit(cli, dio);
+        last = dio->bd_in_flight == 0 && cfs_list_empty(&dio->bd_pending);
+
+        if (opc != 0) {
+                osc_wake_cache_waiters(cli);
+                osc_check_rpcs(env, cli);
+        }
+        client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+        cfs_list_for_each_entry_safe(req, next, &drop, rq_set_chain) {
+                cfs_list_del_init(&req->rq_set_chain);
+                osc_brw_dio_release(req);
+        }
+        if (last)
+                OBD_FREE_PTR(dio);
+}
+
+static int osc_brw_async_interpret(const struct lu_env *env,
+                                   struct ptlrpc_request *req, void *data,
+                                   int rc)
+{
+        struct osc_brw_async_args *aa = data;
+        ENTRY;
+
+        rc = osc_brw_fini_request(req, rc);
+        CDEBUG(D_INODE, "request %p aa %p rc %d\n", req, aa, rc);
+        if (osc_recoverable_error(rc)) {
+                /* the resent RPC keeps the slot of this one */
+                rc = osc_brw_redo_request(req, aa);
+                if (rc == 0)
+                        RETURN(0);
+        }
+
+        if (aa->aa_ocapa) {
+                capa_put(aa->aa_ocapa);
+                aa->aa_ocapa = NULL;
+        }
+
+        osc_brw_dio_done(env, aa->aa_cli, aa->aa_dio,
+                         lustre_msg_get_opc(req->rq_reqmsg), rc);
+
+        OBDO_FREE(aa->aa_oa);
+        osc_release_ppga(aa->aa_ppga, aa->aa_page_count);
+        RETURN(rc);
+}
+
+/* Split \a pga into full-sized RPCs and add them to \a set, so that they
+ * are in flight at the same time.  Unlike osc_brw() the pages are not sent
+ * one RPC after the other, but no more than max_rpcs_in_flight RPCs of the
+ * OSC are in flight, see struct osc_brw_dio.  Each RPC gets its own copy of
+ * the obdo, since the checksum and grant fields are per RPC, and holds a
+ * reference on the capability for resends. */
+static int osc_brw_async(int cmd, struct obd_export *exp,
+                         struct obd_info *oinfo, obd_count page_count,
+                         struct brw_page *pga, struct obd_trans_info *oti,
+                         struct ptlrpc_request_set *set)
+{
+        struct brw_page **ppga, **orig;
+        struct obd_import *imp = class_exp2cliimp(exp);
+        struct client_obd *cli;
+        struct ptlrpc_request *req;
+        struct osc_brw_async_args *aa;
+        struct osc_brw_dio *dio;
+        int rc = 0, page_count_orig;
+        ENTRY;
+
+        LASSERT((imp != NULL) && (imp->imp_obd != NULL));
+        cli = &imp->imp_obd->u.cli;
+        LASSERT(cli->cl_max_pages_per_rpc);
+
+        OBD_ALLOC_PTR(dio);
+        if (dio == NULL)
+                RETURN(-ENOMEM);
+        dio->bd_set = set;
+        CFS_INIT_LIST_HEAD(&dio->bd_pending);
+
+        orig = ppga = osc_build_ppga(pga, page_count);
+        if (ppga == NULL) {
+                OBD_FREE_PTR(dio);
+                RETURN(-ENOMEM);
+        }
+        page_count_orig = page_count;
+
+        sort_brw_pages(ppga, page_count);
+        while (page_count) {
+                struct brw_page **rpc_ppga;
+                struct obdo *oa;
+                obd_count pages_per_brw;
+
+                if (page_count > cli->cl_max_pages_per_rpc)
+                        pages_per_brw = cli->cl_max_pages_per_rpc;
+                else
+                        pages_per_brw = page_count;
+
+                pages_per_brw = max_unfragmented_pages(ppga, pages_per_brw);
+
+                /* released by osc_brw_async_interpret() */
+                OBDO_ALLOC(oa);
+                if (oa == NULL)
+                        GOTO(out, rc = -ENOMEM);
+                *oa = *oinfo->oi_oa;
+
+                OBD_ALLOC(rpc_ppga, sizeof(*rpc_ppga) * pages_per_brw);
+                if (rpc_ppga == NULL) {
+                        OBDO_FREE(oa);
+                        GOTO(out, rc = -ENOMEM);
+                }
+                memcpy(rpc_ppga, ppga, sizeof(*rpc_ppga) * pages_per_brw);
+
+                rc = osc_brw_prep_request(cmd, cli, oa, oinfo->oi_md,
+                                          pages_per_brw, rpc_ppga, &req,
+                                          oinfo->oi_capa, 1, 0);
+                if (rc != 0) {
+                        osc_release_ppga(rpc_ppga, pages_per_brw);
+                        OBDO_FREE(oa);
+                        break;
+                }
+
+                req->rq_interpret_reply = osc_brw_async_interpret;
+                aa = ptlrpc_req_async_args(req);
+                aa->aa_dio = dio;
+                cfs_list_add_tail(&req->rq_set_chain, &dio->bd_pending);
+
+                client_obd_list_lock(&cli->cl_loi_list_lock);
+                osc_brw_dio_admit(cli, dio);
+                client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+                page_count -= pages_per_brw;
+                ppga += pages_per_brw;
+        }
+
+out:
+        /* drops the unsent RPCs on error and frees an unused window */
+        osc_brw_dio_done(NULL, cli, dio, 0, rc);
+        osc_release_ppga(orig, page_count_orig);
+        RETURN(rc);
+}
+
 /* The companion to osc_enter_cache(), called when @oap is no longer part of
  * the dirty accounting.  Writeback completes or truncate happens before
  * writing starts.  Must be called with the loi lock held. */
@@ -2340,6 +2557,7 @@ static struct ptlrpc_request *osc_build_req(const struct lu_env *env,
         LASSERT(ops != NULL);
         crattr.cra_oa = oa;
         crattr.cra_capa = NULL;
+        crattr.cra_jobid[0] = '\0';
         cl_req_attr_set(env, clerq, &crattr, ~0ULL);
         if (lock) {
                 oa->o_handle = lock->l_remote_handle;
@@ -2363,6 +2581,10 @@ static struct ptlrpc_request *osc_build_req(const struct lu_env *env,
         if (cmd & OBD_BRW_MEMALLOC)
                 req->rq_memalloc = 1;
 
+        /* the RPC is sent by ptlrpcd, account it to the job of the pages */
+        if (crattr.cra_jobid[0] != '\0')
+                lustre_msg_set_jobid(req->rq_reqmsg, crattr.cra_jobid);
+
         /* Need to update the timestamps after the request is built in case
          * we race with setattr (locally or in queue at OST).  If OST gets
          * later setattr before earlier BRW (as determined by the request xid),
@@ -4078,6 +4300,37 @@ static int osc_set_info_async(struct obd_export *exp, obd_count keylen,
                 RETURN(0);
         }
 
+        if (KEY_IS(KEY_CACHE_SET)) {
+                struct client_obd      *cli   = &obd->u.cli;
+                struct cl_client_cache *cache = val;
+
+                LASSERT(vallen == sizeof(*cache));
+                LASSERT(cli->cl_cache == NULL || cli->cl_cache == cache);
+                if (cli->cl_cache != NULL)
+                        RETURN(0);
+
+                cli->cl_cache = cache;
+                cfs_atomic_inc(&cache->ccc_users);
+                cfs_spin_lock(&cache->ccc_lru_lock);
+                cfs_list_add(&cli->cl_lru_osc, &cache->ccc_lru);
+                cfs_spin_unlock(&cache->ccc_lru_lock);
+                RETURN(0);
+        }
+
+        if (KEY_IS(KEY_CACHE_LRU_SHRINK)) {
+                struct client_obd *cli = &obd->u.cli;
+                int *target = val;
+                int  nr;
+
+                if (vallen != sizeof(int))
+                        RETURN(-EINVAL);
+                /* take at most half of our pages, the remaining target is
+                 * left for the next OSC */
+                nr = min(cfs_atomic_read(&cli->cl_lru_in_list) >> 1, *target);
+                *target -= osc_lru_shrink(cli, nr);
+                RETURN(0);
+        }
+
         if (KEY_IS(KEY_SPTLRPC_CONF)) {
                 sptlrpc_conf_client_adapt(obd);
                 RETURN(0);
@@ -4534,9 +4787,19 @@ static int osc_precleanup(struct obd_device *obd, enum obd_cleanup_stage stage)
 
 int osc_cleanup(struct obd_device *obd)
 {
+        struct client_obd *cli = &obd->u.cli;
         int rc;
 
         ENTRY;
+        if (cli->cl_cache != NULL) {
+                LASSERT(cfs_atomic_read(&cli->cl_cache->ccc_users) > 0);
+                cfs_spin_lock(&cli->cl_cache->ccc_lru_lock);
+                cfs_list_del_init(&cli->cl_lru_osc);
+                cfs_spin_unlock(&cli->cl_cache->ccc_lru_lock);
+                cfs_atomic_dec(&cli->cl_cache->ccc_users);
+                cli->cl_cache = NULL;
+        }
+
         ptlrpc_lprocfs_unregister_obd(obd);
         lprocfs_obd_cleanup(obd);
 
@@ -4596,6 +4859,7 @@ struct obd_ops osc_obd_ops = {
         .o_setattr              = osc_setattr,
         .o_setattr_async        = osc_setattr_async,
         .o_brw                  = osc_brw,
+        .o_brw_async            = osc_brw_async,
         .o_punch                = osc_punch,
         .o_sync                 = osc_sync,
         .o_enqueue              = osc_enqueue,
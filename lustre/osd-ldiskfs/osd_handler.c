@@ -99,6 +99,12 @@ struct osd_object {
          * to protect index ops.
          */
         cfs_rw_semaphore_t     oo_ext_idx_sem;
+        /**
+         * leaf-local changes of the EA directory running under the shared
+         * oo_ext_idx_sem, and their count, see osd_ea_leaf_change_begin().
+         */
+        cfs_atomic_t           oo_leaf_writers;
+        cfs_atomic_t           oo_leaf_gen;
         cfs_rw_semaphore_t     oo_sem;
         struct osd_directory  *oo_dir;
         /** protects inode attributes. */
@@ -172,6 +178,13 @@ static struct super_block *osd_sb(const struct osd_device *dev)
         return dev->od_mount->lmi_mnt->mnt_sb;
 }
 
+static struct osd_oi *osd_fid2oi(struct osd_device *osd,
+                                 const struct lu_fid *fid)
+{
+        LASSERT(osd->od_oi_table != NULL);
+        return osd_oi_select(osd->od_oi_table, osd->od_oi_count, fid);
+}
+
 static int osd_object_is_root(const struct osd_object *obj)
 {
         return osd_sb(osd_obj2dev(obj))->s_root->d_inode == obj->oo_inode;
@@ -306,6 +319,8 @@ static struct lu_object *osd_object_alloc(const struct lu_env *env,
                 l->lo_ops = &osd_lu_obj_ops;
                 cfs_init_rwsem(&mo->oo_sem);
                 cfs_init_rwsem(&mo->oo_ext_idx_sem);
+                cfs_atomic_set(&mo->oo_leaf_writers, 0);
+                cfs_atomic_set(&mo->oo_leaf_gen, 0);
                 cfs_spin_lock_init(&mo->oo_guard);
                 return l;
         } else
@@ -368,6 +383,7 @@ static int osd_fid_lookup(const struct lu_env *env,
         struct osd_inode_id    *id;
         struct osd_oi          *oi;
         struct inode           *inode;
+        int                     retried = 0;
         int                     result;
 
         LINVRNT(osd_invariant(obj));
@@ -385,14 +401,20 @@ static int osd_fid_lookup(const struct lu_env *env,
         info = osd_oti_get(env);
         dev  = osd_dev(ldev);
         id   = &info->oti_id;
-        oi   = &dev->od_oi;
+        oi   = osd_fid2oi(dev, fid);
 
         if (OBD_FAIL_CHECK(OBD_FAIL_OST_ENOENT))
                 RETURN(-ENOENT);
 
+again:
         result = osd_oi_lookup(info, oi, fid, id);
         if (result == 0) {
                 inode = osd_iget(info, dev, id);
+                /* a cached mapping may be stale, retry through the index */
+                if (IS_ERR(inode) && !retried && osd_oi_cache_del(oi, fid)) {
+                        retried = 1;
+                        goto again;
+                }
                 if (!IS_ERR(inode)) {
                         obj->oo_inode = inode;
                         LASSERT(obj->oo_inode->i_sb == osd_sb(dev));
@@ -762,7 +784,7 @@ static int osd_inode_remove(const struct lu_env *env, struct osd_object *obj)
         th = osd_trans_start(env_del_obj, &osd->od_dt_dev, prm);
         if (!IS_ERR(th)) {
                 result = osd_oi_delete(osd_oti_get(env_del_obj),
-                                       &osd->od_oi, fid, th);
+                                       osd_fid2oi(osd, fid), fid, th);
                 osd_trans_stop(env_del_obj, th);
         } else
                 result = PTR_ERR(th);
@@ -877,6 +899,7 @@ static void osd_conf_get(const struct lu_env *env,
         param->ddp_max_name_len  = LDISKFS_NAME_LEN;
         param->ddp_max_nlink     = LDISKFS_LINK_MAX;
         param->ddp_block_shift   = osd_sb(osd_dt_dev(dev))->s_blocksize_bits;
+        param->ddp_oi_count      = osd_dt_dev(dev)->od_oi_count;
 }
 
 /**
@@ -1737,7 +1760,7 @@ static int __osd_oi_insert(const struct lu_env *env, struct osd_object *obj,
         id->oii_ino = obj->oo_inode->i_ino;
         id->oii_gen = obj->oo_inode->i_generation;
 
-        return osd_oi_insert(info, &osd->od_oi, fid, id, th,
+        return osd_oi_insert(info, osd_fid2oi(osd, fid), fid, id, th,
                              uc->mu_cap & CFS_CAP_SYS_RESOURCE_MASK);
 }
 
@@ -2716,6 +2739,226 @@ static inline int osd_get_fid_from_dentry(struct ldiskfs_dir_entry_2 *de,
         RETURN(rc);
 }
 
+/*
+ * Parallel operations in EA directories.
+ *
+ * Adding or removing a name rewrites only the htree leaf block holding it,
+ * unless an add has to split the leaf. So lookups, deletes and inserts that
+ * fit in their leaf share oo_ext_idx_sem and lock the leaf with the
+ * i_htree_lock dynlock, keyed by its logical block number as in IAM.
+ * Leaf splits and deletes in directories without an htree index take
+ * oo_ext_idx_sem exclusively.
+ *
+ * readdir shares oo_ext_idx_sem too, but ldiskfs reads the leaves without
+ * the dynlock, so it could see an entry half written.  The leaf-local
+ * changes are bracketed by osd_ea_leaf_change_begin() and _end(), and
+ * osd_ldiskfs_it_fill() reads the entries again from the same htree
+ * position when one ran meanwhile.
+ */
+
+struct osd_dx_entry {
+        __le32 hash;
+        __le32 block;
+};
+
+static inline void osd_ea_leaf_change_begin(struct osd_object *obj)
+{
+        cfs_atomic_inc(&obj->oo_leaf_writers);
+        smp_mb();
+}
+
+static inline void osd_ea_leaf_change_end(struct osd_object *obj)
+{
+        smp_mb();
+        cfs_atomic_inc(&obj->oo_leaf_gen);
+        smp_mb();
+        cfs_atomic_dec(&obj->oo_leaf_writers);
+}
+
+static inline unsigned osd_dirent_disk_len(struct ldiskfs_dir_entry_2 *de,
+                                           unsigned blocksize)
+{
+        unsigned len = le16_to_cpu(de->rec_len);
+
+        /* 64KB blocks store their full length as 0 or 65535 */
+        if (len == 0 || len == 65535)
+                return blocksize;
+        return len;
+}
+
+/**
+ * Walks the htree index of \a dir down to the leaf where \a name is, or
+ * would be added, as ldiskfs dx_probe() does. Must be called with
+ * oo_ext_idx_sem held, which keeps the index from changing.
+ *
+ * \retval 0       logical block of the leaf is in \a leaf
+ * \retval -ENODATA \a dir has no index
+ * \retval -EAGAIN the index is not understood here, or entries with the
+ *                 hash of \a name may continue in the next leaf
+ */
+static int osd_ea_dx_leaf(struct inode *dir, const struct qstr *name,
+                          __u32 *leaf)
+{
+        struct super_block          *sb = dir->i_sb;
+        struct ldiskfs_dx_hash_info  hinfo;
+        struct ldiskfs_dir_entry_2  *de;
+        struct dx_root_info         *info;
+        struct dx_countlimit        *cl;
+        struct osd_dx_entry         *entries;
+        struct osd_dx_entry         *at;
+        struct osd_dx_entry         *p;
+        struct osd_dx_entry         *q;
+        struct buffer_head          *bh;
+        unsigned                     levels;
+        unsigned                     count;
+        __u32                        block;
+        int                          root = 1;
+        int                          err = 0;
+        int                          rc = -EAGAIN;
+
+        if (!(LDISKFS_I(dir)->i_flags & LDISKFS_INDEX_FL))
+                return -ENODATA;
+
+        bh = ldiskfs_bread(NULL, dir, 0, 0, &err);
+        if (bh == NULL)
+                return -EAGAIN;
+
+        /* the root info follows the "." and ".." entries */
+        de = (struct ldiskfs_dir_entry_2 *)bh->b_data;
+        de = (struct ldiskfs_dir_entry_2 *)((char *)de +
+                                            LDISKFS_DIR_REC_LEN(de));
+        info = (struct dx_root_info *)((char *)de + LDISKFS_DIR_REC_LEN(de));
+        if (info->reserved_zero != 0 || (info->unused_flags & 1) ||
+            info->indirect_levels > 1 ||
+            (info->hash_version != LDISKFS_DX_HASH_LEGACY &&
+             info->hash_version != LDISKFS_DX_HASH_HALF_MD4 &&
+             info->hash_version != LDISKFS_DX_HASH_TEA))
+                goto out;
+
+        hinfo.hash_version = info->hash_version;
+#ifdef LDISKFS_FLAGS_UNSIGNED_HASH
+        hinfo.hash_version += LDISKFS_SB(sb)->s_hash_unsigned;
+#endif
+        hinfo.seed = LDISKFS_SB(sb)->s_hash_seed;
+        ldiskfsfs_dirhash(name->name, name->len, &hinfo);
+
+        levels = info->indirect_levels;
+        entries = (struct osd_dx_entry *)((char *)info + info->info_length);
+        while (1) {
+                cl = (struct dx_countlimit *)entries;
+                count = le16_to_cpu(cl->count);
+                if (count == 0 || count > le16_to_cpu(cl->limit))
+                        goto out;
+
+                /* last entry with a hash not above that of the name */
+                p = entries + 1;
+                q = entries + count - 1;
+                while (p <= q) {
+                        at = p + (q - p) / 2;
+                        if (le32_to_cpu(at->hash) > hinfo.hash)
+                                q = at - 1;
+                        else
+                                p = at + 1;
+                }
+                at = p - 1;
+                block = le32_to_cpu(at->block) & 0x00ffffff;
+                if (block >= dir->i_size >> sb->s_blocksize_bits)
+                        goto out;
+
+                if (levels == 0)
+                        break;
+                levels--;
+                root = 0;
+                brelse(bh);
+                bh = ldiskfs_bread(NULL, dir, block, 0, &err);
+                if (bh == NULL)
+                        return -EAGAIN;
+                entries = (struct osd_dx_entry *)(bh->b_data +
+                                                  sizeof(struct fake_dirent));
+        }
+
+        /* ldiskfs goes on to the next leaf while it starts with the same
+         * hash; at the end of a non-root node that is not known here */
+        if (at + 1 < entries + count)
+                rc = (le32_to_cpu(at[1].hash) & ~1) == hinfo.hash ?
+                     -EAGAIN : 0;
+        else
+                rc = root ? 0 : -EAGAIN;
+        if (rc == 0)
+                *leaf = block;
+out:
+        brelse(bh);
+        return rc;
+}
+
+/**
+ * Locks the htree leaf of \a dir where the name of \a dentry lives.
+ *
+ * \retval 0       leaf locked, its logical block is in \a leaf
+ * \retval -ENODATA \a dir has no index
+ * \retval -EAGAIN the caller has to take oo_ext_idx_sem exclusively
+ */
+static int osd_ea_leaf_lock(struct inode *dir, struct dentry *dentry,
+                            enum dynlock_type lt, struct dynlock_handle **lh,
+                            __u32 *leaf)
+{
+        int rc;
+
+        *lh = NULL;
+        rc = osd_ea_dx_leaf(dir, &dentry->d_name, leaf);
+        if (rc == 0) {
+                *lh = iam_lock_htree(dir, *leaf, lt);
+                if (*lh == NULL)
+                        rc = -EAGAIN;
+        }
+        return rc;
+}
+
+/**
+ * True iff the entry for \a dentry fits in leaf \a leaf of \a dir as it is,
+ * by the same test as ldiskfs add_dirent_to_buf(), so that adding it does
+ * not split the leaf.
+ */
+static int osd_ea_leaf_fits(struct inode *dir, __u32 leaf,
+                            struct dentry *dentry)
+{
+        unsigned                    blocksize = dir->i_sb->s_blocksize;
+        struct ldiskfs_dir_entry_2 *de;
+        struct buffer_head         *bh;
+        unsigned char              *data;
+        unsigned                    reclen;
+        unsigned                    nlen;
+        unsigned                    rlen;
+        char                       *top;
+        int                         err = 0;
+        int                         fits = 0;
+
+        data = ldiskfs_dentry_get_data(dir->i_sb,
+                        (struct ldiskfs_dentry_param *)dentry->d_fsdata);
+        reclen = __LDISKFS_DIR_REC_LEN(dentry->d_name.len +
+                                       (data != NULL ? *data + 1 : 0));
+
+        bh = ldiskfs_bread(NULL, dir, leaf, 0, &err);
+        if (bh == NULL)
+                return 0;
+
+        de = (struct ldiskfs_dir_entry_2 *)bh->b_data;
+        top = bh->b_data + blocksize - reclen;
+        while ((char *)de <= top) {
+                rlen = osd_dirent_disk_len(de, blocksize);
+                nlen = LDISKFS_DIR_REC_LEN(de);
+                if (rlen < nlen)
+                        break;
+                if ((de->inode ? rlen - nlen : rlen) >= reclen) {
+                        fits = 1;
+                        break;
+                }
+                de = (struct ldiskfs_dir_entry_2 *)((char *)de + rlen);
+        }
+        brelse(bh);
+        return fits;
+}
+
 /**
  * Index delete function for interoperability mode (b11826).
  * It will remove the directory entry added by osd_index_ea_insert().
@@ -2736,7 +2979,9 @@ static int osd_index_ea_delete(const struct lu_env *env, struct dt_object *dt,
         struct osd_thandle         *oh;
         struct ldiskfs_dir_entry_2 *de;
         struct buffer_head         *bh;
-
+        struct dynlock_handle      *lh;
+        __u32                       leaf;
+        int                         excl = 0;
         int rc;
 
         ENTRY;
@@ -2755,7 +3000,14 @@ static int osd_index_ea_delete(const struct lu_env *env, struct dt_object *dt,
         dentry = osd_child_dentry_get(env, obj,
                                       (char *)key, strlen((char *)key));
 
-        cfs_down_write(&obj->oo_ext_idx_sem);
+        cfs_down_read(&obj->oo_ext_idx_sem);
+        if (osd_ea_leaf_lock(dir, dentry, DLT_WRITE, &lh, &leaf) != 0) {
+                cfs_up_read(&obj->oo_ext_idx_sem);
+                cfs_down_write(&obj->oo_ext_idx_sem);
+                excl = 1;
+        }
+        if (!excl)
+                osd_ea_leaf_change_begin(obj);
         bh = ll_ldiskfs_find_entry(dir, dentry, &de);
         if (bh) {
                 rc = ldiskfs_delete_entry(oh->ot_handle,
@@ -2763,8 +3015,15 @@ static int osd_index_ea_delete(const struct lu_env *env, struct dt_object *dt,
                 brelse(bh);
         } else
                 rc = -ENOENT;
+        if (!excl)
+                osd_ea_leaf_change_end(obj);
 
-        cfs_up_write(&obj->oo_ext_idx_sem);
+        if (excl) {
+                cfs_up_write(&obj->oo_ext_idx_sem);
+        } else {
+                iam_unlock_htree(dir, lh);
+                cfs_up_read(&obj->oo_ext_idx_sem);
+        }
         LASSERT(osd_invariant(obj));
         RETURN(rc);
 }
@@ -2900,6 +3159,30 @@ static int osd_index_iam_insert(const struct lu_env *env, struct dt_object *dt,
  * \retval   0, on success
  * \retval -ve, on error
  */
+/**
+ * Sets up the thread dentry used to add \a name, passing \a fid to ldiskfs
+ * for the dirent if it is one ldiskfs can store.
+ */
+static struct dentry *osd_ea_child_dentry(struct osd_thread_info *info,
+                                          struct osd_object *pobj,
+                                          const char *name,
+                                          const struct dt_rec *fid)
+{
+        struct ldiskfs_dentry_param *ldp;
+        struct dentry               *child;
+
+        child = osd_child_dentry_get(info->oti_env, pobj, name, strlen(name));
+
+        if (fid_is_igif((struct lu_fid *)fid) ||
+            fid_is_norm((struct lu_fid *)fid)) {
+                ldp = (struct ldiskfs_dentry_param *)info->oti_ldp;
+                osd_get_ldiskfs_dirent_param(ldp, fid);
+                child->d_fsdata = (void*) ldp;
+        } else
+                child->d_fsdata = NULL;
+        return child;
+}
+
 static int __osd_ea_add_rec(struct osd_thread_info *info,
                             struct osd_object *pobj,
                             struct inode  *cinode,
@@ -2907,7 +3190,6 @@ static int __osd_ea_add_rec(struct osd_thread_info *info,
                             const struct dt_rec *fid,
                             struct thandle *th)
 {
-        struct ldiskfs_dentry_param *ldp;
         struct dentry      *child;
         struct osd_thandle *oth;
         int rc;
@@ -2916,20 +3198,54 @@ static int __osd_ea_add_rec(struct osd_thread_info *info,
         LASSERT(oth->ot_handle != NULL);
         LASSERT(oth->ot_handle->h_transaction != NULL);
 
-        child = osd_child_dentry_get(info->oti_env, pobj, name, strlen(name));
-
-        if (fid_is_igif((struct lu_fid *)fid) ||
-            fid_is_norm((struct lu_fid *)fid)) {
-                ldp = (struct ldiskfs_dentry_param *)info->oti_ldp;
-                osd_get_ldiskfs_dirent_param(ldp, fid);
-                child->d_fsdata = (void*) ldp;
-        } else
-                child->d_fsdata = NULL;
+        child = osd_ea_child_dentry(info, pobj, name, fid);
         rc = ldiskfs_add_entry(oth->ot_handle, child, cinode);
 
         RETURN(rc);
 }
 
+/**
+ * Adds \a name to \a pobj. Runs in parallel with other operations in the
+ * directory if the name fits in its htree leaf, otherwise takes
+ * oo_ext_idx_sem exclusively as ldiskfs may split the leaf.
+ */
+static int osd_ea_add_rec_shared(struct osd_thread_info *info,
+                                 struct osd_object *pobj,
+                                 struct inode *cinode,
+                                 const char *name,
+                                 const struct dt_rec *fid,
+                                 struct thandle *th)
+{
+        struct inode          *dir = pobj->oo_inode;
+        struct osd_thandle    *oth;
+        struct dynlock_handle *lh;
+        struct dentry         *child;
+        __u32                  leaf;
+        int                    rc;
+
+        oth = container_of(th, struct osd_thandle, ot_super);
+        child = osd_ea_child_dentry(info, pobj, name, fid);
+
+        cfs_down_read(&pobj->oo_ext_idx_sem);
+        if (osd_ea_leaf_lock(dir, child, DLT_WRITE, &lh, &leaf) == 0) {
+                if (osd_ea_leaf_fits(dir, leaf, child)) {
+                        osd_ea_leaf_change_begin(pobj);
+                        rc = ldiskfs_add_entry(oth->ot_handle, child, cinode);
+                        osd_ea_leaf_change_end(pobj);
+                        iam_unlock_htree(dir, lh);
+                        cfs_up_read(&pobj->oo_ext_idx_sem);
+                        return rc;
+                }
+                iam_unlock_htree(dir, lh);
+        }
+        cfs_up_read(&pobj->oo_ext_idx_sem);
+
+        cfs_down_write(&pobj->oo_ext_idx_sem);
+        rc = __osd_ea_add_rec(info, pobj, cinode, name, fid, th);
+        cfs_up_write(&pobj->oo_ext_idx_sem);
+        return rc;
+}
+
 /**
  * Calls ldiskfs_add_dot_dotdot() to add dot and dotdot entries
  * into the directory.Also sets flags into osd object to
@@ -3011,12 +3327,15 @@ static int osd_ea_add_rec(const struct lu_env *env,
         int rc;
 
         if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' &&
-                                                   name[2] =='\0')))
+                                                   name[2] =='\0'))) {
+                cfs_down_write(&pobj->oo_ext_idx_sem);
                 rc = osd_add_dot_dotdot(info, pobj, cinode, name,
                      (struct dt_rec *)lu_object_fid(&pobj->oo_dt.do_lu),
                                         fid, th);
-        else
-                rc = __osd_ea_add_rec(info, pobj, cinode, name, fid, th);
+                cfs_up_write(&pobj->oo_ext_idx_sem);
+        } else {
+                rc = osd_ea_add_rec_shared(info, pobj, cinode, name, fid, th);
+        }
 
         return rc;
 }
@@ -3037,7 +3356,10 @@ static int osd_ea_lookup_rec(const struct lu_env *env, struct osd_object *obj,
         struct ldiskfs_dir_entry_2 *de;
         struct buffer_head         *bh;
         struct lu_fid              *fid = (struct lu_fid *) rec;
-        int ino;
+        struct dynlock_handle      *lh;
+        __u32                       leaf;
+        int                         excl = 0;
+        int ino = 0;
         int rc;
 
         LASSERT(dir->i_op != NULL && dir->i_op->lookup != NULL);
@@ -3045,7 +3367,14 @@ static int osd_ea_lookup_rec(const struct lu_env *env, struct osd_object *obj,
         dentry = osd_child_dentry_get(env, obj,
                                       (char *)key, strlen((char *)key));
 
+        /* unindexed directories only change under the exclusive lock */
         cfs_down_read(&obj->oo_ext_idx_sem);
+        rc = osd_ea_leaf_lock(dir, dentry, DLT_READ, &lh, &leaf);
+        if (rc != 0 && rc != -ENODATA) {
+                cfs_up_read(&obj->oo_ext_idx_sem);
+                cfs_down_write(&obj->oo_ext_idx_sem);
+                excl = 1;
+        }
         bh = ll_ldiskfs_find_entry(dir, dentry, &de);
         if (bh) {
                 ino = le32_to_cpu(de->inode);
@@ -3053,12 +3382,19 @@ static int osd_ea_lookup_rec(const struct lu_env *env, struct osd_object *obj,
 
                 /* done with de, release bh */
                 brelse(bh);
-                if (rc != 0)
-                        rc = osd_ea_fid_get(env, obj, ino, fid);
         } else
                 rc = -ENOENT;
+        if (excl) {
+                cfs_up_write(&obj->oo_ext_idx_sem);
+        } else {
+                if (lh != NULL)
+                        iam_unlock_htree(dir, lh);
+                cfs_up_read(&obj->oo_ext_idx_sem);
+        }
 
-        cfs_up_read(&obj->oo_ext_idx_sem);
+        /* fall back to the inode EA without holding up inserts */
+        if (rc != 0 && ino != 0)
+                rc = osd_ea_fid_get(env, obj, ino, fid);
         RETURN (rc);
 }
 
@@ -3160,9 +3496,7 @@ static int osd_index_ea_insert(const struct lu_env *env, struct dt_object *dt,
                 else
                         cfs_cap_lower(CFS_CAP_SYS_RESOURCE);
 #endif
-                cfs_down_write(&obj->oo_ext_idx_sem);
                 rc = osd_ea_add_rec(env, obj, child->oo_inode, name, rec, th);
-                cfs_up_write(&obj->oo_ext_idx_sem);
 #ifdef HAVE_QUOTA_SUPPORT
                 cfs_curproc_cap_unpack(save);
 #endif
@@ -3572,6 +3906,9 @@ static int osd_ldiskfs_filldir(char *buf, const char *name, int namelen,
         RETURN(0);
 }
 
+/* attempts of osd_ldiskfs_it_fill() under the shared oo_ext_idx_sem */
+#define OSD_IT_FILL_RETRIES     4
+
 /**
  * Calls ->readdir() to load a directory entry at a time
  * and stored it in iterator's in-memory data structure.
@@ -3586,18 +3923,48 @@ static int osd_ldiskfs_it_fill(const struct dt_it *di)
         struct osd_it_ea   *it    = (struct osd_it_ea *)di;
         struct osd_object  *obj   = it->oie_obj;
         struct inode       *inode = obj->oo_inode;
+        loff_t             pos    = it->oie_file.f_pos;
+        int                retry  = 0;
+        int                gen;
         int                result = 0;
 
         ENTRY;
-        it->oie_dirent = it->oie_buf;
-        it->oie_rd_dirent = 0;
-
+        /*
+         * Leaf-local inserts and deletes run under the shared lock as well,
+         * see osd_ea_leaf_change_begin(): if one ran while the leaves were
+         * read, read them again from the same htree position (ldiskfs
+         * drops its cached entries as f_pos moved back).  Only a directory
+         * changing on every attempt keeps them out.
+         */
         cfs_down_read(&obj->oo_ext_idx_sem);
-        result = inode->i_fop->readdir(&it->oie_file, it,
-                                       (filldir_t) osd_ldiskfs_filldir);
-
+        do {
+                it->oie_dirent = it->oie_buf;
+                it->oie_rd_dirent = 0;
+                it->oie_file.f_pos = pos;
+
+                gen = cfs_atomic_read(&obj->oo_leaf_gen);
+                smp_mb();
+                if (cfs_atomic_read(&obj->oo_leaf_writers) != 0)
+                        continue;
+                result = inode->i_fop->readdir(&it->oie_file, it,
+                                        (filldir_t) osd_ldiskfs_filldir);
+                smp_mb();
+                if (cfs_atomic_read(&obj->oo_leaf_writers) == 0 &&
+                    cfs_atomic_read(&obj->oo_leaf_gen) == gen)
+                        break;
+        } while (++retry < OSD_IT_FILL_RETRIES);
         cfs_up_read(&obj->oo_ext_idx_sem);
 
+        if (retry == OSD_IT_FILL_RETRIES) {
+                cfs_down_write(&obj->oo_ext_idx_sem);
+                it->oie_dirent = it->oie_buf;
+                it->oie_rd_dirent = 0;
+                it->oie_file.f_pos = pos;
+                result = inode->i_fop->readdir(&it->oie_file, it,
+                                        (filldir_t) osd_ldiskfs_filldir);
+                cfs_up_write(&obj->oo_ext_idx_sem);
+        }
+
         if (it->oie_rd_dirent == 0) {
                 result = -EIO;
         } else {
@@ -3876,7 +4243,11 @@ static int osd_shutdown(const struct lu_env *env, struct osd_device *o)
                 lu_object_put(env, &o->od_obj_area->do_lu);
                 o->od_obj_area = NULL;
         }
-        osd_oi_fini(info, &o->od_oi);
+#ifdef LPROCFS
+        osd_oi_procfs_fini(o);
+#endif
+        osd_oi_fini(info, &o->od_oi_table, o->od_oi_count);
+        o->od_oi_count = 0;
 
         RETURN(0);
 }
@@ -4029,10 +4400,14 @@ static int osd_prepare(const struct lu_env *env,
 
         ENTRY;
         /* 1. initialize oi before any file create or file open */
-        result = osd_oi_init(oti, &osd->od_oi,
+        result = osd_oi_init(oti, &osd->od_oi_table,
                              &osd->od_dt_dev, lu2md_dev(pdev));
-        if (result != 0)
+        if (result < 0)
                 RETURN(result);
+        osd->od_oi_count = result;
+#ifdef LPROCFS
+        osd_oi_procfs_init(osd);
+#endif
 
         lmi = osd->od_mount;
         lsi = s2lsi(lmi->lmi_sb);
@@ -379,7 +379,7 @@ static int iam_leaf_load(struct iam_path *path)
         return err;
 }
 
-static void iam_unlock_htree(struct inode *dir, struct dynlock_handle *lh)
+void iam_unlock_htree(struct inode *dir, struct dynlock_handle *lh)
 {
         if (lh != NULL)
                 dynlock_unlock(&LDISKFS_I(dir)->i_htree_lock, lh);
@@ -961,9 +961,9 @@ struct ldiskfs_dir_entry_2 *move_entries(struct inode *dir,
 
 extern struct iam_descr iam_htree_compat_param;
 
-struct dynlock_handle *dx_lock_htree(struct inode *dir, unsigned long value,
-                                     enum dynlock_type lt);
-void dx_unlock_htree(struct inode *dir, struct dynlock_handle *lh);
+struct dynlock_handle *iam_lock_htree(struct inode *dir, unsigned long value,
+                                      enum dynlock_type lt);
+void iam_unlock_htree(struct inode *dir, struct dynlock_handle *lh);
 
 /*
  * external
@@ -98,8 +98,9 @@ struct osd_device {
         struct dt_device          od_dt_dev;
         /* information about underlying file system */
         struct lustre_mount_info *od_mount;
-        /* object index */
-        struct osd_oi             od_oi;
+        /* object index containers, selected by fid hash */
+        struct osd_oi            *od_oi_table;
+        unsigned int              od_oi_count;
         /*
          * XXX temporary stuff for object index: directory where every object
          * is named by its fid.
@@ -124,6 +125,7 @@ struct osd_device {
         cfs_hlist_head_t         *od_capa_hash;
 
         cfs_proc_dir_entry_t     *od_proc_entry;
+        cfs_proc_dir_entry_t     *od_oi_proc_entry;
         struct lprocfs_stats     *od_stats;
         /*
          * statfs optimization: we cache a bit.
@@ -294,6 +296,8 @@ struct osd_thread_info {
 void lprocfs_osd_init_vars(struct lprocfs_static_vars *lvars);
 int osd_procfs_init(struct osd_device *osd, const char *name);
 int osd_procfs_fini(struct osd_device *osd);
+int osd_oi_procfs_init(struct osd_device *osd);
+void osd_oi_procfs_fini(struct osd_device *osd);
 void osd_lprocfs_time_start(const struct lu_env *env);
 void osd_lprocfs_time_end(const struct lu_env *env,
                           struct osd_device *osd, int op);
@@ -94,6 +94,8 @@ out:
 
 int osd_procfs_fini(struct osd_device *osd)
 {
+        osd_oi_procfs_fini(osd);
+
         if (osd->od_stats)
                 lu_time_fini(&osd->od_stats);
 
@@ -104,6 +106,46 @@ int osd_procfs_fini(struct osd_device *osd)
         RETURN(0);
 }
 
+/**
+ * Export the counters of each oi container as oi/<container name>.
+ */
+int osd_oi_procfs_init(struct osd_device *osd)
+{
+        char name[16];
+        int  rc = 0;
+        int  i;
+        ENTRY;
+
+        if (osd->od_proc_entry == NULL)
+                RETURN(0);
+
+        osd->od_oi_proc_entry = lprocfs_register("oi", osd->od_proc_entry,
+                                                 NULL, NULL);
+        if (IS_ERR(osd->od_oi_proc_entry)) {
+                rc = PTR_ERR(osd->od_oi_proc_entry);
+                osd->od_oi_proc_entry = NULL;
+                CERROR("Error %d setting up oi lprocfs\n", rc);
+                RETURN(rc);
+        }
+
+        for (i = 0; rc == 0 && i < osd->od_oi_count; i++) {
+                osd_oi_name(name, sizeof(name), osd->od_oi_count, i);
+                rc = lprocfs_register_stats(osd->od_oi_proc_entry, name,
+                                            osd->od_oi_table[i].oi_stats);
+        }
+        if (rc != 0) {
+                CERROR("Error %d registering oi stats\n", rc);
+                osd_oi_procfs_fini(osd);
+        }
+        RETURN(rc);
+}
+
+void osd_oi_procfs_fini(struct osd_device *osd)
+{
+        if (osd->od_oi_proc_entry != NULL)
+                lprocfs_remove(&osd->od_oi_proc_entry);
+}
+
 void osd_lprocfs_time_start(const struct lu_env *env)
 {
         lu_lprocfs_time_start(env);
@@ -230,6 +272,17 @@ static int lprocfs_osd_rd_mntdev(char *page, char **start, off_t off, int count,
                         osd->od_mount->lmi_mnt->mnt_devname);
 }
 
+static int lprocfs_osd_rd_oi_count(char *page, char **start, off_t off,
+                                   int count, int *eof, void *data)
+{
+        struct osd_device *osd = data;
+
+        LASSERT(osd != NULL);
+        *eof = 1;
+
+        return snprintf(page, count, "%u\n", osd->od_oi_count);
+}
+
 struct lprocfs_vars lprocfs_osd_obd_vars[] = {
         { "blocksize",       lprocfs_osd_rd_blksize,     0, 0 },
         { "kbytestotal",     lprocfs_osd_rd_kbytestotal, 0, 0 },
@@ -239,6 +292,7 @@ struct lprocfs_vars lprocfs_osd_obd_vars[] = {
         { "filesfree",       lprocfs_osd_rd_filesfree,   0, 0 },
         { "fstype",          lprocfs_osd_rd_fstype,      0, 0 },
         { "mntdev",          lprocfs_osd_rd_mntdev,      0, 0 },
+        { "oi_count",        lprocfs_osd_rd_oi_count,    0, 0 },
         { 0 }
 };
 
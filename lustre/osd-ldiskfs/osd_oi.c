@@ -98,25 +98,68 @@ static const struct oi_descr oi_descr[OSD_OI_FID_NR] = {
         }
 };
 
+/**
+ * Number of oi containers a fresh device is formatted with. Devices that
+ * already have an object index keep the number they were formatted with.
+ */
+static int osd_oi_count = 1;
+CFS_MODULE_PARM(osd_oi_count, "i", int, 0444,
+                "number of OI containers created on a fresh device "
+                "(power of two, at most 64)");
+
+/**
+ * Number of fid->id mappings cached in memory per device, spread over its oi
+ * containers. 0 disables the cache.
+ */
+static int osd_oi_cache_size = 65536;
+CFS_MODULE_PARM(osd_oi_cache_size, "i", int, 0444,
+                "number of fid->inode mappings cached per device");
+
+/**
+ * Name and local fid of the \a idx-th of \a count oi containers. A single
+ * container keeps the historical "oi.16" name, so that devices formatted
+ * with one container remain usable by older servers.
+ */
+static void osd_oi_descr(struct lu_fid *fid, char *buf, int len,
+                         unsigned int count, int idx)
+{
+        LASSERT(idx < count);
+
+        if (count == 1) {
+                snprintf(buf, len, "%s", oi_descr[OSD_OI_FID_16].name);
+                lu_local_obj_fid(fid, oi_descr[OSD_OI_FID_16].oid);
+        } else {
+                snprintf(buf, len, "%s.%d", oi_descr[OSD_OI_FID_16].name,
+                         idx);
+                lu_local_obj_fid(fid, OSD_OI_FID_OID_FIRST + idx);
+        }
+}
+
+void osd_oi_name(char *buf, int len, unsigned int count, int idx)
+{
+        struct lu_fid fid;
+
+        osd_oi_descr(&fid, buf, len, count, idx);
+}
+
 static int osd_oi_index_create(struct osd_thread_info *info,
                                struct dt_device *dev,
-                               struct md_device *mdev)
+                               struct md_device *mdev,
+                               unsigned int count)
 {
         const struct lu_env *env;
         struct lu_fid *oi_fid = &info->oti_fid;
         struct md_object *mdo;
+        char name[16];
         int i;
-        int rc;
 
         env = info->oti_env;
 
-        for (i = rc = 0; i < OSD_OI_FID_NR && rc == 0; ++i) {
-                char *name;
-                name = oi_descr[i].name;
-                lu_local_obj_fid(oi_fid, oi_descr[i].oid);
-                oi_feat.dif_keysize_min = oi_descr[i].fid_size,
-                oi_feat.dif_keysize_max = oi_descr[i].fid_size,
+        oi_feat.dif_keysize_min = oi_descr[OSD_OI_FID_16].fid_size;
+        oi_feat.dif_keysize_max = oi_descr[OSD_OI_FID_16].fid_size;
 
+        for (i = 0; i < count; ++i) {
+                osd_oi_descr(oi_fid, name, sizeof(name), count, i);
                 mdo = llo_store_create_index(env, mdev, dev,
                                              "", name,
                                              oi_fid, &oi_feat);
@@ -129,60 +172,258 @@ static int osd_oi_index_create(struct osd_thread_info *info,
         return 0;
 }
 
+static int osd_oi_open(struct osd_thread_info *info, struct dt_device *dev,
+                       const char *name, struct osd_oi *oi)
+{
+        const struct lu_env *env = info->oti_env;
+        struct dt_object    *obj;
+        int                  rc;
+
+        oi_feat.dif_keysize_min = oi_descr[OSD_OI_FID_16].fid_size;
+        oi_feat.dif_keysize_max = oi_descr[OSD_OI_FID_16].fid_size;
+
+        obj = dt_store_open(env, dev, "", name, &info->oti_fid);
+        if (IS_ERR(obj))
+                return PTR_ERR(obj);
+
+        rc = obj->do_ops->do_index_try(env, obj, &oi_feat);
+        if (rc == 0) {
+                LASSERT(obj->do_index_ops != NULL);
+                oi->oi_dir = obj;
+        } else {
+                CERROR("Wrong index \"%s\": %d\n", name, rc);
+                lu_object_put(env, &obj->do_lu);
+        }
+        return rc;
+}
+
+static int osd_oi_cache_init(struct osd_oi *oi, unsigned int count)
+{
+        unsigned int slots = osd_oi_cache_size / count;
+        int i;
+
+        if (slots == 0)
+                return 0;
+
+        for (oi->oi_cache_bits = 0; (2U << oi->oi_cache_bits) <= slots; )
+                oi->oi_cache_bits++;
+
+        OBD_VMALLOC(oi->oi_cache,
+                    sizeof(*oi->oi_cache) << oi->oi_cache_bits);
+        if (oi->oi_cache == NULL)
+                return -ENOMEM;
+
+        for (i = 0; i < OSD_OI_CACHE_LOCKS; i++)
+                cfs_spin_lock_init(&oi->oi_cache_lock[i]);
+        return 0;
+}
+
+static void osd_oi_cache_fini(struct osd_oi *oi)
+{
+        if (oi->oi_cache != NULL) {
+                OBD_VFREE(oi->oi_cache,
+                          sizeof(*oi->oi_cache) << oi->oi_cache_bits);
+                oi->oi_cache = NULL;
+        }
+}
+
+static inline unsigned int osd_oi_cache_slot(struct osd_oi *oi,
+                                             const struct lu_fid *fid)
+{
+        if (oi->oi_cache_bits == 0)
+                return 0;
+        /* the low bits of fid_flatten() already chose the container */
+        return cfs_hash_long(fid_flatten(fid), oi->oi_cache_bits);
+}
+
+static inline cfs_spinlock_t *osd_oi_cache_lock(struct osd_oi *oi,
+                                                unsigned int slot)
+{
+        return &oi->oi_cache_lock[slot & (OSD_OI_CACHE_LOCKS - 1)];
+}
+
+static int osd_oi_cache_get(struct osd_oi *oi, const struct lu_fid *fid,
+                            struct osd_inode_id *id)
+{
+        struct osd_oi_cache_entry *oce;
+        unsigned int               slot;
+        int                        hit;
+
+        if (oi->oi_cache == NULL)
+                return 0;
+
+        slot = osd_oi_cache_slot(oi, fid);
+        oce  = &oi->oi_cache[slot];
+        cfs_spin_lock(osd_oi_cache_lock(oi, slot));
+        hit = lu_fid_eq(&oce->oce_fid, fid);
+        if (hit)
+                *id = oce->oce_id;
+        cfs_spin_unlock(osd_oi_cache_lock(oi, slot));
+
+        lprocfs_counter_incr(oi->oi_stats, hit ? OSD_OI_STATS_CACHE_HIT :
+                                                 OSD_OI_STATS_CACHE_MISS);
+        return hit;
+}
+
+/* a colliding mapping is simply evicted */
+static void osd_oi_cache_set(struct osd_oi *oi, const struct lu_fid *fid,
+                             const struct osd_inode_id *id)
+{
+        struct osd_oi_cache_entry *oce;
+        unsigned int               slot;
+
+        if (oi->oi_cache == NULL)
+                return;
+
+        slot = osd_oi_cache_slot(oi, fid);
+        oce  = &oi->oi_cache[slot];
+        cfs_spin_lock(osd_oi_cache_lock(oi, slot));
+        oce->oce_fid = *fid;
+        oce->oce_id  = *id;
+        cfs_spin_unlock(osd_oi_cache_lock(oi, slot));
+}
+
+/**
+ * Forget the cached mapping of \a fid.
+ *
+ * \retval 1 if a mapping was cached
+ */
+int osd_oi_cache_del(struct osd_oi *oi, const struct lu_fid *fid)
+{
+        struct osd_oi_cache_entry *oce;
+        unsigned int               slot;
+        int                        found;
+
+        if (oi->oi_cache == NULL)
+                return 0;
+
+        slot = osd_oi_cache_slot(oi, fid);
+        oce  = &oi->oi_cache[slot];
+        cfs_spin_lock(osd_oi_cache_lock(oi, slot));
+        found = lu_fid_eq(&oce->oce_fid, fid);
+        if (found)
+                memset(oce, 0, sizeof(*oce));
+        cfs_spin_unlock(osd_oi_cache_lock(oi, slot));
+        return found;
+}
+
+static int osd_oi_stats_init(struct osd_oi *oi)
+{
+        oi->oi_stats = lprocfs_alloc_stats(OSD_OI_STATS_NR, 0);
+        if (oi->oi_stats == NULL)
+                return -ENOMEM;
+
+        lprocfs_counter_init(oi->oi_stats, OSD_OI_STATS_LOOKUP,
+                             0, "lookup", "reqs");
+        lprocfs_counter_init(oi->oi_stats, OSD_OI_STATS_INSERT,
+                             0, "insert", "reqs");
+        lprocfs_counter_init(oi->oi_stats, OSD_OI_STATS_DELETE,
+                             0, "delete", "reqs");
+        lprocfs_counter_init(oi->oi_stats, OSD_OI_STATS_CACHE_HIT,
+                             0, "cache_hit", "reqs");
+        lprocfs_counter_init(oi->oi_stats, OSD_OI_STATS_CACHE_MISS,
+                             0, "cache_miss", "reqs");
+        return 0;
+}
+
+/**
+ * Open the object index of \a dev, creating it if the device is fresh.
+ *
+ * The number of containers is a property of the device: it is found by
+ * probing for "oi.16.0", "oi.16.1", ... or "oi.16" (one container) and is
+ * only taken from the osd_oi_count module parameter when no index exists.
+ * Several containers are probed first: a server that only knows "oi.16"
+ * may have created an empty one before the MDT refused the device for its
+ * OBD_INCOMPAT_MULTI_OI flag.
+ *
+ * \retval positive number of containers in \a oi_table on success
+ * \retval negative errno on failure
+ */
 int osd_oi_init(struct osd_thread_info *info,
-                struct osd_oi *oi,
+                struct osd_oi **oi_table,
                 struct dt_device *dev,
                 struct md_device *mdev)
 {
-        const struct lu_env *env;
-        int rc;
-        int i;
+        struct osd_oi *oi;
+        unsigned int   count;
+        int            created = 0;
+        char           name[16];
+        int            rc;
+        int            i;
+
+        OBD_ALLOC(oi, sizeof(*oi) * OSD_OI_CONTAINERS_MAX);
+        if (oi == NULL)
+                return -ENOMEM;
 
-        env = info->oti_env;
         cfs_mutex_lock(&oi_init_lock);
-        memset(oi, 0, sizeof *oi);
 retry:
-        for (i = rc = 0; i < OSD_OI_FID_NR && rc == 0; ++i) {
-                const char       *name;
-                struct dt_object *obj;
-
-                name = oi_descr[i].name;
-                oi_feat.dif_keysize_min = oi_descr[i].fid_size,
-                oi_feat.dif_keysize_max = oi_descr[i].fid_size,
-
-                obj = dt_store_open(env, dev, "", name, &info->oti_fid);
-                if (!IS_ERR(obj)) {
-                        rc = obj->do_ops->do_index_try(env, obj, &oi_feat);
-                        if (rc == 0) {
-                                LASSERT(obj->do_index_ops != NULL);
-                                oi->oi_dir = obj;
-                        } else {
-                                CERROR("Wrong index \"%s\": %d\n", name, rc);
-                                lu_object_put(env, &obj->do_lu);
-                        }
-                } else {
-                        rc = PTR_ERR(obj);
-                        if (rc == -ENOENT) {
-                                rc = osd_oi_index_create(info, dev, mdev);
-                                if (!rc)
-                                        goto retry;
-                        }
-                        CERROR("Cannot open \"%s\": %d\n", name, rc);
+        count = 0;
+        for (rc = 0; rc == 0 && count < OSD_OI_CONTAINERS_MAX; ) {
+                osd_oi_name(name, sizeof(name), OSD_OI_CONTAINERS_MAX, count);
+                rc = osd_oi_open(info, dev, name, &oi[count]);
+                if (rc == 0)
+                        count++;
+        }
+        if (rc == -ENOENT && count == 0) {
+                osd_oi_name(name, sizeof(name), 1, 0);
+                rc = osd_oi_open(info, dev, name, &oi[0]);
+                if (rc == 0)
+                        count = 1;
+        }
+        if (rc == -ENOENT) {
+                rc = 0;
+                if (count == 0 && !created) {
+                        created = 1;
+                        rc = osd_oi_index_create(info, dev, mdev,
+                                                 osd_oi_count);
+                        if (rc == 0)
+                                goto retry;
+                } else if (count == 0 || !IS_PO2(count)) {
+                        CERROR("Inconsistent object index: %u containers\n",
+                               count);
+                        rc = -EINVAL;
                 }
         }
         if (rc != 0)
-                osd_oi_fini(info, oi);
+                CERROR("Cannot open \"%s\": %d\n", name, rc);
+
+        for (i = 0; rc == 0 && i < count; i++) {
+                rc = osd_oi_stats_init(&oi[i]);
+                if (rc == 0)
+                        rc = osd_oi_cache_init(&oi[i], count);
+        }
+
+        if (rc != 0) {
+                osd_oi_fini(info, &oi, OSD_OI_CONTAINERS_MAX);
+        } else {
+                *oi_table = oi;
+                rc = count;
+        }
 
         cfs_mutex_unlock(&oi_init_lock);
         return rc;
 }
 
-void osd_oi_fini(struct osd_thread_info *info, struct osd_oi *oi)
+void osd_oi_fini(struct osd_thread_info *info,
+                 struct osd_oi **oi_table, unsigned int count)
 {
-        if (oi->oi_dir != NULL) {
-                lu_object_put(info->oti_env, &oi->oi_dir->do_lu);
-                oi->oi_dir = NULL;
+        struct osd_oi *oi = *oi_table;
+        int i;
+
+        if (oi == NULL)
+                return;
+
+        for (i = 0; i < count; i++) {
+                if (oi[i].oi_dir != NULL) {
+                        lu_object_put(info->oti_env, &oi[i].oi_dir->do_lu);
+                        oi[i].oi_dir = NULL;
+                }
+                if (oi[i].oi_stats != NULL)
+                        lprocfs_free_stats(&oi[i].oi_stats);
+                osd_oi_cache_fini(&oi[i]);
         }
+        OBD_FREE(oi, sizeof(*oi) * OSD_OI_CONTAINERS_MAX);
+        *oi_table = NULL;
 }
 
 static inline int fid_is_oi_fid(const struct lu_fid *fid)
@@ -191,7 +432,9 @@ static inline int fid_is_oi_fid(const struct lu_fid *fid)
          * oi-index create operation.
          */
         return (unlikely(fid_seq(fid) == FID_SEQ_LOCAL_FILE &&
-                fid_oid(fid) == OSD_OI_FID_16_OID));
+                (fid_oid(fid) == OSD_OI_FID_16_OID ||
+                 (fid_oid(fid) >= OSD_OI_FID_OID_FIRST &&
+                  fid_oid(fid) <= OSD_OI_FID_OID_LAST))));
 }
 
 int osd_oi_lookup(struct osd_thread_info *info, struct osd_oi *oi,
@@ -210,6 +453,10 @@ int osd_oi_lookup(struct osd_thread_info *info, struct osd_oi *oi,
                 if (fid_is_oi_fid(fid))
                         return -ENOENT;
 
+                if (osd_oi_cache_get(oi, fid, id))
+                        return 0;
+
+                lprocfs_counter_incr(oi->oi_stats, OSD_OI_STATS_LOOKUP);
                 idx = oi->oi_dir;
                 fid_cpu_to_be(oi_fid, fid);
                 key = (struct dt_key *) oi_fid;
@@ -219,6 +466,7 @@ int osd_oi_lookup(struct osd_thread_info *info, struct osd_oi *oi,
                 if (rc > 0) {
                         id->oii_ino = be32_to_cpu(id->oii_ino);
                         id->oii_gen = be32_to_cpu(id->oii_gen);
+                        osd_oi_cache_set(oi, fid, id);
                         rc = 0;
                 } else if (rc == 0)
                         rc = -ENOENT;
@@ -233,7 +481,9 @@ int osd_oi_insert(struct osd_thread_info *info, struct osd_oi *oi,
         struct lu_fid *oi_fid = &info->oti_fid;
         struct dt_object    *idx;
         struct osd_inode_id *id;
+        struct osd_inode_id  cached = *id0;
         const struct dt_key *key;
+        int                  rc;
 
         if (osd_fid_is_igif(fid))
                 return 0;
@@ -241,6 +491,7 @@ int osd_oi_insert(struct osd_thread_info *info, struct osd_oi *oi,
         if (fid_is_oi_fid(fid))
                 return 0;
 
+        lprocfs_counter_incr(oi->oi_stats, OSD_OI_STATS_INSERT);
         idx = oi->oi_dir;
         fid_cpu_to_be(oi_fid, fid);
         key = (struct dt_key *) oi_fid;
@@ -248,10 +499,13 @@ int osd_oi_insert(struct osd_thread_info *info, struct osd_oi *oi,
         id  = &info->oti_id;
         id->oii_ino = cpu_to_be32(id0->oii_ino);
         id->oii_gen = cpu_to_be32(id0->oii_gen);
-        return idx->do_index_ops->dio_insert(info->oti_env, idx,
-                                             (struct dt_rec *)id,
-                                             key, th, BYPASS_CAPA,
-                                             ignore_quota);
+        rc = idx->do_index_ops->dio_insert(info->oti_env, idx,
+                                           (struct dt_rec *)id,
+                                           key, th, BYPASS_CAPA,
+                                           ignore_quota);
+        if (rc == 0)
+                osd_oi_cache_set(oi, fid, &cached);
+        return rc;
 }
 
 int osd_oi_delete(struct osd_thread_info *info,
@@ -261,19 +515,28 @@ int osd_oi_delete(struct osd_thread_info *info,
         struct lu_fid *oi_fid = &info->oti_fid;
         struct dt_object    *idx;
         const struct dt_key *key;
+        int                  rc;
 
         if (osd_fid_is_igif(fid))
                 return 0;
 
+        lprocfs_counter_incr(oi->oi_stats, OSD_OI_STATS_DELETE);
         idx = oi->oi_dir;
         fid_cpu_to_be(oi_fid, fid);
         key = (struct dt_key *) oi_fid;
-        return idx->do_index_ops->dio_delete(info->oti_env, idx,
-                                             key, th, BYPASS_CAPA);
+        rc = idx->do_index_ops->dio_delete(info->oti_env, idx,
+                                           key, th, BYPASS_CAPA);
+        osd_oi_cache_del(oi, fid);
+        return rc;
 }
 
 int osd_oi_mod_init()
 {
+        if (osd_oi_count < 1 || osd_oi_count > OSD_OI_CONTAINERS_MAX ||
+            !IS_PO2(osd_oi_count)) {
+                CWARN("Invalid osd_oi_count %d, using 1\n", osd_oi_count);
+                osd_oi_count = 1;
+        }
         cfs_mutex_init(&oi_init_lock);
         return 0;
 }
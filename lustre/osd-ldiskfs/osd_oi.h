@@ -55,6 +55,8 @@
 #include <linux/rwsem.h>
 #include <lu_object.h>
 #include <md_object.h>
+/* fid_flatten() */
+#include <lustre_fid.h>
 
 struct lu_fid;
 struct osd_thread_info;
@@ -69,13 +71,22 @@ enum {
 };
 
 /*
- * Object Index (oi) instance.
+ * Maximal number of oi containers a device can be formatted with. Each
+ * container is a separate index with its own locks and working set, fids
+ * are spread across the containers by hash.
  */
-struct osd_oi {
-        /*
-         * underlying index object, where fid->id mapping in stored.
-         */
-        struct dt_object *oi_dir;
+#define OSD_OI_CONTAINERS_MAX   (OSD_OI_FID_OID_LAST - OSD_OI_FID_OID_FIRST + 1)
+
+/*
+ * Per-container operation counters.
+ */
+enum {
+        OSD_OI_STATS_LOOKUP,
+        OSD_OI_STATS_INSERT,
+        OSD_OI_STATS_DELETE,
+        OSD_OI_STATS_CACHE_HIT,
+        OSD_OI_STATS_CACHE_MISS,
+        OSD_OI_STATS_NR
 };
 
 /*
@@ -90,12 +101,58 @@ struct osd_inode_id {
         __u32 oii_gen; /* inode generation */
 };
 
+/*
+ * Slot of the fid->id cache kept in front of an oi container. Empty slots
+ * have a zero fid.
+ */
+struct osd_oi_cache_entry {
+        struct lu_fid       oce_fid;
+        struct osd_inode_id oce_id;
+};
+
+/* number of locks protecting the slots of one cache */
+#define OSD_OI_CACHE_LOCKS      16
+
+/*
+ * Object Index (oi) instance.
+ */
+struct osd_oi {
+        /*
+         * underlying index object, where fid->id mapping in stored.
+         */
+        struct dt_object          *oi_dir;
+        /*
+         * operation counters, exported through lprocfs.
+         */
+        struct lprocfs_stats      *oi_stats;
+        /*
+         * direct mapped fid->id cache, so that warm lookups do not descend
+         * into oi_dir. NULL if the cache is disabled.
+         */
+        struct osd_oi_cache_entry *oi_cache;
+        unsigned int               oi_cache_bits;
+        cfs_spinlock_t             oi_cache_lock[OSD_OI_CACHE_LOCKS];
+};
+
+/*
+ * Container holding the mapping for \a fid. \a count is a power of two.
+ */
+static inline struct osd_oi *osd_oi_select(struct osd_oi *oi_table,
+                                           unsigned int count,
+                                           const struct lu_fid *fid)
+{
+        return &oi_table[fid_flatten(fid) & (count - 1)];
+}
+
 int osd_oi_mod_init(void);
 int osd_oi_init(struct osd_thread_info *info,
-                struct osd_oi *oi,
+                struct osd_oi **oi_table,
                 struct dt_device *dev,
                 struct md_device *mdev);
-void osd_oi_fini(struct osd_thread_info *info, struct osd_oi *oi);
+void osd_oi_fini(struct osd_thread_info *info,
+                 struct osd_oi **oi_table, unsigned int count);
+void osd_oi_name(char *buf, int len, unsigned int count, int idx);
+int  osd_oi_cache_del(struct osd_oi *oi, const struct lu_fid *fid);
 
 int  osd_oi_lookup(struct osd_thread_info *info, struct osd_oi *oi,
                    const struct lu_fid *fid, struct osd_inode_id *id);
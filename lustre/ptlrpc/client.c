@@ -611,6 +611,14 @@ static int __ptlrpc_request_bufs_pack(struct ptlrpc_request *request,
 
         lustre_msg_set_opc(request->rq_reqmsg, opcode);
 
+        if (obd_jobid_var[0] != '\0' &&
+            strcmp(obd_jobid_var, JOBSTATS_DISABLE) != 0) {
+                char jobid[JOBSTATS_JOBID_SIZE];
+
+                lustre_get_jobid(jobid);
+                lustre_msg_set_jobid(request->rq_reqmsg, jobid);
+        }
+
         RETURN(0);
 out_ctx:
         sptlrpc_cli_ctx_put(request->rq_cli_ctx, 1);
@@ -1384,12 +1392,12 @@ static int ptlrpc_send_new_req(struct ptlrpc_request *req)
                 }
         }
 
-        CDEBUG(D_RPCTRACE, "Sending RPC pname:cluuid:pid:xid:nid:opc"
-               " %s:%s:%d:"LPU64":%s:%d\n", cfs_curproc_comm(),
-               imp->imp_obd->obd_uuid.uuid,
-               lustre_msg_get_status(req->rq_reqmsg), req->rq_xid,
-               libcfs_nid2str(imp->imp_connection->c_peer.nid),
-               lustre_msg_get_opc(req->rq_reqmsg));
+        CDEBUG_REQ(D_RPCTRACE, req, "Sending RPC pname:cluuid:pid:xid:nid:opc"
+                   " %s:%s:%d:"LPU64":%s:%d\n", cfs_curproc_comm(),
+                   imp->imp_obd->obd_uuid.uuid,
+                   lustre_msg_get_status(req->rq_reqmsg), req->rq_xid,
+                   libcfs_nid2str(imp->imp_connection->c_peer.nid),
+                   lustre_msg_get_opc(req->rq_reqmsg));
 
         rc = ptl_send_rpc(req, 0);
         if (rc) {
@@ -1717,13 +1725,16 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 
                 ptlrpc_rqphase_move(req, RQ_PHASE_COMPLETE);
 
-                CDEBUG(D_RPCTRACE, "Completed RPC pname:cluuid:pid:xid:nid:"
-                       "opc %s:%s:%d:"LPU64":%s:%d\n", cfs_curproc_comm(),
-                       imp->imp_obd->obd_uuid.uuid,
-                       req->rq_reqmsg ? lustre_msg_get_status(req->rq_reqmsg):-1,
-                       req->rq_xid,
-                       libcfs_nid2str(imp->imp_connection->c_peer.nid),
-                       req->rq_reqmsg ? lustre_msg_get_opc(req->rq_reqmsg) : -1);
+                CDEBUG_REQ(D_RPCTRACE, req,
+                           "Completed RPC pname:cluuid:pid:xid:nid:"
+                           "opc %s:%s:%d:"LPU64":%s:%d\n", cfs_curproc_comm(),
+                           imp->imp_obd->obd_uuid.uuid,
+                           req->rq_reqmsg ?
+                           lustre_msg_get_status(req->rq_reqmsg) : -1,
+                           req->rq_xid,
+                           libcfs_nid2str(imp->imp_connection->c_peer.nid),
+                           req->rq_reqmsg ?
+                           lustre_msg_get_opc(req->rq_reqmsg) : -1);
 
                 cfs_spin_lock(&imp->imp_lock);
                 /* Request already may be not on sending or delaying list. This
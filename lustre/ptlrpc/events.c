@@ -122,8 +122,9 @@ void reply_in_callback(lnet_event_t *ev)
         }
 
         if (ev->mlength < ev->rlength ) {
-                CDEBUG(D_RPCTRACE, "truncate req %p rpc %d - %d+%d\n", req,
-                       req->rq_replen, ev->rlength, ev->offset);
+                CDEBUG_REQ(D_RPCTRACE, req,
+                           "truncate req %p rpc %d - %d+%d\n", req,
+                           req->rq_replen, ev->rlength, ev->offset);
                 req->rq_reply_truncate = 1;
                 req->rq_replied = 1;
                 req->rq_status = -EOVERFLOW;
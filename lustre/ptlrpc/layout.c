@@ -476,6 +476,12 @@ static const struct req_msg_field *llogd_conn_body_only[] = {
         &RMF_LLOGD_CONN_BODY
 };
 
+static const struct req_msg_field *llog_origin_handle_next_block_client[] = {
+        &RMF_PTLRPC_BODY,
+        &RMF_LLOGD_BODY,
+        &RMF_CHANGELOG_FILTER
+};
+
 static const struct req_msg_field *llog_origin_handle_next_block_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_LLOGD_BODY,
@@ -794,6 +800,11 @@ struct req_msg_field RMF_LLOGD_BODY =
                     sizeof(struct llogd_body), lustre_swab_llogd_body, NULL);
 EXPORT_SYMBOL(RMF_LLOGD_BODY);
 
+struct req_msg_field RMF_CHANGELOG_FILTER =
+        DEFINE_MSGF("changelog_filter", 0, sizeof(struct changelog_filter),
+                    lustre_swab_changelog_filter, NULL);
+EXPORT_SYMBOL(RMF_CHANGELOG_FILTER);
+
 struct req_msg_field RMF_LLOG_LOG_HDR =
         DEFINE_MSGF("llog_log_hdr", 0,
                     sizeof(struct llog_log_hdr), lustre_swab_llog_hdr, NULL);
@@ -1215,7 +1226,8 @@ EXPORT_SYMBOL(RQF_LLOG_ORIGIN_HANDLE_DESTROY);
 
 struct req_format RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK =
         DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_NEXT_BLOCK",
-                        llogd_body_only, llog_origin_handle_next_block_server);
+                        llog_origin_handle_next_block_client,
+                        llog_origin_handle_next_block_server);
 EXPORT_SYMBOL(RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
 
 struct req_format RQF_LLOG_ORIGIN_HANDLE_PREV_BLOCK =
@@ -184,20 +184,35 @@ static int llog_client_next_block(struct llog_handle *loghandle,
                                   int *cur_idx, int next_idx,
                                   __u64 *cur_offset, void *buf, int len)
 {
-        struct obd_import     *imp;
-        struct ptlrpc_request *req = NULL;
-        struct llogd_body     *body;
-        void                  *ptr;
-        int                    rc;
+        struct obd_import       *imp;
+        struct ptlrpc_request   *req = NULL;
+        struct llogd_body       *body;
+        struct changelog_filter *filter = NULL;
+        void                    *ptr;
+        int                      size;
+        int                      rc;
         ENTRY;
 
+        /* Catalogs are read whole, only their plain logs are filtered */
+        if (!(loghandle->lgh_hdr->llh_flags & LLOG_F_IS_CAT))
+                filter = loghandle->lgh_filter;
+
         LLOG_CLIENT_ENTRY(loghandle->lgh_ctxt, imp);
-        req = ptlrpc_request_alloc_pack(imp, &RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK,
-                                        LUSTRE_LOG_VERSION,
-                                        LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
+        req = ptlrpc_request_alloc(imp, &RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
         if (req == NULL)
                 GOTO(err_exit, rc =-ENOMEM);
-                
+
+        if (filter == NULL)
+                req_capsule_set_size(&req->rq_pill, &RMF_CHANGELOG_FILTER,
+                                     RCL_CLIENT, 0);
+
+        rc = ptlrpc_request_pack(req, LUSTRE_LOG_VERSION,
+                                 LLOG_ORIGIN_HANDLE_NEXT_BLOCK);
+        if (rc) {
+                ptlrpc_request_free(req);
+                GOTO(err_exit, rc);
+        }
+
         body = req_capsule_client_get(&req->rq_pill, &RMF_LLOGD_BODY);
         body->lgd_logid = loghandle->lgh_id;
         body->lgd_ctxt_idx = loghandle->lgh_ctxt->loc_idx - 1;
@@ -207,6 +222,12 @@ static int llog_client_next_block(struct llog_handle *loghandle,
         body->lgd_len = len;
         body->lgd_cur_offset = *cur_offset;
 
+        if (filter != NULL) {
+                ptr = req_capsule_client_get(&req->rq_pill,
+                                             &RMF_CHANGELOG_FILTER);
+                memcpy(ptr, filter, sizeof(*filter));
+        }
+
         req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER, len);
         ptlrpc_request_set_replen(req);
         rc = ptlrpc_queue_wait(req);
@@ -217,15 +238,30 @@ static int llog_client_next_block(struct llog_handle *loghandle,
         if (body == NULL)
                 GOTO(out, rc =-EFAULT);
 
+        /* Servers that do not filter ignore the filter and send all records.
+         * Record types can still be dropped by the reader, the subtree and
+         * user tests cannot. */
+        if (filter != NULL && !(body->lgd_llh_flags & LLOG_F_FILTERED) &&
+            (filter->clf_user != 0 || !fid_is_zero(&filter->clf_fid)))
+                GOTO(out, rc = -EOPNOTSUPP);
+
+        /* A filtered block is shorter, the rest of buf stays zeroed */
+        size = req_capsule_get_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER);
+        if (size > len)
+                GOTO(out, rc = -EPROTO);
+
         /* The log records are swabbed as they are processed */
-        ptr = req_capsule_server_get(&req->rq_pill, &RMF_EADATA);
-        if (ptr == NULL)
-                GOTO(out, rc =-EFAULT);
+        if (size != 0) {
+                ptr = req_capsule_server_sized_get(&req->rq_pill, &RMF_EADATA,
+                                                   size);
+                if (ptr == NULL)
+                        GOTO(out, rc =-EFAULT);
+                memcpy(buf, ptr, size);
+        }
 
         *cur_idx = body->lgd_saved_index;
         *cur_offset = body->lgd_cur_offset;
 
-        memcpy(buf, ptr, len);
         EXIT;
 out:
         ptlrpc_req_finished(req);
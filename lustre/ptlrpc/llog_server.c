@@ -173,26 +173,102 @@ out_pop:
         return rc;
 }
 
+/**
+ * Leave out the records of block \a buf that do not match \a filter, as told
+ * by the owner of the log through llog_ctxt::loc_filter_rec.  Records before
+ * \a index, which the reader has already seen, are dropped too.
+ *
+ * The records kept are packed at the start of \a buf.  If the block did not
+ * end the log, they are followed by the header of a padding record which
+ * spans the rest of the block and has the index of the last record scanned,
+ * so llog_process() carries on after it.
+ *
+ * \retval number of bytes of \a buf to send
+ */
+static int llog_filter_block(struct ptlrpc_request *req,
+                             struct llog_ctxt *ctxt,
+                             struct changelog_filter *filter, int index,
+                             char *buf, int len)
+{
+        const struct lu_env *env = req->rq_svc_thread->t_env;
+        struct llog_rec_hdr *rec = (struct llog_rec_hdr *)buf;
+        char                *out = buf;
+        int                  last = 0;
+
+        ctxt->loc_filter_rec(env, NULL, filter, ctxt->loc_cb_data);
+
+        while ((char *)rec < buf + len) {
+                int reclen = rec->lrh_len;
+
+                if (rec->lrh_index == 0)
+                        /* end of the log, the reader sees zeroes after out */
+                        return out - buf;
+
+                if (reclen < LLOG_MIN_REC_SIZE ||
+                    reclen > buf + len - (char *)rec) {
+                        /* leave it for the reader to complain about */
+                        reclen = buf + len - (char *)rec;
+                        memmove(out, rec, reclen);
+                        return out - buf + reclen;
+                }
+
+                last = rec->lrh_index;
+                if (rec->lrh_index >= index &&
+                    rec->lrh_type != LLOG_PAD_MAGIC &&
+                    ctxt->loc_filter_rec(env, rec, filter, ctxt->loc_cb_data)) {
+                        if (out != (char *)rec)
+                                memmove(out, rec, reclen);
+                        out += reclen;
+                }
+                rec = (struct llog_rec_hdr *)((char *)rec + reclen);
+        }
+
+        if (out == buf + len)
+                return len;
+
+        /* at least one record was left out, so there is room */
+        rec = (struct llog_rec_hdr *)out;
+        rec->lrh_len = buf + len - out;
+        rec->lrh_index = last;
+        rec->lrh_type = LLOG_PAD_MAGIC;
+
+        return out - buf + sizeof(*rec);
+}
+
 int llog_origin_handle_next_block(struct ptlrpc_request *req)
 {
-        struct obd_export   *exp = req->rq_export;
-        struct obd_device   *obd = exp->exp_obd;
-        struct obd_device   *disk_obd;
-        struct llog_handle  *loghandle;
-        struct llogd_body   *body;
-        struct llogd_body   *repbody;
-        struct lvfs_run_ctxt saved;
-        struct llog_ctxt    *ctxt;
-        __u32                flags;
-        __u8                *buf;
-        void                *ptr;
-        int                  rc, rc2;
+        struct obd_export       *exp = req->rq_export;
+        struct obd_device       *obd = exp->exp_obd;
+        struct obd_device       *disk_obd;
+        struct llog_handle      *loghandle;
+        struct llogd_body       *body;
+        struct llogd_body       *repbody;
+        struct changelog_filter *filter = NULL;
+        struct lvfs_run_ctxt     saved;
+        struct llog_ctxt        *ctxt;
+        __u32                    flags;
+        __u8                    *buf;
+        void                    *ptr;
+        int                      size = LLOG_CHUNK_SIZE;
+        int                      rc, rc2;
         ENTRY;
 
         body = req_capsule_client_get(&req->rq_pill, &RMF_LLOGD_BODY);
         if (body == NULL)
                 RETURN(-EFAULT);
 
+        /* old clients do not send a filter, others send an empty one when
+         * they want all records */
+        if (req_capsule_field_present(&req->rq_pill, &RMF_CHANGELOG_FILTER,
+                                      RCL_CLIENT) &&
+            req_capsule_get_size(&req->rq_pill, &RMF_CHANGELOG_FILTER,
+                                 RCL_CLIENT) != 0) {
+                filter = req_capsule_client_get(&req->rq_pill,
+                                                &RMF_CHANGELOG_FILTER);
+                if (filter == NULL)
+                        RETURN(-EFAULT);
+        }
+
         OBD_ALLOC(buf, LLOG_CHUNK_SIZE);
         if (!buf)
                 RETURN(-ENOMEM);
@@ -219,8 +295,14 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
         if (rc)
                 GOTO(out_close, rc);
 
-        req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER,
-                             LLOG_CHUNK_SIZE);
+        if (filter != NULL && ctxt->loc_filter_rec != NULL &&
+            (loghandle->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN)) {
+                size = llog_filter_block(req, ctxt, filter, body->lgd_index,
+                                         (char *)buf, LLOG_CHUNK_SIZE);
+                body->lgd_llh_flags |= LLOG_F_FILTERED;
+        }
+
+        req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER, size);
         rc = req_capsule_server_pack(&req->rq_pill);
         if (rc)
                 GOTO(out_close, rc = -ENOMEM);
@@ -229,7 +311,7 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
         *repbody = *body;
 
         ptr = req_capsule_server_get(&req->rq_pill, &RMF_EADATA);
-        memcpy(ptr, buf, LLOG_CHUNK_SIZE);
+        memcpy(ptr, buf, size);
         GOTO(out_close, rc);
 out_close:
         rc2 = llog_close(loghandle);
@@ -201,7 +201,8 @@ void ptlrpc_lprocfs_register(struct proc_dir_entry *root, char *dir,
         }
 
         lprocfs_counter_init(svc_stats, PTLRPC_REQWAIT_CNTR,
-                             svc_counter_config, "req_waittime", "usec");
+                             svc_counter_config | LPROCFS_CNTR_HISTOGRAM,
+                             "req_waittime", "usec");
         lprocfs_counter_init(svc_stats, PTLRPC_REQQDEPTH_CNTR,
                              svc_counter_config, "req_qdepth", "reqs");
         lprocfs_counter_init(svc_stats, PTLRPC_REQACTIVE_CNTR,
@@ -617,6 +618,419 @@ static int ptlrpc_lprocfs_wr_hp_ratio(struct file *file, const char *buffer,
         return count;
 }
 
+static const char *ptlrpc_stage_names[PTLRPC_STAGE_MAX] = {
+        [PTLRPC_STAGE_QUEUE]    = "queue",
+        [PTLRPC_STAGE_PREP]     = "prep",
+        [PTLRPC_STAGE_LOCK]     = "lock",
+        [PTLRPC_STAGE_TXN]      = "txn",
+        [PTLRPC_STAGE_HANDLER]  = "handler",
+        [PTLRPC_STAGE_FINISH]   = "finish",
+        [PTLRPC_STAGE_TOTAL]    = "total",
+};
+
+/* upper limit of req_slowest_max */
+#define PTLRPC_SLOW_REQS_MAX    64
+
+/** a request in req_slowest of a service */
+struct ptlrpc_slow_req {
+        __u64                   psr_xid;
+        __u32                   psr_opc;
+        lnet_process_id_t       psr_peer;
+        struct timeval          psr_arrival;
+        /* usecs of each stage, < 0 if the request skipped it */
+        long                    psr_usec[PTLRPC_STAGE_MAX];
+};
+
+static void ptlrpc_slow_req_add(struct ptlrpc_service *svc,
+                                struct ptlrpc_request *req, long *usec)
+{
+        struct ptlrpc_slow_req *slow;
+        int                     i;
+
+        /* unlocked check, most requests are not among the slowest */
+        if (svc->srv_slow_max == 0 ||
+            (svc->srv_slow_count == svc->srv_slow_max &&
+             usec[PTLRPC_STAGE_TOTAL] <= svc->srv_slow_min))
+                return;
+
+        cfs_spin_lock(&svc->srv_slow_lock);
+        if (svc->srv_slow_count < svc->srv_slow_max) {
+                slow = &svc->srv_slow_reqs[svc->srv_slow_count++];
+        } else if (svc->srv_slow_max > 0 &&
+                   usec[PTLRPC_STAGE_TOTAL] > svc->srv_slow_min) {
+                /* replace the fastest one */
+                slow = &svc->srv_slow_reqs[0];
+                for (i = 1; i < svc->srv_slow_count; i++)
+                        if (svc->srv_slow_reqs[i].psr_usec[PTLRPC_STAGE_TOTAL] <
+                            slow->psr_usec[PTLRPC_STAGE_TOTAL])
+                                slow = &svc->srv_slow_reqs[i];
+        } else {
+                cfs_spin_unlock(&svc->srv_slow_lock);
+                return;
+        }
+
+        slow->psr_xid = req->rq_xid;
+        slow->psr_opc = lustre_msg_get_opc(req->rq_reqmsg);
+        slow->psr_peer = req->rq_peer;
+        slow->psr_arrival = req->rq_arrival_time;
+        memcpy(slow->psr_usec, usec, sizeof(slow->psr_usec));
+
+        if (svc->srv_slow_count == svc->srv_slow_max) {
+                svc->srv_slow_min = svc->srv_slow_reqs[0].
+                                    psr_usec[PTLRPC_STAGE_TOTAL];
+                for (i = 1; i < svc->srv_slow_count; i++)
+                        svc->srv_slow_min = min(svc->srv_slow_min,
+                                                svc->srv_slow_reqs[i].
+                                                psr_usec[PTLRPC_STAGE_TOTAL]);
+        }
+        cfs_spin_unlock(&svc->srv_slow_lock);
+}
+
+/**
+ * Get the stage counters of opcode index \a opc of \a svc, allocating them
+ * on the first request of the opcode.  Called by service threads, which
+ * may sleep for the allocation.
+ *
+ * \retval NULL if there is no memory for them
+ */
+static struct lprocfs_stats *
+ptlrpc_lprocfs_stage_stats_get(struct ptlrpc_service *svc, int opc)
+{
+        struct lprocfs_stats *stats = svc->srv_stage_stats[opc];
+        int                   i;
+
+        if (likely(stats != NULL))
+                return stats;
+
+        stats = lprocfs_alloc_stats(PTLRPC_STAGE_MAX,
+                                    LPROCFS_STATS_FLAG_LAZY);
+        if (stats == NULL)
+                return NULL;
+        for (i = 0; i < PTLRPC_STAGE_MAX; i++)
+                lprocfs_counter_init(stats, i, LPROCFS_CNTR_AVGMINMAX |
+                                               LPROCFS_CNTR_HISTOGRAM,
+                                     ptlrpc_stage_names[i], "usec");
+
+        /* another thread may have installed them meanwhile */
+        cfs_spin_lock(&svc->srv_slow_lock);
+        if (svc->srv_stage_stats[opc] == NULL) {
+                svc->srv_stage_stats[opc] = stats;
+                stats = NULL;
+        }
+        cfs_spin_unlock(&svc->srv_slow_lock);
+
+        if (stats != NULL)
+                lprocfs_free_stats(&stats);
+        return svc->srv_stage_stats[opc];
+}
+
+/**
+ * Account the latency of the stages of \a req, handled by \a svc, in
+ * req_stage_stats and keep it in req_slowest if it is one of the slowest.
+ * Requests dropped before reaching the handler are not accounted.
+ */
+void ptlrpc_lprocfs_req_stages(struct ptlrpc_service *svc,
+                               struct ptlrpc_request *req)
+{
+        struct timeval       *stamp = req->rq_stage_time;
+        struct lprocfs_stats *stats;
+        long                  usec[PTLRPC_STAGE_MAX];
+        int                   opc;
+        int                   i;
+
+        opc = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+        if (stamp[PTLRPC_STAMP_HANDLER].tv_sec == 0 || opc < 0 ||
+            opc >= LUSTRE_MAX_OPCODES)
+                return;
+
+        usec[PTLRPC_STAGE_QUEUE] = cfs_timeval_sub(&stamp[PTLRPC_STAMP_DEQUEUE],
+                                                   &req->rq_arrival_time, NULL);
+        usec[PTLRPC_STAGE_PREP] = cfs_timeval_sub(&stamp[PTLRPC_STAMP_HANDLER],
+                                                  &stamp[PTLRPC_STAMP_DEQUEUE],
+                                                  NULL);
+        /* no lock or transaction wait for most requests */
+        usec[PTLRPC_STAGE_LOCK] = req->rq_wait_usec[PTLRPC_WAIT_LOCK] != 0 ?
+                                  req->rq_wait_usec[PTLRPC_WAIT_LOCK] : -1;
+        usec[PTLRPC_STAGE_TXN] = req->rq_wait_usec[PTLRPC_WAIT_TXN] != 0 ?
+                                 req->rq_wait_usec[PTLRPC_WAIT_TXN] : -1;
+        if (stamp[PTLRPC_STAMP_REPLY].tv_sec != 0) {
+                usec[PTLRPC_STAGE_HANDLER] =
+                        cfs_timeval_sub(&stamp[PTLRPC_STAMP_REPLY],
+                                        &stamp[PTLRPC_STAMP_HANDLER], NULL);
+                usec[PTLRPC_STAGE_FINISH] =
+                        cfs_timeval_sub(&stamp[PTLRPC_STAMP_DONE],
+                                        &stamp[PTLRPC_STAMP_REPLY], NULL);
+        } else {
+                usec[PTLRPC_STAGE_HANDLER] =
+                        cfs_timeval_sub(&stamp[PTLRPC_STAMP_DONE],
+                                        &stamp[PTLRPC_STAMP_HANDLER], NULL);
+                usec[PTLRPC_STAGE_FINISH] = -1;
+        }
+        usec[PTLRPC_STAGE_TOTAL] = cfs_timeval_sub(&stamp[PTLRPC_STAMP_DONE],
+                                                   &req->rq_arrival_time, NULL);
+
+        if (svc->srv_stage_stats != NULL) {
+                stats = ptlrpc_lprocfs_stage_stats_get(svc, opc);
+                if (stats == NULL)
+                        cfs_atomic_inc(&svc->srv_stage_lost);
+                for (i = 0; i < PTLRPC_STAGE_MAX && stats != NULL; i++)
+                        if (usec[i] >= 0)
+                                lprocfs_counter_add(stats, i, usec[i]);
+        }
+
+        ptlrpc_slow_req_add(svc, req, usec);
+}
+
+/* walked by index, the blocks of opcodes not seen yet are skipped */
+static void *
+ptlrpc_lprocfs_stage_stats_start(struct seq_file *s, loff_t *pos)
+{
+        return *pos >= LUSTRE_MAX_OPCODES * PTLRPC_STAGE_MAX ? NULL :
+               (void *)(unsigned long)(*pos + 1);
+}
+
+static void ptlrpc_lprocfs_stage_stats_stop(struct seq_file *s, void *v)
+{
+}
+
+static void *
+ptlrpc_lprocfs_stage_stats_next(struct seq_file *s, void *v, loff_t *pos)
+{
+        ++*pos;
+        return ptlrpc_lprocfs_stage_stats_start(s, pos);
+}
+
+/* "<opcode> <stage> <samples> samples [usec] <min> <max> <sum> hist ..." */
+static int ptlrpc_lprocfs_stage_stats_show(struct seq_file *s, void *v)
+{
+        struct ptlrpc_service  *svc = s->private;
+        struct lprocfs_stats   *stats;
+        struct lprocfs_counter *cntr;
+        struct lprocfs_counter  ret;
+        __u64                   hist[LPROCFS_HIST_MAX];
+        int                     idx = (unsigned long)v - 1;
+        int                     stage = idx % PTLRPC_STAGE_MAX;
+        int                     i;
+        int                     rc = 0;
+
+        if (idx == 0) {
+                struct timeval now;
+
+                cfs_gettimeofday(&now);
+                rc = seq_printf(s, "%-20s %lu.%lu secs.usecs\n",
+                                "snapshot_time", now.tv_sec, now.tv_usec);
+                if (rc >= 0 && cfs_atomic_read(&svc->srv_stage_lost) != 0)
+                        rc = seq_printf(s, "%-20s %d samples\n", "lost",
+                                        cfs_atomic_read(&svc->srv_stage_lost));
+                if (rc < 0)
+                        return rc;
+        }
+
+        stats = svc->srv_stage_stats[idx / PTLRPC_STAGE_MAX];
+        if (stats == NULL)
+                return 0;
+
+        lprocfs_stats_collect(stats, stage, &ret);
+        if (ret.lc_count == 0)
+                return 0;
+
+        cntr = &stats->ls_percpu[0]->lp_cntr[stage];
+        rc = seq_printf(s, "%-20s %-8s "LPD64" samples [%s] "LPD64" "LPD64
+                        " "LPD64" hist",
+                        ll_rpc_opcode_table[idx / PTLRPC_STAGE_MAX].opname,
+                        cntr->lc_name,
+                        ret.lc_count, cntr->lc_units, ret.lc_min, ret.lc_max,
+                        ret.lc_sum);
+        lprocfs_stats_collect_hist(stats, stage, hist);
+        for (i = 0; i < LPROCFS_HIST_MAX && rc >= 0; i++) {
+                if (hist[i] != 0)
+                        rc = seq_printf(s, " %lu:"LPU64,
+                                        i == 0 ? 0UL : 1UL << (i - 1),
+                                        hist[i]);
+        }
+        if (rc >= 0)
+                rc = seq_printf(s, "\n");
+        return rc < 0 ? rc : 0;
+}
+
+static int
+ptlrpc_lprocfs_stage_stats_open(struct inode *inode, struct file *file)
+{
+        static struct seq_operations sops = {
+                .start = ptlrpc_lprocfs_stage_stats_start,
+                .stop  = ptlrpc_lprocfs_stage_stats_stop,
+                .next  = ptlrpc_lprocfs_stage_stats_next,
+                .show  = ptlrpc_lprocfs_stage_stats_show,
+        };
+        struct proc_dir_entry *dp = PDE(inode);
+        struct seq_file       *seqf;
+        int                    rc;
+
+        LPROCFS_ENTRY_AND_CHECK(dp);
+        rc = seq_open(file, &sops);
+        if (rc) {
+                LPROCFS_EXIT();
+                return rc;
+        }
+
+        seqf = file->private_data;
+        seqf->private = dp->data;
+        return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_stage_stats_write(struct file *file, const char *buf,
+                                 size_t len, loff_t *off)
+{
+        struct seq_file       *seqf = file->private_data;
+        struct ptlrpc_service *svc = seqf->private;
+        int                    i;
+
+        for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+                if (svc->srv_stage_stats[i] != NULL)
+                        lprocfs_clear_stats(svc->srv_stage_stats[i]);
+        cfs_atomic_set(&svc->srv_stage_lost, 0);
+        return len;
+}
+
+/* the records are walked by index as they may be replaced meanwhile */
+static void *ptlrpc_lprocfs_slowest_start(struct seq_file *s, loff_t *pos)
+{
+        struct ptlrpc_service *svc = s->private;
+
+        return *pos >= svc->srv_slow_count ? NULL :
+               (void *)(unsigned long)(*pos + 1);
+}
+
+static void ptlrpc_lprocfs_slowest_stop(struct seq_file *s, void *v)
+{
+}
+
+static void *
+ptlrpc_lprocfs_slowest_next(struct seq_file *s, void *v, loff_t *pos)
+{
+        ++*pos;
+        return ptlrpc_lprocfs_slowest_start(s, pos);
+}
+
+/* "x<xid> <opcode> <peer> <arrival> <stage>:<usec> ..." */
+static int ptlrpc_lprocfs_slowest_show(struct seq_file *s, void *v)
+{
+        struct ptlrpc_service  *svc = s->private;
+        struct ptlrpc_slow_req  slow;
+        int                     idx = (unsigned long)v - 1;
+        int                     i;
+        int                     rc;
+
+        cfs_spin_lock(&svc->srv_slow_lock);
+        if (idx >= svc->srv_slow_count) {
+                cfs_spin_unlock(&svc->srv_slow_lock);
+                return 0;
+        }
+        slow = svc->srv_slow_reqs[idx];
+        cfs_spin_unlock(&svc->srv_slow_lock);
+
+        rc = seq_printf(s, "x"LPU64" %s %s %lu.%06lu", slow.psr_xid,
+                        ll_opcode2str(slow.psr_opc),
+                        libcfs_id2str(slow.psr_peer),
+                        slow.psr_arrival.tv_sec, slow.psr_arrival.tv_usec);
+        for (i = 0; i < PTLRPC_STAGE_MAX && rc >= 0; i++) {
+                if (slow.psr_usec[i] >= 0)
+                        rc = seq_printf(s, " %s:%ld", ptlrpc_stage_names[i],
+                                        slow.psr_usec[i]);
+        }
+        if (rc >= 0)
+                rc = seq_printf(s, "\n");
+        return rc < 0 ? rc : 0;
+}
+
+static int
+ptlrpc_lprocfs_slowest_open(struct inode *inode, struct file *file)
+{
+        static struct seq_operations sops = {
+                .start = ptlrpc_lprocfs_slowest_start,
+                .stop  = ptlrpc_lprocfs_slowest_stop,
+                .next  = ptlrpc_lprocfs_slowest_next,
+                .show  = ptlrpc_lprocfs_slowest_show,
+        };
+        struct proc_dir_entry *dp = PDE(inode);
+        struct seq_file       *seqf;
+        int                    rc;
+
+        LPROCFS_ENTRY_AND_CHECK(dp);
+        rc = seq_open(file, &sops);
+        if (rc) {
+                LPROCFS_EXIT();
+                return rc;
+        }
+
+        seqf = file->private_data;
+        seqf->private = dp->data;
+        return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_slowest_write(struct file *file, const char *buf,
+                             size_t len, loff_t *off)
+{
+        struct seq_file       *seqf = file->private_data;
+        struct ptlrpc_service *svc = seqf->private;
+
+        cfs_spin_lock(&svc->srv_slow_lock);
+        svc->srv_slow_count = 0;
+        svc->srv_slow_min = 0;
+        cfs_spin_unlock(&svc->srv_slow_lock);
+        return len;
+}
+
+static int
+ptlrpc_lprocfs_rd_slowest_max(char *page, char **start, off_t off,
+                              int count, int *eof, void *data)
+{
+        struct ptlrpc_service *svc = data;
+
+        *eof = 1;
+        return snprintf(page, count, "%d\n", svc->srv_slow_max);
+}
+
+static int
+ptlrpc_lprocfs_wr_slowest_max(struct file *file, const char *buffer,
+                              unsigned long count, void *data)
+{
+        struct ptlrpc_service  *svc = data;
+        struct ptlrpc_slow_req *reqs = NULL;
+        struct ptlrpc_slow_req *old;
+        int                     old_max;
+        int                     val;
+        int                     rc;
+
+        rc = lprocfs_write_helper(buffer, count, &val);
+        if (rc < 0)
+                return rc;
+        if (val < 0 || val > PTLRPC_SLOW_REQS_MAX)
+                return -ERANGE;
+
+        if (val > 0) {
+                OBD_ALLOC(reqs, val * sizeof(*reqs));
+                if (reqs == NULL)
+                        return -ENOMEM;
+        }
+
+        /* start over with the new records */
+        cfs_spin_lock(&svc->srv_slow_lock);
+        old = svc->srv_slow_reqs;
+        old_max = svc->srv_slow_max;
+        svc->srv_slow_reqs = reqs;
+        svc->srv_slow_max = val;
+        svc->srv_slow_count = 0;
+        svc->srv_slow_min = 0;
+        cfs_spin_unlock(&svc->srv_slow_lock);
+
+        if (old != NULL)
+                OBD_FREE(old, old_max * sizeof(*old));
+        return count;
+}
+
 void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
                                      struct ptlrpc_service *svc)
 {
@@ -646,6 +1060,10 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
                 {.name       = "timeouts",
                  .read_fptr  = ptlrpc_lprocfs_rd_timeouts,
                  .data       = svc},
+                {.name       = "req_slowest_max",
+                 .read_fptr  = ptlrpc_lprocfs_rd_slowest_max,
+                 .write_fptr = ptlrpc_lprocfs_wr_slowest_max,
+                 .data       = svc},
                 {NULL}
         };
         static struct file_operations req_history_fops = {
@@ -655,6 +1073,22 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
                 .llseek      = seq_lseek,
                 .release     = lprocfs_seq_release,
         };
+        static struct file_operations req_stage_stats_fops = {
+                .owner       = THIS_MODULE,
+                .open        = ptlrpc_lprocfs_stage_stats_open,
+                .read        = seq_read,
+                .write       = ptlrpc_lprocfs_stage_stats_write,
+                .llseek      = seq_lseek,
+                .release     = lprocfs_seq_release,
+        };
+        static struct file_operations req_slowest_fops = {
+                .owner       = THIS_MODULE,
+                .open        = ptlrpc_lprocfs_slowest_open,
+                .read        = seq_read,
+                .write       = ptlrpc_lprocfs_slowest_write,
+                .llseek      = seq_lseek,
+                .release     = lprocfs_seq_release,
+        };
 
         int rc;
 
@@ -671,6 +1105,23 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
                                 0400, &req_history_fops, svc);
         if (rc)
                 CWARN("Error adding the req_history file\n");
+
+        /* the blocks of stage counters are allocated for the opcodes used */
+        OBD_ALLOC(svc->srv_stage_stats,
+                  LUSTRE_MAX_OPCODES * sizeof(*svc->srv_stage_stats));
+        if (svc->srv_stage_stats == NULL)
+                return;
+        cfs_atomic_set(&svc->srv_stage_lost, 0);
+
+        rc = lprocfs_seq_create(svc->srv_procroot, "req_stage_stats",
+                                0644, &req_stage_stats_fops, svc);
+        if (rc)
+                CWARN("Error adding the req_stage_stats file\n");
+
+        rc = lprocfs_seq_create(svc->srv_procroot, "req_slowest",
+                                0644, &req_slowest_fops, svc);
+        if (rc)
+                CWARN("Error adding the req_slowest file\n");
 }
 
 void ptlrpc_lprocfs_register_obd(struct obd_device *obddev)
@@ -681,6 +1132,71 @@ void ptlrpc_lprocfs_register_obd(struct obd_device *obddev)
 }
 EXPORT_SYMBOL(ptlrpc_lprocfs_register_obd);
 
+/* RPCs accounted in the job stats of targets, with their handling time */
+static __u32 ptlrpc_job_opcodes[] = {
+        OST_READ, OST_WRITE, OST_GETATTR, OST_SETATTR, OST_PUNCH, OST_SYNC,
+        OST_CREATE, OST_DESTROY, OST_STATFS,
+        MDS_GETATTR, MDS_GETATTR_NAME, MDS_CLOSE, MDS_REINT, MDS_READPAGE,
+        MDS_STATFS, MDS_SYNC, MDS_GETXATTR,
+        LDLM_ENQUEUE,
+};
+
+enum {
+        PTLRPC_JOB_READ_BYTES = 0,
+        PTLRPC_JOB_WRITE_BYTES,
+        PTLRPC_JOB_OPC_BASE,
+};
+
+static int ptlrpc_job_opc2cntr(__u32 opc)
+{
+        int i;
+
+        for (i = 0; i < ARRAY_SIZE(ptlrpc_job_opcodes); i++)
+                if (ptlrpc_job_opcodes[i] == opc)
+                        return PTLRPC_JOB_OPC_BASE + i;
+        return -1;
+}
+
+static void ptlrpc_job_stats_cntr_init(struct lprocfs_stats *stats)
+{
+        int i;
+
+        lprocfs_counter_init(stats, PTLRPC_JOB_READ_BYTES,
+                             LPROCFS_CNTR_AVGMINMAX, "read_bytes", "bytes");
+        lprocfs_counter_init(stats, PTLRPC_JOB_WRITE_BYTES,
+                             LPROCFS_CNTR_AVGMINMAX, "write_bytes", "bytes");
+        for (i = 0; i < ARRAY_SIZE(ptlrpc_job_opcodes); i++)
+                lprocfs_counter_init(stats, PTLRPC_JOB_OPC_BASE + i,
+                                     LPROCFS_CNTR_AVGMINMAX,
+                                     ll_opcode2str(ptlrpc_job_opcodes[i]),
+                                     "usec");
+}
+
+/* Account the RPCs handled for \a obd per job ID of the client. */
+int ptlrpc_lprocfs_register_job_stats(struct obd_device *obd)
+{
+        return lprocfs_job_stats_init(obd, PTLRPC_JOB_OPC_BASE +
+                                      ARRAY_SIZE(ptlrpc_job_opcodes),
+                                      ptlrpc_job_stats_cntr_init);
+}
+EXPORT_SYMBOL(ptlrpc_lprocfs_register_job_stats);
+
+void ptlrpc_lprocfs_job_stats(struct ptlrpc_request *req, long usec)
+{
+        struct obd_export *exp = req->rq_export;
+        int idx;
+
+        if (exp == NULL || exp->exp_obd == NULL ||
+            exp->exp_obd->obd_jobstats.ojs_hash == NULL)
+                return;
+
+        idx = ptlrpc_job_opc2cntr(lustre_msg_get_opc(req->rq_reqmsg));
+        if (idx >= 0)
+                lprocfs_job_stats_log(exp->exp_obd,
+                                      lustre_msg_get_jobid(req->rq_reqmsg),
+                                      idx, usec);
+}
+
 void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount)
 {
         struct lprocfs_stats *svc_stats;
@@ -700,6 +1216,18 @@ void ptlrpc_lprocfs_brw(struct ptlrpc_request *req, int bytes)
         struct lprocfs_stats *svc_stats;
         int idx;
 
+        if (req->rq_export != NULL) {
+                struct obd_device *obd = req->rq_export->exp_obd;
+
+                /* server side: the bytes moved for the job of the client */
+                idx = lustre_msg_get_opc(req->rq_reqmsg) == OST_READ ?
+                      PTLRPC_JOB_READ_BYTES : PTLRPC_JOB_WRITE_BYTES;
+                if (obd->obd_jobstats.ojs_hash != NULL)
+                        lprocfs_job_stats_log(obd,
+                                        lustre_msg_get_jobid(req->rq_reqmsg),
+                                        idx, bytes);
+        }
+
         if (!req->rq_import)
                 return;
         svc_stats = req->rq_import->imp_obd->obd_svc_stats;
@@ -725,11 +1253,28 @@ EXPORT_SYMBOL(ptlrpc_lprocfs_brw);
 
 void ptlrpc_lprocfs_unregister_service(struct ptlrpc_service *svc)
 {
+        int i;
+
         if (svc->srv_procroot != NULL)
                 lprocfs_remove(&svc->srv_procroot);
 
         if (svc->srv_stats)
                 lprocfs_free_stats(&svc->srv_stats);
+
+        if (svc->srv_stage_stats != NULL) {
+                for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+                        lprocfs_free_stats(&svc->srv_stage_stats[i]);
+                OBD_FREE(svc->srv_stage_stats,
+                         LUSTRE_MAX_OPCODES * sizeof(*svc->srv_stage_stats));
+                svc->srv_stage_stats = NULL;
+        }
+
+        if (svc->srv_slow_reqs != NULL) {
+                OBD_FREE(svc->srv_slow_reqs,
+                         svc->srv_slow_max * sizeof(*svc->srv_slow_reqs));
+                svc->srv_slow_reqs = NULL;
+                svc->srv_slow_max = 0;
+        }
 }
 
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd)
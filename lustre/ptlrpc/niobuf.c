@@ -476,6 +476,8 @@ int ptlrpc_send_reply(struct ptlrpc_request *req, int flags)
                            LNET_ACK_REQ : LNET_NOACK_REQ,
                            &rs->rs_cb_id, conn, svc->srv_rep_portal,
                            req->rq_xid, req->rq_reply_off);
+        if (rc == 0 && !(flags & PTLRPC_REPLY_EARLY))
+                ptlrpc_req_stamp(req, PTLRPC_STAMP_REPLY);
 out:
         if (unlikely(rc != 0))
                 ptlrpc_req_drop_rs(req);
@@ -1241,6 +1241,31 @@ __u32 lustre_msg_get_service_time(struct lustre_msg *msg)
         }
 }
 
+/* Job ID of the request, NULL if the sender did not set one or the
+ * field is not a valid string. */
+char *lustre_msg_get_jobid(struct lustre_msg *msg)
+{
+        switch (msg->lm_magic) {
+        case LUSTRE_MSG_MAGIC_V1:
+        case LUSTRE_MSG_MAGIC_V1_SWABBED:
+                return NULL;
+        case LUSTRE_MSG_MAGIC_V2: {
+                struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+                if (!pb) {
+                        CERROR("invalid msg %p: no ptlrpc body!\n", msg);
+                        return NULL;
+                }
+                if (pb->pb_jobid[0] == '\0' ||
+                    pb->pb_jobid[JOBSTATS_JOBID_SIZE - 1] != '\0')
+                        return NULL;
+                return pb->pb_jobid;
+        }
+        default:
+                CERROR("incorrect message magic: %08x\n", msg->lm_magic);
+                return NULL;
+        }
+}
+
 __u32 lustre_msg_get_cksum(struct lustre_msg *msg)
 {
         switch (msg->lm_magic) {
@@ -1450,6 +1475,23 @@ void lustre_msg_set_service_time(struct lustre_msg *msg, __u32 service_time)
         }
 }
 
+void lustre_msg_set_jobid(struct lustre_msg *msg, const char *jobid)
+{
+        switch (msg->lm_magic) {
+        case LUSTRE_MSG_MAGIC_V1:
+                return;
+        case LUSTRE_MSG_MAGIC_V2: {
+                struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+                LASSERTF(pb, "invalid msg %p: no ptlrpc body!\n", msg);
+                memset(pb->pb_jobid, 0, sizeof(pb->pb_jobid));
+                strncpy(pb->pb_jobid, jobid, sizeof(pb->pb_jobid) - 1);
+                return;
+        }
+        default:
+                LASSERTF(0, "incorrect message magic: %08x\n", msg->lm_magic);
+        }
+}
+
 void lustre_msg_set_cksum(struct lustre_msg *msg, __u32 cksum)
 {
         switch (msg->lm_magic) {
@@ -1554,7 +1596,8 @@ void lustre_swab_ptlrpc_body(struct ptlrpc_body *b)
         __swab64s (&b->pb_pre_versions[1]);
         __swab64s (&b->pb_pre_versions[2]);
         __swab64s (&b->pb_pre_versions[3]);
-        CLASSERT(offsetof(typeof(*b), pb_padding) != 0);
+        /* pb_jobid is a string and needs no swabbing */
+        CLASSERT(offsetof(typeof(*b), pb_jobid) != 0);
 }
 
 void lustre_swab_connect(struct obd_connect_data *ocd)
@@ -2243,20 +2286,44 @@ static inline int rep_ptlrpc_body_swabbed(struct ptlrpc_request *req)
         }
 }
 
+/**
+ * Fill in the trace filter key of \a req, see CDEBUG_REQ() and DEBUG_REQ().
+ */
+void ptlrpc_req_debug_key(struct ptlrpc_request *req,
+                          struct libcfs_debug_key *key)
+{
+        key->dk_id = req->rq_xid;
+        if (req->rq_import == NULL)
+                key->dk_nid = req->rq_peer.nid;
+        else if (req->rq_import->imp_connection != NULL)
+                key->dk_nid = req->rq_import->imp_connection->c_peer.nid;
+        else
+                key->dk_nid = LNET_NID_ANY;
+        key->dk_opc = req->rq_reqmsg && req_ptlrpc_body_swabbed(req) ?
+                      lustre_msg_get_opc(req->rq_reqmsg) : -1;
+}
+EXPORT_SYMBOL(ptlrpc_req_debug_key);
+
 void _debug_req(struct ptlrpc_request *req, __u32 mask,
                 struct libcfs_debug_msg_data *data, const char *fmt, ... )
 {
         va_list args;
+        struct libcfs_debug_key key;
+        int opc;
+
+        ptlrpc_req_debug_key(req, &key);
+        opc = key.dk_opc;
+
         va_start(args, fmt);
-        libcfs_debug_vmsg2(data->msg_cdls, data->msg_subsys, mask, data->msg_file,
-                           data->msg_fn, data->msg_line, fmt, args,
+        libcfs_debug_vmsg2_key(&key, data->msg_cdls, data->msg_subsys, mask,
+                           data->msg_file, data->msg_fn, data->msg_line,
+                           fmt, args,
                            " req@%p x"LPU64"/t"LPD64"("LPD64") o%d->%s@%s:%d/%d"
                            " lens %d/%d e %d to %d dl "CFS_TIME_T" ref %d "
                            "fl "REQ_FLAGS_FMT"/%x/%x rc %d/%d\n",
                            req, req->rq_xid, req->rq_transno,
                            req->rq_reqmsg ? lustre_msg_get_transno(req->rq_reqmsg) : 0,
-                           req->rq_reqmsg && req_ptlrpc_body_swabbed(req) ?
-                           lustre_msg_get_opc(req->rq_reqmsg) : -1,
+                           opc,
                            req->rq_import ? obd2cli_tgt(req->rq_import->imp_obd) :
                            req->rq_export ?
                            (char*)req->rq_export->exp_client_uuid.uuid : "<?>",
@@ -502,6 +502,7 @@ ptlrpc_init_svc(int nbufs, int bufsize, int max_req_size, int max_reply_size,
         cfs_spin_lock_init(&service->srv_lock);
         cfs_spin_lock_init(&service->srv_rq_lock);
         cfs_spin_lock_init(&service->srv_rs_lock);
+        cfs_spin_lock_init(&service->srv_slow_lock);
         CFS_INIT_LIST_HEAD(&service->srv_threads);
         cfs_waitq_init(&service->srv_waitq);
 
@@ -845,8 +846,9 @@ static int ptlrpc_check_req(struct ptlrpc_request *req)
                      req->rq_export->exp_obd->obd_fail)) {
              /* Failing over, don't handle any more reqs, send
                 error response instead. */
-                CDEBUG(D_RPCTRACE, "Dropping req %p for failed obd %s\n",
-                       req, req->rq_export->exp_obd->obd_name);
+                CDEBUG_REQ(D_RPCTRACE, req,
+                           "Dropping req %p for failed obd %s\n",
+                           req, req->rq_export->exp_obd->obd_name);
                 rc = -ENODEV;
         } else if (lustre_msg_get_flags(req->rq_reqmsg) &
                    (MSG_REPLAY | MSG_REQ_REPLAY_DONE) &&
@@ -1646,6 +1648,7 @@ ptlrpc_server_handle_request(struct ptlrpc_service *svc,
                 libcfs_debug_dumplog();
 
         cfs_gettimeofday(&work_start);
+        request->rq_stage_time[PTLRPC_STAMP_DEQUEUE] = work_start;
         timediff = cfs_timeval_sub(&work_start, &request->rq_arrival_time,NULL);
         if (likely(svc->srv_stats != NULL)) {
                 lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
@@ -1694,19 +1697,21 @@ ptlrpc_server_handle_request(struct ptlrpc_service *svc,
                 goto put_rpc_export;
         }
 
-        CDEBUG(D_RPCTRACE, "Handling RPC pname:cluuid+ref:pid:xid:nid:opc "
-               "%s:%s+%d:%d:x"LPU64":%s:%d\n", cfs_curproc_comm(),
-               (request->rq_export ?
-                (char *)request->rq_export->exp_client_uuid.uuid : "0"),
-               (request->rq_export ?
-                cfs_atomic_read(&request->rq_export->exp_refcount) : -99),
-               lustre_msg_get_status(request->rq_reqmsg), request->rq_xid,
-               libcfs_id2str(request->rq_peer),
-               lustre_msg_get_opc(request->rq_reqmsg));
+        CDEBUG_REQ(D_RPCTRACE, request,
+                   "Handling RPC pname:cluuid+ref:pid:xid:nid:opc "
+                   "%s:%s+%d:%d:x"LPU64":%s:%d\n", cfs_curproc_comm(),
+                   (request->rq_export ?
+                    (char *)request->rq_export->exp_client_uuid.uuid : "0"),
+                   (request->rq_export ?
+                    cfs_atomic_read(&request->rq_export->exp_refcount) : -99),
+                   lustre_msg_get_status(request->rq_reqmsg), request->rq_xid,
+                   libcfs_id2str(request->rq_peer),
+                   lustre_msg_get_opc(request->rq_reqmsg));
 
         if (lustre_msg_get_opc(request->rq_reqmsg) != OBD_PING)
                 CFS_FAIL_TIMEOUT_MS(OBD_FAIL_PTLRPC_PAUSE_REQ, cfs_fail_val);
 
+        ptlrpc_req_stamp(request, PTLRPC_STAMP_HANDLER);
         rc = svc->srv_handler(request);
 
         ptlrpc_rqphase_move(request, RQ_PHASE_COMPLETE);
@@ -1729,27 +1734,29 @@ put_conn:
         }
 
         cfs_gettimeofday(&work_end);
+        request->rq_stage_time[PTLRPC_STAMP_DONE] = work_end;
         timediff = cfs_timeval_sub(&work_end, &work_start, NULL);
-        CDEBUG(D_RPCTRACE, "Handled RPC pname:cluuid+ref:pid:xid:nid:opc "
-               "%s:%s+%d:%d:x"LPU64":%s:%d Request procesed in "
-               "%ldus (%ldus total) trans "LPU64" rc %d/%d\n",
-                cfs_curproc_comm(),
-                (request->rq_export ?
-                 (char *)request->rq_export->exp_client_uuid.uuid : "0"),
-                (request->rq_export ?
-                 cfs_atomic_read(&request->rq_export->exp_refcount) : -99),
-                lustre_msg_get_status(request->rq_reqmsg),
-                request->rq_xid,
-                libcfs_id2str(request->rq_peer),
-                lustre_msg_get_opc(request->rq_reqmsg),
-                timediff,
-                cfs_timeval_sub(&work_end, &request->rq_arrival_time, NULL),
-                (request->rq_repmsg ?
-                 lustre_msg_get_transno(request->rq_repmsg) :
-                 request->rq_transno),
-                request->rq_status,
-                (request->rq_repmsg ?
-                 lustre_msg_get_status(request->rq_repmsg) : -999));
+        CDEBUG_REQ(D_RPCTRACE, request,
+                   "Handled RPC pname:cluuid+ref:pid:xid:nid:opc "
+                   "%s:%s+%d:%d:x"LPU64":%s:%d Request procesed in "
+                   "%ldus (%ldus total) trans "LPU64" rc %d/%d\n",
+                    cfs_curproc_comm(),
+                    (request->rq_export ?
+                     (char *)request->rq_export->exp_client_uuid.uuid : "0"),
+                    (request->rq_export ?
+                     cfs_atomic_read(&request->rq_export->exp_refcount) : -99),
+                    lustre_msg_get_status(request->rq_reqmsg),
+                    request->rq_xid,
+                    libcfs_id2str(request->rq_peer),
+                    lustre_msg_get_opc(request->rq_reqmsg),
+                    timediff,
+                    cfs_timeval_sub(&work_end, &request->rq_arrival_time, NULL),
+                    (request->rq_repmsg ?
+                     lustre_msg_get_transno(request->rq_repmsg) :
+                     request->rq_transno),
+                    request->rq_status,
+                    (request->rq_repmsg ?
+                     lustre_msg_get_status(request->rq_repmsg) : -999));
         if (likely(svc->srv_stats != NULL && request->rq_reqmsg != NULL)) {
                 __u32 op = lustre_msg_get_opc(request->rq_reqmsg);
                 int opc = opcode_offset(op);
@@ -1760,6 +1767,10 @@ put_conn:
                                             timediff);
                 }
         }
+        if (request->rq_reqmsg != NULL) {
+                ptlrpc_lprocfs_job_stats(request, timediff);
+                ptlrpc_lprocfs_req_stages(svc, request);
+        }
         if (unlikely(request->rq_early_count)) {
                 DEBUG_REQ(D_ADAPTTO, request,
                           "sent %d early replies before finishing in "
@@ -0,0 +1,259 @@
+/* -*- mode: c; c-basic-offset: 8; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.sun.com/software/products/lustre/docs/GPLv2.pdf
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa Clara,
+ * CA 95054 USA or visit www.sun.com if you need additional information or
+ * have any questions.
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2008, 2010, Oracle and/or its affiliates. All rights reserved.
+ * Use is subject to license terms.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/tests/qos_bench.c
+ *
+ * Check and benchmark of the weighted random target selection of
+ * alloc_qos() in lustre/lov/lov_qos.c: the former linear scan of
+ * cumulative weights against the weight_tree prefix sums.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <libcfs/libcfs.h>
+#include <weight_tree.h>
+
+#define error(fmt, args...) do {                        \
+        fflush(stdout), fflush(stderr);                 \
+        fprintf(stderr, "\nError:" fmt, ##args);        \
+        abort();                                        \
+} while(0)
+
+/* a simplified alloc_qos(): picking a target drops it from the candidates
+ * and adds a penalty to the other targets on its OSS */
+struct bench_tgt {
+        __u64   weight;
+        int     oss;
+        int     usable;
+};
+
+static struct bench_tgt *tgts;
+static int tgt_count = 1000;
+static int ost_per_oss = 8;
+static int stripes = 4;
+static int loops = 100000;
+
+static __u64 bench_rand(__u64 total)
+{
+        return total ? (((__u64)random() << 31) ^ random()) % total : 0;
+}
+
+static void bench_init(void)
+{
+        int i;
+
+        for (i = 0; i < tgt_count; i++) {
+                tgts[i].weight = 1 + random() % 1000000;
+                tgts[i].oss = i / ost_per_oss;
+        }
+}
+
+static __u64 oss_penalty(__u64 weight)
+{
+        return weight / 4;
+}
+
+/* the loop of alloc_qos() before weight trees: O(targets) per stripe */
+static void pick_linear(int *picks, __u64 *rands, __u64 *weight)
+{
+        __u64 total = 0, cur;
+        int i, n, oss;
+
+        for (i = 0; i < tgt_count; i++) {
+                weight[i] = tgts[i].weight;
+                tgts[i].usable = 1;
+                total += weight[i];
+        }
+
+        for (n = 0; n < stripes; n++) {
+                __u64 rand = rands != NULL ? rands[n] : bench_rand(total);
+
+                cur = 0;
+                for (i = 0; i < tgt_count; i++) {
+                        if (!tgts[i].usable)
+                                continue;
+                        cur += weight[i];
+                        if (cur > rand)
+                                break;
+                }
+                if (i == tgt_count)
+                        error("linear pick %d found nothing\n", n);
+                picks[n] = i;
+                tgts[i].usable = 0;
+                total -= weight[i];
+
+                oss = tgts[i].oss;
+                for (i = 0; i < tgt_count; i++) {
+                        __u64 pen;
+
+                        if (!tgts[i].usable || tgts[i].oss != oss)
+                                continue;
+                        pen = oss_penalty(weight[i]);
+                        weight[i] -= pen;
+                        total -= pen;
+                }
+        }
+}
+
+/* the weight_tree version: O(log(targets)) per stripe plus the OSS */
+static void pick_tree(int *picks, __u64 *rands, struct weight_tree *wt,
+                      __u64 *sum, __u64 *weight)
+{
+        int i, j, n, oss;
+
+        for (i = 0; i < tgt_count; i++) {
+                weight[i] = tgts[i].weight;
+                tgts[i].usable = 1;
+        }
+        weight_tree_build(wt, sum, weight, tgt_count);
+
+        for (n = 0; n < stripes; n++) {
+                __u64 total = weight_tree_total(wt);
+                __u64 rand = bench_rand(total);
+
+                if (rands != NULL)
+                        rands[n] = rand;
+                j = weight_tree_find(wt, rand);
+                if (j >= tgt_count)
+                        error("tree pick %d found nothing\n", n);
+                picks[n] = j;
+                tgts[j].usable = 0;
+                weight_tree_add(wt, j, -(__s64)weight[j]);
+                weight[j] = 0;
+
+                /* targets of one OSS are adjacent here */
+                oss = tgts[j].oss;
+                for (i = oss * ost_per_oss;
+                     i < tgt_count && tgts[i].oss == oss; i++) {
+                        __u64 pen;
+
+                        if (!tgts[i].usable)
+                                continue;
+                        pen = oss_penalty(weight[i]);
+                        weight_tree_add(wt, i, -(__s64)pen);
+                        weight[i] -= pen;
+                }
+        }
+}
+
+static double bench_now(void)
+{
+        struct timeval tv;
+
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+        struct weight_tree wt;
+        __u64 *sum, *weight, *rands;
+        int *picks, *picks2;
+        double start, linear, tree;
+        int c, i, n;
+
+        while ((c = getopt(argc, argv, "n:o:s:l:")) != -1) {
+                switch (c) {
+                case 'n':
+                        tgt_count = atoi(optarg);
+                        break;
+                case 'o':
+                        ost_per_oss = atoi(optarg);
+                        break;
+                case 's':
+                        stripes = atoi(optarg);
+                        break;
+                case 'l':
+                        loops = atoi(optarg);
+                        break;
+                default:
+                        error("usage: %s [-n targets] [-o osts_per_oss] "
+                              "[-s stripes] [-l loops]\n", argv[0]);
+                }
+        }
+        if (tgt_count < 1 || ost_per_oss < 1 || stripes < 1 ||
+            stripes > tgt_count || loops < 1)
+                error("invalid parameters\n");
+
+        tgts   = calloc(tgt_count, sizeof(*tgts));
+        sum    = calloc(tgt_count + 1, sizeof(*sum));
+        weight = calloc(tgt_count, sizeof(*weight));
+        rands  = calloc(stripes, sizeof(*rands));
+        picks  = calloc(stripes, sizeof(*picks));
+        picks2 = calloc(stripes, sizeof(*picks2));
+        if (!tgts || !sum || !weight || !rands || !picks || !picks2)
+                error("out of memory\n");
+
+        srandom(getpid());
+        bench_init();
+
+        /* both must pick the same targets for the same random numbers */
+        for (i = 0; i < 1000; i++) {
+                pick_tree(picks, rands, &wt, sum, weight);
+                pick_linear(picks2, rands, weight);
+                for (n = 0; n < stripes; n++)
+                        if (picks[n] != picks2[n])
+                                error("stripe %d: tree %d, linear %d\n",
+                                      n, picks[n], picks2[n]);
+        }
+
+        start = bench_now();
+        for (i = 0; i < loops; i++)
+                pick_linear(picks, NULL, weight);
+        linear = bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < loops; i++)
+                pick_tree(picks, NULL, &wt, sum, weight);
+        tree = bench_now() - start;
+
+        printf("%d targets, %d per oss, %d stripes, %d allocations\n",
+               tgt_count, ost_per_oss, stripes, loops);
+        printf("linear: %8.3f us/allocation\n", linear * 1000000 / loops);
+        printf("tree:   %8.3f us/allocation (including O(n) build)\n",
+               tree * 1000000 / loops);
+
+        free(picks2);
+        free(picks);
+        free(rands);
+        free(weight);
+        free(sum);
+        free(tgts);
+        return 0;
+}
@@ -8042,6 +8042,699 @@ test_219() {
 }
 run_test 219 "LU-394: Write partial won't cause uncontiguous pages vec at LND"
 
+# number of write RPCs which were submitted to disk merged with others
+merged_write_rpcs() {
+	do_facet ost1 $LCTL get_param -n obdfilter.*.brw_stats |
+		awk '/RPCs merged per disk I\/O/ { m = 1; next }
+		     m && /^$/ { exit }
+		     m && $1 + 0 >= 2 { n += ($1 + 0) * $6 }
+		     END { print n + 0 }'
+}
+
+test_220() {
+	local p="$TMP/$TFILE-$TESTNAME.parameters"
+	local merged=0
+	local i
+	local n
+
+	save_lustre_params ost1 "obdfilter.*.write_gather_usec" > $p
+	do_facet ost1 $LCTL set_param -n obdfilter.*.write_gather_usec=2000
+	do_facet ost1 $LCTL set_param -n obdfilter.*.brw_stats=0
+
+	$SETSTRIPE -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	# many concurrent small direct writes to nearby offsets of one object
+	for n in 1 2 3 4 5; do
+		for i in $(seq 0 31); do
+			$DIRECTIO write $DIR/$tfile $i 1 4096 &
+		done
+		wait
+		merged=$(merged_write_rpcs)
+		[ $merged -gt 0 ] && break
+	done
+	$CHECKSTAT -s $((32 * 4096)) $DIR/$tfile || error "wrong file size"
+	$DIRECTIO read $DIR/$tfile 0 32 4096 || error "data mismatch"
+
+	restore_lustre_params < $p
+	rm -f $p $DIR/$tfile
+	echo "$merged write RPCs merged"
+	[ $merged -gt 0 ] || error "no write RPCs were merged"
+}
+run_test 220 "small writes to the same object are gathered on the OST"
+
+test_221() {
+	local fastpath=$($LCTL get_param -n llite.*.direct_io_fastpath | head -1)
+
+	[ -z "$fastpath" ] && skip "no direct_io_fastpath support" && return
+	$SETSTRIPE -c -1 $DIR/$tfile || error "setstripe failed"
+
+	$LCTL set_param -n llite.*.direct_io_fastpath=1
+	$DIRECTIO rdwr $DIR/$tfile 0 64 65536 || error "fast path failed"
+	$CHECKSTAT -s $((64 * 65536)) $DIR/$tfile || error "wrong file size"
+
+	# cached pages force the cl_page path for coherency
+	dd if=$DIR/$tfile of=/dev/null bs=4096 count=16 ||
+		error "buffered read failed"
+	$DIRECTIO rdwr $DIR/$tfile 0 64 65536 || error "cached path failed"
+
+	$LCTL set_param -n llite.*.direct_io_fastpath=0
+	$DIRECTIO rdwr $DIR/$tfile 64 64 65536 || error "cl_page path failed"
+
+	$LCTL set_param -n llite.*.direct_io_fastpath=$fastpath
+	rm -f $DIR/$tfile
+}
+run_test 221 "O_DIRECT fast path bypassing cl_page"
+
+test_222() {
+	local param="lov.$FSNAME-clilov-*.submit_parallel"
+	local old=$($LCTL get_param -n $param | head -1)
+
+	[ -z "$old" ] && skip "no parallel stripe submission" && return
+	[ $OSTCOUNT -lt 2 ] && skip "needs >= 2 OSTs" && return
+
+	$SETSTRIPE -c -1 -s 65536 $DIR/$tfile || error "setstripe failed"
+	$LCTL set_param -n $param=1
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=8 ||
+		error "cannot create reference file"
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=1M || error "write failed"
+	cancel_lru_locks osc
+	cmp $TMP/$tfile $DIR/$tfile || error "data mismatch"
+
+	$LCTL set_param -n $param=$old
+	rm -f $TMP/$tfile $DIR/$tfile
+}
+run_test 222 "stripes of one write are submitted in parallel"
+
+test_223() {
+	local window=$(do_facet ost1 $LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.grant_window 2>/dev/null)
+
+	[ -z "$window" ] && skip "no dynamic grant support" && return
+	$SETSTRIPE -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 oflag=sync ||
+		error "write failed"
+	do_facet ost1 $LCTL get_param \
+		obdfilter.$FSNAME-OST0000.exports.*.grant | grep -q demand ||
+		error "no per-export grant demand reported"
+
+	do_facet ost1 $LCTL set_param obdfilter.$FSNAME-OST0000.grant_window=0
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 conv=notrunc ||
+		error "write with static grant policy failed"
+	do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.grant_window=$window
+	rm -f $DIR/$tfile
+}
+run_test 223 "grant is sized after per-client write demand"
+
+test_224() {
+	local limit=16
+	local used
+	local reclaimed
+
+	$LCTL get_param -n llite.*.cache_lru > /dev/null 2>&1 ||
+		{ skip "no cached page LRU" && return; }
+	trap cleanup_101 EXIT
+	$LCTL set_param -n llite.*.max_cached_mb $limit
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=$((limit * 4)) ||
+		error "write failed"
+	dd if=$DIR/$tfile of=/dev/null bs=1M || error "read failed"
+
+	used=$($LCTL get_param -n llite.*.cache_lru |
+		awk '/^used_mb:/ { print $2; exit }')
+	reclaimed=$($LCTL get_param -n llite.*.cache_lru |
+		awk '/^reclaimed_pages:/ { print $2; exit }')
+	$LCTL get_param llite.*.cache_lru
+	# one batch of pages per OSC may be in flight above the budget
+	[ $used -le $((limit * 2)) ] ||
+		error "cache uses ${used}MB, budget is ${limit}MB"
+	[ $reclaimed -gt 0 ] || error "no pages reclaimed from the LRU"
+
+	cleanup_101
+	rm -f $DIR/$tfile
+}
+run_test 224 "cached pages are limited by max_cached_mb"
+
+test_225() {
+	local dir=$DIR/$tdir
+	local i
+
+	mkdir -p $dir/a/b $dir/c || error "mkdir failed"
+	# renames in one directory run in parallel under the parent locks
+	for i in $(seq 1 8); do
+		(touch $dir/c/f$i.tmp && mv $dir/c/f$i.tmp $dir/c/f$i) &
+	done
+	wait
+	for i in $(seq 1 8); do
+		[ -f $dir/c/f$i ] || error "$dir/c/f$i missing"
+	done
+
+	# a file moved across directories does not need the rename lock
+	mv $dir/c/f1 $dir/a/b/ || error "cross-directory file rename failed"
+	[ -f $dir/a/b/f1 ] || error "$dir/a/b/f1 missing"
+
+	# a directory moved below itself must still be refused
+	mv $dir/a $dir/a/b/ 2>/dev/null &&
+		error "directory moved into its own subdirectory"
+	mv $dir/a/b $dir/c/ || error "cross-directory dir rename failed"
+	rm -rf $dir
+}
+run_test 225 "rename lock only for directories moved across parents"
+
+test_226() {
+	local count=$(do_facet $SINGLEMDS \
+		"$LCTL get_param -n osd*.*MDT0000.oi_count" 2>/dev/null)
+	[ -z "$count" ] && skip "no oi_count on MDS" && return
+
+	# the container count is a power of two
+	[ $((count & (count - 1))) -eq 0 ] ||
+		error "oi_count $count is not a power of two"
+	local nr=$(do_facet $SINGLEMDS \
+		"ls /proc/fs/lustre/osd*/*MDT0000/oi/ | wc -l")
+	[ $nr -eq $count ] || error "$nr oi stats files for $count containers"
+
+	local before=$(do_facet $SINGLEMDS \
+		"$LCTL get_param -n osd*.*MDT0000.oi.*" |
+		awk '/^insert/ { sum += $2 } END { print sum + 0 }')
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	local after=$(do_facet $SINGLEMDS \
+		"$LCTL get_param -n osd*.*MDT0000.oi.*" |
+		awk '/^insert/ { sum += $2 } END { print sum + 0 }')
+	[ $((after - before)) -ge 100 ] ||
+		error "only $((after - before)) oi inserts for 100 creates"
+	rm -rf $DIR/$tdir
+}
+run_test 226 "object index is sharded across oi containers"
+
+test_227() {
+	local stats="osd*.*MDT0000.oi.*"
+
+	do_facet $SINGLEMDS "$LCTL get_param -n $stats" 2>/dev/null |
+		grep -q cache_miss || { skip "no oi cache stats" && return; }
+
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	# each lookup is either answered from the cache or goes to the index
+	do_facet $SINGLEMDS "$LCTL get_param -n $stats" |
+		awk '/^cache_(hit|miss)/ { n += $2 } END { exit n == 0 }' ||
+		error "oi cache was not consulted"
+	unlinkmany $DIR/$tdir/f 100 || error "unlinkmany failed"
+	rm -rf $DIR/$tdir
+}
+run_test 227 "fid to inode mappings are cached in front of the oi"
+
+test_228() {
+	local param="osc.*OST0000*.create_rate"
+
+	do_facet $SINGLEMDS "$LCTL get_param -n $param" > /dev/null 2>&1 ||
+		{ skip "no create_rate on MDS" && return; }
+
+	mkdir -p $DIR/$tdir
+	$SETSTRIPE -c -1 $DIR/$tdir || error "setstripe failed"
+	# a create storm spanning a few seconds is seen by the rate average
+	local end=$((SECONDS + 5))
+	local i=0
+	while [ $SECONDS -lt $end ]; do
+		touch $DIR/$tdir/f$i || error "create f$i failed"
+		i=$((i + 1))
+	done
+	local rate=$(do_facet $SINGLEMDS "$LCTL get_param -n $param" |
+		head -1)
+	echo "created $i files, OST0000 create_rate $rate/s"
+	[ $rate -gt 0 ] || error "create rate not tracked"
+	rm -rf $DIR/$tdir
+}
+run_test 228 "precreation follows the observed create rate"
+
+test_229() {
+	local param="mdd.*MDT0000.orphan_cleanup"
+	local pids=""
+	local destroyed
+	local i
+
+	do_facet $SINGLEMDS "$LCTL get_param -n $param" > /dev/null 2>&1 ||
+		{ skip "no orphan_cleanup on MDS" && return; }
+
+	local rate=$(do_facet $SINGLEMDS \
+		"$LCTL get_param -n ${param}_rate" | head -1)
+	do_facet $SINGLEMDS "$LCTL set_param ${param}_rate=10" ||
+		error "cannot set orphan cleanup rate"
+
+	mkdir -p $DIR/$tdir
+	# files held open across the failover and unlinked stay on the MDS
+	# as orphans; aborting recovery drops the open handles
+	for i in $(seq 1 20); do
+		multiop_bg_pause $DIR/$tdir/f$i O_c ||
+			error "multiop on f$i failed"
+		pids="$pids $!"
+	done
+	rm -f $DIR/$tdir/f* || error "unlink failed"
+	fail_abort $SINGLEMDS
+	for i in $pids; do
+		kill -USR1 $i
+		wait $i
+	done
+	ls -l $DIR/$tdir > /dev/null || error "ls after failover failed"
+	wait_update $(facet_active_host $SINGLEMDS) \
+		"$LCTL get_param -n $param | awk '/^state/ { print \$2 }'" \
+		done 60 || error "orphan cleanup did not finish"
+	do_facet $SINGLEMDS "$LCTL get_param -n $param"
+	do_facet $SINGLEMDS "$LCTL get_param -n $param" |
+		awk '/^errors/ { exit $2 != 0 }' ||
+		error "orphan cleanup reported errors"
+	destroyed=$(do_facet $SINGLEMDS "$LCTL get_param -n $param" |
+		    awk '/^destroyed/ { print $2 }')
+	[ ${destroyed:-0} -gt 0 ] || error "no orphan destroyed"
+
+	do_facet $SINGLEMDS "$LCTL set_param ${param}_rate=$rate"
+	rm -rf $DIR/$tdir
+}
+run_test 229 "orphans are cleaned up in the background after recovery"
+
+test_230() {
+	local nthreads=8
+	local count=1000
+	local i
+
+	mkdir -p $DIR/$tdir
+	# concurrent creates, unlinks and lookups in one directory share it
+	# under htree leaf locks on the MDS, the result must be consistent
+	for i in $(seq 0 $((nthreads - 1))); do
+		createmany -o $DIR/$tdir/f $((i * count)) $count > /dev/null &
+	done
+	wait
+	[ $(ls $DIR/$tdir | wc -l) -eq $((nthreads * count)) ] ||
+		error "$(ls $DIR/$tdir | wc -l) files after parallel creates"
+	for i in $(seq 0 $((nthreads - 1))); do
+		$CHECKSTAT -t file $DIR/$tdir/f$((i * count + count - 1)) ||
+			error "f$((i * count + count - 1)) missing"
+	done
+
+	for i in $(seq 0 $((nthreads - 1))); do
+		unlinkmany $DIR/$tdir/f $((i * count)) $count &
+	done
+	for i in $(seq 0 $((nthreads - 1))); do
+		ls -l $DIR/$tdir > /dev/null &
+	done
+	wait
+	[ -z "$(ls $DIR/$tdir)" ] || error "directory not empty after unlinks"
+	rmdir $DIR/$tdir || error "rmdir failed"
+}
+run_test 230 "parallel creates and unlinks in a shared directory"
+
+changelog_writes() {
+	do_facet $SINGLEMDS "$LCTL get_param -n mdd.$MDT0.lu_stats" |
+		awk '/^changelog_write/ { print $2; found = 1 }
+		     END { if (!found) print 0 }'
+}
+
+test_231() {
+	do_facet $SINGLEMDS "$LCTL get_param -n mdd.$MDT0.lu_stats" \
+		> /dev/null 2>&1 || { skip "no mdd lu_stats" && return; }
+
+	local user=$(do_facet $SINGLEMDS lctl --device $MDT0 \
+		changelog_register -n)
+	local before=$(changelog_writes)
+
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	local after=$(changelog_writes)
+	echo "changelog_write samples $before -> $after"
+	do_facet $SINGLEMDS "$LCTL get_param -n mdd.$MDT0.lu_stats" |
+		grep changelog_write
+	[ $((after - before)) -ge 100 ] ||
+		error "changelog write cost not accounted"
+
+	do_facet $SINGLEMDS lctl --device $MDT0 changelog_deregister $user
+	if do_facet $SINGLEMDS "$LCTL get_param -n mdd.$MDT0.changelog_users" |
+	    grep -q "^cl"; then
+		echo "other changelog users registered, changelog stays on"
+	else
+		before=$(changelog_writes)
+		unlinkmany $DIR/$tdir/f 100 || error "unlinkmany failed"
+		after=$(changelog_writes)
+		[ $after -eq $before ] ||
+			error "changelog written while off: $before -> $after"
+	fi
+	rm -rf $DIR/$tdir
+}
+run_test 231 "changelog write overhead is reported in lu_stats"
+
+test_232() {
+	local user=$(do_facet $SINGLEMDS lctl --device $MDT0 \
+		changelog_register -n)
+
+	mkdir -p $DIR/$tdir
+	createmany -d $DIR/$tdir/d 20 || error "createmany -d failed"
+	createmany -o $DIR/$tdir/f 100 || error "createmany -o failed"
+
+	local all=$($LFS changelog $MDT0 | grep -c MKDIR)
+	local dirs=$($LFS changelog --type=MKDIR $MDT0 | grep -c MKDIR)
+	local other=$($LFS changelog --type=MKDIR $MDT0 | grep -vc MKDIR)
+	echo "MKDIR records: $all unfiltered, $dirs filtered, $other others"
+	[ $dirs -eq $all ] || error "filtered $dirs MKDIR records != $all"
+	[ $other -eq 0 ] || error "$other records of other types sent"
+
+	# a consumer resuming from the middle sees exactly the tail
+	local last=$($LFS changelog $MDT0 | tail -1 | awk '{ print $1 }')
+	local start=$((last - 50))
+	local count=$($LFS changelog $MDT0 $start | wc -l)
+	[ $count -eq 51 ] || error "resume from $start: $count records != 51"
+	local first=$($LFS changelog $MDT0 $start | head -1 | awk '{ print $1 }')
+	[ $first -eq $start ] || error "resume from $start started at $first"
+
+	# only the changes below the subtree are sent
+	mkdir -p $DIR/$tdir/sub $DIR/$tdir.other
+	createmany -o $DIR/$tdir/sub/f 10 || error "createmany sub failed"
+	createmany -o $DIR/$tdir.other/f 10 || error "createmany other failed"
+	count=$($LFS changelog --type=CREAT --subtree=$DIR/$tdir/sub $MDT0 |
+		wc -l)
+	[ $count -eq 10 ] || error "subtree: $count CREAT records != 10"
+	count=$($LFS changelog --type=CREAT --subtree=$DIR/$tdir $MDT0 |
+		wc -l)
+	[ $count -eq 110 ] || error "tree: $count CREAT records != 110"
+
+	# only the records this user has not cleared yet are sent
+	last=$($LFS changelog $MDT0 | tail -1 | awk '{ print $1 }')
+	$LFS changelog_clear $MDT0 $user $start ||
+		error "changelog_clear $start failed"
+	count=$($LFS changelog --user=$user $MDT0 | wc -l)
+	[ $count -eq $((last - start)) ] ||
+		error "user $user: $count uncleared records != $((last - start))"
+
+	do_facet $SINGLEMDS lctl --device $MDT0 changelog_deregister $user
+	rm -rf $DIR/$tdir $DIR/$tdir.other
+}
+run_test 232 "changelog readers filter on the MDS and resume mid-log"
+
+test_233() {
+	$LCTL get_param -n debug_deferred > /dev/null 2>&1 ||
+		{ skip "no deferred debug formatting" && return; }
+
+	local old_debug="$($LCTL get_param -n debug)"
+	local old_deferred=$($LCTL get_param -n debug_deferred)
+	local pattern="Sending RPC pname:cluuid:pid:xid:nid:opc"
+	local deferred
+	local count
+
+	local start
+
+	mkdir -p $DIR/$tdir
+	$LCTL set_param debug=+rpctrace
+	for deferred in 0 1; do
+		$LCTL set_param debug_deferred=$deferred
+		$LCTL clear
+		# report the tracing cost, it is not checked
+		start=$(date +%s.%N)
+		createmany -o $DIR/$tdir/f 2000 > /dev/null ||
+			error "createmany failed"
+		unlinkmany $DIR/$tdir/f 2000 > /dev/null ||
+			error "unlinkmany failed"
+		echo "debug_deferred=$deferred: 2000 creates and unlinks in" \
+			"$(echo "$(date +%s.%N) - $start" | bc)s"
+		$LCTL clear
+		touch $DIR/$tfile.$deferred || error "touch failed"
+		rm $DIR/$tfile.$deferred || error "rm failed"
+		$LCTL dk > $TMP/$tfile.dk.$deferred
+		count=$(grep -c "$pattern" $TMP/$tfile.dk.$deferred)
+		echo "debug_deferred=$deferred: $count RPCs traced"
+		[ $count -gt 0 ] || error "no RPC trace with deferred=$deferred"
+		# every argument must have been formatted
+		grep "$pattern" $TMP/$tfile.dk.$deferred |
+			grep -Ev "opc [^:]+:[^:]+:-?[0-9]+:[0-9]+:[^:]+:[0-9]+$" &&
+			error "badly formatted RPC trace with deferred=$deferred"
+	done
+
+	$LCTL set_param debug_deferred=$old_deferred
+	$LCTL set_param debug="$old_debug"
+	rm -f $TMP/$tfile.dk.*
+	rm -rf $DIR/$tdir
+}
+run_test 233 "debug messages formatted at dump time match inline ones"
+
+test_234() {
+	$LCTL get_param -n debug_sample > /dev/null 2>&1 ||
+		{ skip "no debug sampling" && return; }
+
+	local old_debug="$($LCTL get_param -n debug)"
+	local old_sample=$($LCTL get_param -n debug_sample)
+	local pattern="Sending RPC pname:cluuid:pid:xid:nid:opc"
+	local all
+	local some
+	local i
+
+	$LCTL set_param debug=+rpctrace
+	$LCTL set_param debug=+dlmtrace
+	for i in 0 10; do
+		$LCTL set_param debug_sample=$i
+		$LCTL clear
+		createmany -o $DIR/$tfile- 100 || error "createmany failed"
+		unlinkmany $DIR/$tfile- 100 || error "unlinkmany failed"
+		some=$($LCTL dk | grep -c "$pattern")
+		echo "debug_sample=$i: $some RPCs traced"
+		[ $i -eq 0 ] && all=$some
+	done
+	$LCTL set_param debug_sample=$old_sample
+	[ $all -gt 0 ] || error "no RPC traced without sampling"
+	[ $some -lt $((all / 2)) ] ||
+		error "$some of $all RPCs traced with debug_sample=10"
+
+	# LDLM_ENQUEUE
+	$LCTL set_param debug_filter_opc=101
+	$LCTL clear
+	createmany -o $DIR/$tfile- 10 || error "createmany failed"
+	unlinkmany $DIR/$tfile- 10 || error "unlinkmany failed"
+	$LCTL dk > $TMP/$tfile.dk
+	$LCTL set_param debug_filter_opc=-1
+	$LCTL set_param debug="$old_debug"
+
+	grep -q " req@.* o101->" $TMP/$tfile.dk ||
+		error "no LDLM_ENQUEUE traced with debug_filter_opc=101"
+	grep " req@" $TMP/$tfile.dk | grep -v " o101->" &&
+		error "other opcodes traced with debug_filter_opc=101"
+	# plain RPC messages are filtered too
+	grep "$pattern" $TMP/$tfile.dk | grep -v ":101$" &&
+		error "other opcodes sent with debug_filter_opc=101"
+	# lock messages have no opcode and are kept
+	grep -q "### " $TMP/$tfile.dk ||
+		error "lock traces dropped with debug_filter_opc=101"
+	rm -f $TMP/$tfile.dk
+}
+run_test 234 "trace sampling and RPC opcode filter"
+
+test_235() {
+	local mod=$LUSTRE/../libcfs/libcfs/cfs_hash_bench.ko
+	local mode
+
+	[ -f $mod ] || { skip "no $mod" && return; }
+
+	$LCTL clear
+	insmod $mod hb_threads=4 hb_loops=100000 ||
+		error "cfs_hash benchmark failed"
+	rmmod cfs_hash_bench
+	$LCTL dk > $TMP/$tfile.dk
+	# lookup rates of every mode and thread count, for the record
+	grep "lookups/sec" $TMP/$tfile.dk
+	for mode in spin rw rcu; do
+		grep "hash_bench_$mode:" $TMP/$tfile.dk ||
+			error "no result for $mode lookups"
+		grep "hash_bench_$mode:.* 0 misses" $TMP/$tfile.dk ||
+			error "$mode lookups missed existing items"
+	done
+	rm -f $TMP/$tfile.dk
+}
+run_test 235 "cfs_hash lockless lookups find every item"
+
+test_236() {
+	local mod=$LUSTRE/../libcfs/libcfs/cfs_hash_bench.ko
+
+	[ -f $mod ] || { skip "no $mod" && return; }
+
+	$LCTL clear
+	insmod $mod hb_threads=4 hb_loops=100000 ||
+		error "cfs_hash benchmark failed"
+	rmmod cfs_hash_bench
+	$LCTL dk > $TMP/$tfile.dk
+	grep "hash_bench_rehash:.* 0 misses" $TMP/$tfile.dk ||
+		error "lookups missed items while rehashing"
+	grep "hash_bench_rehash: [1-9][0-9]* rehashes" $TMP/$tfile.dk ||
+		error "hash was not rehashed"
+	do_facet $SINGLEMDS $LCTL get_param -n mdt.*.hash_stats |
+		grep -q maxpause || error "no maxpause in hash_stats"
+	rm -f $TMP/$tfile.dk
+}
+run_test 236 "cfs_hash lookups during incremental rehash"
+
+test_237() {
+	$LCTL get_param -n wi_stats > /dev/null 2>&1 ||
+		{ skip "no workitem statistics" && return; }
+
+	local ncpt=$($LCTL get_param -n wi_stats | grep -c "^cpt")
+	local nthr=$(ps -eo comm | grep -c "^cfs_wi_sd")
+
+	$LCTL get_param -n wi_stats
+	[ $ncpt -gt 0 ] || error "no per-partition workitem scheduler"
+	$LCTL get_param -n wi_stats | grep -q "^serial" ||
+		error "no serial workitem scheduler"
+	[ $nthr -ge $ncpt ] ||
+		error "$nthr threads for $ncpt partitions"
+}
+run_test 237 "per-CPU-partition workitem schedulers"
+
+test_238() {
+	local mod=$LUSTRE/obdclass/obd_stats_bench.ko
+
+	[ -f $mod ] || { skip "no $mod" && return; }
+
+	$LCTL clear
+	insmod $mod sb_threads=4 sb_rpcs=100000 ||
+		error "stats benchmark failed"
+	rmmod obd_stats_bench
+	$LCTL dk > $TMP/$tfile.dk
+	grep "stats_bench_" $TMP/$tfile.dk
+	[ $(grep -c "stats_bench_.* ns/RPC" $TMP/$tfile.dk) -eq 4 ] ||
+		error "stats benchmark did not complete"
+	rm -f $TMP/$tfile.dk
+
+	dd if=/dev/zero of=$DIR/$tfile bs=4k count=16 || error "dd failed"
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		grep "^req_waittime.* hist " || error "no req_waittime histogram"
+	rm -f $DIR/$tfile
+}
+run_test 238 "lockless lprocfs counters and histograms"
+
+test_239() {
+	local dev=$(do_facet ost1 $LCTL dl | awk '/obdfilter/ {print $4; exit}')
+	local gen
+	local n
+
+	[ -n "$dev" ] || { skip "no obdfilter device" && return; }
+
+	do_facet ost1 $LCTL --device $dev stats_snapshot -n > $TMP/$tfile ||
+		error "stats_snapshot failed"
+	head -n 1 $TMP/$tfile
+	grep -q "^exports " $TMP/$tfile || error "no per-client stats"
+	gen=$(awk '/^snapshot_time/ {print $4}' $TMP/$tfile)
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 oflag=sync ||
+		error "dd failed"
+	do_facet ost1 $LCTL --device $dev stats_snapshot $gen > $TMP/$tfile ||
+		error "incremental stats_snapshot failed"
+	n=$(awk '/^snapshot_time/ {print $8}' $TMP/$tfile)
+	[ $n -gt 0 ] || error "no changed counters since snapshot $gen"
+
+	[ $(do_facet ost1 "$LCTL --device $dev stats_snapshot -b" |
+	    od -An -tx4 -N4 | tr -d ' ') = "0bd57a75" ] ||
+		error "bad binary snapshot"
+	rm -f $TMP/$tfile $DIR/$tfile
+}
+run_test 239 "binary stats snapshot of a target"
+
+test_240() {
+	local old=$($LCTL get_param -n jobid_var 2>/dev/null)
+	local jobid=dd.$(id -u)
+
+	[ -n "$old" ] || { skip "no jobid_var support" && return; }
+
+	do_facet ost1 $LCTL set_param -n obdfilter.*.job_stats=clear
+	$LCTL set_param jobid_var=procname_uid
+	# buffered, the pages are written by ptlrpcd
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 conv=fsync
+	local rc=$?
+	$LCTL set_param jobid_var=$old
+	[ $rc -eq 0 ] || error "dd failed"
+
+	do_facet ost1 $LCTL get_param -n obdfilter.*.job_stats |
+		grep -A 10 "job_id: *$jobid\$" | grep -q "write_bytes:" ||
+		error "no write_bytes of job $jobid on ost1"
+
+	do_facet ost1 $LCTL set_param -n obdfilter.*.job_stats=clear
+	do_facet ost1 $LCTL get_param -n obdfilter.*.job_stats |
+		grep -q "job_id: *$jobid\$" && error "job $jobid not cleared"
+	rm -f $DIR/$tfile
+}
+run_test 240 "per-job stats of a target"
+
+test_241() {
+	local svc=mds.MDS.mdt
+	local old=$(do_facet $SINGLEMDS $LCTL get_param -n $svc.req_slowest_max)
+	local n
+
+	do_facet $SINGLEMDS $LCTL set_param -n $svc.req_stage_stats=clear
+	do_facet $SINGLEMDS $LCTL set_param -n $svc.req_slowest_max=4
+	mkdir -p $DIR/$tdir
+	for i in $(seq 10); do
+		mcreate $DIR/$tdir/f$i || error "mcreate $i failed"
+	done
+
+	do_facet $SINGLEMDS $LCTL get_param -n $svc.req_stage_stats |
+		grep -q "^mds_reint  *txn " ||
+		error "no transaction stage of mds_reint"
+	do_facet $SINGLEMDS $LCTL get_param -n $svc.req_stage_stats |
+		grep -q "^mds_reint  *total " ||
+		error "no total stage of mds_reint"
+
+	n=$(do_facet $SINGLEMDS $LCTL get_param -n $svc.req_slowest | wc -l)
+	do_facet $SINGLEMDS $LCTL set_param -n $svc.req_slowest_max=$old
+	[ $n -eq 4 ] || error "$n slowest requests, expected 4"
+	rm -rf $DIR/$tdir
+}
+run_test 241 "per-stage latency of MDS requests"
+
+test_242() {
+	local old=$(do_facet $SINGLEMDS $LCTL get_param -n mdt.*.site_cache |
+		    awk '/^cache_max:/ { print $2; exit }')
+	local max=512
+	local lru
+
+	[ -n "$old" ] || { skip "no site_cache support" && return; }
+
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.*.site_cache=$max
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 2000 || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	sleep 2
+
+	lru=$(do_facet $SINGLEMDS $LCTL get_param -n mdt.*.site_cache |
+	      awk '/^cache_lru:/ { print $2; exit }')
+	do_facet $SINGLEMDS $LCTL get_param -n mdt.*.site_cache
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.*.site_cache=$old
+	# each hash bucket keeps its share of the limit, rounded up
+	[ $lru -le $((max * 2)) ] ||
+		error "$lru objects cached, limit $max"
+	rm -rf $DIR/$tdir
+}
+run_test 242 "object cache of the MDT is bounded"
+
+test_243() {
+	local dir=$DIR/$tdir
+	local deadline=$((SECONDS + 300))
+	local i
+
+	mkdir -p $dir/c $dir/d1 $dir/d2 || error "mkdir failed"
+	touch $dir/c/x $dir/d1/x || error "touch failed"
+	# each pair takes the same two parent and child locks in opposite
+	# name order; a failed rename only means the other one won the race
+	(for i in $(seq 1 500); do mv $dir/c/x $dir/c/y 2>/dev/null; done) &
+	(for i in $(seq 1 500); do mv $dir/c/y $dir/c/x 2>/dev/null; done) &
+	(for i in $(seq 1 500); do mv $dir/d1/x $dir/d2/y 2>/dev/null; done) &
+	(for i in $(seq 1 500); do mv $dir/d2/y $dir/d1/x 2>/dev/null; done) &
+	while [ -n "$(jobs -rp)" ]; do
+		[ $SECONDS -lt $deadline ] || error "swap renames hung"
+		sleep 1
+	done
+	wait
+
+	[ $(ls $dir/c | wc -l) -eq 1 ] || error "$(ls $dir/c) left in c"
+	[ $(ls $dir/d1 $dir/d2 | grep -c '^[xy]$') -eq 1 ] ||
+		error "$(ls $dir/d1 $dir/d2) left in d1, d2"
+	rm -rf $dir
+}
+run_test 243 "concurrent swap renames do not deadlock"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
@@ -311,6 +311,10 @@ command_t cmdlist[] = {
         {"getobjversion", jt_get_obj_version, 0,
          "get the version of an object on servers\n"
          "usage: getobjversion <fid>"},
+        {"stats_snapshot", jt_obd_stats_snapshot, 0,
+         "dump all stats counters of the current device in one snapshot,\n"
+         "only those changed since snapshot <gen> if given\n"
+         "usage: stats_snapshot [-n|--names] [-b|--binary] [gen]"},
 
         {"==== obsolete (DANGEROUS) ====", jt_noop, 0, "obsolete (DANGEROUS)"},
         /* some test scripts still use these */
@@ -228,7 +228,12 @@ command_t cmdlist[] = {
          "usage: ls [OPTION]... [FILE]..."},
         {"changelog", lfs_changelog, 0,
          "Show the metadata changes on an MDT."
-         "\nusage: changelog <mdtname> [startrec [endrec]]"},
+         "\nusage: changelog [--type|-t TYPE[,TYPE...]] "
+         "[--subtree|-s PATH|FID] [--user|-u ID] <mdtname> "
+         "[startrec [endrec]]"
+         "\n\tTYPE: record type to show, e.g. CREAT, MKDIR, UNLNK"
+         "\n\tPATH|FID: only show changes below this directory"
+         "\n\tID: only show records not yet cleared by this changelog user"},
         {"changelog_clear", lfs_changelog_clear, 0,
          "Indicate that old changelog records up to <endrec> are no longer of "
          "interest to consumer <id>, allowing the system to free up space.\n"
@@ -2304,6 +2309,29 @@ static int lfs_ls(int argc, char **argv)
         return(llapi_ls(argc, argv));
 }
 
+/* Parse a comma separated list of changelog record type names */
+static int changelog_str2mask(char *str, __u32 *mask)
+{
+        char *name;
+        int i;
+
+        *mask = 0;
+        for (name = strtok(str, ","); name != NULL;
+             name = strtok(NULL, ",")) {
+                for (i = 0; i < CL_LAST; i++)
+                        if (strcasecmp(name, changelog_type2str(i)) == 0)
+                                break;
+                if (i == CL_LAST) {
+                        fprintf(stderr, "error: unknown changelog type "
+                                "'%s'\n", name);
+                        return -EINVAL;
+                }
+                *mask |= 1 << i;
+        }
+
+        return *mask ? 0 : -EINVAL;
+}
+
 static int lfs_changelog(int argc, char **argv)
 {
         void *changelog_priv;
@@ -2312,10 +2340,14 @@ static int lfs_changelog(int argc, char **argv)
         char *mdd;
         struct option long_opts[] = {
                 {"follow", no_argument, 0, 'f'},
+                {"subtree", required_argument, 0, 's'},
+                {"type", required_argument, 0, 't'},
+                {"user", required_argument, 0, 'u'},
                 {0, 0, 0, 0}
         };
-        char short_opts[] = "f";
-        int rc, follow = 0;
+        char short_opts[] = "fs:t:u:";
+        struct changelog_filter filter = { 0 };
+        int rc, follow = 0, filtered = 0;
 
         optind = 0;
         while ((rc = getopt_long(argc, argv, short_opts,
@@ -2324,6 +2356,37 @@ static int lfs_changelog(int argc, char **argv)
                 case 'f':
                         follow++;
                         break;
+                case 's':
+                        if (sscanf(optarg, SFID, RFID(&filter.clf_fid)) != 3) {
+                                rc = llapi_path2fid(optarg, &filter.clf_fid);
+                                if (rc) {
+                                        fprintf(stderr, "error: can't get fid "
+                                                "for '%s': %s\n", optarg,
+                                                strerror(-rc));
+                                        return CMD_HELP;
+                                }
+                        }
+                        filtered = 1;
+                        break;
+                case 't':
+                        if (changelog_str2mask(optarg, &filter.clf_mask))
+                                return CMD_HELP;
+                        filtered = 1;
+                        break;
+                case 'u':
+                        if (strncmp(optarg, CHANGELOG_USER_PREFIX,
+                                    strlen(CHANGELOG_USER_PREFIX)) == 0)
+                                filter.clf_user = strtoul(optarg +
+                                        strlen(CHANGELOG_USER_PREFIX), NULL,
+                                        10);
+                        if (filter.clf_user == 0) {
+                                fprintf(stderr, "error: expecting id of the "
+                                        "form '"CHANGELOG_USER_PREFIX"<num>'; "
+                                        "got '%s'\n", optarg);
+                                return CMD_HELP;
+                        }
+                        filtered = 1;
+                        break;
                 case '?':
                         return CMD_HELP;
                 default:
@@ -2341,10 +2404,16 @@ static int lfs_changelog(int argc, char **argv)
         if (argc > optind)
                 endrec = strtoll(argv[optind++], NULL, 10);
 
-        rc = llapi_changelog_start(&changelog_priv,
-                                   CHANGELOG_FLAG_BLOCK |
-                                   (follow ? CHANGELOG_FLAG_FOLLOW : 0),
-                                   mdd, startrec);
+        if (filtered)
+                rc = llapi_changelog_start_filter(&changelog_priv,
+                                        CHANGELOG_FLAG_BLOCK |
+                                        (follow ? CHANGELOG_FLAG_FOLLOW : 0),
+                                        mdd, startrec, &filter);
+        else
+                rc = llapi_changelog_start(&changelog_priv,
+                                           CHANGELOG_FLAG_BLOCK |
+                                           (follow ? CHANGELOG_FLAG_FOLLOW : 0),
+                                           mdd, startrec);
         if (rc < 0) {
                 fprintf(stderr, "Can't start changelog: %s\n",
                         strerror(errno = -rc));
@@ -3045,35 +3045,42 @@ static int root_ioctl(const char *mdtname, int opc, void *data, int *mdtidxp,
 /****** Changelog API ********/
 
 static int changelog_ioctl(const char *mdtname, int opc, int id,
-                           long long recno, int flags)
+                           long long recno, int flags,
+                           const struct changelog_filter *filter)
 {
-        struct ioc_changelog data;
+        struct ioc_changelog_filter data;
         int *idx;
 
-        data.icc_id = id;
-        data.icc_recno = recno;
-        data.icc_flags = flags;
-        idx = (int *)(&data.icc_mdtindex);
+        memset(&data, 0, sizeof(data));
+        data.icf_icc.icc_id = id;
+        data.icf_icc.icc_recno = recno;
+        data.icf_icc.icc_flags = flags;
+        idx = (int *)(&data.icf_icc.icc_mdtindex);
+        if (filter != NULL) {
+                /* older kernels do not know this ioctl and refuse it */
+                opc = OBD_IOC_CHANGELOG_FILTER;
+                data.icf_size = sizeof(data);
+                data.icf_filter = *filter;
+        }
 
         return root_ioctl(mdtname, opc, &data, idx, WANT_ERROR);
 }
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
+/* The kernel queues several records per pipe write; read them in chunks */
+#define CHANGELOG_BUF_SIZE (64 * 1024)
 struct changelog_private {
         int magic;
         int flags;
         lustre_kernelcomm kuc;
+        char *buf;       /* data read from the pipe */
+        int buf_len;     /* valid bytes in buf */
+        int buf_pos;     /* start of the next message in buf */
 };
 
-/** Start reading from a changelog
- * @param priv Opaque private control structure
- * @param flags Start flags (e.g. CHANGELOG_FLAG_BLOCK)
- * @param device Report changes recorded on this MDT
- * @param startrec Report changes beginning with this record number
- * (just call llapi_changelog_fini when done; don't need an endrec)
- */
-int llapi_changelog_start(void **priv, int flags, const char *device,
-                          long long startrec)
+static int changelog_start(void **priv, int flags, const char *device,
+                           long long startrec,
+                           const struct changelog_filter *filter)
 {
         struct changelog_private *cp;
         int rc;
@@ -3086,6 +3093,12 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
         cp->magic = CHANGELOG_PRIV_MAGIC;
         cp->flags = flags;
 
+        cp->buf = malloc(CHANGELOG_BUF_SIZE);
+        if (cp->buf == NULL) {
+                rc = -ENOMEM;
+                goto out_free;
+        }
+
         /* Set up the receiver */
         rc = libcfs_ukuc_start(&cp->kuc, 0 /* no group registration */);
         if (rc < 0)
@@ -3095,7 +3108,7 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
 
         /* Tell the kernel to start sending */
         rc = changelog_ioctl(device, OBD_IOC_CHANGELOG_SEND, cp->kuc.lk_wfd,
-                             startrec, flags);
+                             startrec, flags, filter);
         /* Only the kernel reference keeps the write side open */
         close(cp->kuc.lk_wfd);
         cp->kuc.lk_wfd = 0;
@@ -3108,10 +3121,36 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
         return 0;
 
 out_free:
+        free(cp->buf);
         free(cp);
         return rc;
 }
 
+/** Start reading from a changelog
+ * @param priv Opaque private control structure
+ * @param flags Start flags (e.g. CHANGELOG_FLAG_BLOCK)
+ * @param device Report changes recorded on this MDT
+ * @param startrec Report changes beginning with this record number
+ * (just call llapi_changelog_fini when done; don't need an endrec)
+ */
+int llapi_changelog_start(void **priv, int flags, const char *device,
+                          long long startrec)
+{
+        return changelog_start(priv, flags, device, startrec, NULL);
+}
+
+/** Start reading from a changelog, only getting the records that match
+ * \a filter.  The MDS does the filtering, so other records are not sent.
+ * @param filter Record types, changelog user and directory tree to report
+ * (other parameters as for llapi_changelog_start)
+ */
+int llapi_changelog_start_filter(void **priv, int flags, const char *device,
+                                 long long startrec,
+                                 const struct changelog_filter *filter)
+{
+        return changelog_start(priv, flags, device, startrec, filter);
+}
+
 /** Finish reading from a changelog */
 int llapi_changelog_fini(void **priv)
 {
@@ -3121,11 +3160,62 @@ int llapi_changelog_fini(void **priv)
                 return -EINVAL;
 
         libcfs_ukuc_stop(&cp->kuc);
+        free(cp->buf);
         free(cp);
         *priv = NULL;
         return 0;
 }
 
+/** Get the next complete message from the pipe.
+ * Messages are returned from the local buffer, which is refilled with a
+ * single read of everything the kernel has queued so far.
+ * @return 0 and the message in \a kuch, or <0 error code
+ */
+static int changelog_msg_get(struct changelog_private *cp,
+                             struct kuc_hdr **kuch)
+{
+        struct kuc_hdr hdr;
+        int avail, rc;
+
+        while (1) {
+                avail = cp->buf_len - cp->buf_pos;
+                if (avail >= sizeof(hdr)) {
+                        memcpy(&hdr, cp->buf + cp->buf_pos, sizeof(hdr));
+                        if (hdr.kuc_magic != KUC_MAGIC) {
+                                llapi_err(LLAPI_MSG_ERROR | LLAPI_MSG_NO_ERRNO,
+                                          "bad message magic %x != %x\n",
+                                          hdr.kuc_magic, KUC_MAGIC);
+                                return -EPROTO;
+                        }
+                        if (hdr.kuc_msglen < sizeof(hdr) ||
+                            hdr.kuc_msglen > CR_MAXSIZE + sizeof(hdr))
+                                return -EMSGSIZE;
+                        if (avail >= hdr.kuc_msglen) {
+                                *kuch = malloc(hdr.kuc_msglen);
+                                if (*kuch == NULL)
+                                        return -ENOMEM;
+                                memcpy(*kuch, cp->buf + cp->buf_pos,
+                                       hdr.kuc_msglen);
+                                cp->buf_pos += hdr.kuc_msglen;
+                                return 0;
+                        }
+                }
+
+                /* Keep the partial message and read more behind it */
+                memmove(cp->buf, cp->buf + cp->buf_pos, avail);
+                cp->buf_len = avail;
+                cp->buf_pos = 0;
+                rc = read(cp->kuc.lk_rfd, cp->buf + avail,
+                          CHANGELOG_BUF_SIZE - avail);
+                if (rc < 0)
+                        return -errno;
+                if (rc == 0)
+                        /* writer went away without sending EOF */
+                        return avail ? -EPROTO : -EPIPE;
+                cp->buf_len += rc;
+        }
+}
+
 /** Read the next changelog entry
  * @param priv Opaque private control structure
  * @param rech Changelog record handle; record will be allocated here
@@ -3136,21 +3226,16 @@ int llapi_changelog_fini(void **priv)
 int llapi_changelog_recv(void *priv, struct changelog_rec **rech)
 {
         struct changelog_private *cp = (struct changelog_private *)priv;
-        struct kuc_hdr *kuch;
+        struct kuc_hdr *kuch = NULL;
         int rc = 0;
 
         if (!cp || (cp->magic != CHANGELOG_PRIV_MAGIC))
                 return -EINVAL;
         if (rech == NULL)
                 return -EINVAL;
-        kuch = malloc(CR_MAXSIZE + sizeof(*kuch));
-        if (kuch == NULL)
-                return -ENOMEM;
 
 repeat:
-        rc = libcfs_ukuc_msg_get(&cp->kuc, (char *)kuch,
-                                 CR_MAXSIZE + sizeof(*kuch),
-                                 KUC_TRANSPORT_CHANGELOG);
+        rc = changelog_msg_get(cp, &kuch);
         if (rc < 0)
                 goto out_free;
 
@@ -3167,6 +3252,8 @@ repeat:
         if (kuch->kuc_msgtype == CL_EOF) {
                 if (cp->flags & CHANGELOG_FLAG_FOLLOW) {
                         /* Ignore EOFs */
+                        free(kuch);
+                        kuch = NULL;
                         goto repeat;
                 } else {
                         rc = 1;
@@ -3222,7 +3309,8 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
                 return -EINVAL;
         }
 
-        return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0);
+        return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0,
+                               NULL);
 }
 
 int llapi_fid2path(const char *device, const char *fidstr, char *buf,
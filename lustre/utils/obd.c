@@ -3087,6 +3087,152 @@ int jt_get_obj_version(int argc, char **argv)
         return 0;
 }
 
+static const char *stats_set_names[] = {
+        [OBD_STATS_SET_OBD]             = "stats",
+        [OBD_STATS_SET_MD]              = "md_stats",
+        [OBD_STATS_SET_SVC]             = "svc_stats",
+        [OBD_STATS_SET_EXP]             = "exports",
+        [OBD_STATS_SET_EXP_LDLM]        = "exports_ldlm",
+};
+
+static void stats_snapshot_print(struct obd_stats_hdr *hdr)
+{
+        struct obd_stats_set  *set;
+        struct obd_stats_name *names;
+        struct obd_stats_rec  *rec;
+        char                  *ptr = (char *)(hdr + 1);
+        const char            *type;
+        int                    i, j;
+
+        printf("snapshot_time "LPU64".%06u gen %u sets %u counters %u\n",
+               hdr->osh_time / 1000000, (unsigned)(hdr->osh_time % 1000000),
+               hdr->osh_gen, hdr->osh_nsets, hdr->osh_nrecs);
+
+        for (i = 0; i < hdr->osh_nsets; i++) {
+                set = (struct obd_stats_set *)ptr;
+                names = (struct obd_stats_name *)(set + 1);
+                rec = (struct obd_stats_rec *)(names + set->oss_nnames);
+                ptr = (char *)(rec + set->oss_nrecs);
+
+                type = set->oss_type <= OBD_STATS_SET_EXP_LDLM ?
+                       stats_set_names[set->oss_type] : "unknown";
+                if (set->oss_type == OBD_STATS_SET_EXP ||
+                    set->oss_type == OBD_STATS_SET_EXP_LDLM)
+                        printf("%s %s\n", type, set->oss_name);
+                else
+                        printf("%s\n", type);
+
+                for (j = 0; j < set->oss_nrecs; j++, rec++) {
+                        if (set->oss_nnames > rec->osr_idx)
+                                printf("  %-25s", names[rec->osr_idx].osn_name);
+                        else
+                                printf("  %-25u", rec->osr_idx);
+                        printf(" "LPU64" samples", rec->osr_count);
+                        if (set->oss_nnames > rec->osr_idx)
+                                printf(" [%s]", names[rec->osr_idx].osn_units);
+                        if (rec->osr_config & LPROCFS_CNTR_AVGMINMAX)
+                                printf(" "LPD64" "LPD64" "LPD64,
+                                       rec->osr_min, rec->osr_max,
+                                       rec->osr_sum);
+                        if (rec->osr_config & LPROCFS_CNTR_STDDEV)
+                                printf(" "LPD64, rec->osr_sumsquare);
+                        printf("\n");
+                }
+        }
+}
+
+int jt_obd_stats_snapshot(int argc, char **argv)
+{
+        struct obd_ioctl_data  data;
+        struct obd_stats_hdr  *hdr;
+        char                   rawbuf[MAX_IOC_BUFLEN], *buf = rawbuf;
+        char                  *end;
+        __u32                  size = 1 << 20;
+        __u32                  since = 0;
+        int                    binary = 0;
+        int                    flags = 0;
+        int                    tries = 0;
+        int                    rc;
+        int                    i;
+
+        for (i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-b") == 0 ||
+                    strcmp(argv[i], "--binary") == 0) {
+                        binary = 1;
+                } else if (strcmp(argv[i], "-n") == 0 ||
+                           strcmp(argv[i], "--names") == 0) {
+                        flags |= OBD_STATS_FL_NAMES;
+                } else {
+                        since = strtoul(argv[i], &end, 0);
+                        if (*end != '\0')
+                                return CMD_HELP;
+                }
+        }
+
+        hdr = NULL;
+        do {
+                /* grow the buffer to the size reported by a short read */
+                if (hdr != NULL)
+                        size = hdr->osh_len;
+                free(hdr);
+                hdr = malloc(size);
+                if (hdr == NULL) {
+                        fprintf(stderr, "error: %s: no memory for %u bytes\n",
+                                jt_cmdname(argv[0]), size);
+                        return -ENOMEM;
+                }
+
+                memset(&data, 0, sizeof(data));
+                data.ioc_dev = cur_device;
+                data.ioc_count = since;
+                data.ioc_type = flags;
+                data.ioc_pbuf1 = (char *)hdr;
+                data.ioc_plen1 = size;
+
+                memset(buf, 0, sizeof(rawbuf));
+                rc = obd_ioctl_pack(&data, &buf, sizeof(rawbuf));
+                if (rc) {
+                        fprintf(stderr, "error: %s: invalid ioctl\n",
+                                jt_cmdname(argv[0]));
+                        goto out;
+                }
+
+                rc = l2_ioctl(OBD_DEV_ID, OBD_IOC_STATS_SNAPSHOT, buf);
+                if (rc < 0) {
+                        rc = -errno;
+                        fprintf(stderr, "error: %s: %s\n",
+                                jt_cmdname(argv[0]), strerror(-rc));
+                        goto out;
+                }
+        } while ((hdr->osh_flags & OBD_STATS_FL_TRUNC) && ++tries < 3);
+
+        if (hdr->osh_flags & OBD_STATS_FL_TRUNC) {
+                fprintf(stderr, "error: %s: snapshot of %u bytes too big\n",
+                        jt_cmdname(argv[0]), hdr->osh_len);
+                rc = -EOVERFLOW;
+                goto out;
+        }
+
+        if (hdr->osh_magic != OBD_STATS_MAGIC ||
+            hdr->osh_version != OBD_STATS_VERSION) {
+                fprintf(stderr, "error: %s: unknown snapshot %#x/%u\n",
+                        jt_cmdname(argv[0]), hdr->osh_magic,
+                        hdr->osh_version);
+                rc = -EPROTO;
+                goto out;
+        }
+
+        if (binary) {
+                if (fwrite(hdr, hdr->osh_len, 1, stdout) != 1)
+                        rc = -errno;
+        } else {
+                stats_snapshot_print(hdr);
+        }
+out:
+        free(hdr);
+        return rc;
+}
+
 void  llapi_ping_target(char *obd_type, char *obd_name,
                         char *obd_uuid, void *args)
 {
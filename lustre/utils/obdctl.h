@@ -82,6 +82,7 @@ int jt_obd_mdc_lookup(int argc, char **argv);
 int jt_get_version(int argc, char **argv);
 int jt_cfg_dump_log(int argc, char **argv);
 int jt_get_obj_version(int argc, char **argv);
+int jt_obd_stats_snapshot(int argc, char **argv);
 
 int jt_llog_catlist(int argc, char **argv);
 int jt_llog_info(int argc, char **argv);
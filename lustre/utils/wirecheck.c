@@ -173,6 +173,8 @@ check_ptlrpc_body(void)
         CHECK_MEMBER(ptlrpc_body, pb_limit);
         CHECK_CVALUE(PTLRPC_NUM_VERSIONS);
         CHECK_MEMBER(ptlrpc_body, pb_pre_versions[PTLRPC_NUM_VERSIONS]);
+        CHECK_CVALUE(JOBSTATS_JOBID_SIZE);
+        CHECK_MEMBER(ptlrpc_body, pb_jobid);
 }
 
 static void check_obd_connect_data(void)
@@ -1076,6 +1078,16 @@ check_llogd_body(void)
         CHECK_CVALUE(LLOG_ORIGIN_HANDLE_DESTROY);
 }
 
+static void
+check_changelog_filter(void)
+{
+        BLANK_LINE();
+        CHECK_STRUCT(changelog_filter);
+        CHECK_MEMBER(changelog_filter, clf_mask);
+        CHECK_MEMBER(changelog_filter, clf_user);
+        CHECK_MEMBER(changelog_filter, clf_fid);
+}
+
 static void
 check_llogd_conn_body(void)
 {
@@ -1513,6 +1525,7 @@ main(int argc, char **argv)
         check_llog_log_hdr();
         check_llog_cookie();
         check_llogd_body();
+        check_changelog_filter();
         check_llogd_conn_body();
         check_qunit_data();
         check_quota_adjust_qunit();
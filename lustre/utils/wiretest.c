@@ -405,6 +405,11 @@ void lustre_assert_wire_constants(void)
                  (long long)(int)offsetof(struct ptlrpc_body, pb_pre_versions[4]));
         LASSERTF((int)sizeof(((struct ptlrpc_body *)0)->pb_pre_versions[4]) == 8, " found %lld\n",
                  (long long)(int)sizeof(((struct ptlrpc_body *)0)->pb_pre_versions[4]));
+        CLASSERT(JOBSTATS_JOBID_SIZE == 32);
+        LASSERTF((int)offsetof(struct ptlrpc_body, pb_jobid) == 120, " found %lld\n",
+                 (long long)(int)offsetof(struct ptlrpc_body, pb_jobid));
+        LASSERTF((int)sizeof(((struct ptlrpc_body *)0)->pb_jobid) == 32, " found %lld\n",
+                 (long long)(int)sizeof(((struct ptlrpc_body *)0)->pb_jobid));
 
         /* Checks for struct obd_connect_data */
         LASSERTF((int)sizeof(struct obd_connect_data) == 72, " found %lld\n",
@@ -2385,6 +2390,22 @@ void lustre_assert_wire_constants(void)
         CLASSERT(LLOG_ORIGIN_HANDLE_PREV_BLOCK == 508);
         CLASSERT(LLOG_ORIGIN_HANDLE_DESTROY == 509);
 
+        /* Checks for struct changelog_filter */
+        LASSERTF((int)sizeof(struct changelog_filter) == 24, " found %lld\n",
+                 (long long)(int)sizeof(struct changelog_filter));
+        LASSERTF((int)offsetof(struct changelog_filter, clf_mask) == 0, " found %lld\n",
+                 (long long)(int)offsetof(struct changelog_filter, clf_mask));
+        LASSERTF((int)sizeof(((struct changelog_filter *)0)->clf_mask) == 4, " found %lld\n",
+                 (long long)(int)sizeof(((struct changelog_filter *)0)->clf_mask));
+        LASSERTF((int)offsetof(struct changelog_filter, clf_user) == 4, " found %lld\n",
+                 (long long)(int)offsetof(struct changelog_filter, clf_user));
+        LASSERTF((int)sizeof(((struct changelog_filter *)0)->clf_user) == 4, " found %lld\n",
+                 (long long)(int)sizeof(((struct changelog_filter *)0)->clf_user));
+        LASSERTF((int)offsetof(struct changelog_filter, clf_fid) == 8, " found %lld\n",
+                 (long long)(int)offsetof(struct changelog_filter, clf_fid));
+        LASSERTF((int)sizeof(((struct changelog_filter *)0)->clf_fid) == 16, " found %lld\n",
+                 (long long)(int)sizeof(((struct changelog_filter *)0)->clf_fid));
+
         /* Checks for struct llogd_conn_body */
         LASSERTF((int)sizeof(struct llogd_conn_body) == 40, " found %lld\n",
                  (long long)(int)sizeof(struct llogd_conn_body));